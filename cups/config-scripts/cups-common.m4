@@ -208,6 +208,10 @@ AC_TRY_COMPILE([#include <sys/stat.h>],[struct stat t;
 dnl See if we have the removefile(3) function for securely removing files
 AC_CHECK_FUNCS(removefile)
 
+dnl See if we have the Linux sendfile(2) function for sending files
+AC_CHECK_HEADER(sys/sendfile.h,AC_DEFINE(HAVE_SYS_SENDFILE_H))
+AC_CHECK_FUNCS(sendfile)
+
 dnl See if we have libusb...
 AC_ARG_ENABLE(libusb, [  --enable-libusb         use libusb for USB printing])
 
@@ -35,6 +35,11 @@ struct _cups_array_s			/**** CUPS array structure ****/
   * sorted pointers.  We leave the array type private/opaque so that we
   * can change the underlying implementation without affecting the users
   * of this API.
+  *
+  * The elements can start anywhere in the allocated storage so that
+  * elements can be added or removed at either end without moving the
+  * rest of the array; elements in the middle are moved towards the
+  * nearest end.
   */
 
   int			num_elements,	/* Number of array elements */
@@ -45,7 +50,8 @@ struct _cups_array_s			/**** CUPS array structure ****/
 			num_saved,	/* Number of saved elements */
 			saved[_CUPS_MAXSAVE];
 					/* Saved elements */
-  void			**elements;	/* Array elements */
+  void			**elements,	/* Array elements */
+			**storage;	/* Allocated storage for elements */
   cups_array_func_t	compare;	/* Element comparison function */
   void			*data;		/* User data passed to compare */
   cups_ahash_func_t	hashfunc;	/* Hash function */
@@ -233,6 +239,7 @@ cupsArrayClear(cups_array_t *a)		/* I - Array */
   */
 
   a->num_elements = 0;
+  a->elements     = a->storage;
   a->current      = -1;
   a->insert       = -1;
   a->unique       = 1;
@@ -332,7 +339,7 @@ cupsArrayDelete(cups_array_t *a)	/* I - Array */
   */
 
   if (a->alloc_elements)
-    free(a->elements);
+    free(a->storage);
 
   if (a->hashsize)
     free(a->hash);
@@ -383,7 +390,7 @@ cupsArrayDup(cups_array_t *a)		/* I - Array */
     * Allocate memory for the elements...
     */
 
-    da->elements = malloc((size_t)a->num_elements * sizeof(void *));
+    da->elements = da->storage = malloc((size_t)a->num_elements * sizeof(void *));
     if (!da->elements)
     {
       free(da);
@@ -910,9 +917,32 @@ cupsArrayRemove(cups_array_t *a,	/* I - Array */
   if (a->freefunc)
     (a->freefunc)(a->elements[current], a->data);
 
-  if (current < a->num_elements)
+  if (!a->num_elements)
+  {
+   /*
+    * Start over at the beginning of the storage...
+    */
+
+    a->elements = a->storage;
+  }
+  else if (current < (a->num_elements / 2))
+  {
+   /*
+    * Shift earlier elements to the right...
+    */
+
+    memmove(a->elements + 1, a->elements, (size_t)current * sizeof(void *));
+    a->elements ++;
+  }
+  else if (current < a->num_elements)
+  {
+   /*
+    * Shift later elements to the left...
+    */
+
     memmove(a->elements + current, a->elements + current + 1,
             (size_t)(a->num_elements - current) * sizeof(void *));
+  }
 
   if (current <= a->current)
     a->current --;
@@ -1014,7 +1044,8 @@ cups_array_add(cups_array_t *a,		/* I - Array */
 	       int          insert)	/* I - 1 = insert, 0 = append */
 {
   int		i,			/* Looping var */
-		current;		/* Current element */
+		current,		/* Current element */
+		head;			/* Unused elements before the first */
   int		diff;			/* Comparison with current element */
 
 
@@ -1024,7 +1055,23 @@ cups_array_add(cups_array_t *a,		/* I - Array */
   * Verify we have room for the new element...
   */
 
-  if (a->num_elements >= a->alloc_elements)
+  head = (int)(a->elements - a->storage);
+
+  if (head > 0 && head >= (a->num_elements / 4) &&
+      (head + a->num_elements) >= a->alloc_elements)
+  {
+   /*
+    * Move the elements back to the start of the storage rather than growing
+    * the storage...
+    */
+
+    memmove(a->storage, a->elements, (size_t)a->num_elements * sizeof(void *));
+
+    a->elements = a->storage;
+    head        = 0;
+  }
+
+  if ((head + a->num_elements) >= a->alloc_elements)
   {
    /*
     * Allocate additional elements; start with 16 elements, then
@@ -1048,7 +1095,7 @@ cups_array_add(cups_array_t *a,		/* I - Array */
       else
         count = a->alloc_elements + 1024;
 
-      temp = realloc(a->elements, (size_t)count * sizeof(void *));
+      temp = realloc(a->storage, (size_t)count * sizeof(void *));
     }
 
     DEBUG_printf(("9cups_array_add: count=" CUPS_LLFMT, CUPS_LLCAST count));
@@ -1060,7 +1107,8 @@ cups_array_add(cups_array_t *a,		/* I - Array */
     }
 
     a->alloc_elements = count;
-    a->elements       = temp;
+    a->storage        = temp;
+    a->elements       = temp + head;
   }
 
  /*
@@ -1136,12 +1184,24 @@ cups_array_add(cups_array_t *a,		/* I - Array */
 
   if (current < a->num_elements)
   {
-   /*
-    * Shift other elements to the right...
-    */
+    if (head > 0 && current < (a->num_elements / 2))
+    {
+     /*
+      * Shift earlier elements to the left...
+      */
 
-    memmove(a->elements + current + 1, a->elements + current,
-            (size_t)(a->num_elements - current) * sizeof(void *));
+      a->elements --;
+      memmove(a->elements, a->elements + 1, (size_t)current * sizeof(void *));
+    }
+    else
+    {
+     /*
+      * Shift later elements to the right...
+      */
+
+      memmove(a->elements + current + 1, a->elements + current,
+	      (size_t)(a->num_elements - current) * sizeof(void *));
+    }
 
     if (a->current >= current)
       a->current ++;
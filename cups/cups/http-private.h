@@ -117,6 +117,7 @@ extern "C" {
  */
 
 #  define _HTTP_MAX_SBUFFER	65536	/* Size of (de)compression buffer */
+#  define _HTTP_MAX_BUFSIZE	1048576	/* Max size of read/write buffers */
 #  define _HTTP_RESOLVE_DEFAULT	0	/* Just resolve with default options */
 #  define _HTTP_RESOLVE_STDERR	1	/* Log resolve progress to stderr */
 #  define _HTTP_RESOLVE_FQDN	2	/* Resolve to a FQDN */
@@ -227,8 +228,8 @@ struct _http_s				/**** HTTP connection structure ****/
   http_encoding_t	data_encoding;	/* Chunked or not */
   int			_data_remaining;/* Number of bytes left (deprecated) */
   int			used;		/* Number of bytes used in buffer */
-  char			buffer[HTTP_MAX_BUFFER];
-					/* Buffer for incoming data */
+  char			_buffer[HTTP_MAX_BUFFER];
+					/* Default buffer for incoming data */
   int			_auth_type;	/* Authentication in use (deprecated) */
   unsigned char		_md5_state[88];	/* MD5 state (deprecated) */
   char			nonce[HTTP_MAX_VALUE];
@@ -253,8 +254,8 @@ struct _http_s				/**** HTTP connection structure ****/
   off_t			data_remaining;	/* Number of bytes left */
   http_addr_t		*hostaddr;	/* Current host address and port */
   http_addrlist_t	*addrlist;	/* List of valid addresses */
-  char			wbuffer[HTTP_MAX_BUFFER];
-					/* Buffer for outgoing data */
+  char			_wbuffer[HTTP_MAX_BUFFER];
+					/* Default buffer for outgoing data */
   int			wused;		/* Write buffer bytes used */
 
   /**** New in CUPS 1.3 ****/
@@ -302,6 +303,11 @@ struct _http_s				/**** HTTP connection structure ****/
 					/* Allocated field values */
   			*default_fields[HTTP_FIELD_MAX];
 					/* Default field values, if any */
+
+  /**** New in CUPS 2.3.4 ****/
+  char			*buffer,	/* Buffer for incoming data */
+			*wbuffer;	/* Buffer for outgoing data */
+  size_t		bufsize;	/* Size of buffer and wbuffer */
 };
 #  endif /* !_HTTP_NO_PRIVATE */
 
@@ -333,6 +339,8 @@ extern const char	*_httpResolveURI(const char *uri, char *resolved_uri,
 			                 size_t resolved_size, int options,
 					 int (*cb)(void *context),
 					 void *context) _CUPS_PRIVATE;
+extern ssize_t		_httpSendFile(http_t *http, int fd, size_t length) _CUPS_PRIVATE;
+extern int		_httpSetBufferSize(http_t *http, size_t size) _CUPS_PRIVATE;
 extern int		_httpSetDigestAuthString(http_t *http, const char *nonce, const char *method, const char *resource) _CUPS_PRIVATE;
 extern const char	*_httpStatus(cups_lang_t *lang, http_status_t status) _CUPS_PRIVATE;
 extern void		_httpTLSInitialize(void) _CUPS_PRIVATE;
@@ -29,6 +29,12 @@
 #ifdef HAVE_POLL
 #  include <poll.h>
 #endif /* HAVE_POLL */
+#ifdef HAVE_SYS_SENDFILE_H
+#  include <sys/sendfile.h>
+#endif /* HAVE_SYS_SENDFILE_H */
+#ifndef _WIN32
+#  include <sys/uio.h>
+#endif /* !_WIN32 */
 #  ifdef HAVE_LIBZ
 #    include <zlib.h>
 #  endif /* HAVE_LIBZ */
@@ -372,6 +378,12 @@ httpClose(http_t *http)			/* I - HTTP connection */
   if (http->authstring && http->authstring != http->_authstring)
     free(http->authstring);
 
+  if (http->buffer != http->_buffer)
+  {
+    free(http->buffer);
+    free(http->wbuffer);
+  }
+
   free(http);
 }
 
@@ -1175,7 +1187,7 @@ httpGets(char   *line,			/* I - Line to read into */
         return (NULL);
       }
 
-      bytes = http_read(http, http->buffer + http->used, (size_t)(HTTP_MAX_BUFFER - http->used));
+      bytes = http_read(http, http->buffer + http->used, http->bufsize - (size_t)http->used);
 
       DEBUG_printf(("4httpGets: read " CUPS_LLFMT " bytes.", CUPS_LLCAST bytes));
 
@@ -1704,8 +1716,8 @@ httpPeek(http_t *http,			/* I - HTTP connection */
       }
     }
 
-    if ((size_t)http->data_remaining > sizeof(http->buffer))
-      buflen = sizeof(http->buffer);
+    if ((size_t)http->data_remaining > http->bufsize)
+      buflen = (ssize_t)http->bufsize;
     else
       buflen = (ssize_t)http->data_remaining;
 
@@ -2437,6 +2449,179 @@ httpReconnect2(http_t *http,		/* I - HTTP connection */
 }
 
 
+/*
+ * '_httpSendFile()' - Send message body data from a file without copying it.
+ *
+ * The data is sent with sendfile() when the connection is not encrypted and
+ * the message body has a fixed length with no content coding.  Otherwise, or
+ * when the socket is not ready for more data, 0 is returned and the caller
+ * needs to read the file and use httpWrite2.
+ */
+
+ssize_t					/* O - Bytes sent, 0 if not possible, -1 on error */
+_httpSendFile(http_t *http,		/* I - HTTP connection */
+              int    fd,		/* I - File to send */
+	      size_t length)		/* I - Maximum number of bytes to send */
+{
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
+  ssize_t	bytes;			/* Bytes sent */
+
+
+  DEBUG_printf(("_httpSendFile(http=%p, fd=%d, length=" CUPS_LLFMT ")", (void *)http, fd, CUPS_LLCAST length));
+
+  if (!http || fd < 0 || http->data_encoding != HTTP_ENCODING_LENGTH ||
+      http->coding != _HTTP_CODING_IDENTITY)
+    return (0);
+
+#  ifdef HAVE_SSL
+  if (http->tls)
+    return (0);
+#  endif /* HAVE_SSL */
+
+  if ((off_t)length > http->data_remaining)
+    length = (size_t)http->data_remaining;
+
+  if (length == 0)
+    return (0);
+
+ /*
+  * Flush any buffered data and then send the file data...
+  */
+
+  if (http->wused && httpFlushWrite(http) < 0)
+    return (-1);
+
+  http->activity = time(NULL);
+  http->error    = 0;
+
+  while ((bytes = sendfile(http->fd, fd, NULL, length)) < 0)
+  {
+    if (errno == EINTR)
+      continue;
+    else if (errno == EWOULDBLOCK || errno == EAGAIN)
+    {
+     /*
+      * Socket is full, let the caller wait for it to become writable...
+      */
+
+      DEBUG_puts("1_httpSendFile: Socket not ready.");
+      return (0);
+    }
+    else if (errno == EINVAL || errno == ENOSYS)
+    {
+     /*
+      * File can't be sent this way, have the caller copy it...
+      */
+
+      DEBUG_printf(("1_httpSendFile: sendfile not supported (%s).", strerror(errno)));
+      return (0);
+    }
+
+    http->error = errno;
+
+    DEBUG_printf(("1_httpSendFile: Unable to send file data (%s).", strerror(errno)));
+    return (-1);
+  }
+
+  DEBUG_printf(("1_httpSendFile: Sent " CUPS_LLFMT " bytes.", CUPS_LLCAST bytes));
+
+  http->data_remaining -= bytes;
+
+ /*
+  * Handle end-of-message processing...
+  */
+
+  if (http->data_remaining == 0)
+    httpWrite2(http, "", 0);
+
+  return (bytes);
+
+#else
+  (void)http;
+  (void)fd;
+  (void)length;
+
+  return (0);
+#endif /* HAVE_SENDFILE && HAVE_SYS_SENDFILE_H */
+}
+
+
+/*
+ * '_httpSetBufferSize()' - Set the size of the read and write buffers.
+ *
+ * Sizes of @code HTTP_MAX_BUFFER@ or less use the default buffers in the
+ * connection object.  Any buffered output is flushed first, and the size
+ * cannot be reduced below the amount of buffered input.
+ */
+
+int					/* O - 0 on success, -1 on error */
+_httpSetBufferSize(http_t *http,	/* I - HTTP connection */
+                   size_t size)		/* I - Buffer size in bytes */
+{
+  char	*buffer,			/* New input buffer */
+	*wbuffer;			/* New output buffer */
+
+
+  DEBUG_printf(("_httpSetBufferSize(http=%p, size=" CUPS_LLFMT ")", (void *)http, CUPS_LLCAST size));
+
+  if (!http)
+    return (-1);
+
+  if (size < sizeof(http->_buffer))
+    size = sizeof(http->_buffer);
+  else if (size > _HTTP_MAX_BUFSIZE)
+    size = _HTTP_MAX_BUFSIZE;
+
+  if (size == http->bufsize)
+    return (0);
+
+  if ((size_t)http->used > size)
+  {
+    DEBUG_printf(("1_httpSetBufferSize: %d bytes of input are buffered.", http->used));
+    return (-1);
+  }
+
+  if (http->wused && httpFlushWrite(http) < 0)
+    return (-1);
+
+ /*
+  * Allocate the new buffers as needed...
+  */
+
+  if (size == sizeof(http->_buffer))
+  {
+    buffer  = http->_buffer;
+    wbuffer = http->_wbuffer;
+  }
+  else if ((buffer = malloc(size)) == NULL || (wbuffer = malloc(size)) == NULL)
+  {
+    DEBUG_puts("1_httpSetBufferSize: Unable to allocate buffers.");
+
+    free(buffer);
+    return (-1);
+  }
+
+ /*
+  * Copy any buffered input and free the old buffers...
+  */
+
+  if (http->used > 0)
+    memcpy(buffer, http->buffer, (size_t)http->used);
+
+  if (http->buffer != http->_buffer)
+  {
+    free(http->buffer);
+    free(http->wbuffer);
+  }
+
+  http->buffer  = buffer;
+  http->wbuffer = wbuffer;
+  http->bufsize = size;
+
+  return (0);
+}
+
+
 /*
  * 'httpSetAuthString()' - Set the current authorization string.
  *
@@ -3220,7 +3405,7 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
 #endif /* HAVE_LIBZ */
   if (length > 0)
   {
-    if (http->wused && (length + (size_t)http->wused) > sizeof(http->wbuffer))
+    if (http->wused && (length + (size_t)http->wused) > http->bufsize)
     {
       DEBUG_printf(("2httpWrite2: Flushing buffer (wused=%d, length="
                     CUPS_LLFMT ")", http->wused, CUPS_LLCAST length));
@@ -3228,7 +3413,7 @@ httpWrite2(http_t     *http,		/* I - HTTP connection */
       httpFlushWrite(http);
     }
 
-    if ((length + (size_t)http->wused) <= sizeof(http->wbuffer) && length < sizeof(http->wbuffer))
+    if ((length + (size_t)http->wused) <= http->bufsize && length < http->bufsize)
     {
      /*
       * Write to buffer...
@@ -3982,6 +4167,9 @@ http_create(
   http->addrlist = myaddrlist;
   http->blocking = blocking;
   http->fd       = -1;
+  http->buffer   = http->_buffer;
+  http->wbuffer  = http->_wbuffer;
+  http->bufsize  = sizeof(http->_buffer);
 #ifdef HAVE_GSSAPI
   http->gssctx   = GSS_C_NO_CONTEXT;
   http->gssname  = GSS_C_NO_NAME;
@@ -4817,15 +5005,77 @@ http_write_chunk(http_t     *http,	/* I - HTTP connection */
 {
   char		header[16];		/* Chunk header */
   ssize_t	bytes;			/* Bytes written */
+#ifndef _WIN32
+  struct iovec	iov[3];			/* Header, data, and trailer */
+  int		i;			/* Looping var */
+  size_t	total;			/* Total bytes to write */
+#endif /* !_WIN32 */
 
 
   DEBUG_printf(("7http_write_chunk(http=%p, buffer=%p, length=" CUPS_LLFMT ")", (void *)http, (void *)buffer, CUPS_LLCAST length));
 
+  snprintf(header, sizeof(header), "%x\r\n", (unsigned)length);
+
+#ifndef _WIN32
+ /*
+  * Try writing the chunk header, data, and trailer with a single system
+  * call, then finish any partial write below...
+  */
+
+#  ifdef HAVE_SSL
+  if (!http->tls)
+#  endif /* HAVE_SSL */
+  {
+    iov[0].iov_base = header;
+    iov[0].iov_len  = strlen(header);
+    iov[1].iov_base = (void *)buffer;
+    iov[1].iov_len  = length;
+    iov[2].iov_base = "\r\n";
+    iov[2].iov_len  = 2;
+    total           = iov[0].iov_len + length + 2;
+
+    while ((bytes = writev(http->fd, iov, 3)) < 0 && errno == EINTR);
+
+    if (bytes < 0)
+    {
+     /*
+      * Let http_write() handle timeouts and errors...
+      */
+
+      DEBUG_printf(("8http_write_chunk: writev failed (%s).", strerror(errno)));
+      bytes = 0;
+    }
+    else
+      http->activity = time(NULL);
+
+    if ((size_t)bytes == total)
+      return ((ssize_t)length);
+
+    for (i = 0; i < 3; i ++)
+    {
+      if ((size_t)bytes >= iov[i].iov_len)
+      {
+        bytes -= (ssize_t)iov[i].iov_len;
+        continue;
+      }
+
+      if (http_write(http, (char *)iov[i].iov_base + bytes, iov[i].iov_len - (size_t)bytes) < 0)
+      {
+	DEBUG_printf(("8http_write_chunk: http_write of chunk part %d failed.", i));
+	return (-1);
+      }
+
+      bytes = 0;
+    }
+
+    return ((ssize_t)length);
+  }
+#endif /* !_WIN32 */
+
  /*
   * Write the chunk header, data, and trailer.
   */
 
-  snprintf(header, sizeof(header), "%x\r\n", (unsigned)length);
   if (http_write(http, header, strlen(header)) < 0)
   {
     DEBUG_puts("8http_write_chunk: http_write of length failed.");
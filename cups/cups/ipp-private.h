@@ -33,6 +33,12 @@ extern "C" {
 
 #  define IPP_BUF_SIZE	(IPP_MAX_LENGTH + 2)
 					/* Size of buffer */
+#  define _IPP_TAG_ENCODED	((ipp_tag_t)0x7ffffffe)
+					/* Value tag for pre-encoded attributes */
+#  define _IPP_INDEX_MIN	32	/* Attributes scanned before indexing names */
+#  define _IPP_INDEX_HASH	64	/* Size of attribute name hash */
+#  define _IPP_ARENA_MIN	2048	/* Size of first arena block */
+#  define _IPP_ARENA_MAX	65536	/* Maximum size of arena blocks */
 
 
 /*
@@ -115,9 +121,17 @@ struct _ipp_attribute_s			/**** IPP attribute ****/
 		value_tag;		/* What type of value is it? */
   char		*name;			/* Name of attribute */
   int		num_values;		/* Number of values */
+  int		arena;			/* Allocated from message arena? */
   _ipp_value_t	values[1];		/* Values */
 };
 
+typedef struct _ipp_arena_s		/**** Attribute arena block ****/
+{
+  struct _ipp_arena_s	*next;		/* Previous block */
+  size_t		size,		/* Size of block data */
+			used;		/* Bytes used in block */
+} _ipp_arena_t;				/* Block data follows the header */
+
 struct _ipp_s				/**** IPP Request/Response/Notification ****/
 {
   ipp_state_t		state;		/* State of request */
@@ -135,6 +149,9 @@ struct _ipp_s				/**** IPP Request/Response/Notification ****/
 /**** New in CUPS 2.0 ****/
   int			atend,		/* At end of list? */
 			curindex;	/* Current attribute index for hierarchical search */
+/**** New in CUPS 2.3.4 ****/
+  cups_array_t		*index;		/* Index of first attribute by name */
+  _ipp_arena_t		*arena;		/* Attribute arena or NULL */
 };
 
 typedef struct _ipp_option_s		/**** Attribute mapping data ****/
@@ -196,6 +213,10 @@ extern const char	*_ippCheckOptions(void) _CUPS_PRIVATE;
 #endif /* DEBUG */
 extern _ipp_option_t	*_ippFindOption(const char *name) _CUPS_PRIVATE;
 
+/* ipp.c */
+extern ipp_attribute_t	*_ippAddEncoded(ipp_t *ipp, ipp_tag_t group, const char *name, const void *data, size_t datalen) _CUPS_PRIVATE;
+extern ipp_t		*_ippNewArena(void) _CUPS_PRIVATE;
+
 /* ipp-file.c */
 extern ipp_t		*_ippFileParse(_ipp_vars_t *v, const char *filename, void *user_data) _CUPS_PRIVATE;
 extern int		_ippFileReadToken(_ipp_file_t *f, char *token, size_t tokensize) _CUPS_PRIVATE;
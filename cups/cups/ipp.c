@@ -27,9 +27,18 @@
 static ipp_attribute_t	*ipp_add_attr(ipp_t *ipp, const char *name,
 			              ipp_tag_t  group_tag, ipp_tag_t value_tag,
 			              int num_values);
+static void		*ipp_arena_alloc(ipp_t *ipp, size_t size);
+static void		*ipp_arena_realloc(ipp_t *ipp, void *ptr, size_t oldsize,
+			                   size_t size);
+static int		ipp_compare_names(ipp_attribute_t *a,
+			                  ipp_attribute_t *b, void *data);
 static void		ipp_free_values(ipp_attribute_t *attr, int element,
 			                int count);
 static char		*ipp_get_code(const char *locale, char *buffer, size_t bufsize) _CUPS_NONNULL(1,2);
+static int		ipp_hash_name(ipp_attribute_t *attr, void *data);
+static void		ipp_index_add(ipp_t *ipp, ipp_attribute_t *attr);
+static void		ipp_index_attrs(ipp_t *ipp);
+static void		ipp_index_remove(ipp_t *ipp, ipp_attribute_t *attr);
 static char		*ipp_lang_code(const char *locale, char *buffer, size_t bufsize) _CUPS_NONNULL(1,2);
 static size_t		ipp_length(ipp_t *ipp, int collection);
 static ssize_t		ipp_read_http(http_t *http, ipp_uchar_t *buffer,
@@ -352,6 +361,56 @@ ippAddDate(ipp_t             *ipp,	/* I - IPP message */
 }
 
 
+/*
+ * '_ippAddEncoded()' - Add pre-encoded attributes to an IPP message.
+ *
+ * The data must contain one or more complete attributes in wire format
+ * without any group or end tags.  The attribute is written as-is by
+ * @link ippWrite@ and is only supported in IPP messages, not collections.
+ * The name is only used for debugging.
+ */
+
+ipp_attribute_t *			/* O - New attribute */
+_ippAddEncoded(ipp_t      *ipp,		/* I - IPP message */
+               ipp_tag_t  group,	/* I - IPP group */
+               const char *name,	/* I - Name of attribute */
+               const void *data,	/* I - Encoded attributes */
+	       size_t     datalen)	/* I - Length of data in bytes */
+{
+  ipp_attribute_t	*attr;		/* New attribute */
+
+
+  DEBUG_printf(("_ippAddEncoded(ipp=%p, group=%02x(%s), name=\"%s\", data=%p, datalen=" CUPS_LLFMT ")", (void *)ipp, group, ippTagString(group), name, data, CUPS_LLCAST datalen));
+
+ /*
+  * Range check input...
+  */
+
+  if (!ipp || !name || !data || group <= IPP_TAG_ZERO ||
+      group == IPP_TAG_END || group >= IPP_TAG_UNSUPPORTED_VALUE ||
+      datalen == 0 || datalen > INT_MAX)
+    return (NULL);
+
+ /*
+  * Create the attribute...
+  */
+
+  if ((attr = ipp_add_attr(ipp, name, group, _IPP_TAG_ENCODED, 1)) == NULL)
+    return (NULL);
+
+  if ((attr->values[0].unknown.data = malloc(datalen)) == NULL)
+  {
+    ippDeleteAttribute(ipp, attr);
+    return (NULL);
+  }
+
+  attr->values[0].unknown.length = (int)datalen;
+  memcpy(attr->values[0].unknown.data, data, datalen);
+
+  return (attr);
+}
+
+
 /*
  * 'ippAddInteger()' - Add a integer attribute to an IPP message.
  *
@@ -1730,6 +1789,8 @@ ippDelete(ipp_t *ipp)			/* I - IPP message */
 {
   ipp_attribute_t	*attr,		/* Current attribute */
 			*next;		/* Next attribute */
+  _ipp_arena_t		*block,		/* Current arena block */
+			*nextblock;	/* Next arena block */
 
 
   DEBUG_printf(("ippDelete(ipp=%p)", (void *)ipp));
@@ -1757,9 +1818,18 @@ ippDelete(ipp_t *ipp)			/* I - IPP message */
     if (attr->name)
       _cupsStrFree(attr->name);
 
-    free(attr);
+    if (!attr->arena)
+      free(attr);
+  }
+
+  for (block = ipp->arena; block; block = nextblock)
+  {
+    nextblock = block->next;
+    free(block);
   }
 
+  cupsArrayDelete(ipp->index);
+
   free(ipp);
 }
 
@@ -1813,6 +1883,9 @@ ippDeleteAttribute(
 	if (current == ipp->last)
 	  ipp->last = prev;
 
+        if (ipp->index)
+          ipp_index_remove(ipp, current);
+
         break;
       }
 
@@ -1829,7 +1902,8 @@ ippDeleteAttribute(
   if (attr->name)
     _cupsStrFree(attr->name);
 
-  free(attr);
+  if (!attr->arena)
+    free(attr);
 }
 
 
@@ -1930,10 +2004,12 @@ ippFindNextAttribute(ipp_t      *ipp,	/* I - IPP message */
 		     ipp_tag_t  type)	/* I - Type of attribute */
 {
   ipp_attribute_t	*attr,		/* Current atttribute */
-			*childattr;	/* Child attribute */
+			*childattr,	/* Child attribute */
+			key;		/* Name index search key */
   ipp_tag_t		value_tag;	/* Value tag */
   char			parent[1024],	/* Parent attribute name */
 			*child = NULL;	/* Child attribute name */
+  int			scanned = -1;	/* Number of attributes scanned */
 
 
   DEBUG_printf(("2ippFindNextAttribute(ipp=%p, name=\"%s\", type=%02x(%s))", (void *)ipp, name, type, ippTagString(type)));
@@ -1999,16 +2075,36 @@ ippFindNextAttribute(ipp_t      *ipp,	/* I - IPP message */
     ipp->prev = ipp->current;
     attr      = ipp->current->next;
   }
+  else if (ipp->index)
+  {
+   /*
+    * Start with the first attribute of this name...
+    */
+
+    key.name  = (char *)name;
+    ipp->prev = NULL;
+    attr      = (ipp_attribute_t *)cupsArrayFind(ipp->index, &key);
+  }
   else
   {
     ipp->prev = NULL;
     attr      = ipp->attrs;
+    scanned   = 0;
   }
 
   for (; attr != NULL; ipp->prev = attr, attr = attr->next)
   {
     DEBUG_printf(("4ippFindAttribute: attr=%p, name=\"%s\"", (void *)attr, attr->name));
 
+    if (scanned >= 0 && ++ scanned > _IPP_INDEX_MIN && !ipp->index)
+    {
+     /*
+      * Long message, index the attribute names for subsequent searches...
+      */
+
+      ipp_index_attrs(ipp);
+    }
+
     value_tag = (ipp_tag_t)(attr->value_tag & IPP_TAG_CUPS_MASK);
 
     if (attr->name != NULL && _cups_strcasecmp(attr->name, name) == 0 &&
@@ -2641,6 +2737,36 @@ ippNew(void)
 }
 
 
+/*
+ * '_ippNewArena()' - Allocate a new IPP message using an attribute arena.
+ *
+ * Attributes added to the message are carved out of large blocks that are
+ * released all at once by @link ippDelete@, which avoids thousands of small
+ * allocations when decoding large requests and responses.  Memory for deleted
+ * or resized attributes is not reused until the message is deleted, so arena
+ * messages are best used for requests and responses that are mostly read.
+ */
+
+ipp_t *					/* O - IPP message */
+_ippNewArena(void)
+{
+  ipp_t	*temp;				/* New IPP message */
+
+
+  if ((temp = ippNew()) != NULL)
+  {
+    if ((temp->arena = malloc(sizeof(_ipp_arena_t) + _IPP_ARENA_MIN)) != NULL)
+    {
+      temp->arena->next = NULL;
+      temp->arena->size = _IPP_ARENA_MIN;
+      temp->arena->used = 0;
+    }
+  }
+
+  return (temp);
+}
+
+
 /*
  *  'ippNewRequest()' - Allocate a new IPP request message.
  *
@@ -3891,6 +4017,17 @@ ippSetName(ipp_t           *ipp,	/* I  - IPP message */
 
   if ((temp = _cupsStrAlloc(name)) != NULL)
   {
+    if (ipp->index)
+    {
+     /*
+      * Renaming may change which attribute comes first for a given name, so
+      * just rebuild the index on the next long search...
+      */
+
+      cupsArrayDelete(ipp->index);
+      ipp->index = NULL;
+    }
+
     if ((*attr)->name)
       _cupsStrFree((*attr)->name);
 
@@ -5396,6 +5533,28 @@ ippWriteIO(void       *dst,		/* I - Destination */
 	    }
 	    else if (attr->group_tag == IPP_TAG_ZERO)
 	      continue;
+
+	    if (attr->value_tag == _IPP_TAG_ENCODED)
+	    {
+	     /*
+	      * Write pre-encoded attributes as-is...
+	      */
+
+	      DEBUG_printf(("1ippWriteIO: %s (%d encoded bytes)", attr->name, attr->values[0].unknown.length));
+
+	      if ((bufptr > buffer && (*cb)(dst, buffer, (size_t)(bufptr - buffer)) < 0) ||
+	          (*cb)(dst, attr->values[0].unknown.data, (size_t)attr->values[0].unknown.length) < 0)
+	      {
+		DEBUG_puts("1ippWriteIO: Could not write IPP attribute...");
+		_cupsBufferRelease((char *)buffer);
+		return (IPP_STATE_ERROR);
+	      }
+
+	      if (!blocking && ipp->current)
+		break;
+	      else
+		continue;
+	    }
 	  }
 
 	  DEBUG_printf(("1ippWriteIO: %s (%s%s)", attr->name,
@@ -6182,6 +6341,7 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
              int        num_values)	/* I - Number of values */
 {
   int			alloc_values;	/* Number of values to allocate */
+  size_t		size;		/* Size of attribute */
   ipp_attribute_t	*attr;		/* New attribute */
 
 
@@ -6203,8 +6363,12 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
   else
     alloc_values = (num_values + IPP_MAX_VALUES - 1) & ~(IPP_MAX_VALUES - 1);
 
-  attr = calloc(sizeof(ipp_attribute_t) +
-                (size_t)(alloc_values - 1) * sizeof(_ipp_value_t), 1);
+  size = sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t);
+
+  if (ipp->arena && (attr = ipp_arena_alloc(ipp, size)) != NULL)
+    attr->arena = 1;
+  else
+    attr = calloc(size, 1);
 
   if (attr)
   {
@@ -6232,6 +6396,9 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
 
     ipp->prev = ipp->last;
     ipp->last = ipp->current = attr;
+
+    if (ipp->index)
+      ipp_index_add(ipp, attr);
   }
 
   DEBUG_printf(("5ipp_add_attr: Returning %p", (void *)attr));
@@ -6240,6 +6407,105 @@ ipp_add_attr(ipp_t      *ipp,		/* I - IPP message */
 }
 
 
+/*
+ * 'ipp_arena_alloc()' - Allocate zeroed memory from a message's arena.
+ */
+
+static void *				/* O - Memory or NULL on error */
+ipp_arena_alloc(ipp_t  *ipp,		/* I - IPP message */
+                size_t size)		/* I - Number of bytes */
+{
+  _ipp_arena_t	*block = ipp->arena;	/* Current arena block */
+  void		*ptr;			/* Allocated memory */
+  size_t	blocksize;		/* Size of new block */
+
+
+ /*
+  * Keep allocations aligned for the pointers in attribute values...
+  */
+
+  size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+  if (block->used + size > block->size)
+  {
+   /*
+    * Start a new block, doubling the size each time up to the limit...
+    */
+
+    if ((blocksize = 2 * block->size) > _IPP_ARENA_MAX)
+      blocksize = _IPP_ARENA_MAX;
+    if (blocksize < size)
+      blocksize = size;
+
+    if ((block = malloc(sizeof(_ipp_arena_t) + blocksize)) == NULL)
+      return (NULL);
+
+    block->next = ipp->arena;
+    block->size = blocksize;
+    block->used = 0;
+    ipp->arena  = block;
+  }
+
+  ptr = (char *)(block + 1) + block->used;
+  block->used += size;
+
+  memset(ptr, 0, size);
+
+  return (ptr);
+}
+
+
+/*
+ * 'ipp_arena_realloc()' - Resize memory allocated from a message's arena.
+ *
+ * The most recent allocation is grown in place when the block has room, which
+ * is the common case when reading a 1setOf value.  Otherwise the data is copied
+ * to a new allocation and the old memory is released with the arena.
+ */
+
+static void *				/* O - Memory or NULL on error */
+ipp_arena_realloc(ipp_t  *ipp,		/* I - IPP message */
+                  void   *ptr,		/* I - Current memory */
+                  size_t oldsize,	/* I - Current size */
+                  size_t size)		/* I - New size */
+{
+  _ipp_arena_t	*block = ipp->arena;	/* Current arena block */
+  char		*data = (char *)(block + 1);
+					/* Block data */
+  void		*temp;			/* New memory */
+
+
+  oldsize = (oldsize + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+  size    = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+  if ((char *)ptr + oldsize == data + block->used && block->used - oldsize + size <= block->size)
+  {
+    block->used = block->used - oldsize + size;
+    return (ptr);
+  }
+
+  if ((temp = ipp_arena_alloc(ipp, size)) != NULL)
+    memcpy(temp, ptr, oldsize);
+
+  return (temp);
+}
+
+
+/*
+ * 'ipp_compare_names()' - Compare two attribute names.
+ */
+
+static int				/* O - Result of comparison */
+ipp_compare_names(ipp_attribute_t *a,	/* I - First attribute */
+                  ipp_attribute_t *b,	/* I - Second attribute */
+                  void            *data)/* Unused */
+{
+  (void)data;
+
+  return (_cups_strcasecmp(a->name, b->name));
+}
+
+
 /*
  * 'ipp_free_values()' - Free attribute values.
  */
@@ -6382,6 +6648,91 @@ ipp_get_code(const char *value,		/* I - Locale/charset string */
 }
 
 
+/*
+ * 'ipp_hash_name()' - Generate a hash for an attribute name.
+ */
+
+static int				/* O - Hash value */
+ipp_hash_name(ipp_attribute_t *attr,	/* I - Attribute */
+              void            *data)	/* Unused */
+{
+  unsigned	hash;			/* Hash value */
+  const char	*name;			/* Pointer into name */
+
+
+  (void)data;
+
+  for (hash = 0, name = attr->name; *name; name ++)
+    hash = 33 * hash + (unsigned)_cups_tolower(*name & 255);
+
+  return ((int)(hash & (_IPP_INDEX_HASH - 1)));
+}
+
+
+/*
+ * 'ipp_index_add()' - Add an attribute to the name index.
+ *
+ * The index only tracks the first attribute with a given name, so attributes
+ * appended after an existing one with the same name are not added.
+ */
+
+static void
+ipp_index_add(ipp_t           *ipp,	/* I - IPP message */
+              ipp_attribute_t *attr)	/* I - Attribute */
+{
+  if (attr->name && !cupsArrayFind(ipp->index, attr))
+    cupsArrayAdd(ipp->index, attr);
+}
+
+
+/*
+ * 'ipp_index_attrs()' - Create the name index for a message.
+ */
+
+static void
+ipp_index_attrs(ipp_t *ipp)		/* I - IPP message */
+{
+  ipp_attribute_t	*attr;		/* Current attribute */
+
+
+  if ((ipp->index = cupsArrayNew2((cups_array_func_t)ipp_compare_names, NULL, (cups_ahash_func_t)ipp_hash_name, _IPP_INDEX_HASH)) == NULL)
+    return;
+
+  for (attr = ipp->attrs; attr; attr = attr->next)
+    ipp_index_add(ipp, attr);
+}
+
+
+/*
+ * 'ipp_index_remove()' - Remove an attribute from the name index.
+ *
+ * If the attribute was indexed, the next attribute with the same name (if any)
+ * takes its place.
+ */
+
+static void
+ipp_index_remove(ipp_t           *ipp,	/* I - IPP message */
+                 ipp_attribute_t *attr)	/* I - Attribute */
+{
+  ipp_attribute_t	*next;		/* Next attribute */
+
+
+  if (!attr->name || cupsArrayFind(ipp->index, attr) != attr)
+    return;
+
+  cupsArrayRemove(ipp->index, attr);
+
+  for (next = attr->next; next; next = next->next)
+  {
+    if (next->name && !_cups_strcasecmp(next->name, attr->name))
+    {
+      cupsArrayAdd(ipp->index, next);
+      break;
+    }
+  }
+}
+
+
 /*
  * 'ipp_lang_code()' - Convert a C locale name into an IPP language code.
  *
@@ -6457,6 +6808,12 @@ ipp_length(ipp_t *ipp,			/* I - IPP message or collection */
     if (!attr->name)
       continue;
 
+    if (attr->value_tag == _IPP_TAG_ENCODED)
+    {
+      bytes += (size_t)attr->values[0].unknown.length;
+      continue;
+    }
+
     DEBUG_printf(("5ipp_length: attr->name=\"%s\", attr->num_values=%d, "
                   "bytes=" CUPS_LLFMT, attr->name, attr->num_values, CUPS_LLCAST bytes));
 
@@ -6712,7 +7069,9 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
   ipp_attribute_t	*temp,		/* New attribute pointer */
 			*current,	/* Current attribute in list */
 			*prev;		/* Previous attribute in list */
-  int			alloc_values;	/* Allocated values */
+  int			alloc_values,	/* Allocated values */
+			indexed;	/* Is the attribute in the name index? */
+  size_t		oldsize;	/* Current size of attribute */
 
 
  /*
@@ -6740,6 +7099,8 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
   * values when num_values > 1.
   */
 
+  oldsize = sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t);
+
   if (alloc_values < IPP_MAX_VALUES)
     alloc_values = IPP_MAX_VALUES;
   else
@@ -6748,12 +7109,27 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
   DEBUG_printf(("4ipp_set_value: Reallocating for up to %d values.",
                 alloc_values));
 
+ /*
+  * Pull the attribute from the name index while its address may change...
+  */
+
+  if ((indexed = ipp->index && temp->name && cupsArrayFind(ipp->index, temp) == temp) != 0)
+    cupsArrayRemove(ipp->index, temp);
+
  /*
   * Reallocate memory...
   */
 
-  if ((temp = realloc(temp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t))) == NULL)
+  if (temp->arena)
+    temp = ipp_arena_realloc(ipp, temp, oldsize, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t));
+  else
+    temp = realloc(temp, sizeof(ipp_attribute_t) + (size_t)(alloc_values - 1) * sizeof(_ipp_value_t));
+
+  if (!temp)
   {
+    if (indexed)
+      cupsArrayAdd(ipp->index, *attr);
+
     _cupsSetHTTPError(HTTP_STATUS_ERROR);
     DEBUG_puts("4ipp_set_value: Unable to resize attribute.");
     return (NULL);
@@ -6765,6 +7141,9 @@ ipp_set_value(ipp_t           *ipp,	/* IO - IPP message */
 
   memset(temp->values + temp->num_values, 0, (size_t)(alloc_values - temp->num_values) * sizeof(_ipp_value_t));
 
+  if (indexed)
+    cupsArrayAdd(ipp->index, temp);
+
   if (temp != *attr)
   {
    /*
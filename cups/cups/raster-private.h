@@ -46,6 +46,7 @@ struct _cups_raster_s			/**** Raster stream data ****/
   unsigned		rowheight,	/* Row height in lines */
 			count,		/* Current row run-length count */
 			remaining,	/* Remaining rows in page image */
+			partial,	/* Bytes read from current row (uncompressed) */
 			bpp;		/* Bytes per pixel/color */
   unsigned char		*pixels,	/* Pixels for current row */
 			*pend,		/* End of pixel buffer */
@@ -90,7 +91,9 @@ extern const char	*_cupsRasterErrorString(void) _CUPS_PRIVATE;
 extern int		_cupsRasterInitPWGHeader(cups_page_header2_t *h, pwg_media_t *media, const char *type, int xdpi, int ydpi, const char *sides, const char *sheet_back) _CUPS_PRIVATE;
 extern cups_raster_t	*_cupsRasterNew(cups_raster_iocb_t iocb, void *ctx, cups_mode_t mode) _CUPS_PRIVATE;
 extern unsigned		_cupsRasterReadHeader(cups_raster_t *r) _CUPS_PRIVATE;
+extern const unsigned char *_cupsRasterReadLine(cups_raster_t *r) _CUPS_PRIVATE;
 extern unsigned		_cupsRasterReadPixels(cups_raster_t *r, unsigned char *p, unsigned len) _CUPS_PRIVATE;
+extern unsigned		_cupsRasterWriteBand(cups_raster_t *r, unsigned char *p, unsigned len) _CUPS_PRIVATE;
 extern unsigned		_cupsRasterWriteHeader(cups_raster_t *r) _CUPS_PRIVATE;
 extern unsigned		_cupsRasterWritePixels(cups_raster_t *r, unsigned char *p, unsigned len) _CUPS_PRIVATE;
 
@@ -15,6 +15,7 @@
  */
 
 #include "raster-private.h"
+#include "thread-private.h"
 #include "debug-internal.h"
 #ifdef HAVE_STDINT_H
 #  include <stdint.h>
@@ -27,6 +28,29 @@
 
 typedef void (*_cups_copyfunc_t)(void *dst, const void *src, size_t bytes);
 
+typedef struct _cups_raster_run_s	/**** Run of identical lines ****/
+{
+  const unsigned char	*pixels;	/* Pixels for line */
+  unsigned		count;		/* Repeat count */
+} _cups_raster_run_t;
+
+typedef struct _cups_raster_band_s	/**** Band compression job ****/
+{
+  cups_raster_t		*r;		/* Raster stream */
+  _cups_raster_run_t	*runs;		/* Lines to compress */
+  unsigned		num_runs;	/* Number of lines */
+  unsigned char		*buffer;	/* Compressed data */
+  size_t		bytes;		/* Number of compressed bytes */
+} _cups_raster_band_t;
+
+
+/*
+ * Local constants...
+ */
+
+#define CUPS_RASTER_BAND_MIN	65536	/* Minimum bytes per band thread */
+#define CUPS_RASTER_BAND_THREADS 8	/* Maximum number of band threads */
+
 
 /*
  * Local globals...
@@ -66,7 +90,13 @@ static const char * const cups_modes[] =
  * Local functions...
  */
 
+#ifdef HAVE_PTHREAD_H
+static void	*cups_raster_band(_cups_raster_band_t *band);
+#endif /* HAVE_PTHREAD_H */
+static size_t	cups_raster_differ(const unsigned char *ptr, size_t bpp, size_t count);
+static size_t	cups_raster_encode(cups_raster_t *r, const unsigned char *pixels, unsigned count, unsigned char *buffer);
 static ssize_t	cups_raster_io(cups_raster_t *r, unsigned char *buf, size_t bytes);
+static size_t	cups_raster_match(const unsigned char *ptr, size_t bpp, size_t bytes);
 static ssize_t	cups_raster_read(cups_raster_t *r, unsigned char *buf, size_t bytes);
 static int	cups_raster_update(cups_raster_t *r);
 static ssize_t	cups_raster_write(cups_raster_t *r, const unsigned char *pixels);
@@ -737,6 +767,124 @@ _cupsRasterReadHeader(
 }
 
 
+/*
+ * '_cupsRasterReadLine()' - Read a line of raster pixels without copying.
+ */
+
+const unsigned char *			/* O - Pointer to line or `NULL` on error */
+_cupsRasterReadLine(cups_raster_t *r)	/* I - Raster stream */
+{
+  unsigned	cupsBytesPerLine;	/* cupsBytesPerLine value */
+  unsigned	lines;			/* Lines to read */
+  size_t	bufsize,		/* Size of read buffer */
+		leftover;		/* Bytes left in read buffer */
+  unsigned char	*ptr;			/* Pointer to line */
+
+
+  DEBUG_printf(("_cupsRasterReadLine(r=%p)", (void *)r));
+
+  if (r == NULL || r->mode != CUPS_RASTER_READ || r->remaining == 0 ||
+      (cupsBytesPerLine = r->header.cupsBytesPerLine) == 0)
+  {
+    DEBUG_puts("1_cupsRasterReadLine: Returning NULL.");
+    return (NULL);
+  }
+
+  if (r->compressed)
+  {
+   /*
+    * Decode the next row into the line buffer, or reuse it for repeated
+    * rows...
+    */
+
+    if (r->pcurrent != r->pixels)
+    {
+      DEBUG_puts("1_cupsRasterReadLine: Partial line pending, returning NULL.");
+      return (NULL);
+    }
+
+    if (r->count == 0)
+    {
+      if (_cupsRasterReadPixels(r, r->pixels, cupsBytesPerLine) < cupsBytesPerLine)
+        return (NULL);
+    }
+    else
+    {
+      r->count --;
+      r->remaining --;
+    }
+
+    return (r->pixels);
+  }
+
+  if (r->partial)
+  {
+    DEBUG_puts("1_cupsRasterReadLine: Partial line pending, returning NULL.");
+    return (NULL);
+  }
+
+  if ((size_t)(r->bufend - r->bufptr) < cupsBytesPerLine)
+  {
+   /*
+    * Read as many whole lines of the current page as will fit in the read
+    * buffer...
+    */
+
+    leftover = (size_t)(r->bufend - r->bufptr);
+    bufsize  = cupsBytesPerLine < 65536 ? 65536 : cupsBytesPerLine;
+
+    if (leftover > 0)
+      memmove(r->buffer, r->bufptr, leftover);
+
+    if (bufsize > r->bufsize)
+    {
+      if (r->buffer)
+        ptr = realloc(r->buffer, bufsize);
+      else
+        ptr = malloc(bufsize);
+
+      if (!ptr)
+        return (NULL);
+
+      r->buffer  = ptr;
+      r->bufsize = bufsize;
+    }
+
+    if ((lines = (unsigned)(r->bufsize / cupsBytesPerLine)) > r->remaining)
+      lines = r->remaining;
+
+    bufsize   = (size_t)lines * cupsBytesPerLine;
+    r->bufptr = r->buffer;
+    r->bufend = r->buffer + leftover;
+
+    if (cups_raster_io(r, r->bufend, bufsize - leftover) < (ssize_t)(bufsize - leftover))
+    {
+      DEBUG_puts("1_cupsRasterReadLine: Read error, returning NULL.");
+      return (NULL);
+    }
+
+    r->bufend = r->buffer + bufsize;
+  }
+
+  ptr = r->bufptr;
+
+  r->bufptr += cupsBytesPerLine;
+  r->remaining --;
+
+ /*
+  * Swap bytes as needed...
+  */
+
+  if (r->swapped &&
+      (r->header.cupsBitsPerColor == 16 ||
+       r->header.cupsBitsPerPixel == 12 ||
+       r->header.cupsBitsPerPixel == 16))
+    cups_swap(ptr, cupsBytesPerLine);
+
+  return (ptr);
+}
+
+
 /*
  * '_cupsRasterReadPixels()' - Read raster pixels.
  *
@@ -774,12 +922,14 @@ _cupsRasterReadPixels(
   if (!r->compressed)
   {
    /*
-    * Read without compression...
+    * Read without compression, counting rows that are split across calls...
     */
 
-    r->remaining -= len / r->header.cupsBytesPerLine;
+    r->partial   += len;
+    r->remaining -= r->partial / r->header.cupsBytesPerLine;
+    r->partial   %= r->header.cupsBytesPerLine;
 
-    if (cups_raster_io(r, p, len) < (ssize_t)len)
+    if (cups_raster_read(r, p, len) < (ssize_t)len)
     {
       DEBUG_puts("1_cupsRasterReadPixels: Read error, returning 0.");
       return (0);
@@ -922,12 +1072,28 @@ _cupsRasterReadPixels(
 	  temp  += r->bpp;
 	  count -= r->bpp;
 
-	  while (count > 0)
+	 /*
+	  * Copy the pixel, doubling the amount copied each time...
+	  */
+
+	  if (count > 0)
 	  {
-	    memcpy(temp, temp - r->bpp, r->bpp);
-	    temp  += r->bpp;
-	    count -= r->bpp;
-          }
+	    unsigned char	*start = temp - r->bpp;
+					/* Start of repeated pixels */
+	    unsigned		filled = r->bpp;
+					/* Bytes filled so far */
+
+	    while (count > 0)
+	    {
+	      unsigned chunk = filled < count ? filled : count;
+					/* Bytes to copy */
+
+	      memcpy(temp, start, chunk);
+	      temp   += chunk;
+	      count  -= chunk;
+	      filled += chunk;
+	    }
+	  }
 	}
       }
 
@@ -998,6 +1164,246 @@ _cupsRasterReadPixels(
 }
 
 
+/*
+ * '_cupsRasterWriteBand()' - Write a band of raster lines.
+ *
+ * Compressed lines are encoded on up to 8 threads and written in order.
+ */
+
+unsigned				/* O - Number of bytes written */
+_cupsRasterWriteBand(
+    cups_raster_t *r,			/* I - Raster stream */
+    unsigned char *p,			/* I - Bytes to write */
+    unsigned      len)			/* I - Number of bytes to write */
+{
+  unsigned		i,		/* Looping var */
+			bpl,		/* Bytes per line */
+			lines,		/* Number of whole lines */
+			num_runs,	/* Number of runs */
+			num_write,	/* Number of runs to write */
+			num_bands;	/* Number of bands */
+  int			open,		/* Can the last run be extended? */
+			status = 1;	/* Write status */
+  unsigned char		*ptr;		/* Pointer to current line */
+  _cups_raster_run_t	*runs,		/* Runs of identical lines */
+			*run;		/* Current run */
+#ifdef HAVE_PTHREAD_H
+  unsigned		per_band = 1;	/* Runs per band */
+  _cups_raster_band_t	bands[CUPS_RASTER_BAND_THREADS];
+					/* Band compression jobs */
+  _cups_thread_t	threads[CUPS_RASTER_BAND_THREADS];
+					/* Band compression threads */
+  long			cpus;		/* Number of processors */
+#endif /* HAVE_PTHREAD_H */
+
+
+  DEBUG_printf(("_cupsRasterWriteBand(r=%p, p=%p, len=%u), remaining=%u", (void *)r, (void *)p, len, r ? r->remaining : 0));
+
+  if (r == NULL || r->mode == CUPS_RASTER_READ || r->remaining == 0)
+    return (0);
+
+ /*
+  * Uncompressed data, partial lines, and single lines go through the normal
+  * write code...
+  */
+
+  bpl = r->header.cupsBytesPerLine;
+
+  if (!r->compressed || bpl == 0 || r->pcurrent != r->pixels || (lines = len / bpl) < 2)
+    return (_cupsRasterWritePixels(r, p, len));
+
+  if (lines > r->remaining)
+    lines = r->remaining;
+
+  if ((runs = calloc(lines + 1, sizeof(_cups_raster_run_t))) == NULL)
+    return (_cupsRasterWritePixels(r, p, len));
+
+ /*
+  * Group identical lines into runs the same way _cupsRasterWritePixels does,
+  * starting with any line that is still pending from the last call...
+  */
+
+  if (r->count > 0)
+  {
+    runs[0].pixels = r->pixels;
+    runs[0].count  = r->count;
+    num_runs       = 1;
+    open           = 1;
+  }
+  else
+  {
+    num_runs = 0;
+    open     = 0;
+  }
+
+  for (i = lines, ptr = p; i > 0; i --, ptr += bpl)
+  {
+    if (open && !memcmp(ptr, runs[num_runs - 1].pixels, bpl))
+    {
+     /*
+      * Extend the last run...
+      */
+
+      run = runs + num_runs - 1;
+      run->count += r->rowheight;
+
+      if (run->count > (256 - r->rowheight))
+        open = 0;
+    }
+    else
+    {
+     /*
+      * Start a new run...
+      */
+
+      run = runs + num_runs;
+      run->pixels = ptr;
+      run->count  = r->rowheight;
+      num_runs ++;
+      open = 1;
+    }
+  }
+
+  r->remaining -= lines;
+
+  if (open && r->remaining > 0)
+    num_write = num_runs - 1;
+  else
+    num_write = num_runs;
+
+ /*
+  * Split the runs into bands of at least CUPS_RASTER_BAND_MIN bytes, one per
+  * processor...
+  */
+
+  num_bands = 1;
+
+#ifdef HAVE_PTHREAD_H
+  if ((size_t)num_write * bpl >= 2 * CUPS_RASTER_BAND_MIN)
+  {
+#  ifdef _SC_NPROCESSORS_ONLN
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+#  else
+    cpus = 1;
+#  endif /* _SC_NPROCESSORS_ONLN */
+
+    num_bands = (unsigned)((size_t)num_write * bpl / CUPS_RASTER_BAND_MIN);
+
+    if (cpus > 0 && num_bands > (unsigned)cpus)
+      num_bands = (unsigned)cpus;
+    if (num_bands > CUPS_RASTER_BAND_THREADS)
+      num_bands = CUPS_RASTER_BAND_THREADS;
+    if (num_bands > num_write)
+      num_bands = num_write;
+
+    if (num_bands > 1)
+    {
+      per_band  = (num_write + num_bands - 1) / num_bands;
+      num_bands = (num_write + per_band - 1) / per_band;
+    }
+
+    for (i = 0, run = runs; num_bands > 1 && i < num_bands; i ++, run += per_band)
+    {
+      bands[i].r        = r;
+      bands[i].runs     = run;
+      bands[i].num_runs = i < (num_bands - 1) ? per_band : num_write - i * per_band;
+      bands[i].bytes    = 0;
+
+      if ((bands[i].buffer = malloc((size_t)bands[i].num_runs * (2 * bpl + 1))) == NULL)
+      {
+        while (i > 0)
+          free(bands[--i].buffer);
+
+        num_bands = 1;
+      }
+    }
+  }
+#endif /* HAVE_PTHREAD_H */
+
+  if (num_bands == 1)
+  {
+   /*
+    * Compress and write each run on this thread...
+    */
+
+    for (i = 0, run = runs; i < num_write; i ++, run ++)
+    {
+      r->count = run->count;
+
+      if (cups_raster_write(r, run->pixels) <= 0)
+      {
+        status = 0;
+        break;
+      }
+    }
+  }
+#ifdef HAVE_PTHREAD_H
+  else
+  {
+   /*
+    * Compress the bands in parallel and then write them in order...
+    */
+
+    for (i = 1; i < num_bands; i ++)
+      threads[i] = _cupsThreadCreate((_cups_thread_func_t)cups_raster_band, bands + i);
+
+    cups_raster_band(bands);
+
+    for (i = 1; i < num_bands; i ++)
+    {
+      if (threads[i])
+        _cupsThreadWait(threads[i]);
+      else
+        cups_raster_band(bands + i);
+    }
+
+    for (i = 0; i < num_bands && status; i ++)
+      if (cups_raster_io(r, bands[i].buffer, bands[i].bytes) < (ssize_t)bands[i].bytes)
+        status = 0;
+
+    while (num_bands > 0)
+      free(bands[--num_bands].buffer);
+  }
+#endif /* HAVE_PTHREAD_H */
+
+  if (!status)
+  {
+    free(runs);
+    return (0);
+  }
+
+ /*
+  * Keep the last run pending so that following lines can extend it...
+  */
+
+  if (num_write < num_runs)
+  {
+    run = runs + num_write;
+
+    if (run->pixels != r->pixels)
+      memcpy(r->pixels, run->pixels, bpl);
+
+    r->count = run->count;
+  }
+  else
+    r->count = 0;
+
+  free(runs);
+
+ /*
+  * Write any partial line...
+  */
+
+  if (r->remaining > 0 && len > lines * bpl)
+  {
+    if (_cupsRasterWritePixels(r, p + lines * bpl, len - lines * bpl) == 0)
+      return (0);
+  }
+
+  return (len);
+}
+
+
 /*
  * '_cupsRasterWriteHeader()' - Write a raster page header.
  */
@@ -1352,6 +1758,179 @@ _cupsRasterWritePixels(
 }
 
 
+#ifdef HAVE_PTHREAD_H
+/*
+ * 'cups_raster_band()' - Compress a band of raster lines.
+ */
+
+static void *				/* O - Band */
+cups_raster_band(
+    _cups_raster_band_t *band)		/* I - Band to compress */
+{
+  unsigned		i;		/* Looping var */
+  _cups_raster_run_t	*run;		/* Current run */
+
+
+  for (i = band->num_runs, run = band->runs; i > 0; i --, run ++)
+    band->bytes += cups_raster_encode(band->r, run->pixels, run->count, band->buffer + band->bytes);
+
+  return (band);
+}
+#endif /* HAVE_PTHREAD_H */
+
+
+/*
+ * 'cups_raster_differ()' - Count the pixels that differ from the next pixel.
+ */
+
+static size_t				/* O - Number of differing pixels */
+cups_raster_differ(
+    const unsigned char *ptr,		/* I - First pixel */
+    size_t              bpp,		/* I - Bytes per pixel */
+    size_t              count)		/* I - Maximum number of pixels */
+{
+  size_t	i;			/* Current pixel */
+
+
+ /*
+  * Compare the first byte of each pixel before comparing the whole pixel,
+  * since neighboring pixels that differ usually differ there...
+  */
+
+  if (bpp == 1)
+  {
+    for (i = 0; i < count; i ++)
+      if (ptr[i] == ptr[i + 1])
+        break;
+  }
+  else
+  {
+    for (i = 0; i < count; i ++, ptr += bpp)
+      if (ptr[0] == ptr[bpp] && !memcmp(ptr, ptr + bpp, bpp))
+        break;
+  }
+
+  return (i);
+}
+
+
+/*
+ * 'cups_raster_encode()' - Compress a row of raster data.
+ *
+ * The buffer must hold at least 2 * cupsBytesPerLine + 1 bytes.
+ */
+
+static size_t				/* O - Number of compressed bytes */
+cups_raster_encode(
+    cups_raster_t       *r,		/* I - Raster stream */
+    const unsigned char *pixels,	/* I - Pixel data to compress */
+    unsigned            count,		/* I - Row repeat count */
+    unsigned char       *buffer)	/* I - Output buffer */
+{
+  const unsigned char	*start,		/* Start of sequence */
+			*ptr,		/* Current pointer in sequence */
+			*pend,		/* End of raster buffer */
+			*plast;		/* Pointer to last pixel */
+  unsigned char		*wptr;		/* Pointer into write buffer */
+  unsigned		bpp;		/* Bytes per pixel */
+  _cups_copyfunc_t	cf;		/* Copy function */
+
+
+  DEBUG_printf(("3cups_raster_encode(r=%p, pixels=%p, count=%u, buffer=%p)", (void *)r, (void *)pixels, count, (void *)buffer));
+
+ /*
+  * Determine whether we need to swap bytes...
+  */
+
+  if (r->swapped && (r->header.cupsBitsPerColor == 16 || r->header.cupsBitsPerPixel == 12 || r->header.cupsBitsPerPixel == 16))
+  {
+    DEBUG_puts("4cups_raster_encode: Swapping bytes when writing.");
+    cf = (_cups_copyfunc_t)cups_swap_copy;
+  }
+  else
+    cf = (_cups_copyfunc_t)memcpy;
+
+ /*
+  * Write the row repeat count...
+  */
+
+  bpp     = r->bpp;
+  pend    = pixels + r->header.cupsBytesPerLine;
+  plast   = pend - bpp;
+  wptr    = buffer;
+  *wptr++ = (unsigned char)(count - 1);
+
+ /*
+  * Write using a modified PackBits compression...
+  */
+
+  for (ptr = pixels; ptr < pend;)
+  {
+    start = ptr;
+    ptr += bpp;
+
+    if (ptr == pend)
+    {
+     /*
+      * Encode a single pixel at the end...
+      */
+
+      *wptr++ = 0;
+      (*cf)(wptr, start, bpp);
+      wptr += bpp;
+    }
+    else if (!memcmp(start, ptr, bpp))
+    {
+     /*
+      * Encode a sequence of repeating pixels; each pixel in the run matches
+      * the next one when the bytes match the bytes one pixel later...
+      */
+
+      count = (unsigned)(plast - ptr) / bpp;
+      if (count > 126)
+        count = 126;
+
+      count = (unsigned)(cups_raster_match(ptr, bpp, count * bpp) / bpp);
+      ptr   += count * bpp;
+      count += 2;
+
+      *wptr++ = (unsigned char)(count - 1);
+      (*cf)(wptr, ptr, bpp);
+      wptr += bpp;
+      ptr  += bpp;
+    }
+    else
+    {
+     /*
+      * Encode a sequence of non-repeating pixels...
+      */
+
+      count = (unsigned)(plast - ptr) / bpp;
+      if (count > 127)
+        count = 127;
+
+      count = (unsigned)cups_raster_differ(ptr, bpp, count);
+      ptr   += count * bpp;
+      count ++;
+
+      if (ptr >= plast && count < 128)
+      {
+        count ++;
+	ptr += bpp;
+      }
+
+      *wptr++ = (unsigned char)(257 - count);
+
+      count *= bpp;
+      (*cf)(wptr, start, count);
+      wptr += count;
+    }
+  }
+
+  return ((size_t)(wptr - buffer));
+}
+
+
 /*
  * 'cups_raster_io()' - Read/write bytes from a context, handling interruptions.
  */
@@ -1396,6 +1975,44 @@ cups_raster_io(cups_raster_t *r,	/* I - Raster stream */
 }
 
 
+/*
+ * 'cups_raster_match()' - Count the bytes that match the bytes one pixel later.
+ */
+
+static size_t				/* O - Number of matching bytes */
+cups_raster_match(
+    const unsigned char *ptr,		/* I - First pixel */
+    size_t              bpp,		/* I - Bytes per pixel */
+    size_t              bytes)		/* I - Maximum number of bytes */
+{
+  size_t	i;			/* Current byte */
+#ifdef HAVE_STDINT_H
+  uint64_t	a, b;			/* Current words */
+
+
+ /*
+  * Compare 8 bytes at a time, then finish up a byte at a time...
+  */
+
+  for (i = 0; (i + 8) <= bytes; i += 8)
+  {
+    memcpy(&a, ptr + i, 8);
+    memcpy(&b, ptr + i + bpp, 8);
+
+    if (a != b)
+      break;
+  }
+#else
+  i = 0;
+#endif /* HAVE_STDINT_H */
+
+  while (i < bytes && ptr[i] == ptr[i + bpp])
+    i ++;
+
+  return (i);
+}
+
+
 /*
  * 'cups_raster_read()' - Read through the raster buffer.
  */
@@ -1413,7 +2030,28 @@ cups_raster_read(cups_raster_t *r,	/* I - Raster stream */
   DEBUG_printf(("4cups_raster_read(r=%p, buf=%p, bytes=" CUPS_LLFMT "), offset=" CUPS_LLFMT, (void *)r, (void *)buf, CUPS_LLCAST bytes, CUPS_LLCAST (r->iostart + r->bufptr - r->buffer)));
 
   if (!r->compressed)
-    return (cups_raster_io(r, buf, bytes));
+  {
+   /*
+    * Use any lines left over from _cupsRasterReadLine before reading more...
+    */
+
+    if ((count = r->bufend - r->bufptr) <= 0)
+      return (cups_raster_io(r, buf, bytes));
+
+    if (count > (ssize_t)bytes)
+      count = (ssize_t)bytes;
+
+    memcpy(buf, r->bufptr, (size_t)count);
+    r->bufptr += count;
+
+    if ((size_t)count == bytes)
+      return (count);
+
+    if ((total = cups_raster_io(r, buf + count, bytes - (size_t)count)) < 0)
+      return (total);
+
+    return (total + count);
+  }
 
  /*
   * Allocate a read buffer as needed...
@@ -1664,6 +2302,8 @@ cups_raster_update(cups_raster_t *r)	/* I - Raster stream */
   else
     r->remaining = r->header.cupsHeight;
 
+  r->partial = 0;
+
  /*
   * Allocate the compression buffer...
   */
@@ -1700,30 +2340,13 @@ cups_raster_write(
     cups_raster_t       *r,		/* I - Raster stream */
     const unsigned char *pixels)	/* I - Pixel data to write */
 {
-  const unsigned char	*start,		/* Start of sequence */
-			*ptr,		/* Current pointer in sequence */
-			*pend,		/* End of raster buffer */
-			*plast;		/* Pointer to last pixel */
   unsigned char		*wptr;		/* Pointer into write buffer */
-  unsigned		bpp,		/* Bytes per pixel */
-			count;		/* Count */
-  _cups_copyfunc_t	cf;		/* Copy function */
+  unsigned		count;		/* Count */
+  size_t		bytes;		/* Number of compressed bytes */
 
 
   DEBUG_printf(("3cups_raster_write(r=%p, pixels=%p)", (void *)r, (void *)pixels));
 
- /*
-  * Determine whether we need to swap bytes...
-  */
-
-  if (r->swapped && (r->header.cupsBitsPerColor == 16 || r->header.cupsBitsPerPixel == 12 || r->header.cupsBitsPerPixel == 16))
-  {
-    DEBUG_puts("4cups_raster_write: Swapping bytes when writing.");
-    cf = (_cups_copyfunc_t)cups_swap_copy;
-  }
-  else
-    cf = (_cups_copyfunc_t)memcpy;
-
   /*
   * Allocate a write buffer as needed...
   */
@@ -1750,76 +2373,14 @@ cups_raster_write(
   }
 
  /*
-  * Write the row repeat count...
+  * Compress and write the line...
   */
 
-  bpp     = r->bpp;
-  pend    = pixels + r->header.cupsBytesPerLine;
-  plast   = pend - bpp;
-  wptr    = r->buffer;
-  *wptr++ = (unsigned char)(r->count - 1);
+  bytes = cups_raster_encode(r, pixels, r->count, r->buffer);
 
- /*
-  * Write using a modified PackBits compression...
-  */
+  DEBUG_printf(("4cups_raster_write: Writing " CUPS_LLFMT " bytes.", CUPS_LLCAST bytes));
 
-  for (ptr = pixels; ptr < pend;)
-  {
-    start = ptr;
-    ptr += bpp;
-
-    if (ptr == pend)
-    {
-     /*
-      * Encode a single pixel at the end...
-      */
-
-      *wptr++ = 0;
-      (*cf)(wptr, start, bpp);
-      wptr += bpp;
-    }
-    else if (!memcmp(start, ptr, bpp))
-    {
-     /*
-      * Encode a sequence of repeating pixels...
-      */
-
-      for (count = 2; count < 128 && ptr < plast; count ++, ptr += bpp)
-        if (memcmp(ptr, ptr + bpp, bpp))
-	  break;
-
-      *wptr++ = (unsigned char)(count - 1);
-      (*cf)(wptr, ptr, bpp);
-      wptr += bpp;
-      ptr  += bpp;
-    }
-    else
-    {
-     /*
-      * Encode a sequence of non-repeating pixels...
-      */
-
-      for (count = 1; count < 128 && ptr < plast; count ++, ptr += bpp)
-        if (!memcmp(ptr, ptr + bpp, bpp))
-	  break;
-
-      if (ptr >= plast && count < 128)
-      {
-        count ++;
-	ptr += bpp;
-      }
-
-      *wptr++ = (unsigned char)(257 - count);
-
-      count *= bpp;
-      (*cf)(wptr, start, count);
-      wptr += count;
-    }
-  }
-
-  DEBUG_printf(("4cups_raster_write: Writing " CUPS_LLFMT " bytes.", CUPS_LLCAST (wptr - r->buffer)));
-
-  return (cups_raster_io(r, r->buffer, (size_t)(wptr - r->buffer)));
+  return (cups_raster_io(r, r->buffer, bytes));
 }
 
 
@@ -1836,6 +2397,24 @@ cups_swap(unsigned char *buf,		/* I - Buffer to swap */
 
   bytes /= 2;
 
+#ifdef HAVE_STDINT_H
+ /*
+  * Swap 4 samples at a time...
+  */
+
+  while (bytes >= 4)
+  {
+    uint64_t	v;			/* Current samples */
+
+    memcpy(&v, buf, 8);
+    v = ((v & 0x00ff00ff00ff00ffULL) << 8) | ((v >> 8) & 0x00ff00ff00ff00ffULL);
+    memcpy(buf, &v, 8);
+
+    buf   += 8;
+    bytes -= 4;
+  }
+#endif /* HAVE_STDINT_H */
+
   while (bytes > 0)
   {
     even   = buf[0];
@@ -1861,6 +2440,25 @@ cups_swap_copy(
 {
   bytes /= 2;
 
+#ifdef HAVE_STDINT_H
+ /*
+  * Swap 4 samples at a time...
+  */
+
+  while (bytes >= 4)
+  {
+    uint64_t	v;			/* Current samples */
+
+    memcpy(&v, src, 8);
+    v = ((v & 0x00ff00ff00ff00ffULL) << 8) | ((v >> 8) & 0x00ff00ff00ff00ffULL);
+    memcpy(dst, &v, 8);
+
+    dst   += 8;
+    src   += 8;
+    bytes -= 4;
+  }
+#endif /* HAVE_STDINT_H */
+
   while (bytes > 0)
   {
     dst[0] = src[1];
@@ -211,6 +211,28 @@ cupsRasterReadHeader2(
 }
 
 
+/*
+ * 'cupsRasterReadLine()' - Read a line of raster pixels without copying.
+ *
+ * This function returns a pointer to the next "cupsBytesPerLine" bytes of
+ * pixel data from the current page.  The data belongs to the raster stream
+ * and is only valid until the next read from the stream.  Uncompressed lines
+ * are returned from the read buffer and repeated compressed lines are only
+ * decoded once.
+ *
+ * `NULL` is returned at the end of the page, on error, or when a partial
+ * line is pending from @link cupsRasterReadPixels@.
+ *
+ * @since CUPS 2.3.4@
+ */
+
+const unsigned char *			/* O - Pointer to line or `NULL` on error */
+cupsRasterReadLine(cups_raster_t *r)	/* I - Raster stream */
+{
+  return (_cupsRasterReadLine(r));
+}
+
+
 /*
  * 'cupsRasterReadPixels()' - Read raster pixels.
  *
@@ -229,6 +251,26 @@ cupsRasterReadPixels(
 }
 
 
+/*
+ * 'cupsRasterWriteBand()' - Write a band of raster lines.
+ *
+ * This function works like @link cupsRasterWritePixels@ but compresses
+ * whole lines in parallel when "len" holds several lines of data.  The
+ * compressed data is the same as with @link cupsRasterWritePixels@.
+ *
+ * @since CUPS 2.3.4@
+ */
+
+unsigned				/* O - Number of bytes written */
+cupsRasterWriteBand(
+    cups_raster_t *r,			/* I - Raster stream */
+    unsigned char *p,			/* I - Bytes to write */
+    unsigned      len)			/* I - Number of bytes to write */
+{
+  return (_cupsRasterWriteBand(r, p, len));
+}
+
+
 /*
  * 'cupsRasterWriteHeader()' - Write a raster page header from a version 1 page
  *                             header structure.
@@ -392,6 +392,10 @@ extern cups_raster_t	*cupsRasterOpenIO(cups_raster_iocb_t iocb, void *ctx, cups_
 /**** New in CUPS 2.2/macOS 10.12 ****/
 extern int		cupsRasterInitPWGHeader(cups_page_header2_t *h, pwg_media_t *media, const char *type, int xdpi, int ydpi, const char *sides, const char *sheet_back) _CUPS_API_2_2;
 
+/**** New in CUPS 2.3.4 ****/
+extern const unsigned char *cupsRasterReadLine(cups_raster_t *r) _CUPS_API_2_3_4;
+extern unsigned		cupsRasterWriteBand(cups_raster_t *r, unsigned char *p, unsigned len) _CUPS_API_2_3_4;
+
 #  ifdef __cplusplus
 }
 #  endif /* __cplusplus */
@@ -13,6 +13,7 @@
 
 #include <config.h>
 #include <cups/raster.h>
+#include <cups/string-private.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/time.h>
@@ -30,15 +31,85 @@
 #define TEST_PAGES	16
 #define TEST_PASSES	20
 
+#define SUITE_DPI	300
+#define SUITE_PAGES	2
+#define SUITE_PASSES	5
+#define SUITE_TILE	256
+
+
+/*
+ * Local types...
+ */
+
+typedef enum suite_content_e		/**** Page content ****/
+{
+  SUITE_BLANK,				/* Blank page */
+  SUITE_TEXT,				/* Black text on white */
+  SUITE_HALFTONE,			/* Halftoned gradients */
+  SUITE_PHOTO,				/* Continuous tone image */
+  SUITE_MAX_CONTENT
+} suite_content_t;
+
+typedef struct suite_buffer_s		/**** Memory raster stream ****/
+{
+  unsigned char	*data;			/* Raster data */
+  size_t	length,			/* Number of bytes written */
+		alloc,			/* Allocated bytes */
+		pos;			/* Current read position */
+} suite_buffer_t;
+
+
+/*
+ * Local globals...
+ */
+
+static const char * const suite_contents[] =
+{					/* Page content names */
+  "blank",
+  "text",
+  "halftone",
+  "photo"
+};
+static const char * const suite_modes[] =
+{					/* Write mode names, by cups_mode_t */
+  "read",
+  "write",
+  "compressed",
+  "pwg",
+  "apple"
+};
+static const char * const suite_types[] =
+{					/* Color spaces and bit depths */
+  "black_1",
+  "sgray_8",
+  "srgb_8",
+  "srgb_16",
+  "cmyk_8",
+  "cmyk_16"
+};
+static const char * const suite_apple_types[] =
+{					/* Color spaces for Apple raster */
+  "sgray_8",
+  "srgb_8",
+  "adobe-rgb_16",
+  "cmyk_8"
+};
+
 
 /*
  * Local functions...
  */
 
-static double	compute_median(double *secs);
+static double	compute_median(double *secs, int num_secs);
 static double	get_time(void);
+static void	make_tile(unsigned char *tile, cups_page_header2_t *header, suite_content_t content);
+static ssize_t	mem_read(void *ctx, unsigned char *data, size_t bytes);
+static ssize_t	mem_write(void *ctx, unsigned char *data, size_t bytes);
 static void	read_test(int fd);
 static int	run_read_test(void);
+static int	run_suite(int mode, const char *type, int content, int passes, int band, int csv);
+static int	run_suite_case(cups_mode_t mode, const char *type, suite_content_t content, int passes, int band, int csv);
+static void	usage(void);
 static void	write_test(int fd, cups_mode_t mode);
 
 
@@ -51,26 +122,114 @@ main(int  argc,				/* I - Number of command-line args */
      char *argv[])			/* I - Command-line arguments */
 {
   int		i;			/* Looping var */
+  const char	*opt;			/* Current option */
   int		ras_fd,			/* File descriptor for read process */
 		status;			/* Exit status of read process */
   double	start_secs,		/* Start time */
 		write_secs,		/* Write time */
 		read_secs,		/* Read time */
 		pass_secs[TEST_PASSES];	/* Total test times */
-  cups_mode_t	mode;			/* Write mode */
+  cups_mode_t	mode = CUPS_RASTER_WRITE;/* Write mode */
+  int		suite = 0,		/* Run the benchmark suite? */
+		suite_mode = -1,	/* Suite write mode or -1 for all */
+		content = -1,		/* Page content or -1 for all */
+		passes = SUITE_PASSES,	/* Number of suite passes */
+		band = 0,		/* Use band/line functions? */
+		csv = 0;		/* Produce CSV output? */
+  const char	*type = NULL;		/* Color space and bit depth */
 
 
  /*
   * See if we have anything on the command-line...
   */
 
-  if (argc > 2 || (argc == 2 && strcmp(argv[1], "-z")))
+  for (i = 1; i < argc; i ++)
   {
-    puts("Usage: rasterbench [-z]");
-    return (1);
+    if (argv[i][0] != '-')
+      usage();
+
+    for (opt = argv[i] + 1; *opt; opt ++)
+    {
+      switch (*opt)
+      {
+        case 'a' : /* -a (run the suite) */
+            suite = 1;
+            break;
+
+        case 'b' : /* -b (use cupsRasterWriteBand and cupsRasterReadLine) */
+            suite = 1;
+            band  = 1;
+            break;
+
+        case 'c' : /* -c (CSV output) */
+            suite = 1;
+            csv   = 1;
+            break;
+
+        case 'm' : /* -m mode */
+            i ++;
+            if (i >= argc)
+              usage();
+
+            for (suite_mode = CUPS_RASTER_WRITE; suite_mode <= CUPS_RASTER_WRITE_APPLE; suite_mode ++)
+              if (!strcmp(argv[i], suite_modes[suite_mode]))
+                break;
+
+            if (suite_mode > CUPS_RASTER_WRITE_APPLE)
+              usage();
+
+            suite = 1;
+            break;
+
+        case 'n' : /* -n passes */
+            i ++;
+            if (i >= argc || (passes = atoi(argv[i])) < 1)
+              usage();
+
+            suite = 1;
+            break;
+
+        case 's' : /* -s type */
+            i ++;
+            if (i >= argc)
+              usage();
+
+            type  = argv[i];
+            suite = 1;
+            break;
+
+        case 't' : /* -t content */
+            i ++;
+            if (i >= argc)
+              usage();
+
+            for (content = SUITE_BLANK; content < SUITE_MAX_CONTENT; content ++)
+              if (!strcmp(argv[i], suite_contents[content]))
+                break;
+
+            if (content >= SUITE_MAX_CONTENT)
+              usage();
+
+            suite = 1;
+            break;
+
+        case 'z' : /* -z (compressed pipe test) */
+            mode = CUPS_RASTER_WRITE_COMPRESSED;
+            break;
+
+        default :
+            usage();
+      }
+    }
   }
 
-  mode = argc > 1 ? CUPS_RASTER_WRITE_COMPRESSED : CUPS_RASTER_WRITE;
+  if (suite)
+  {
+    if (suite_mode < 0 && mode == CUPS_RASTER_WRITE_COMPRESSED)
+      suite_mode = CUPS_RASTER_WRITE_COMPRESSED;
+
+    return (run_suite(suite_mode, type, content, passes, band, csv));
+  }
 
  /*
   * Ignore SIGPIPE...
@@ -107,7 +266,7 @@ main(int  argc,				/* I - Number of command-line args */
   }
 
   printf("\nMedian Total Time: %.3f seconds per document\n",
-         compute_median(pass_secs));
+         compute_median(pass_secs, TEST_PASSES));
 
   return (0);
 }
@@ -118,7 +277,8 @@ main(int  argc,				/* I - Number of command-line args */
  */
 
 static double				/* O - Median time in seconds */
-compute_median(double *secs)		/* I - Array of time samples */
+compute_median(double *secs,		/* I - Array of time samples */
+               int    num_secs)		/* I - Number of samples */
 {
   int		i, j;			/* Looping vars */
   double	temp;			/* Swap variable */
@@ -128,8 +288,8 @@ compute_median(double *secs)		/* I - Array of time samples */
   * Sort the array into ascending order using a quicky bubble sort...
   */
 
-  for (i = 0; i < (TEST_PASSES - 1); i ++)
-    for (j = i + 1; j < TEST_PASSES; j ++)
+  for (i = 0; i < (num_secs - 1); i ++)
+    for (j = i + 1; j < num_secs; j ++)
       if (secs[i] > secs[j])
       {
         temp    = secs[i];
@@ -138,10 +298,13 @@ compute_median(double *secs)		/* I - Array of time samples */
       }
 
  /*
-  * Return the average of the middle two samples...
+  * Return the middle sample or the average of the middle two samples...
   */
 
-  return (0.5 * (secs[TEST_PASSES / 2 - 1] + secs[TEST_PASSES / 2]));
+  if (num_secs & 1)
+    return (secs[num_secs / 2]);
+  else
+    return (0.5 * (secs[num_secs / 2 - 1] + secs[num_secs / 2]));
 }
 
 
@@ -160,6 +323,177 @@ get_time(void)
 }
 
 
+/*
+ * 'make_tile()' - Make a band of test content that is repeated down the page.
+ */
+
+static void
+make_tile(unsigned char       *tile,	/* I - Tile buffer */
+          cups_page_header2_t *header,	/* I - Page header */
+          suite_content_t     content)	/* I - Page content */
+{
+  unsigned		x, y, c,	/* Looping vars */
+			sample,		/* Sample number */
+			row,		/* Row within line of text */
+			cell,		/* Character cell */
+			hash,		/* Glyph hash */
+			ink,		/* Amount of ink (0 to 65535) */
+			value;		/* Sample value */
+  unsigned char		*line;		/* Current line */
+  int			additive;	/* Additive color space? */
+  static const unsigned char bayer[8][8] =
+  {					/* Ordered dither matrix */
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 }
+  };
+
+
+  additive = header->cupsColorSpace != CUPS_CSPACE_CMYK && header->cupsColorSpace != CUPS_CSPACE_K;
+
+  memset(tile, 0, SUITE_TILE * header->cupsBytesPerLine);
+
+  for (y = 0, line = tile; y < SUITE_TILE; y ++, line += header->cupsBytesPerLine)
+  {
+    for (x = 0; x < header->cupsWidth; x ++)
+    {
+      for (c = 0; c < header->cupsNumColors; c ++)
+      {
+        switch (content)
+        {
+          default :
+              ink = 0;
+              break;
+
+          case SUITE_TEXT :
+             /*
+              * Lines of 20x32 pixel glyphs with word gaps, leading, and a
+              * ragged right margin; CMYK text only uses black ink...
+              */
+
+              row  = y % 48;
+              cell = x / 24;
+
+              if (row >= 32 || (x % 24) >= 20 || (cell % 7) == 6 ||
+                  cell >= header->cupsWidth / 24 - (y / 48) * 7 % 10 ||
+                  (header->cupsColorSpace == CUPS_CSPACE_CMYK && c < 3))
+              {
+                ink = 0;
+              }
+              else
+              {
+                hash = (x / 3) * 73856093U ^ (row / 4) * 19349663U ^ (y / 48 + cell) * 83492791U;
+                ink  = ((hash >> 8) % 5) < 2 ? 65535 : 0;
+              }
+              break;
+
+          case SUITE_HALFTONE :
+             /*
+              * Horizontal gradients, offset for each colorant, dithered
+              * with an 8x8 Bayer matrix...
+              */
+
+              ink = ((x + c * header->cupsWidth / 4) % header->cupsWidth) * 65535 / header->cupsWidth;
+              ink = ink > bayer[y & 7][x & 7] * 1024U + 512 ? 65535 : 0;
+              break;
+
+          case SUITE_PHOTO :
+             /*
+              * Smooth gradients with sensor noise...
+              */
+
+              ink = x * 40000 / header->cupsWidth + y * 20000 / SUITE_TILE + c * 5000 + (CUPS_RAND() & 1023);
+              if (ink > 65535)
+                ink = 65535;
+              break;
+        }
+
+        value  = additive ? 65535 - ink : ink;
+        sample = x * header->cupsNumColors + c;
+
+        switch (header->cupsBitsPerColor)
+        {
+          case 1 :
+              if (value & 0x8000)
+                line[sample / 8] |= (unsigned char)(0x80 >> (sample & 7));
+              break;
+
+          case 8 :
+              line[sample] = (unsigned char)(value >> 8);
+              break;
+
+          case 16 :
+              line[2 * sample]     = (unsigned char)(value >> 8);
+              line[2 * sample + 1] = (unsigned char)value;
+              break;
+        }
+      }
+    }
+  }
+}
+
+
+/*
+ * 'mem_read()' - Read raster data from memory.
+ */
+
+static ssize_t				/* O - Bytes read or -1 on error */
+mem_read(void          *ctx,		/* I - Memory buffer */
+         unsigned char *data,		/* I - Buffer to read into */
+         size_t        bytes)		/* I - Number of bytes to read */
+{
+  suite_buffer_t	*buffer = (suite_buffer_t *)ctx;
+					/* Memory buffer */
+
+
+  if (bytes > (buffer->length - buffer->pos))
+    bytes = buffer->length - buffer->pos;
+
+  memcpy(data, buffer->data + buffer->pos, bytes);
+  buffer->pos += bytes;
+
+  return ((ssize_t)bytes);
+}
+
+
+/*
+ * 'mem_write()' - Write raster data to memory.
+ */
+
+static ssize_t				/* O - Bytes written or -1 on error */
+mem_write(void          *ctx,		/* I - Memory buffer */
+          unsigned char *data,		/* I - Data to write */
+          size_t        bytes)		/* I - Number of bytes to write */
+{
+  suite_buffer_t	*buffer = (suite_buffer_t *)ctx;
+					/* Memory buffer */
+  unsigned char		*temp;		/* New buffer */
+  size_t		alloc;		/* New allocation size */
+
+
+  if ((buffer->length + bytes) > buffer->alloc)
+  {
+    for (alloc = buffer->alloc ? buffer->alloc : 1048576; alloc < (buffer->length + bytes); alloc *= 2);
+
+    if ((temp = realloc(buffer->data, alloc)) == NULL)
+      return (-1);
+
+    buffer->data  = temp;
+    buffer->alloc = alloc;
+  }
+
+  memcpy(buffer->data + buffer->length, data, bytes);
+  buffer->length += bytes;
+
+  return ((ssize_t)bytes);
+}
+
+
 /*
  * 'read_test()' - Benchmark the raster read functions.
  */
@@ -241,6 +575,287 @@ run_read_test(void)
 }
 
 
+/*
+ * 'run_suite()' - Run the raster codec benchmark suite.
+ */
+
+static int				/* O - Exit status */
+run_suite(int        mode,		/* I - Write mode or -1 for all */
+          const char *type,		/* I - Color space and bit depth or `NULL` for all */
+          int        content,		/* I - Page content or -1 for all */
+          int        passes,		/* I - Number of passes */
+          int        band,		/* I - Use band/line functions? */
+          int        csv)		/* I - Produce CSV output? */
+{
+  int			m,		/* Current mode */
+			c,		/* Current content */
+			status = 0;	/* Exit status */
+  size_t		t,		/* Current type */
+			num_types;	/* Number of types */
+  const char * const	*types;		/* Types */
+  cups_page_header2_t	header;		/* Page header */
+
+
+  if (type && !cupsRasterInitPWGHeader(&header, pwgMediaForPWG("na_letter_8.5x11in"), type, SUITE_DPI, SUITE_DPI, "one-sided", NULL))
+  {
+    fprintf(stderr, "rasterbench: Unsupported type \"%s\": %s\n", type, cupsRasterErrorString());
+    return (1);
+  }
+
+  if (csv)
+  {
+    puts("mode,type,content,width,height,pages,bytes,encoded_bytes,ratio,write_secs,read_secs,write_mbps,read_mbps,write_rows_per_sec,read_rows_per_sec");
+  }
+  else
+  {
+    printf("Test raster codec speed of %d letter pages at %ddpi, median of %d passes%s...\n\n", SUITE_PAGES, SUITE_DPI, passes, band ? " using bands" : "");
+    printf("%-10s %-12s %-8s %10s %10s %12s %12s %7s\n", "Mode", "Type", "Content", "Write MB/s", "Read MB/s", "Write rows/s", "Read rows/s", "Ratio");
+  }
+
+  for (m = CUPS_RASTER_WRITE; m <= CUPS_RASTER_WRITE_APPLE; m ++)
+  {
+    if (mode >= 0 && m != mode)
+      continue;
+
+    if (type)
+    {
+      types     = &type;
+      num_types = 1;
+    }
+    else if (m == CUPS_RASTER_WRITE_APPLE)
+    {
+      types     = suite_apple_types;
+      num_types = sizeof(suite_apple_types) / sizeof(suite_apple_types[0]);
+    }
+    else
+    {
+      types     = suite_types;
+      num_types = sizeof(suite_types) / sizeof(suite_types[0]);
+    }
+
+    for (t = 0; t < num_types; t ++)
+    {
+      for (c = SUITE_BLANK; c < SUITE_MAX_CONTENT; c ++)
+      {
+        if (content >= 0 && c != content)
+          continue;
+
+        if (run_suite_case((cups_mode_t)m, types[t], (suite_content_t)c, passes, band, csv))
+          status = 1;
+      }
+    }
+  }
+
+  return (status);
+}
+
+
+/*
+ * 'run_suite_case()' - Benchmark writing and reading one kind of page.
+ */
+
+static int				/* O - 0 on success, 1 on error */
+run_suite_case(
+    cups_mode_t     mode,		/* I - Write mode */
+    const char      *type,		/* I - Color space and bit depth */
+    suite_content_t content,		/* I - Page content */
+    int             passes,		/* I - Number of passes */
+    int             band,		/* I - Use band/line functions? */
+    int             csv)		/* I - Produce CSV output? */
+{
+  int			i,		/* Looping var */
+			pages,		/* Pages read */
+			status = 0;	/* Return status */
+  unsigned		page,		/* Current page */
+			y,		/* Current line */
+			j,		/* Line in band */
+			lines;		/* Lines in band */
+  cups_raster_t		*r;		/* Raster stream */
+  cups_page_header2_t	header,		/* Page header */
+			inheader;	/* Page header that was read */
+  suite_buffer_t	buffer;		/* Memory buffer for raster data */
+  unsigned char		*tile,		/* Page content */
+			*line;		/* Line buffer for reading */
+  double		start,		/* Start time */
+			*write_secs,	/* Write times */
+			*read_secs,	/* Read times */
+			wsecs,		/* Median write time */
+			rsecs,		/* Median read time */
+			bytes,		/* Uncompressed bytes */
+			rows;		/* Number of lines */
+
+
+  if (!cupsRasterInitPWGHeader(&header, pwgMediaForPWG("na_letter_8.5x11in"), type, SUITE_DPI, SUITE_DPI, "one-sided", NULL))
+  {
+    fprintf(stderr, "rasterbench: Unable to create %s page header: %s\n", type, cupsRasterErrorString());
+    return (1);
+  }
+
+  header.cupsInteger[CUPS_RASTER_PWG_TotalPageCount] = SUITE_PAGES;
+
+  tile       = malloc(SUITE_TILE * header.cupsBytesPerLine);
+  line       = malloc(header.cupsBytesPerLine);
+  write_secs = calloc((size_t)passes, sizeof(double));
+  read_secs  = calloc((size_t)passes, sizeof(double));
+
+  memset(&buffer, 0, sizeof(buffer));
+
+  if (!tile || !line || !write_secs || !read_secs)
+  {
+    perror("rasterbench: Unable to allocate memory");
+    status = 1;
+    passes = 0;
+  }
+  else
+    make_tile(tile, &header, content);
+
+  for (i = 0; i < passes && !status; i ++)
+  {
+   /*
+    * Test write speed...
+    */
+
+    buffer.length = 0;
+    start         = get_time();
+
+    if ((r = cupsRasterOpenIO(mem_write, &buffer, mode)) == NULL)
+    {
+      perror("rasterbench: Unable to create raster output stream");
+      status = 1;
+      break;
+    }
+
+    for (page = 0; page < SUITE_PAGES && !status; page ++)
+    {
+      if (!cupsRasterWriteHeader2(r, &header))
+      {
+        fprintf(stderr, "rasterbench: Unable to write %s page header: %s\n", type, cupsRasterErrorString());
+        status = 1;
+        break;
+      }
+
+      for (y = 0; y < header.cupsHeight && !status; y += lines)
+      {
+        if ((lines = header.cupsHeight - y) > SUITE_TILE)
+          lines = SUITE_TILE;
+
+        if (band)
+        {
+          if (!cupsRasterWriteBand(r, tile, lines * header.cupsBytesPerLine))
+            status = 1;
+        }
+        else
+        {
+          for (j = 0; j < lines && !status; j ++)
+            if (!cupsRasterWritePixels(r, tile + j * header.cupsBytesPerLine, header.cupsBytesPerLine))
+              status = 1;
+        }
+      }
+    }
+
+    cupsRasterClose(r);
+
+    write_secs[i] = get_time() - start;
+
+    if (status)
+    {
+      fprintf(stderr, "rasterbench: Unable to write %s %s page.\n", suite_modes[mode], type);
+      break;
+    }
+
+   /*
+    * Test read speed...
+    */
+
+    buffer.pos = 0;
+    pages      = 0;
+    start      = get_time();
+
+    if ((r = cupsRasterOpenIO(mem_read, &buffer, CUPS_RASTER_READ)) == NULL)
+    {
+      perror("rasterbench: Unable to create raster input stream");
+      status = 1;
+      break;
+    }
+
+    while (!status && cupsRasterReadHeader2(r, &inheader))
+    {
+      for (y = 0; y < inheader.cupsHeight && !status; y ++)
+      {
+        if (band)
+        {
+          if (!cupsRasterReadLine(r))
+            status = 1;
+        }
+        else if (cupsRasterReadPixels(r, line, inheader.cupsBytesPerLine) != inheader.cupsBytesPerLine)
+          status = 1;
+      }
+
+      pages ++;
+    }
+
+    cupsRasterClose(r);
+
+    read_secs[i] = get_time() - start;
+
+    if (status || pages != SUITE_PAGES)
+    {
+      fprintf(stderr, "rasterbench: Unable to read %s %s pages (got %d of %d).\n", suite_modes[mode], type, pages, SUITE_PAGES);
+      status = 1;
+    }
+  }
+
+  if (!status)
+  {
+   /*
+    * Report the median times...
+    */
+
+    wsecs = compute_median(write_secs, passes);
+    rsecs = compute_median(read_secs, passes);
+    bytes = (double)SUITE_PAGES * header.cupsHeight * header.cupsBytesPerLine;
+    rows  = (double)SUITE_PAGES * header.cupsHeight;
+
+    if (csv)
+      printf("%s,%s,%s,%u,%u,%d,%.0f,%lu,%.3f,%.6f,%.6f,%.1f,%.1f,%.0f,%.0f\n", suite_modes[mode], type, suite_contents[content], header.cupsWidth, header.cupsHeight, SUITE_PAGES, bytes, (unsigned long)buffer.length, bytes / buffer.length, wsecs, rsecs, bytes / wsecs / 1000000.0, bytes / rsecs / 1000000.0, rows / wsecs, rows / rsecs);
+    else
+      printf("%-10s %-12s %-8s %10.1f %10.1f %12.0f %12.0f %7.2f\n", suite_modes[mode], type, suite_contents[content], bytes / wsecs / 1000000.0, bytes / rsecs / 1000000.0, rows / wsecs, rows / rsecs, bytes / buffer.length);
+  }
+
+  free(tile);
+  free(line);
+  free(write_secs);
+  free(read_secs);
+  free(buffer.data);
+
+  return (status);
+}
+
+
+/*
+ * 'usage()' - Show program usage.
+ */
+
+static void
+usage(void)
+{
+  puts("Usage: rasterbench [-z]");
+  puts("       rasterbench [-abc] [-m mode] [-n passes] [-s type] [-t content]");
+  puts("");
+  puts("Options:");
+  puts("  -a          Run the codec benchmark suite.");
+  puts("  -b          Use cupsRasterWriteBand and cupsRasterReadLine.");
+  puts("  -c          Produce CSV output.");
+  puts("  -m mode     Only test mode 'write', 'compressed', 'pwg', or 'apple'.");
+  puts("  -n passes   Number of passes (default 5).");
+  puts("  -s type     Only test the given PWG raster type, for example 'srgb_8'.");
+  puts("  -t content  Only test content 'blank', 'text', 'halftone', or 'photo'.");
+  puts("  -z          Use compressed raster data.");
+
+  exit(1);
+}
+
+
 /*
  * 'write_test()' - Benchmark the raster write functions.
  */
@@ -376,7 +376,7 @@ cupsGetResponse(http_t     *http,	/* I - Connection to server or @code CUPS_HTTP
     * Get the IPP response...
     */
 
-    response = ippNew();
+    response = _ippNewArena();
 
     while ((state = ippRead(http, response)) != IPP_STATE_DATA)
       if (state == IPP_STATE_ERROR)
@@ -940,7 +940,7 @@ cupsWriteRequestData(
   * Finally, check if we have any pending data from the server...
   */
 
-  if (length >= HTTP_MAX_BUFFER ||
+  if (length >= http->bufsize ||
       http->wused < wused ||
       (wused > 0 && (size_t)http->wused == length))
   {
@@ -67,6 +67,8 @@ typedef struct _cups_sp_item_s		/**** String Pool Item ****/
   unsigned int	guard;			/* Guard word */
 #  endif /* DEBUG_GUARDS */
   unsigned int	ref_count;		/* Reference count */
+  unsigned int	hash;			/* Hash of string */
+  struct _cups_sp_item_s *next;		/* Next string in hash bucket */
   char		str[1];			/* String */
 } _cups_sp_item_t;
 
@@ -187,6 +189,7 @@ extern int	_cups_vsnprintf(char *, size_t, const char *, va_list) _CUPS_PRIVATE;
 extern char	*_cupsStrAlloc(const char *s) _CUPS_PRIVATE;
 extern void	_cupsStrFlush(void) _CUPS_PRIVATE;
 extern void	_cupsStrFree(const char *s) _CUPS_PRIVATE;
+extern size_t	_cupsStrLockStatistics(size_t *contended) _CUPS_PRIVATE;
 extern char	*_cupsStrRetain(const char *s) _CUPS_PRIVATE;
 extern size_t	_cupsStrStatistics(size_t *alloc_bytes, size_t *total_bytes) _CUPS_PRIVATE;
 
@@ -19,21 +19,50 @@
 #include <limits.h>
 
 
+/*
+ * Local types...
+ */
+
+#define _CUPS_SP_SHARDS	16		/* Number of string pool shards */
+#define _CUPS_SP_BUCKETS 64		/* Initial number of hash buckets */
+
+typedef struct _cups_sp_shard_s		/**** String Pool Shard ****/
+{
+  _cups_mutex_t		mutex;		/* Mutex to control access to shard */
+  _cups_sp_item_t	**buckets;	/* Hash buckets */
+  size_t		num_buckets,	/* Number of hash buckets */
+			num_items,	/* Number of strings */
+			locks,		/* Number of times locked */
+			contended;	/* Number of times we had to wait */
+} _cups_sp_shard_t;
+
+#define _CUPS_SP_SHARD_INITIALIZER { _CUPS_MUTEX_INITIALIZER, NULL, 0, 0, 0, 0 }
+
+
 /*
  * Local globals...
  */
 
-static _cups_mutex_t	sp_mutex = _CUPS_MUTEX_INITIALIZER;
-					/* Mutex to control access to pool */
-static cups_array_t	*stringpool = NULL;
-					/* Global string pool */
+static _cups_sp_shard_t	sp_shards[_CUPS_SP_SHARDS] =
+{					/* Global string pool */
+  _CUPS_SP_SHARD_INITIALIZER, _CUPS_SP_SHARD_INITIALIZER,
+  _CUPS_SP_SHARD_INITIALIZER, _CUPS_SP_SHARD_INITIALIZER,
+  _CUPS_SP_SHARD_INITIALIZER, _CUPS_SP_SHARD_INITIALIZER,
+  _CUPS_SP_SHARD_INITIALIZER, _CUPS_SP_SHARD_INITIALIZER,
+  _CUPS_SP_SHARD_INITIALIZER, _CUPS_SP_SHARD_INITIALIZER,
+  _CUPS_SP_SHARD_INITIALIZER, _CUPS_SP_SHARD_INITIALIZER,
+  _CUPS_SP_SHARD_INITIALIZER, _CUPS_SP_SHARD_INITIALIZER,
+  _CUPS_SP_SHARD_INITIALIZER, _CUPS_SP_SHARD_INITIALIZER
+};
 
 
 /*
  * Local functions...
  */
 
-static int	compare_sp_items(_cups_sp_item_t *a, _cups_sp_item_t *b);
+static unsigned	sp_hash(const char *s);
+static _cups_sp_shard_t *sp_lock(unsigned hash);
+static void	sp_resize(_cups_sp_shard_t *shard);
 
 
 /*
@@ -44,8 +73,10 @@ char *					/* O - String pointer */
 _cupsStrAlloc(const char *s)		/* I - String */
 {
   size_t		slen;		/* Length of string */
+  unsigned		hash;		/* Hash of string */
+  _cups_sp_shard_t	*shard;		/* String pool shard */
   _cups_sp_item_t	*item,		/* String pool item */
-			*key;		/* Search key */
+			**bucket;	/* Hash bucket */
 
 
  /*
@@ -56,47 +87,53 @@ _cupsStrAlloc(const char *s)		/* I - String */
     return (NULL);
 
  /*
-  * Get the string pool...
+  * Get the string pool shard for this string...
   */
 
-  _cupsMutexLock(&sp_mutex);
-
-  if (!stringpool)
-    stringpool = cupsArrayNew((cups_array_func_t)compare_sp_items, NULL);
+  hash  = sp_hash(s);
+  shard = sp_lock(hash);
 
-  if (!stringpool)
+  if (!shard->buckets)
   {
-    _cupsMutexUnlock(&sp_mutex);
+    sp_resize(shard);
 
-    return (NULL);
+    if (!shard->buckets)
+    {
+      _cupsMutexUnlock(&shard->mutex);
+
+      return (NULL);
+    }
   }
 
  /*
   * See if the string is already in the pool...
   */
 
-  key = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
+  bucket = shard->buckets + ((hash / _CUPS_SP_SHARDS) & (shard->num_buckets - 1));
 
-  if ((item = (_cups_sp_item_t *)cupsArrayFind(stringpool, key)) != NULL)
+  for (item = *bucket; item; item = item->next)
   {
-   /*
-    * Found it, return the cached string...
-    */
+    if (item->hash == hash && !strcmp(item->str, s))
+    {
+     /*
+      * Found it, return the cached string...
+      */
 
-    item->ref_count ++;
+      item->ref_count ++;
 
 #ifdef DEBUG_GUARDS
-    DEBUG_printf(("5_cupsStrAlloc: Using string %p(%s) for \"%s\", guard=%08x, "
-                  "ref_count=%d", item, item->str, s, item->guard,
-		  item->ref_count));
+      DEBUG_printf(("5_cupsStrAlloc: Using string %p(%s) for \"%s\", guard=%08x, "
+		    "ref_count=%d", item, item->str, s, item->guard,
+		    item->ref_count));
 
-    if (item->guard != _CUPS_STR_GUARD)
-      abort();
+      if (item->guard != _CUPS_STR_GUARD)
+	abort();
 #endif /* DEBUG_GUARDS */
 
-    _cupsMutexUnlock(&sp_mutex);
+      _cupsMutexUnlock(&shard->mutex);
 
-    return (item->str);
+      return (item->str);
+    }
   }
 
  /*
@@ -107,12 +144,13 @@ _cupsStrAlloc(const char *s)		/* I - String */
   item = (_cups_sp_item_t *)calloc(1, sizeof(_cups_sp_item_t) + slen);
   if (!item)
   {
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&shard->mutex);
 
     return (NULL);
   }
 
   item->ref_count = 1;
+  item->hash      = hash;
   memcpy(item->str, s, slen + 1);
 
 #ifdef DEBUG_GUARDS
@@ -127,9 +165,15 @@ _cupsStrAlloc(const char *s)		/* I - String */
   * Add the string to the pool and return it...
   */
 
-  cupsArrayAdd(stringpool, item);
+  item->next = *bucket;
+  *bucket    = item;
+
+  shard->num_items ++;
 
-  _cupsMutexUnlock(&sp_mutex);
+  if (shard->num_items > shard->num_buckets)
+    sp_resize(shard);
+
+  _cupsMutexUnlock(&shard->mutex);
 
   return (item->str);
 }
@@ -175,23 +219,37 @@ _cupsStrDate(char   *buf,		/* I - Buffer */
 void
 _cupsStrFlush(void)
 {
-  _cups_sp_item_t	*item;		/* Current item */
+  int			i;		/* Looping var */
+  size_t		j;		/* Looping var */
+  _cups_sp_shard_t	*shard;		/* Current shard */
+  _cups_sp_item_t	*item,		/* Current item */
+			*next;		/* Next item */
 
 
-  DEBUG_printf(("4_cupsStrFlush: %d strings in array",
-                cupsArrayCount(stringpool)));
+  for (i = 0, shard = sp_shards; i < _CUPS_SP_SHARDS; i ++, shard ++)
+  {
+    _cupsMutexLock(&shard->mutex);
 
-  _cupsMutexLock(&sp_mutex);
+    DEBUG_printf(("4_cupsStrFlush: %d strings in shard %d",
+                  (int)shard->num_items, i));
 
-  for (item = (_cups_sp_item_t *)cupsArrayFirst(stringpool);
-       item;
-       item = (_cups_sp_item_t *)cupsArrayNext(stringpool))
-    free(item);
+    for (j = 0; j < shard->num_buckets; j ++)
+    {
+      for (item = shard->buckets[j]; item; item = next)
+      {
+        next = item->next;
+	free(item);
+      }
+    }
 
-  cupsArrayDelete(stringpool);
-  stringpool = NULL;
+    free(shard->buckets);
 
-  _cupsMutexUnlock(&sp_mutex);
+    shard->buckets     = NULL;
+    shard->num_buckets = 0;
+    shard->num_items   = 0;
+
+    _cupsMutexUnlock(&shard->mutex);
+  }
 }
 
 
@@ -282,7 +340,10 @@ _cupsStrFormatd(char         *buf,	/* I - String */
 void
 _cupsStrFree(const char *s)		/* I - String to free */
 {
+  unsigned		hash;		/* Hash of string */
+  _cups_sp_shard_t	*shard;		/* String pool shard */
   _cups_sp_item_t	*item,		/* String pool item */
+			**prev,		/* Previous item in bucket */
 			*key;		/* Search key */
 
 
@@ -297,51 +358,92 @@ _cupsStrFree(const char *s)		/* I - String to free */
   * Check the string pool...
   *
   * We don't need to lock the mutex yet, as we only want to know if
-  * the stringpool is initialized.  The rest of the code will still
+  * the shard is initialized.  The rest of the code will still
   * work if it is initialized before we lock...
   */
 
-  if (!stringpool)
+  hash = sp_hash(s);
+
+  if (!sp_shards[hash % _CUPS_SP_SHARDS].buckets)
     return;
 
  /*
   * See if the string is already in the pool...
   */
 
-  _cupsMutexLock(&sp_mutex);
-
-  key = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
+  shard = sp_lock(hash);
+  key   = (_cups_sp_item_t *)(s - offsetof(_cups_sp_item_t, str));
 
-  if ((item = (_cups_sp_item_t *)cupsArrayFind(stringpool, key)) != NULL &&
-      item == key)
+  if (shard->buckets)
   {
-   /*
-    * Found it, dereference...
-    */
+    for (prev = shard->buckets + ((hash / _CUPS_SP_SHARDS) & (shard->num_buckets - 1));
+         (item = *prev) != NULL;
+	 prev = &(item->next))
+    {
+      if (item != key)
+        continue;
+
+     /*
+      * Found it, dereference...
+      */
 
 #ifdef DEBUG_GUARDS
-    if (key->guard != _CUPS_STR_GUARD)
-    {
-      DEBUG_printf(("5_cupsStrFree: Freeing string %p(%s), guard=%08x, ref_count=%d", key, key->str, key->guard, key->ref_count));
-      abort();
-    }
+      if (key->guard != _CUPS_STR_GUARD)
+      {
+	DEBUG_printf(("5_cupsStrFree: Freeing string %p(%s), guard=%08x, ref_count=%d", key, key->str, key->guard, key->ref_count));
+	abort();
+      }
 #endif /* DEBUG_GUARDS */
 
-    item->ref_count --;
+      item->ref_count --;
 
-    if (!item->ref_count)
-    {
-     /*
-      * Remove and free...
-      */
+      if (!item->ref_count)
+      {
+       /*
+	* Remove and free...
+	*/
 
-      cupsArrayRemove(stringpool, item);
+	*prev = item->next;
+	shard->num_items --;
 
-      free(item);
+	free(item);
+      }
+      break;
     }
   }
 
-  _cupsMutexUnlock(&sp_mutex);
+  _cupsMutexUnlock(&shard->mutex);
+}
+
+
+/*
+ * '_cupsStrLockStatistics()' - Return lock statistics for the string pool.
+ */
+
+size_t					/* O - Number of times locked */
+_cupsStrLockStatistics(
+    size_t *contended)			/* O - Number of times we had to wait */
+{
+  int			i;		/* Looping var */
+  _cups_sp_shard_t	*shard;		/* Current shard */
+  size_t		locks,		/* Number of times locked */
+			waits;		/* Number of times we had to wait */
+
+
+  for (i = 0, locks = 0, waits = 0, shard = sp_shards; i < _CUPS_SP_SHARDS; i ++, shard ++)
+  {
+    _cupsMutexLock(&shard->mutex);
+
+    locks += shard->locks;
+    waits += shard->contended;
+
+    _cupsMutexUnlock(&shard->mutex);
+  }
+
+  if (contended)
+    *contended = waits;
+
+  return (locks);
 }
 
 
@@ -372,11 +474,11 @@ _cupsStrRetain(const char *s)		/* I - String to retain */
     }
 #endif /* DEBUG_GUARDS */
 
-    _cupsMutexLock(&sp_mutex);
+    _cupsMutexLock(&sp_shards[item->hash % _CUPS_SP_SHARDS].mutex);
 
     item->ref_count ++;
 
-    _cupsMutexUnlock(&sp_mutex);
+    _cupsMutexUnlock(&sp_shards[item->hash % _CUPS_SP_SHARDS].mutex);
   }
 
   return ((char *)s);
@@ -529,10 +631,13 @@ size_t					/* O - Number of strings */
 _cupsStrStatistics(size_t *alloc_bytes,	/* O - Allocated bytes */
                    size_t *total_bytes)	/* O - Total string bytes */
 {
-  size_t		count,		/* Number of strings */
+  int			i;		/* Looping var */
+  size_t		j,		/* Looping var */
+			count,		/* Number of strings */
 			abytes,		/* Allocated string bytes */
 			tbytes,		/* Total string bytes */
 			len;		/* Length of string */
+  _cups_sp_shard_t	*shard;		/* Current shard */
   _cups_sp_item_t	*item;		/* Current item */
 
 
@@ -540,24 +645,29 @@ _cupsStrStatistics(size_t *alloc_bytes,	/* O - Allocated bytes */
   * Loop through strings in pool, counting everything up...
   */
 
-  _cupsMutexLock(&sp_mutex);
-
-  for (count = 0, abytes = 0, tbytes = 0,
-           item = (_cups_sp_item_t *)cupsArrayFirst(stringpool);
-       item;
-       item = (_cups_sp_item_t *)cupsArrayNext(stringpool))
+  for (i = 0, count = 0, abytes = 0, tbytes = 0, shard = sp_shards; i < _CUPS_SP_SHARDS; i ++, shard ++)
   {
-   /*
-    * Count allocated memory, using a 64-bit aligned buffer as a basis.
-    */
+    _cupsMutexLock(&shard->mutex);
 
-    count  += item->ref_count;
-    len    = (strlen(item->str) + 8) & (size_t)~7;
-    abytes += sizeof(_cups_sp_item_t) + len;
-    tbytes += item->ref_count * len;
-  }
+    abytes += shard->num_buckets * sizeof(_cups_sp_item_t *);
 
-  _cupsMutexUnlock(&sp_mutex);
+    for (j = 0; j < shard->num_buckets; j ++)
+    {
+      for (item = shard->buckets[j]; item; item = item->next)
+      {
+       /*
+	* Count allocated memory, using a 64-bit aligned buffer as a basis.
+	*/
+
+	count  += item->ref_count;
+	len    = (strlen(item->str) + 8) & (size_t)~7;
+	abytes += sizeof(_cups_sp_item_t) + len;
+	tbytes += item->ref_count * len;
+      }
+    }
+
+    _cupsMutexUnlock(&shard->mutex);
+  }
 
  /*
   * Return values...
@@ -754,12 +864,82 @@ _cups_strlcpy(char       *dst,		/* O - Destination string */
 
 
 /*
- * 'compare_sp_items()' - Compare two string pool items...
+ * 'sp_hash()' - Compute the hash of a string pool string.
  */
 
-static int				/* O - Result of comparison */
-compare_sp_items(_cups_sp_item_t *a,	/* I - First item */
-                 _cups_sp_item_t *b)	/* I - Second item */
+static unsigned				/* O - Hash value */
+sp_hash(const char *s)			/* I - String */
 {
-  return (strcmp(a->str, b->str));
+  unsigned	hash;			/* Hash value */
+
+
+ /*
+  * FNV-1a hash...
+  */
+
+  for (hash = 2166136261U; *s; s ++)
+    hash = (hash ^ (unsigned char)*s) * 16777619U;
+
+  return (hash);
+}
+
+
+/*
+ * 'sp_lock()' - Lock the string pool shard for a hash value.
+ */
+
+static _cups_sp_shard_t *		/* O - Locked shard */
+sp_lock(unsigned hash)			/* I - Hash value */
+{
+  _cups_sp_shard_t	*shard;		/* String pool shard */
+
+
+  shard = sp_shards + hash % _CUPS_SP_SHARDS;
+
+  if (_cupsMutexTryLock(&shard->mutex))
+  {
+    _cupsMutexLock(&shard->mutex);
+    shard->contended ++;
+  }
+
+  shard->locks ++;
+
+  return (shard);
+}
+
+
+/*
+ * 'sp_resize()' - Allocate or grow the hash buckets for a shard.
+ */
+
+static void
+sp_resize(_cups_sp_shard_t *shard)	/* I - Locked shard */
+{
+  size_t		i,		/* Looping var */
+			num_buckets;	/* New number of buckets */
+  _cups_sp_item_t	**buckets,	/* New buckets */
+			*item,		/* Current item */
+			*next;		/* Next item */
+
+
+  num_buckets = shard->num_buckets ? 2 * shard->num_buckets : _CUPS_SP_BUCKETS;
+
+  if ((buckets = (_cups_sp_item_t **)calloc(num_buckets, sizeof(_cups_sp_item_t *))) == NULL)
+    return;				/* Keep using the old buckets */
+
+  for (i = 0; i < shard->num_buckets; i ++)
+  {
+    for (item = shard->buckets[i]; item; item = next)
+    {
+      next = item->next;
+
+      item->next = buckets[(item->hash / _CUPS_SP_SHARDS) & (num_buckets - 1)];
+      buckets[(item->hash / _CUPS_SP_SHARDS) & (num_buckets - 1)] = item;
+    }
+  }
+
+  free(shard->buckets);
+
+  shard->buckets     = buckets;
+  shard->num_buckets = num_buckets;
 }
@@ -286,10 +286,13 @@ static ipp_uchar_t mixed[] =		/* Mixed value buffer */
  * Local functions...
  */
 
+ipp_attribute_t *find_linear(ipp_t *ipp, const char *name, ipp_tag_t type, int n);
 void	hex_dump(const char *title, ipp_uchar_t *buffer, size_t bytes);
 void	print_attributes(ipp_t *ipp, int indent);
 ssize_t	read_cb(_ippdata_t *data, ipp_uchar_t *buffer, size_t bytes);
 ssize_t	read_hex(cups_file_t *fp, ipp_uchar_t *buffer, size_t bytes);
+int	test_arena(void);
+int	test_index(void);
 int	token_cb(_ipp_file_t *f, _ipp_vars_t *v, void *user_data, const char *token);
 ssize_t	write_cb(_ippdata_t *data, ipp_uchar_t *buffer, size_t bytes);
 
@@ -748,6 +751,20 @@ main(int  argc,			/* I - Number of command-line arguments */
 
     ippDelete(request);
 
+   /*
+    * Test the attribute name index used for long messages...
+    */
+
+    if (!test_index())
+      status = 1;
+
+   /*
+    * Test arena messages, which are used for requests and responses...
+    */
+
+    if (!test_arena())
+      status = 1;
+
 #ifdef DEBUG
    /*
     * Test that private option array is sorted...
@@ -876,6 +893,31 @@ main(int  argc,			/* I - Number of command-line arguments */
 }
 
 
+/*
+ * 'find_linear()' - Find the Nth matching attribute without the name index.
+ */
+
+ipp_attribute_t *			/* O - Matching attribute or NULL */
+find_linear(ipp_t      *ipp,		/* I - IPP message */
+            const char *name,		/* I - Attribute name */
+            ipp_tag_t  type,		/* I - Value tag or IPP_TAG_ZERO */
+            int        n)		/* I - Match number (0-based) */
+{
+  ipp_attribute_t	*attr;		/* Current attribute */
+
+
+  for (attr = ipp->attrs; attr; attr = attr->next)
+  {
+    if (attr->name && !_cups_strcasecmp(attr->name, name) &&
+        (type == IPP_TAG_ZERO || (attr->value_tag & IPP_TAG_CUPS_MASK) == type) &&
+        n-- == 0)
+      break;
+  }
+
+  return (attr);
+}
+
+
 /*
  * 'hex_dump()' - Produce a hex dump of a buffer.
  */
@@ -1043,6 +1085,319 @@ read_hex(cups_file_t *fp,		/* I - File to read from */
 }
 
 
+/*
+ * 'test_arena()' - Test deleting and resizing attributes in arena messages.
+ */
+
+int					/* O - 1 on success, 0 on failure */
+test_arena(void)
+{
+  int			i, j;		/* Looping vars */
+  int			ret = 1;	/* Return value */
+  ipp_t			*ipp[2],	/* Arena and regular messages */
+			*copy;		/* Copy of arena message */
+  ipp_attribute_t	*attr,		/* Current attribute */
+			*expected;	/* Expected attribute */
+  char			name[256];	/* Attribute name */
+  int			values[5000];	/* Integer values */
+
+
+ /*
+  * Make the same changes to an arena message and a regular message:
+  * growing the newest attribute (resized in place), growing an older one
+  * (moved), replacing strings, deleting values and attributes, and adding
+  * an attribute that is larger than an arena block...
+  */
+
+  fputs("_ippNewArena: ", stdout);
+
+  for (i = 0; i < 5000; i ++)
+    values[i] = i;
+
+  ipp[0] = _ippNewArena();
+  ipp[1] = ippNew();
+
+  for (j = 0; j < 2; j ++)
+  {
+    for (i = 0; i < 40; i ++)
+    {
+      snprintf(name, sizeof(name), "attr-%d", i);
+      attr = ippAddInteger(ipp[j], IPP_TAG_JOB, IPP_TAG_INTEGER, name, i);
+    }
+
+    for (i = 1; i < 20; i ++)
+      ippSetInteger(ipp[j], &attr, i, 39 + i);
+
+    attr = ippFindAttribute(ipp[j], "attr-5", IPP_TAG_INTEGER);
+    for (i = 1; i < 100; i ++)
+      ippSetInteger(ipp[j], &attr, i, 5 + i);
+
+    attr = ippAddString(ipp[j], IPP_TAG_JOB, IPP_TAG_KEYWORD, "keyword", NULL, "one");
+    ippSetString(ipp[j], &attr, 0, "replaced");
+    ippSetString(ipp[j], &attr, 1, "two");
+    ippSetString(ipp[j], &attr, 2, "three");
+    ippDeleteValues(ipp[j], &attr, 1, 1);
+
+    ippDeleteAttribute(ipp[j], ippFindAttribute(ipp[j], "attr-3", IPP_TAG_ZERO));
+    ippDeleteAttribute(ipp[j], ippFindAttribute(ipp[j], "attr-10", IPP_TAG_ZERO));
+    ippDeleteAttribute(ipp[j], ippFindAttribute(ipp[j], "attr-39", IPP_TAG_ZERO));
+
+    ippAddIntegers(ipp[j], IPP_TAG_PRINTER, IPP_TAG_INTEGER, "large", 5000, values);
+    ippAddInteger(ipp[j], IPP_TAG_PRINTER, IPP_TAG_INTEGER, "attr-3", 3003);
+  }
+
+  for (attr = ipp[0]->attrs, expected = ipp[1]->attrs; attr && expected; attr = attr->next, expected = expected->next)
+  {
+    if (strcmp(attr->name, expected->name) || attr->group_tag != expected->group_tag || attr->value_tag != expected->value_tag || attr->num_values != expected->num_values)
+      break;
+
+    for (i = 0; i < attr->num_values; i ++)
+    {
+      if (attr->value_tag == IPP_TAG_INTEGER ? attr->values[i].integer != expected->values[i].integer : strcmp(attr->values[i].string.text, expected->values[i].string.text))
+        break;
+    }
+
+    if (i < attr->num_values)
+      break;
+  }
+
+  if (attr || expected)
+  {
+    printf("FAIL (wrong attribute \"%s\")\n", attr ? attr->name : expected->name);
+    ret = 0;
+  }
+  else if (!ipp[0]->arena || !ipp[0]->attrs->arena)
+  {
+    puts("FAIL (attributes not in arena)");
+    ret = 0;
+  }
+  else if (ippLength(ipp[0]) != ippLength(ipp[1]))
+  {
+    printf("FAIL (%d bytes, expected %d)\n", (int)ippLength(ipp[0]), (int)ippLength(ipp[1]));
+    ret = 0;
+  }
+  else
+    puts("PASS");
+
+ /*
+  * Copies of arena messages must not use the arena...
+  */
+
+  fputs("ippCopyAttributes(arena): ", stdout);
+
+  copy = ippNew();
+  ippCopyAttributes(copy, ipp[0], 0, NULL, NULL);
+  ippDelete(ipp[0]);
+
+  for (attr = copy->attrs, expected = ipp[1]->attrs; attr && expected; attr = attr->next, expected = expected->next)
+  {
+    if (attr->arena || strcmp(attr->name, expected->name) || attr->num_values != expected->num_values)
+      break;
+  }
+
+  if (attr || expected)
+  {
+    printf("FAIL (wrong attribute \"%s\")\n", attr ? attr->name : expected->name);
+    ret = 0;
+  }
+  else
+    puts("PASS");
+
+  ippDelete(copy);
+  ippDelete(ipp[1]);
+
+  return (ret);
+}
+
+
+/*
+ * 'test_index()' - Test searches in messages with an attribute name index.
+ */
+
+int					/* O - 1 on success, 0 on failure */
+test_index(void)
+{
+  int			i, j;		/* Looping vars */
+  int			ret = 1;	/* Return value */
+  ipp_t			*ipp,		/* Test message */
+			*copy;		/* Copy of test message */
+  ipp_attribute_t	*attr,		/* Current attribute */
+			*expected;	/* Expected attribute */
+  char			name[256];	/* Attribute name */
+  static const ipp_tag_t groups[3] =	/* Groups in test message */
+  {
+    IPP_TAG_OPERATION,
+    IPP_TAG_JOB,
+    IPP_TAG_PRINTER
+  };
+
+
+ /*
+  * Build a message with 48 attributes in 3 groups; "dup-name" is repeated in
+  * each group (once as an integer, then as keywords)...
+  */
+
+  ipp = ippNew();
+
+  for (i = 0; i < 3; i ++)
+  {
+    for (j = 0; j < 15; j ++)
+    {
+      snprintf(name, sizeof(name), "attr-%d", i * 15 + j);
+      ippAddInteger(ipp, groups[i], IPP_TAG_INTEGER, name, i * 15 + j);
+    }
+
+    if (i == 0)
+      ippAddInteger(ipp, groups[i], IPP_TAG_INTEGER, "dup-name", i);
+    else
+      ippAddString(ipp, groups[i], IPP_TAG_KEYWORD, "dup-name", NULL, i == 1 ? "job" : "printer");
+
+    if (i < 2)
+      ippAddSeparator(ipp);
+  }
+
+  fputs("ippFindAttribute(index): ", stdout);
+
+  for (i = 0; i < 45; i ++)
+  {
+    snprintf(name, sizeof(name), "attr-%d", i);
+
+    if ((attr = ippFindAttribute(ipp, name, IPP_TAG_INTEGER)) != find_linear(ipp, name, IPP_TAG_INTEGER, 0) || ippGetInteger(attr, 0) != i)
+      break;
+  }
+
+  if (i < 45)
+  {
+    printf("FAIL (wrong attribute for \"%s\")\n", name);
+    ret = 0;
+  }
+  else if (!ipp->index)
+  {
+    puts("FAIL (no index)");
+    ret = 0;
+  }
+  else if (ippFindAttribute(ipp, "no-such-attr", IPP_TAG_ZERO))
+  {
+    puts("FAIL (found no-such-attr)");
+    ret = 0;
+  }
+  else if (ippFindAttribute(ipp, "DUP-NAME", IPP_TAG_KEYWORD) != find_linear(ipp, "dup-name", IPP_TAG_KEYWORD, 0))
+  {
+    puts("FAIL (wrong keyword dup-name)");
+    ret = 0;
+  }
+  else
+    puts("PASS");
+
+  fputs("ippFindNextAttribute(index): ", stdout);
+
+  for (i = 0, attr = ippFindAttribute(ipp, "dup-name", IPP_TAG_ZERO); attr; i ++, attr = ippFindNextAttribute(ipp, "dup-name", IPP_TAG_ZERO))
+  {
+    if (attr != find_linear(ipp, "dup-name", IPP_TAG_ZERO, i) || ippGetGroupTag(attr) != groups[i])
+      break;
+  }
+
+  if (attr || i != 3)
+  {
+    printf("FAIL (wrong attribute %d)\n", i + 1);
+    ret = 0;
+  }
+  else
+    puts("PASS");
+
+  fputs("ippDeleteAttribute(index): ", stdout);
+
+  ippDeleteAttribute(ipp, ippFindAttribute(ipp, "dup-name", IPP_TAG_ZERO));
+  ippDeleteAttribute(ipp, ippFindAttribute(ipp, "attr-20", IPP_TAG_ZERO));
+
+  if ((attr = ippFindAttribute(ipp, "dup-name", IPP_TAG_ZERO)) == NULL || attr != find_linear(ipp, "dup-name", IPP_TAG_ZERO, 0) || ippGetGroupTag(attr) != IPP_TAG_JOB)
+  {
+    puts("FAIL (wrong dup-name)");
+    ret = 0;
+  }
+  else if (ippFindAttribute(ipp, "attr-20", IPP_TAG_ZERO))
+  {
+    puts("FAIL (found deleted attr-20)");
+    ret = 0;
+  }
+  else if ((attr = ippFindAttribute(ipp, "attr-21", IPP_TAG_ZERO)) == NULL || ippGetInteger(attr, 0) != 21)
+  {
+    puts("FAIL (wrong attr-21)");
+    ret = 0;
+  }
+  else
+    puts("PASS");
+
+  fputs("ippAddInteger(index): ", stdout);
+
+  ippAddInteger(ipp, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "attr-20", 2020);
+  ippAddInteger(ipp, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "dup-name", 3);
+
+  if ((attr = ippFindAttribute(ipp, "attr-20", IPP_TAG_ZERO)) == NULL || attr != find_linear(ipp, "attr-20", IPP_TAG_ZERO, 0) || ippGetInteger(attr, 0) != 2020)
+  {
+    puts("FAIL (wrong attr-20)");
+    ret = 0;
+  }
+  else
+  {
+    for (i = 0, attr = ippFindAttribute(ipp, "dup-name", IPP_TAG_ZERO); attr; i ++, attr = ippFindNextAttribute(ipp, "dup-name", IPP_TAG_ZERO))
+    {
+      if (attr != find_linear(ipp, "dup-name", IPP_TAG_ZERO, i))
+        break;
+    }
+
+    if (attr || i != 3)
+    {
+      printf("FAIL (wrong dup-name %d)\n", i + 1);
+      ret = 0;
+    }
+    else if ((attr = ippFindAttribute(ipp, "dup-name", IPP_TAG_INTEGER)) == NULL || ippGetInteger(attr, 0) != 3)
+    {
+      puts("FAIL (wrong integer dup-name)");
+      ret = 0;
+    }
+    else
+      puts("PASS");
+  }
+
+  fputs("ippCopyAttributes(index): ", stdout);
+
+  copy = ippNew();
+  ippCopyAttributes(copy, ipp, 0, NULL, NULL);
+
+  for (attr = ipp->attrs, expected = copy->attrs; attr && expected; attr = attr->next, expected = expected->next)
+  {
+    if (!attr->name)
+    {
+      if (expected->name)
+        break;
+      continue;
+    }
+
+    if (!expected->name || strcmp(attr->name, expected->name) || ippFindAttribute(copy, attr->name, IPP_TAG_ZERO) != find_linear(copy, attr->name, IPP_TAG_ZERO, 0))
+      break;
+  }
+
+  if (attr || expected)
+  {
+    printf("FAIL (wrong attribute \"%s\")\n", attr && attr->name ? attr->name : "(null)");
+    ret = 0;
+  }
+  else if (!copy->index)
+  {
+    puts("FAIL (no index)");
+    ret = 0;
+  }
+  else
+    puts("PASS");
+
+  ippDelete(copy);
+  ippDelete(ipp);
+
+  return (ret);
+}
+
+
 /*
  * 'token_cb()' - Token callback for ASCII IPP data file parser.
  */
@@ -16,13 +16,32 @@
 #include <math.h>
 
 
+/*
+ * Local types...
+ */
+
+typedef struct raster_buffer_s		/**** Memory raster stream ****/
+{
+  unsigned char	*data;			/* Stream data */
+  size_t	length,			/* Number of bytes in stream */
+		size,			/* Allocated size of stream */
+		pos;			/* Current read position */
+} raster_buffer_t;
+
+
 /*
  * Local functions...
  */
 
+static int	do_band_tests(cups_mode_t mode);
 static int	do_ras_file(const char *filename);
 static int	do_raster_tests(cups_mode_t mode);
+static int	do_read_tests(void);
+static void	make_read_header(unsigned page, cups_page_header2_t *header);
+static void	make_read_line(unsigned page, unsigned y, unsigned bpl, unsigned char *line);
 static void	print_changes(cups_page_header2_t *header, cups_page_header2_t *expected);
+static ssize_t	raster_read_cb(raster_buffer_t *buffer, unsigned char *data, size_t length);
+static ssize_t	raster_write_cb(raster_buffer_t *buffer, unsigned char *data, size_t length);
 
 
 /*
@@ -42,6 +61,13 @@ main(int  argc,				/* I - Number of command-line args */
     errors += do_raster_tests(CUPS_RASTER_WRITE_COMPRESSED);
     errors += do_raster_tests(CUPS_RASTER_WRITE_PWG);
     errors += do_raster_tests(CUPS_RASTER_WRITE_APPLE);
+
+    errors += do_band_tests(CUPS_RASTER_WRITE);
+    errors += do_band_tests(CUPS_RASTER_WRITE_COMPRESSED);
+    errors += do_band_tests(CUPS_RASTER_WRITE_PWG);
+    errors += do_band_tests(CUPS_RASTER_WRITE_APPLE);
+
+    errors += do_read_tests();
   }
   else
   {
@@ -55,6 +81,177 @@ main(int  argc,				/* I - Number of command-line args */
 }
 
 
+/*
+ * 'do_band_tests()' - Test that banded writes match line-by-line writes.
+ */
+
+static int				/* O - Number of errors */
+do_band_tests(cups_mode_t mode)		/* I - Write mode */
+{
+  int			i, j, k;	/* Looping vars */
+  unsigned		page,		/* Current page */
+			x, y,		/* Current column and line */
+			key;		/* Line contents */
+  size_t		bytes,		/* Bytes in page image */
+			chunk,		/* Bytes in current band */
+			pos;		/* Position in page image */
+  unsigned char		*image,		/* Page image */
+			*line;		/* Current line */
+  cups_raster_t		*r;		/* Raster stream */
+  cups_page_header2_t	header;		/* Page header */
+  raster_buffer_t	lines,		/* Line-by-line stream */
+			bands;		/* Banded stream */
+  int			errors = 0;	/* Number of errors */
+  static const char * const names[] =	/* Band schedule names */
+  {
+    "one band",
+    "5-line bands",
+    "odd-length bands",
+    "large bands"
+  };
+  static const int	schedules[][8][2] =
+  {					/* Band sizes (lines + bytes) */
+    { { 100000, 0 }, { 0, 0 } },
+    { { 5, 0 }, { 0, 0 } },
+    { { 3, 17 }, { 0, 1 }, { 1, 0 }, { 300, 5 }, { 2, 0 }, { 64, 0 }, { 0, 999 }, { 0, 0 } },
+    { { 700, 0 }, { 2, 0 }, { 1, 0 }, { 0, 0 } }
+  };
+
+
+ /*
+  * Each page has a run of 600 identical lines, 400 unique lines (enough data
+  * for several compression threads), and runs of 13 lines that straddle the
+  * band boundaries...
+  */
+
+  if ((image = malloc(1500 * 3072)) == NULL)
+  {
+    puts("cupsRasterWriteBand: FAIL (out of memory)");
+    return (1);
+  }
+
+  for (y = 0, line = image; y < 1500; y ++, line += 3072)
+  {
+    if (y < 600)
+      key = 0;
+    else if (y < 1000)
+      key = y;
+    else
+      key = 1000 + (y - 1000) / 13;
+
+    for (x = 0; x < 3072; x ++)
+      line[x] = (unsigned char)(x * (key % 11 + 1) + key);
+  }
+
+  for (i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i ++)
+  {
+    printf("cupsRasterWriteBand(%s, %s): ",
+	   mode == CUPS_RASTER_WRITE ? "CUPS_RASTER_WRITE" :
+	       mode == CUPS_RASTER_WRITE_COMPRESSED ? "CUPS_RASTER_WRITE_COMPRESSED" :
+	       mode == CUPS_RASTER_WRITE_PWG ? "CUPS_RASTER_WRITE_PWG" :
+					       "CUPS_RASTER_WRITE_APPLE", names[i]);
+    fflush(stdout);
+
+    memset(&lines, 0, sizeof(lines));
+    memset(&bands, 0, sizeof(bands));
+
+    for (j = 0; j < 2; j ++)
+    {
+      if ((r = cupsRasterOpenIO((cups_raster_iocb_t)raster_write_cb, j ? &bands : &lines, mode)) == NULL)
+        break;
+
+     /*
+      * The second page uses a 2:1 resolution so that Apple raster repeats
+      * each line...
+      */
+
+      for (page = 0; page < 2; page ++)
+      {
+	memset(&header, 0, sizeof(header));
+	header.cupsWidth        = 1024;
+	header.cupsHeight       = 1500;
+	header.cupsBytesPerLine = 3072;
+	header.cupsBitsPerColor = 8;
+	header.cupsBitsPerPixel = 24;
+	header.cupsColorSpace   = CUPS_CSPACE_SRGB;
+	header.cupsColorOrder   = CUPS_ORDER_CHUNKED;
+	header.cupsNumColors    = 3;
+	header.HWResolution[0]  = page ? 600 : 300;
+	header.HWResolution[1]  = 300;
+	header.PageSize[0]      = 246;
+	header.PageSize[1]      = 360;
+	header.cupsPageSize[0]  = 246.0f;
+	header.cupsPageSize[1]  = 360.0f;
+
+	strlcpy(header.MediaType, "auto", sizeof(header.MediaType));
+
+	if (!cupsRasterWriteHeader2(r, &header))
+	  break;
+
+	bytes = 1500 * 3072;
+
+	if (j == 0)
+	{
+	  for (pos = 0; pos < bytes; pos += 3072)
+	    if (!cupsRasterWritePixels(r, image + pos, 3072))
+	      break;
+	}
+	else
+	{
+	  for (pos = 0, k = 0; pos < bytes; pos += chunk, k ++)
+	  {
+	    if (!schedules[i][k][0] && !schedules[i][k][1])
+	      k = 0;
+
+	    chunk = (size_t)schedules[i][k][0] * 3072 + (size_t)schedules[i][k][1];
+	    if (chunk > (bytes - pos))
+	      chunk = bytes - pos;
+
+	    if (cupsRasterWriteBand(r, image + pos, (unsigned)chunk) != chunk)
+	      break;
+	  }
+	}
+
+	if (pos < bytes)
+	  break;
+      }
+
+      cupsRasterClose(r);
+
+      if (page < 2)
+        break;
+    }
+
+    if (j < 2)
+    {
+      printf("FAIL (unable to write %s stream)\n", j ? "banded" : "line-by-line");
+      errors ++;
+    }
+    else if (lines.length != bands.length)
+    {
+      printf("FAIL (%u bytes, expected %u)\n", (unsigned)bands.length, (unsigned)lines.length);
+      errors ++;
+    }
+    else if (memcmp(lines.data, bands.data, lines.length))
+    {
+      for (pos = 0; lines.data[pos] == bands.data[pos]; pos ++);
+
+      printf("FAIL (byte %u differs)\n", (unsigned)pos);
+      errors ++;
+    }
+    else
+      puts("PASS");
+
+    free(lines.data);
+    free(bands.data);
+  }
+
+  free(image);
+
+  return (errors);
+}
+
+
 /*
  * 'do_ras_file()' - Test reading of a raster file.
  */
@@ -522,6 +719,305 @@ do_raster_tests(cups_mode_t mode)	/* O - Write mode */
 }
 
 
+/*
+ * 'do_read_tests()' - Test mixing line, pixel, and header reads.
+ */
+
+static int				/* O - Number of errors */
+do_read_tests(void)
+{
+  int			i;		/* Looping var */
+  unsigned		page,		/* Current page */
+			x, y,		/* Current byte and line */
+			bpl,		/* Bytes per line */
+			count,		/* Words to swap */
+			sync;		/* Sync word */
+  cups_raster_t		*r;		/* Raster stream */
+  cups_page_header2_t	header,		/* Page header */
+			expected;	/* Expected page header */
+  raster_buffer_t	buffer;		/* Raster stream data */
+  const unsigned char	*data;		/* Line data */
+  unsigned char		line[1024],	/* Line buffer */
+			check[1024],	/* Expected line */
+			temp,		/* Temporary byte */
+			*ptr;		/* Pointer into header */
+  int			errors = 0;	/* Number of errors */
+  static const char * const names[] =	/* Stream names */
+  {
+    "CUPS_RASTER_WRITE_COMPRESSED",
+    "CUPS_RASTER_WRITE_PWG",
+    "uncompressed v1",
+    "byte-swapped v1"
+  };
+
+
+  for (i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i ++)
+  {
+    printf("cupsRasterReadLine(%s): ", names[i]);
+    fflush(stdout);
+
+   /*
+    * Write three pages of 8- and 16-bit data.  PWG raster is big-endian, so it
+    * is byte-swapped on little-endian hosts; the v1 streams are built by hand
+    * since there is no v1 write mode...
+    */
+
+    memset(&buffer, 0, sizeof(buffer));
+
+    if (i < 2)
+    {
+      if ((r = cupsRasterOpenIO((cups_raster_iocb_t)raster_write_cb, &buffer, i ? CUPS_RASTER_WRITE_PWG : CUPS_RASTER_WRITE_COMPRESSED)) == NULL)
+      {
+        printf("FAIL (%s)\n", cupsRasterErrorString());
+        errors ++;
+        continue;
+      }
+
+      for (page = 0; page < 3; page ++)
+      {
+        make_read_header(page, &header);
+        cupsRasterWriteHeader2(r, &header);
+
+        for (y = 0; y < header.cupsHeight; y ++)
+        {
+          make_read_line(page, y, header.cupsBytesPerLine, line);
+          cupsRasterWritePixels(r, line, header.cupsBytesPerLine);
+        }
+      }
+
+      cupsRasterClose(r);
+    }
+    else
+    {
+      sync = i == 2 ? CUPS_RASTER_SYNCv1 : CUPS_RASTER_REVSYNCv1;
+      raster_write_cb(&buffer, (unsigned char *)&sync, sizeof(sync));
+
+      for (page = 0; page < 3; page ++)
+      {
+        make_read_header(page, &header);
+        bpl = header.cupsBytesPerLine;
+
+        if (i == 3)
+        {
+         /*
+          * Swap the integer fields that follow the strings in the header...
+          */
+
+          ptr   = (unsigned char *)&header.AdvanceDistance;
+          count = (unsigned)((sizeof(cups_page_header_t) - (size_t)(ptr - (unsigned char *)&header)) / 4);
+
+          for (; count > 0; count --, ptr += 4)
+          {
+            temp   = ptr[0];
+            ptr[0] = ptr[3];
+            ptr[3] = temp;
+            temp   = ptr[1];
+            ptr[1] = ptr[2];
+            ptr[2] = temp;
+          }
+        }
+
+        raster_write_cb(&buffer, (unsigned char *)&header, sizeof(cups_page_header_t));
+
+        make_read_header(page, &header);
+
+        for (y = 0; y < header.cupsHeight; y ++)
+        {
+          make_read_line(page, y, bpl, line);
+
+          if (i == 3 && header.cupsBitsPerColor == 16)
+          {
+            for (x = 0; x < bpl; x += 2)
+            {
+              temp        = line[x];
+              line[x]     = line[x + 1];
+              line[x + 1] = temp;
+            }
+          }
+
+          raster_write_cb(&buffer, line, bpl);
+        }
+      }
+    }
+
+   /*
+    * Read it back, cycling through whole-line reads, zero-copy reads, and
+    * partial-line reads.  Partial reads are an even number of bytes so that
+    * 16-bit samples are not split...
+    */
+
+    if ((r = cupsRasterOpenIO((cups_raster_iocb_t)raster_read_cb, &buffer, CUPS_RASTER_READ)) == NULL)
+    {
+      printf("FAIL (%s)\n", cupsRasterErrorString());
+      errors ++;
+      free(buffer.data);
+      continue;
+    }
+
+    for (page = 0; page < 3; page ++)
+    {
+      make_read_header(page, &expected);
+
+      if (!cupsRasterReadHeader2(r, &header))
+      {
+        printf("FAIL (unable to read page %u header)\n", page + 1);
+        break;
+      }
+
+      if (header.cupsWidth != expected.cupsWidth || header.cupsHeight != expected.cupsHeight || header.cupsBitsPerColor != expected.cupsBitsPerColor || header.cupsBytesPerLine != expected.cupsBytesPerLine)
+      {
+        printf("FAIL (bad page %u header)\n", page + 1);
+        print_changes(&header, &expected);
+        break;
+      }
+
+      bpl = header.cupsBytesPerLine;
+
+      for (y = 0; y < header.cupsHeight; y ++)
+      {
+        data = line;
+
+        switch ((y + page) % 4)
+        {
+          case 0 :
+              data = cupsRasterReadLine(r);
+              break;
+          case 1 :
+              if (cupsRasterReadPixels(r, line, bpl) != bpl)
+                data = NULL;
+              break;
+          case 2 :
+              if (cupsRasterReadPixels(r, line, 18) != 18 || cupsRasterReadPixels(r, line + 18, bpl - 18) != (bpl - 18))
+                data = NULL;
+              break;
+          case 3 :
+              if (cupsRasterReadPixels(r, line, 6) != 6 || cupsRasterReadPixels(r, line + 6, 100) != 100 || cupsRasterReadPixels(r, line + 106, bpl - 106) != (bpl - 106))
+                data = NULL;
+              break;
+        }
+
+        if (!data)
+        {
+          printf("FAIL (unable to read page %u line %u)\n", page + 1, y);
+          break;
+        }
+
+        make_read_line(page, y, bpl, check);
+
+        if (memcmp(data, check, bpl))
+        {
+          printf("FAIL (page %u line %u corrupt)\n", page + 1, y);
+          break;
+        }
+      }
+
+      if (y < header.cupsHeight)
+        break;
+    }
+
+    if (page == 3 && cupsRasterReadHeader2(r, &header))
+    {
+      puts("FAIL (read past end of stream)");
+      errors ++;
+    }
+    else if (page == 3)
+      puts("PASS");
+    else
+      errors ++;
+
+    cupsRasterClose(r);
+    free(buffer.data);
+  }
+
+  return (errors);
+}
+
+
+/*
+ * 'make_read_header()' - Make the page header for the read tests.
+ */
+
+static void
+make_read_header(
+    unsigned            page,		/* I - Page number (0-based) */
+    cups_page_header2_t *header)	/* O - Page header */
+{
+  memset(header, 0, sizeof(cups_page_header2_t));
+
+  header->HWResolution[0] = 100;
+  header->HWResolution[1] = 100;
+  header->cupsColorOrder  = CUPS_ORDER_CHUNKED;
+
+  strlcpy(header->MediaType, "auto", sizeof(header->MediaType));
+
+  switch (page)
+  {
+    case 0 :				/* 8-bit grayscale, odd width */
+        header->cupsWidth        = 301;
+        header->cupsHeight       = 97;
+        header->cupsBitsPerColor = 8;
+        header->cupsBitsPerPixel = 8;
+        header->cupsBytesPerLine = 301;
+        header->cupsColorSpace   = CUPS_CSPACE_W;
+        header->cupsNumColors    = 1;
+        break;
+
+    case 1 :				/* 16-bit RGB */
+        header->cupsWidth        = 123;
+        header->cupsHeight       = 300;
+        header->cupsBitsPerColor = 16;
+        header->cupsBitsPerPixel = 48;
+        header->cupsBytesPerLine = 738;
+        header->cupsColorSpace   = CUPS_CSPACE_SRGB;
+        header->cupsNumColors    = 3;
+        break;
+
+    default :				/* 16-bit grayscale */
+        header->cupsWidth        = 500;
+        header->cupsHeight       = 80;
+        header->cupsBitsPerColor = 16;
+        header->cupsBitsPerPixel = 16;
+        header->cupsBytesPerLine = 1000;
+        header->cupsColorSpace   = CUPS_CSPACE_SW;
+        header->cupsNumColors    = 1;
+        break;
+  }
+
+  header->PageSize[0]     = header->cupsWidth * 72 / 100;
+  header->PageSize[1]     = header->cupsHeight * 72 / 100;
+  header->cupsPageSize[0] = header->PageSize[0];
+  header->cupsPageSize[1] = header->PageSize[1];
+}
+
+
+/*
+ * 'make_read_line()' - Make a line of data for the read tests.
+ *
+ * Lines repeat in runs so that compressed streams use repeat counts.
+ */
+
+static void
+make_read_line(unsigned      page,	/* I - Page number (0-based) */
+               unsigned      y,		/* I - Line number */
+               unsigned      bpl,	/* I - Bytes per line */
+               unsigned char *line)	/* O - Line data */
+{
+  unsigned	x,			/* Current byte */
+		key;			/* Line contents */
+
+
+  if (y < 40)
+    key = 0;
+  else if (y < 60)
+    key = y;
+  else
+    key = 60 + y / 7;
+
+  for (x = 0; x < bpl; x ++)
+    line[x] = (unsigned char)(x * (key % 5 + 1) + key + page * 3);
+}
+
+
 /*
  * 'print_changes()' - Print differences in the page header.
  */
@@ -758,3 +1254,54 @@ print_changes(
            header->cupsPageSizeName,
            expected->cupsPageSizeName);
 }
+
+
+
+/*
+ * 'raster_read_cb()' - Read from a memory raster stream.
+ */
+
+static ssize_t				/* O - Bytes read or -1 on error */
+raster_read_cb(raster_buffer_t *buffer,	/* I - Memory stream */
+               unsigned char   *data,	/* I - Read buffer */
+	       size_t          length)	/* I - Number of bytes to read */
+{
+  if (length > (buffer->length - buffer->pos))
+    length = buffer->length - buffer->pos;
+
+  memcpy(data, buffer->data + buffer->pos, length);
+  buffer->pos += length;
+
+  return ((ssize_t)length);
+}
+
+/*
+ * 'raster_write_cb()' - Write to a memory raster stream.
+ */
+
+static ssize_t				/* O - Bytes written or -1 on error */
+raster_write_cb(
+    raster_buffer_t *buffer,		/* I - Memory stream */
+    unsigned char   *data,		/* I - Bytes to write */
+    size_t          length)		/* I - Number of bytes to write */
+{
+  unsigned char	*temp;			/* New stream data */
+  size_t	size;			/* New allocation size */
+
+
+  if ((buffer->length + length) > buffer->size)
+  {
+    size = buffer->size + length + 65536;
+
+    if ((temp = realloc(buffer->data, size)) == NULL)
+      return (-1);
+
+    buffer->data = temp;
+    buffer->size = size;
+  }
+
+  memcpy(buffer->data + buffer->length, data, length);
+  buffer->length += length;
+
+  return ((ssize_t)length);
+}
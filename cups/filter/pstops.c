@@ -19,6 +19,7 @@
 #include <cups/array.h>
 #include <cups/language-private.h>
 #include <signal.h>
+#include <sys/stat.h>
 
 
 /*
@@ -60,6 +61,14 @@ typedef struct				/**** Page information ****/
   cups_option_t	*options;		/* Options for this page */
 } pstops_page_t;
 
+typedef struct				/**** Spooled data segment ****/
+{
+  off_t		start;			/* Offset in spooled data */
+  off_t		offset;			/* Offset in input or temporary file */
+  size_t	length;			/* Number of bytes */
+  int		input;			/* Data is in the input file? */
+} pstops_segment_t;
+
 typedef struct				/**** Document information ****/
 {
   int		page;			/* Current page */
@@ -76,6 +85,11 @@ typedef struct				/**** Document information ****/
   cups_array_t	*pages;			/* Pages in document */
   cups_file_t	*temp;			/* Temporary file, if any */
   char		tempfile[1024];		/* Temporary filename */
+  cups_file_t	*input;			/* Seekable print file, if any */
+  off_t		length;			/* Length of spooled data */
+  size_t	num_segments,		/* Number of spooled data segments */
+		alloc_segments;		/* Allocated spooled data segments */
+  pstops_segment_t *segments;		/* Spooled data segments */
   int		job_id;			/* Job ID */
   const char	*user,			/* User name */
 		*title;			/* Job name */
@@ -132,7 +146,7 @@ static int		JobCanceled = 0;/* Set to 1 on SIGTERM */
 static pstops_page_t	*add_page(pstops_doc_t *doc, const char *label);
 static void		cancel_job(int sig);
 static int		check_range(pstops_doc_t *doc, int page);
-static void		copy_bytes(cups_file_t *fp, off_t offset,
+static void		copy_bytes(pstops_doc_t *doc, off_t offset,
 			           size_t length);
 static ssize_t		copy_comments(cups_file_t *fp, pstops_doc_t *doc,
 			              ppd_file_t *ppd, char *line,
@@ -157,8 +171,12 @@ static ssize_t		copy_trailer(cups_file_t *fp, pstops_doc_t *doc,
 				     ssize_t linelen, size_t linesize);
 static void		do_prolog(pstops_doc_t *doc, ppd_file_t *ppd);
 static void 		do_setup(pstops_doc_t *doc, ppd_file_t *ppd);
+static void		doc_copy(pstops_doc_t *doc, cups_file_t *fp,
+			         const char *s, size_t len);
 static void		doc_printf(pstops_doc_t *doc, const char *format, ...) _CUPS_FORMAT(2, 3);
 static void		doc_puts(pstops_doc_t *doc, const char *s);
+static void		doc_spool(pstops_doc_t *doc, cups_file_t *fp,
+			          const char *s, size_t len);
 static void		doc_write(pstops_doc_t *doc, const char *s, size_t len);
 static void		end_nup(pstops_doc_t *doc, int number);
 static int		include_feature(ppd_file_t *ppd, const char *line,
@@ -381,6 +399,11 @@ main(int  argc,				/* I - Number of command-line args */
     unlink(doc.tempfile);
   }
 
+  if (doc.input)
+    cupsFileClose(doc.input);
+
+  free(doc.segments);
+
   ppdClose(ppd);
   cupsFreeOptions(num_options, options);
 
@@ -417,7 +440,7 @@ add_page(pstops_doc_t *doc,		/* I - Document information */
   }
 
   pageinfo->label  = strdup(label);
-  pageinfo->offset = cupsFileTell(doc->temp);
+  pageinfo->offset = doc->length;
 
   cupsArrayAdd(doc->pages, pageinfo);
 
@@ -507,40 +530,84 @@ check_range(pstops_doc_t *doc,		/* I - Document information */
 
 
 /*
- * 'copy_bytes()' - Copy bytes from the input file to stdout.
+ * 'copy_bytes()' - Copy spooled data to stdout.
+ *
+ * Spooled data is read back from the temporary file or, for lines that were
+ * copied unchanged from a seekable print file, from the print file itself.
  */
 
 static void
-copy_bytes(cups_file_t *fp,		/* I - File to read from */
-           off_t       offset,		/* I - Offset to page data */
-           size_t      length)		/* I - Length of page data */
+copy_bytes(pstops_doc_t *doc,		/* I - Document information */
+           off_t        offset,		/* I - Offset to page data */
+           size_t       length)		/* I - Length of page data or 0 for all */
 {
-  char		buffer[8192];		/* Data buffer */
-  ssize_t	nbytes;			/* Number of bytes read */
-  size_t	nleft;			/* Number of bytes left/remaining */
+  char			buffer[8192];	/* Data buffer */
+  ssize_t		nbytes;		/* Number of bytes read */
+  size_t		nleft,		/* Number of bytes left/remaining */
+			seglen;		/* Number of bytes from segment */
+  pstops_segment_t	*seg,		/* Current segment */
+			*segend;	/* End of segments */
+  cups_file_t		*fp;		/* File to read from */
+  size_t		left,		/* Left side of search */
+			right,		/* Right side of search */
+			middle;		/* Middle of search */
+
+
+  if (doc->num_segments == 0 || offset >= doc->length)
+    return;
 
+  if (length == 0 || (off_t)length > (doc->length - offset))
+    length = (size_t)(doc->length - offset);
 
-  nleft = length;
+ /*
+  * Find the segment containing the starting offset...
+  */
 
-  if (cupsFileSeek(fp, offset) < 0)
+  for (left = 0, right = doc->num_segments - 1; left < right;)
   {
-    _cupsLangPrintError("ERROR", _("Unable to see in file"));
-    return;
+    middle = (left + right + 1) / 2;
+
+    if (doc->segments[middle].start <= offset)
+      left = middle;
+    else
+      right = middle - 1;
   }
 
-  while (nleft > 0 || length == 0)
+ /*
+  * Copy the data from each segment...
+  */
+
+  for (seg = doc->segments + left, segend = doc->segments + doc->num_segments;
+       length > 0 && seg < segend;
+       seg ++)
   {
-    if (nleft > sizeof(buffer) || length == 0)
-      nbytes = sizeof(buffer);
-    else
-      nbytes = (ssize_t)nleft;
+    fp     = seg->input ? doc->input : doc->temp;
+    seglen = seg->length - (size_t)(offset - seg->start);
+
+    if (seglen > length)
+      seglen = length;
 
-    if ((nbytes = cupsFileRead(fp, buffer, (size_t)nbytes)) < 1)
+    if (cupsFileSeek(fp, seg->offset + offset - seg->start) < 0)
+    {
+      _cupsLangPrintError("ERROR", _("Unable to see in file"));
       return;
+    }
+
+    for (nleft = seglen; nleft > 0; nleft -= (size_t)nbytes)
+    {
+      if (nleft > sizeof(buffer))
+	nbytes = sizeof(buffer);
+      else
+	nbytes = (ssize_t)nleft;
 
-    nleft -= (size_t)nbytes;
+      if ((nbytes = cupsFileRead(fp, buffer, (size_t)nbytes)) < 1)
+	return;
 
-    fwrite(buffer, 1, (size_t)nbytes, stdout);
+      fwrite(buffer, 1, (size_t)nbytes, stdout);
+    }
+
+    offset += (off_t)seglen;
+    length -= seglen;
   }
 }
 
@@ -824,7 +891,7 @@ copy_dsc(cups_file_t  *fp,		/* I - File to read from */
 
   while (strncmp(line, "%%Page:", 7) && strncmp(line, "%%Trailer", 9))
   {
-    doc_write(doc, line, (size_t)linelen);
+    doc_copy(doc, fp, line, (size_t)linelen);
 
     if ((linelen = (ssize_t)cupsFileGetLine(fp, line, linesize)) == 0)
       break;
@@ -869,7 +936,7 @@ copy_dsc(cups_file_t  *fp,		/* I - File to read from */
     doc_puts(doc, "showpage\n");
     end_nup(doc, doc->number_up);
 
-    pageinfo->length = (ssize_t)(cupsFileTell(doc->temp) - pageinfo->offset);
+    pageinfo->length = (ssize_t)(doc->length - pageinfo->offset);
   }
 
   if (doc->slow_duplex && (doc->page & 1))
@@ -893,7 +960,7 @@ copy_dsc(cups_file_t  *fp,		/* I - File to read from */
     doc_puts(doc, "showpage\n");
     end_nup(doc, doc->number_up);
 
-    pageinfo->length = (ssize_t)(cupsFileTell(doc->temp) - pageinfo->offset);
+    pageinfo->length = (ssize_t)(doc->length - pageinfo->offset);
   }
 
  /*
@@ -970,7 +1037,7 @@ copy_dsc(cups_file_t  *fp,		/* I - File to read from */
       if (!number)
       {
         pageinfo = (pstops_page_t *)cupsArrayFirst(doc->pages);
-	copy_bytes(doc->temp, 0, (size_t)pageinfo->offset);
+	copy_bytes(doc, 0, (size_t)pageinfo->offset);
       }
 
      /*
@@ -1005,7 +1072,7 @@ copy_dsc(cups_file_t  *fp,		/* I - File to read from */
 		 pageinfo->bounding_box[2], pageinfo->bounding_box[3]);
 	}
 
-	copy_bytes(doc->temp, pageinfo->offset, (size_t)pageinfo->length);
+	copy_bytes(doc, pageinfo->offset, (size_t)pageinfo->length);
 
 	pageinfo = doc->slow_order ? (pstops_page_t *)cupsArrayPrev(doc->pages) :
                                      (pstops_page_t *)cupsArrayNext(doc->pages);
@@ -1144,14 +1211,14 @@ copy_non_dsc(cups_file_t  *fp,		/* I - File to read from */
   fwrite(line, (size_t)linelen, 1, stdout);
 
   if (doc->temp)
-    cupsFileWrite(doc->temp, line, (size_t)linelen);
+    doc_spool(doc, fp, line, (size_t)linelen);
 
   while ((bytes = cupsFileRead(fp, buffer, sizeof(buffer))) > 0)
   {
     fwrite(buffer, 1, (size_t)bytes, stdout);
 
     if (doc->temp)
-      cupsFileWrite(doc->temp, buffer, (size_t)bytes);
+      doc_spool(doc, fp, buffer, (size_t)bytes);
   }
 
   puts("%%EndDocument");
@@ -1190,7 +1257,7 @@ copy_non_dsc(cups_file_t  *fp,		/* I - File to read from */
       puts("%%EndPageSetup");
       puts("%%BeginDocument: nondsc");
 
-      copy_bytes(doc->temp, 0, 0);
+      copy_bytes(doc, 0, 0);
 
       puts("%%EndDocument");
 
@@ -1548,7 +1615,7 @@ copy_page(cups_file_t  *fp,		/* I - File to read from */
         break;
 
       if (!feature || (doc->number_up == 1 && !doc->fit_to_page))
-	doc_write(doc, line, (size_t)linelen);
+	doc_copy(doc, fp, line, (size_t)linelen);
     }
 
    /*
@@ -1605,14 +1672,14 @@ copy_page(cups_file_t  *fp,		/* I - File to read from */
     else if (!strncmp(line, "%%BeginDocument", 15) ||
 	     !strncmp(line, "%ADO_BeginApplication", 21))
     {
-      doc_write(doc, line, (size_t)linelen);
+      doc_copy(doc, fp, line, (size_t)linelen);
 
       level ++;
     }
     else if ((!strncmp(line, "%%EndDocument", 13) ||
 	      !strncmp(line, "%ADO_EndApplication", 19)) && level > 0)
     {
-      doc_write(doc, line, (size_t)linelen);
+      doc_copy(doc, fp, line, (size_t)linelen);
 
       level --;
     }
@@ -1627,7 +1694,7 @@ copy_page(cups_file_t  *fp,		/* I - File to read from */
       int	bytes;			/* Bytes of data */
 
 
-      doc_write(doc, line, (size_t)linelen);
+      doc_copy(doc, fp, line, (size_t)linelen);
 
       bytes = atoi(strchr(line, ':') + 1);
 
@@ -1645,13 +1712,13 @@ copy_page(cups_file_t  *fp,		/* I - File to read from */
 	  return (0);
 	}
 
-        doc_write(doc, line, (size_t)linelen);
+        doc_copy(doc, fp, line, (size_t)linelen);
 
 	bytes -= linelen;
       }
     }
     else
-      doc_write(doc, line, (size_t)linelen);
+      doc_copy(doc, fp, line, (size_t)linelen);
   }
   while ((linelen = (ssize_t)cupsFileGetLine(fp, line, linesize)) > 0);
 
@@ -1661,7 +1728,7 @@ copy_page(cups_file_t  *fp,		/* I - File to read from */
 
   end_nup(doc, number);
 
-  pageinfo->length = (ssize_t)(cupsFileTell(doc->temp) - pageinfo->offset);
+  pageinfo->length = (ssize_t)(doc->length - pageinfo->offset);
 
   return (linelen);
 }
@@ -1687,7 +1754,7 @@ copy_prolog(cups_file_t  *fp,		/* I - File to read from */
     if (!strncmp(line, "%%BeginSetup", 12) || !strncmp(line, "%%Page:", 7))
       break;
 
-    doc_write(doc, line, (size_t)linelen);
+    doc_copy(doc, fp, line, (size_t)linelen);
 
     if ((linelen = (ssize_t)cupsFileGetLine(fp, line, linesize)) == 0)
       break;
@@ -1706,7 +1773,7 @@ copy_prolog(cups_file_t  *fp,		/* I - File to read from */
           !strncmp(line, "%%Page:", 7))
         break;
 
-      doc_write(doc, line, (size_t)linelen);
+      doc_copy(doc, fp, line, (size_t)linelen);
     }
 
     if (!strncmp(line, "%%EndProlog", 11))
@@ -1745,7 +1812,7 @@ copy_setup(cups_file_t  *fp,		/* I - File to read from */
     if (!strncmp(line, "%%Page:", 7))
       break;
 
-    doc_write(doc, line, (size_t)linelen);
+    doc_copy(doc, fp, line, (size_t)linelen);
 
     if ((linelen = (ssize_t)cupsFileGetLine(fp, line, linesize)) == 0)
       break;
@@ -1774,7 +1841,7 @@ copy_setup(cups_file_t  *fp,		/* I - File to read from */
 	  num_options = include_feature(ppd, line, num_options, &options);
       }
       else if (strncmp(line, "%%BeginSetup", 12))
-        doc_write(doc, line, (size_t)linelen);
+        doc_copy(doc, fp, line, (size_t)linelen);
 
       if ((linelen = (ssize_t)cupsFileGetLine(fp, line, linesize)) == 0)
 	break;
@@ -1999,6 +2066,28 @@ do_setup(pstops_doc_t *doc,		/* I - Document information */
 }
 
 
+/*
+ * 'doc_copy()' - Send data read from the print file to stdout and/or the
+ *                temp file.
+ *
+ * This function should be used instead of doc_write() for data that was just
+ * read, unchanged, from the print file.
+ */
+
+static void
+doc_copy(pstops_doc_t *doc,		/* I - Document information */
+         cups_file_t  *fp,		/* I - Print file */
+         const char   *s,		/* I - Data to send */
+         size_t       len)		/* I - Number of bytes to send */
+{
+  if (!doc->slow_order)
+    fwrite(s, 1, len, stdout);
+
+  if (doc->temp)
+    doc_spool(doc, fp, s, len);
+}
+
+
 /*
  * 'doc_printf()' - Send a formatted string to stdout and/or the temp file.
  *
@@ -2046,6 +2135,81 @@ doc_puts(pstops_doc_t *doc,		/* I - Document information */
 }
 
 
+/*
+ * 'doc_spool()' - Add data to the temp file.
+ *
+ * Data from a seekable print file is only recorded by offset so that it can
+ * be read back from the print file later; everything else is written to the
+ * temp file.
+ */
+
+static void
+doc_spool(pstops_doc_t *doc,		/* I - Document information */
+          cups_file_t  *fp,		/* I - Print file or `NULL` */
+          const char   *s,		/* I - Data to spool */
+          size_t       len)		/* I - Number of bytes to spool */
+{
+  pstops_segment_t	*seg;		/* Current segment */
+  off_t			offset;		/* Offset of data */
+  int			input;		/* Data is in the input file? */
+
+
+  if (len == 0)
+    return;
+
+  if (fp && doc->input)
+  {
+    input  = 1;
+    offset = cupsFileTell(fp) - (off_t)len;
+  }
+  else
+  {
+    input  = 0;
+    offset = cupsFileTell(doc->temp);
+
+    cupsFileWrite(doc->temp, s, len);
+  }
+
+ /*
+  * Extend the last segment or add a new one...
+  */
+
+  seg = doc->num_segments > 0 ? doc->segments + doc->num_segments - 1 : NULL;
+
+  if (seg && seg->input == input && (seg->offset + (off_t)seg->length) == offset)
+  {
+    seg->length += len;
+  }
+  else
+  {
+    if (doc->num_segments >= doc->alloc_segments)
+    {
+      size_t		alloc_segments = doc->alloc_segments ? 2 * doc->alloc_segments : 64;
+					/* New allocation */
+
+      if ((seg = realloc(doc->segments, alloc_segments * sizeof(pstops_segment_t))) == NULL)
+      {
+	_cupsLangPrintError("EMERG", _("Unable to allocate memory for page info"));
+	exit(1);
+      }
+
+      doc->segments       = seg;
+      doc->alloc_segments = alloc_segments;
+    }
+
+    seg = doc->segments + doc->num_segments;
+    doc->num_segments ++;
+
+    seg->start  = doc->length;
+    seg->offset = offset;
+    seg->length = len;
+    seg->input  = input;
+  }
+
+  doc->length += (off_t)len;
+}
+
+
 /*
  * 'doc_write()' - Send data to stdout and/or the temp file.
  */
@@ -2059,7 +2223,7 @@ doc_write(pstops_doc_t *doc,		/* I - Document information */
     fwrite(s, 1, len, stdout);
 
   if (doc->temp)
-    cupsFileWrite(doc->temp, s, len);
+    doc_spool(doc, NULL, s, len);
 }
 
 
@@ -2300,6 +2464,7 @@ set_pstops_options(
   ppd_choice_t	*choice;		/* PPD choice */
   const char	*content_type;		/* Original content type */
   int		max_copies;		/* Maximum number of copies supported */
+  struct stat	fileinfo;		/* Print file information */
 
 
  /*
@@ -2637,6 +2802,20 @@ set_pstops_options(
       perror("DEBUG: Unable to create temporary file");
       exit(1);
     }
+
+   /*
+    * Read unchanged page data back from the print file when it is a regular,
+    * uncompressed file, so that only generated PostScript is spooled...
+    */
+
+    if (argv[6] && !stat(argv[6], &fileinfo) && S_ISREG(fileinfo.st_mode) &&
+        (doc->input = cupsFileOpen(argv[6], "r")) != NULL &&
+        (cupsFilePeekChar(doc->input) < 0 ||
+         cupsFileCompression(doc->input) != CUPS_FILE_NONE))
+    {
+      cupsFileClose(doc->input);
+      doc->input = NULL;
+    }
   }
 
  /*
@@ -2653,8 +2832,8 @@ set_pstops_options(
     doc->use_ESPshowpage = 1;
   }
 
-  fprintf(stderr, "DEBUG: slow_collate=%d, slow_duplex=%d, slow_order=%d\n",
-          doc->slow_collate, doc->slow_duplex, doc->slow_order);
+  fprintf(stderr, "DEBUG: slow_collate=%d, slow_duplex=%d, slow_order=%d, spool_input=%d\n",
+          doc->slow_collate, doc->slow_duplex, doc->slow_order, doc->input != NULL);
 }
 
 
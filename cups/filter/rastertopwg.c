@@ -34,7 +34,8 @@ main(int  argc,				/* I - Number of command-line args */
   cups_page_header2_t	inheader,	/* Input raster page header */
 			outheader;	/* Output raster page header */
   unsigned		y;		/* Current line */
-  unsigned char		*line;		/* Line buffer */
+  unsigned char		*line,		/* Line buffer */
+			*lineptr;	/* Line to write */
   unsigned		page = 0,	/* Current page */
 			page_width,	/* Actual page width */
 			page_height,	/* Actual page height */
@@ -447,7 +448,18 @@ main(int  argc,				/* I - Number of command-line args */
 
     for (y = inheader.cupsHeight; y > 0; y --)
     {
-      if (cupsRasterReadPixels(inras, line + lineoffset, inheader.cupsBytesPerLine) != inheader.cupsBytesPerLine)
+     /*
+      * Pass input lines through without copying when no padding is needed...
+      */
+
+      if (linesize == inheader.cupsBytesPerLine)
+        lineptr = (unsigned char *)cupsRasterReadLine(inras);
+      else if (cupsRasterReadPixels(inras, line + lineoffset, inheader.cupsBytesPerLine) == inheader.cupsBytesPerLine)
+        lineptr = line;
+      else
+        lineptr = NULL;
+
+      if (!lineptr)
       {
 	_cupsLangPrintFilter(stderr, "ERROR", _("Error reading raster data."));
 	fprintf(stderr, "DEBUG: Unable to read line %d for page %d.\n",
@@ -455,7 +467,7 @@ main(int  argc,				/* I - Number of command-line args */
 	return (1);
       }
 
-      if (!cupsRasterWritePixels(outras, line, outheader.cupsBytesPerLine))
+      if (!cupsRasterWritePixels(outras, lineptr, outheader.cupsBytesPerLine))
       {
 	_cupsLangPrintFilter(stderr, "ERROR", _("Error sending raster data."));
 	fprintf(stderr, "DEBUG: Unable to write line %d for page %d.\n",
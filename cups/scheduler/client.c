@@ -331,6 +331,14 @@ cupsdAcceptClient(cupsd_listener_t *lis)/* I - Listener socket */
     con->serverport = httpAddrPort(&(lis->address));
   }
 
+ /*
+  * Use larger I/O buffers as needed...
+  */
+
+  if (ClientBufferSize > HTTP_MAX_BUFFER &&
+      _httpSetBufferSize(con->http, (size_t)ClientBufferSize))
+    cupsdLogClient(con, CUPSD_LOG_WARN, "Unable to allocate %d byte I/O buffers.", ClientBufferSize);
+
  /*
   * Add the connection to the array of active clients...
   */
@@ -1224,7 +1232,7 @@ cupsdReadClient(cupsd_client_t *con)	/* I - Client to read from */
 
 	    if (!strcmp(httpGetField(con->http, HTTP_FIELD_CONTENT_TYPE), "application/ipp"))
 	    {
-              con->request = ippNew();
+              con->request = _ippNewArena();
               break;
             }
             else if (!WebInterface)
@@ -2219,7 +2227,7 @@ cupsdUpdateCGI(void)
     if (loglevel == CUPSD_LOG_INFO)
       cupsdLogMessage(CUPSD_LOG_INFO, "%s", message);
 
-    if (!strchr(CGIStatusBuffer->buffer, '\n'))
+    if (!cupsdStatBufHasLine(CGIStatusBuffer))
       break;
   }
 
@@ -2245,6 +2253,7 @@ cupsdWriteClient(cupsd_client_t *con)	/* I - Client connection */
 {
   int		bytes,			/* Number of bytes written */
 		field_col;		/* Current column */
+  ssize_t	sent;			/* Number of bytes sent from file */
   char		*bufptr,		/* Pointer into buffer */
 		*bufend;		/* Pointer to end of buffer */
   ipp_state_t	ipp_state;		/* IPP state value */
@@ -2355,6 +2364,29 @@ cupsdWriteClient(cupsd_client_t *con)	/* I - Client connection */
                    (int)bytes, httpGetState(con->http),
                    CUPS_LLCAST httpGetLength2(con->http));
   }
+  else if (!con->pipe_pid && con->header_used == 0 &&
+           (sent = _httpSendFile(con->http, con->file, 65536)) != 0)
+  {
+   /*
+    * Sent file data without copying it (plain fixed-length responses only,
+    * otherwise we fall through and copy the data below)...
+    */
+
+    if (sent < 0)
+    {
+      cupsdLogClient(con, CUPSD_LOG_DEBUG, "Closing for error %d (%s)",
+		     httpError(con->http), strerror(httpError(con->http)));
+      cupsdCloseClient(con);
+      return;
+    }
+
+    con->bytes += sent;
+
+    if (httpGetState(con->http) == HTTP_STATE_WAITING)
+      bytes = 0;
+    else
+      bytes = (int)sent;
+  }
   else if ((bytes = read(con->file, con->header + con->header_used, (size_t)bytes)) > 0)
   {
     con->header_used += bytes;
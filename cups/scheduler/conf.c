@@ -74,6 +74,7 @@ static const cupsd_var_t	cupsd_vars[] =
   { "Browsing",			&Browsing,		CUPSD_VARTYPE_BOOLEAN },
   { "Classification",		&Classification,	CUPSD_VARTYPE_STRING },
   { "ClassifyOverride",		&ClassifyOverride,	CUPSD_VARTYPE_BOOLEAN },
+  { "ClientBufferSize",		&ClientBufferSize,	CUPSD_VARTYPE_INTEGER },
   { "DefaultLanguage",		&DefaultLanguage,	CUPSD_VARTYPE_STRING },
   { "DefaultLeaseDuration",	&DefaultLeaseDuration,	CUPSD_VARTYPE_TIME },
   { "DefaultPaperSize",		&DefaultPaperSize,	CUPSD_VARTYPE_STRING },
@@ -93,6 +94,7 @@ static const cupsd_var_t	cupsd_vars[] =
   { "IdleExitTimeout",		&IdleExitTimeout,	CUPSD_VARTYPE_TIME },
 #endif /* HAVE_ONDEMAND */
   { "JobKillDelay",		&JobKillDelay,		CUPSD_VARTYPE_TIME },
+  { "JobLoadThreads",		&JobLoadThreads,	CUPSD_VARTYPE_INTEGER },
   { "JobRetryLimit",		&JobRetryLimit,		CUPSD_VARTYPE_INTEGER },
   { "JobRetryInterval",		&JobRetryInterval,	CUPSD_VARTYPE_TIME },
   { "KeepAliveTimeout",		&KeepAliveTimeout,	CUPSD_VARTYPE_TIME },
@@ -702,6 +704,7 @@ cupsdReadConfiguration(void)
   */
 
   AccessLogLevel           = CUPSD_ACCESSLOG_ACTIONS;
+  ClientBufferSize         = 0;
   ConfigFilePerm           = CUPS_DEFAULT_CONFIG_FILE_PERM;
   FatalErrors              = parse_fatal_errors(CUPS_DEFAULT_FATAL_ERRORS);
   default_auth_type        = CUPSD_AUTH_BASIC;
@@ -711,6 +714,7 @@ cupsdReadConfiguration(void)
 #endif /* HAVE_SSL */
   DirtyCleanInterval       = DEFAULT_KEEPALIVE;
   JobKillDelay             = DEFAULT_TIMEOUT;
+  JobLoadThreads           = 0;
   JobRetryLimit            = 5;
   JobRetryInterval         = 300;
   FileDevice               = FALSE;
@@ -722,6 +726,7 @@ cupsdReadConfiguration(void)
   KeepAliveTimeout         = DEFAULT_KEEPALIVE;
   ListenBackLog            = SOMAXCONN;
   LogDebugHistory          = 200;
+  LogFileFormat            = CUPSD_LOGFORMAT_TEXT;
   LogFilePerm              = CUPS_DEFAULT_LOG_FILE_PERM;
   LogLevel                 = CUPSD_LOG_WARN;
   LogTimeFormat            = CUPSD_TIME_STANDARD;
@@ -3297,6 +3302,20 @@ read_cupsd_conf(cups_file_t *fp)	/* I - File to read from */
         cupsdLogMessage(CUPSD_LOG_WARN, "Unknown LogLevel %s on line %d of %s.",
 	                value, linenum, ConfigurationFile);
     }
+    else if (!_cups_strcasecmp(line, "LogFileFormat") && value)
+    {
+     /*
+      * Format of access and page log lines...
+      */
+
+      if (!_cups_strcasecmp(value, "text"))
+        LogFileFormat = CUPSD_LOGFORMAT_TEXT;
+      else if (!_cups_strcasecmp(value, "json"))
+        LogFileFormat = CUPSD_LOGFORMAT_JSON;
+      else
+        cupsdLogMessage(CUPSD_LOG_WARN, "Unknown LogFileFormat %s on line %d of %s.",
+	                value, linenum, ConfigurationFile);
+    }
     else if (!_cups_strcasecmp(line, "LogTimeFormat") && value)
     {
      /*
@@ -40,6 +40,12 @@ typedef enum
   CUPSD_ACCESSLOG_ALL			/* Log everything */
 } cupsd_accesslog_t;
 
+typedef enum
+{
+  CUPSD_LOGFORMAT_TEXT,			/* Text (common log format) lines */
+  CUPSD_LOGFORMAT_JSON			/* JSON objects, one per line */
+} cupsd_logformat_t;
+
 typedef enum
 {
   CUPSD_TIME_STANDARD,			/* "Standard" Apache/CLF format */
@@ -173,6 +179,8 @@ VAR mode_t		ConfigFilePerm		VALUE(0640U),
 					/* Permissions for config files */
 			LogFilePerm		VALUE(0644U);
 					/* Permissions for log files */
+VAR cupsd_logformat_t	LogFileFormat		VALUE(CUPSD_LOGFORMAT_TEXT);
+					/* Access and page log file format */
 VAR cupsd_loglevel_t	LogLevel		VALUE(CUPSD_LOG_WARN);
 					/* Error log level */
 VAR cupsd_time_t	LogTimeFormat		VALUE(CUPSD_TIME_STANDARD);
@@ -193,6 +201,8 @@ VAR int			MaxClients		VALUE(100),
 					/* Maximum size of log files */
 			MaxRequestSize		VALUE(0),
 					/* Maximum size of IPP requests */
+			ClientBufferSize	VALUE(0),
+					/* Size of client I/O buffers */
 			HostNameLookups		VALUE(FALSE),
 					/* Do we do reverse lookups? */
 			Timeout			VALUE(DEFAULT_TIMEOUT),
@@ -274,6 +284,7 @@ extern int	cupsdCheckPermissions(const char *filename,
 				      int create_dir);
 extern int	cupsdCheckProgram(const char *filename, cupsd_printer_t *p);
 extern int	cupsdDefaultAuthType(void);
+extern void	cupsdFlushLogFiles(void);
 extern void	cupsdFreeAliases(cups_array_t *aliases);
 extern char	*cupsdGetDateTime(struct timeval *t, cupsd_time_t format);
 extern int	cupsdLogClient(cupsd_client_t *con, int level, const char *message, ...) _CUPS_FORMAT(3, 4);
@@ -287,4 +298,6 @@ extern int	cupsdLogMessage(int level, const char *message, ...) _CUPS_FORMAT(2,
 extern int	cupsdLogPage(cupsd_job_t *job, const char *page);
 extern int	cupsdLogRequest(cupsd_client_t *con, http_status_t code);
 extern int	cupsdReadConfiguration(void);
+extern void	cupsdStartLogThread(void);
+extern void	cupsdStopLogThread(void);
 extern int	cupsdWriteErrorLog(int level, const char *message);
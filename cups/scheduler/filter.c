@@ -12,7 +12,7 @@
  */
 
 #include <cups/string-private.h>
-#include "mime.h"
+#include "mime-private.h"
 
 
 /*
@@ -27,6 +27,16 @@
  * Local types...
  */
 
+typedef struct _mime_fcache_s		/**** Cached filter chain ****/
+{
+  mime_type_t		*src,		/* Source type */
+			*dst;		/* Destination type */
+  int			sizeclass,	/* Number of filters excluded by size */
+			mincost,	/* Was the cheapest chain requested? */
+			cost;		/* Cost of filters */
+  cups_array_t		*filters;	/* Filters to run or NULL */
+} _mime_fcache_t;
+
 typedef struct _mime_typelist_s		/**** List of source types ****/
 {
   struct _mime_typelist_s *next;	/* Next source type */
@@ -34,15 +44,24 @@ typedef struct _mime_typelist_s		/**** List of source types ****/
 } _mime_typelist_t;
 
 
+/*
+ * Local constants...
+ */
+
+#define MIME_MAX_FCACHE	4096		/* Maximum number of cached chains */
+
+
 /*
  * Local functions...
  */
 
+static int		mime_compare_fcache(_mime_fcache_t *, _mime_fcache_t *);
 static int		mime_compare_filters(mime_filter_t *, mime_filter_t *);
 static int		mime_compare_srcs(mime_filter_t *, mime_filter_t *);
 static cups_array_t	*mime_find_filters(mime_t *mime, mime_type_t *src,
 				      size_t srcsize, mime_type_t *dst,
 				      int *cost, _mime_typelist_t *visited);
+static void		mime_free_fcache(_mime_fcache_t *);
 
 
 /*
@@ -124,6 +143,13 @@ mimeAddFilter(mime_t      *mime,	/* I - MIME database */
     cupsArrayAdd(mime->srcs, temp);
   }
 
+ /*
+  * The caller may change the cost or maximum size of the filter, so clear any
+  * cached filter chains...
+  */
+
+  _mimeClearFilterCache(mime);
+
  /*
   * Return the new/updated filter...
   */
@@ -134,6 +160,26 @@ mimeAddFilter(mime_t      *mime,	/* I - MIME database */
 }
 
 
+/*
+ * '_mimeClearFilterCache()' - Clear the cached filter chains.
+ */
+
+void
+_mimeClearFilterCache(mime_t *mime)	/* I - MIME database */
+{
+  if (mime->fcache)
+  {
+    DEBUG_puts("4_mimeClearFilterCache: Deleting filter chain cache.");
+
+    cupsArrayDelete(mime->fcache);
+    mime->fcache = NULL;
+
+    cupsArrayDelete(mime->fsizes);
+    mime->fsizes = NULL;
+  }
+}
+
+
 /*
  * 'mimeFilter()' - Find the fastest way to convert from one type to another.
  */
@@ -167,6 +213,9 @@ mimeFilter2(mime_t      *mime,		/* I - MIME database */
 	    int         *cost)		/* O - Cost of filters */
 {
   cups_array_t	*filters;		/* Array of filters to run */
+  mime_filter_t	*current;		/* Current filter */
+  _mime_fcache_t key,			/* Cached chain search key */
+		*chain;			/* Cached chain */
 
 
  /*
@@ -192,8 +241,6 @@ mimeFilter2(mime_t      *mime,		/* I - MIME database */
 
   if (!mime->srcs)
   {
-    mime_filter_t	*current;	/* Current filter */
-
     mime->srcs = cupsArrayNew((cups_array_func_t)mime_compare_srcs, NULL);
 
     for (current = mimeFirstFilter(mime);
@@ -202,12 +249,72 @@ mimeFilter2(mime_t      *mime,		/* I - MIME database */
       cupsArrayAdd(mime->srcs, current);
   }
 
+ /*
+  * (Re)build the filter chain cache as needed...
+  */
+
+  if (!mime->fcache)
+  {
+    mime->fcache = cupsArrayNew3((cups_array_func_t)mime_compare_fcache, NULL, NULL, 0, NULL, (cups_afree_func_t)mime_free_fcache);
+    mime->fsizes = cupsArrayNew(NULL, NULL);
+
+    for (current = mimeFirstFilter(mime);
+         current;
+	 current = mimeNextFilter(mime))
+      if (current->maxsize > 0)
+        cupsArrayAdd(mime->fsizes, current);
+  }
+
+ /*
+  * The chain only depends on the file size through the filters that are too
+  * small for the file, so use the number of those filters as part of the
+  * cache key...
+  */
+
+  key.src       = src;
+  key.dst       = dst;
+  key.sizeclass = 0;
+  key.mincost   = cost != NULL;
+
+  for (current = (mime_filter_t *)cupsArrayFirst(mime->fsizes);
+       current;
+       current = (mime_filter_t *)cupsArrayNext(mime->fsizes))
+    if (srcsize > current->maxsize)
+      key.sizeclass ++;
+
+  if ((chain = (_mime_fcache_t *)cupsArrayFind(mime->fcache, &key)) != NULL)
+  {
+    DEBUG_printf(("1mimeFilter2: Returning %d cached filter(s), cost %d.",
+                  cupsArrayCount(chain->filters), chain->cost));
+
+    if (cost)
+      *cost = chain->cost;
+
+    return (cupsArrayDup(chain->filters));
+  }
+
  /*
   * Find the filters...
   */
 
   filters = mime_find_filters(mime, src, srcsize, dst, cost, NULL);
 
+ /*
+  * Cache the result, including failures...
+  */
+
+  if (cupsArrayCount(mime->fcache) >= MIME_MAX_FCACHE)
+    cupsArrayClear(mime->fcache);
+
+  if ((chain = malloc(sizeof(_mime_fcache_t))) != NULL)
+  {
+    *chain         = key;
+    chain->cost    = cost ? *cost : 0;
+    chain->filters = cupsArrayDup(filters);
+
+    cupsArrayAdd(mime->fcache, chain);
+  }
+
   DEBUG_printf(("1mimeFilter2: Returning %d filter(s), cost %d:",
                 cupsArrayCount(filters), cost ? *cost : -1));
 #ifdef DEBUG
@@ -254,6 +361,28 @@ mimeFilterLookup(mime_t      *mime,	/* I - MIME database */
 }
 
 
+/*
+ * 'mime_compare_fcache()' - Compare two cached filter chains.
+ */
+
+static int				/* O - Comparison result */
+mime_compare_fcache(_mime_fcache_t *c0,	/* I - First chain */
+                    _mime_fcache_t *c1)	/* I - Second chain */
+{
+  int	i;				/* Result of comparison */
+
+
+  if ((i = strcmp(c0->src->super, c1->src->super)) == 0)
+    if ((i = strcmp(c0->src->type, c1->src->type)) == 0)
+      if ((i = strcmp(c0->dst->super, c1->dst->super)) == 0)
+        if ((i = strcmp(c0->dst->type, c1->dst->type)) == 0)
+          if ((i = c0->sizeclass - c1->sizeclass) == 0)
+            i = c0->mincost - c1->mincost;
+
+  return (i);
+}
+
+
 /*
  * 'mime_compare_filters()' - Compare two filters.
  */
@@ -485,3 +614,15 @@ mime_find_filters(
 
   return (NULL);
 }
+
+
+/*
+ * 'mime_free_fcache()' - Free a cached filter chain.
+ */
+
+static void
+mime_free_fcache(_mime_fcache_t *chain)	/* I - Cached chain */
+{
+  cupsArrayDelete(chain->filters);
+  free(chain);
+}
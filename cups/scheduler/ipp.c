@@ -50,6 +50,7 @@ static void	authenticate_job(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	cancel_all_jobs(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	cancel_job(cupsd_client_t *con, ipp_attribute_t *uri);
 static void	cancel_subscription(cupsd_client_t *con, int id);
+static int	check_notifications(cupsd_client_t *con);
 static int	check_rss_recipient(const char *recipient);
 static int	check_quotas(cupsd_client_t *con, cupsd_printer_t *p);
 static void	close_job(cupsd_client_t *con, ipp_attribute_t *uri);
@@ -58,6 +59,8 @@ static void	copy_attrs(ipp_t *to, ipp_t *from, cups_array_t *ra,
 			   cups_array_t *exclude);
 static int	copy_banner(cupsd_client_t *con, cupsd_job_t *job,
 		            const char *name);
+static void	copy_cached_attrs(ipp_t *to, cupsd_printer_t *printer,
+		                  cups_array_t *ra);
 static int	copy_file(const char *from, const char *to, mode_t mode);
 static int	copy_model(cupsd_client_t *con, const char *from,
 		           const char *to);
@@ -170,7 +173,7 @@ cupsdProcessIPPRequest(
   * First build an empty response message for this request...
   */
 
-  con->response = ippNew();
+  con->response = _ippNewArena();
 
   con->response->request.status.version[0] = con->request->request.op.version[0];
   con->response->request.status.version[1] = con->request->request.op.version[1];
@@ -732,6 +735,57 @@ cupsdTimeoutJob(cupsd_job_t *job)	/* I - Job to timeout */
 }
 
 
+/*
+ * 'cupsdUpdateNotifyWaits()' - Answer waiting Get-Notifications requests.
+ *
+ * Requests are answered once new events are available, when the wait times
+ * out, or when the scheduler needs to reload.  Calling this once per pass
+ * through the main loop lets each response carry all of the events from that
+ * pass.
+ */
+
+void
+cupsdUpdateNotifyWaits(void)
+{
+  cupsd_client_t	*con;		/* Current client */
+  time_t		curtime;	/* Current time */
+  int			sent;		/* Was the response header sent? */
+
+
+  curtime = time(NULL);
+
+  for (con = (cupsd_client_t *)cupsArrayFirst(Clients);
+       con;
+       con = (cupsd_client_t *)cupsArrayNext(Clients))
+  {
+    if (!con->notify_wait)
+      continue;
+
+    if (con->notify_wait > curtime && !NeedReload && !check_notifications(con))
+      continue;
+
+    cupsdLogClient(con, CUPSD_LOG_DEBUG, "Done waiting for notifications.");
+
+    if (!cupsArrayFind(ActiveClients, con))
+    {
+      cupsArrayAdd(ActiveClients, con);
+      cupsdSetBusyState(0);
+    }
+
+   /*
+    * Process the request again to send the response; the notify_wait value
+    * keeps get_notifications() from waiting a second time...
+    */
+
+    sent             = cupsdProcessIPPRequest(con);
+    con->notify_wait = 0;
+
+    if (!sent)
+      cupsdCloseClient(con);
+  }
+}
+
+
 /*
  * 'accept_jobs()' - Accept print jobs to a printer.
  */
@@ -1566,8 +1620,6 @@ add_job(cupsd_client_t  *con,		/* I - Client connection */
     ippAddString(con->request, IPP_TAG_JOB, IPP_TAG_NAME, "job-name", NULL, "Untitled");
   }
 
-  attr = ippFindAttribute(con->request, "requesting-user-name", IPP_TAG_NAME);
-
   if ((job = cupsdAddJob(priority, printer->name)) == NULL)
   {
     send_ipp_status(con, IPP_INTERNAL_ERROR,
@@ -1576,10 +1628,22 @@ add_job(cupsd_client_t  *con,		/* I - Client connection */
     return (NULL);
   }
 
-  job->dtype   = printer->type & (CUPS_PRINTER_CLASS | CUPS_PRINTER_REMOTE);
-  job->attrs   = con->request;
-  job->dirty   = 1;
-  con->request = ippNewRequest(job->attrs->request.op.operation_id);
+ /*
+  * The request is an arena message that never frees deleted or resized
+  * attributes, so copy it to a regular message for the life of the job.  The
+  * request stays with the connection since the caller may still be using
+  * attributes from it...
+  */
+
+  job->dtype = printer->type & (CUPS_PRINTER_CLASS | CUPS_PRINTER_REMOTE);
+  job->attrs = ippNew();
+  job->dirty = 1;
+
+  job->attrs->request = con->request->request;
+  ippCopyAttributes(job->attrs, con->request, 0, NULL, NULL);
+
+  attr      = ippFindAttribute(job->attrs, "requesting-user-name", IPP_TAG_NAME);
+  auth_info = ippFindAttribute(job->attrs, "auth-info", IPP_TAG_TEXT);
 
   cupsdMarkDirty(CUPSD_DIRTY_JOBS);
 
@@ -1588,7 +1652,7 @@ add_job(cupsd_client_t  *con,		/* I - Client connection */
 
   if (con->username[0])
   {
-    cupsdSetString(&job->username, con->username);
+    cupsdSetJobUsername(job, con->username);
 
     if (attr)
       ippSetString(job->attrs, &attr, 0, con->username);
@@ -1599,10 +1663,10 @@ add_job(cupsd_client_t  *con,		/* I - Client connection */
                     "add_job: requesting-user-name=\"%s\"",
                     attr->values[0].string.text);
 
-    cupsdSetString(&job->username, attr->values[0].string.text);
+    cupsdSetJobUsername(job, attr->values[0].string.text);
   }
   else
-    cupsdSetString(&job->username, "anonymous");
+    cupsdSetJobUsername(job, "anonymous");
 
   if (!attr)
     ippAddString(job->attrs, IPP_TAG_JOB, IPP_TAG_NAME,
@@ -1745,6 +1809,8 @@ add_job(cupsd_client_t  *con,		/* I - Client connection */
     ippSetString(job->attrs, &job->reasons, 0, "none");
   }
 
+  cupsdUpdateJobTimer(job);
+
   if (!(printer->type & CUPS_PRINTER_REMOTE) || Classification)
   {
    /*
@@ -1950,8 +2016,7 @@ add_job_subscriptions(
     cupsd_job_t    *job)		/* I - Newly created job */
 {
   int			i;		/* Looping var */
-  ipp_attribute_t	*prev,		/* Previous attribute */
-			*next,		/* Next attribute */
+  ipp_attribute_t	*next,		/* Next attribute */
 			*attr;		/* Current attribute */
   cupsd_subscription_t	*sub;		/* Subscription object */
   const char		*recipient,	/* notify-recipient-uri */
@@ -2146,7 +2211,7 @@ add_job_subscriptions(
   * end of the request...
   */
 
-  for (attr = job->attrs->attrs, prev = NULL; attr; attr = next)
+  for (attr = job->attrs->attrs; attr; attr = next)
   {
     next = attr->next;
 
@@ -2157,19 +2222,11 @@ add_job_subscriptions(
       * Free and remove this attribute...
       */
 
-      ippDeleteAttribute(NULL, attr);
-
-      if (prev)
-        prev->next = next;
-      else
-        job->attrs->attrs = next;
+      ippDeleteAttribute(job->attrs, attr);
     }
-    else
-      prev = attr;
   }
 
-  job->attrs->last    = prev;
-  job->attrs->current = prev;
+  job->attrs->current = job->attrs->last;
 }
 
 
@@ -3614,6 +3671,62 @@ cancel_subscription(
 }
 
 
+/*
+ * 'check_notifications()' - Check whether a waiting Get-Notifications request
+ *                           can be answered.
+ */
+
+static int				/* O - 1 if ready, 0 if not */
+check_notifications(
+    cupsd_client_t *con)		/* I - Client connection */
+{
+  int			i;		/* Looping var */
+  cupsd_subscription_t	*sub;		/* Subscription */
+  ipp_attribute_t	*ids,		/* notify-subscription-ids */
+			*sequences;	/* notify-sequence-numbers */
+  int			min_seq;	/* Minimum sequence number */
+
+
+  ids       = ippFindAttribute(con->request, "notify-subscription-ids",
+                               IPP_TAG_INTEGER);
+  sequences = ippFindAttribute(con->request, "notify-sequence-numbers",
+                               IPP_TAG_INTEGER);
+
+  if (!ids)
+    return (1);
+
+  for (i = 0; i < ids->num_values; i ++)
+  {
+   /*
+    * Answer right away if the subscription went away or the job is done...
+    */
+
+    if ((sub = cupsdFindSubscription(ids->values[i].integer)) == NULL)
+      return (1);
+
+    if (sub->job && sub->job->state_value >= IPP_JOB_STOPPED)
+      return (1);
+
+   /*
+    * Otherwise see if there are any new events...
+    */
+
+    if (sequences && i < sequences->num_values)
+      min_seq = sequences->values[i].integer;
+    else
+      min_seq = 1;
+
+    if (min_seq < sub->first_event_id)
+      min_seq = sub->first_event_id;
+
+    if (min_seq < (sub->first_event_id + cupsArrayCount(sub->events)))
+      return (1);
+  }
+
+  return (0);
+}
+
+
 /*
  * 'check_rss_recipient()' - Check that we do not have a duplicate RSS feed URI.
  */
@@ -3980,6 +4093,8 @@ close_job(cupsd_client_t  *con,		/* I - Client connection */
     }
   }
 
+  cupsdUpdateJobTimer(job);
+
   job->dirty = 1;
   cupsdMarkDirty(CUPSD_DIRTY_JOBS);
 
@@ -4365,6 +4480,60 @@ copy_banner(cupsd_client_t *con,	/* I - Client connection */
 }
 
 
+/*
+ * 'copy_cached_attrs()' - Copy cached printer attributes.
+ *
+ * This applies the same filtering as copy_attrs() to the attributes encoded
+ * by cupsdCachePrinterAttrs() and adds the result as a single pre-encoded
+ * attribute.
+ */
+
+static void
+copy_cached_attrs(
+    ipp_t           *to,		/* I - Destination request */
+    cupsd_printer_t *printer,		/* I - Printer */
+    cups_array_t    *ra)		/* I - Requested attributes */
+{
+  int		i;			/* Looping var */
+  cupsd_cattr_t	*cattr;			/* Current cached attribute */
+  unsigned char	*data,			/* Encoded attributes */
+		*dataptr;		/* Pointer into data */
+
+
+  if (printer->cattr_length == 0 || (data = malloc(printer->cattr_length)) == NULL)
+    return;
+
+  for (i = printer->num_cattrs, cattr = printer->cattrs, dataptr = data; i > 0; i --, cattr ++)
+  {
+    if (ra)
+    {
+      if (!cupsArrayFind(ra, cattr->name))
+        continue;
+    }
+    else if (cattr->value_tag == IPP_TAG_BEGIN_COLLECTION &&
+             (to->request.status.version[0] == 1 ||
+	      !strcmp(cattr->name, "media-col-database")))
+    {
+     /*
+      * Don't send collection attributes by default to IPP/1.x clients
+      * since many do not support collections.  Also don't send
+      * media-col-database unless specifically requested by the client.
+      */
+
+      continue;
+    }
+
+    memcpy(dataptr, printer->cattr_data + cattr->offset, cattr->length);
+    dataptr += cattr->length;
+  }
+
+  if (dataptr > data)
+    _ippAddEncoded(to, IPP_TAG_PRINTER, "printer-attributes", data, (size_t)(dataptr - data));
+
+  free(data);
+}
+
+
 /*
  * 'copy_file()' - Copy a PPD file...
  */
@@ -4793,18 +4962,30 @@ copy_job_attrs(cupsd_client_t *con,	/* I - Client connection */
     if (job->creation_time && (!ra || cupsArrayFind(ra, "date-time-at-creation")))
       ippAddDate(con->response, IPP_TAG_JOB, "date-time-at-creation", ippTimeToDate(job->creation_time));
 
+    if (job->processing_time && (!ra || cupsArrayFind(ra, "date-time-at-processing")))
+      ippAddDate(con->response, IPP_TAG_JOB, "date-time-at-processing", ippTimeToDate(job->processing_time));
+
     if (!ra || cupsArrayFind(ra, "job-id"))
       ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-id", job->id);
 
+    if (!ra || cupsArrayFind(ra, "job-impressions-completed"))
+      ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-impressions-completed", job->num_impressions);
+
     if (!ra || cupsArrayFind(ra, "job-k-octets"))
       ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-k-octets", job->koctets);
 
+    if (!ra || cupsArrayFind(ra, "job-media-sheets-completed"))
+      ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-media-sheets-completed", job->num_sheets);
+
     if (job->name && (!ra || cupsArrayFind(ra, "job-name")))
       ippAddString(con->response, IPP_TAG_JOB, IPP_TAG_NAME, "job-name", NULL, job->name);
 
     if (job->username && (!ra || cupsArrayFind(ra, "job-originating-user-name")))
       ippAddString(con->response, IPP_TAG_JOB, IPP_TAG_NAME, "job-originating-user-name", NULL, job->username);
 
+    if (job->message && (!ra || cupsArrayFind(ra, "job-printer-state-message")))
+      ippAddString(con->response, IPP_TAG_JOB, IPP_TAG_TEXT, "job-printer-state-message", NULL, job->message);
+
     if (!ra || cupsArrayFind(ra, "job-state"))
       ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_ENUM, "job-state", (int)job->state_value);
 
@@ -4831,6 +5012,9 @@ copy_job_attrs(cupsd_client_t *con,	/* I - Client connection */
 
     if (job->creation_time && (!ra || cupsArrayFind(ra, "time-at-creation")))
       ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "time-at-creation", (int)job->creation_time);
+
+    if (job->processing_time && (!ra || cupsArrayFind(ra, "time-at-processing")))
+      ippAddInteger(con->response, IPP_TAG_JOB, IPP_TAG_INTEGER, "time-at-processing", (int)job->processing_time);
   }
 }
 
@@ -5016,10 +5200,17 @@ copy_printer_attrs(
   if (!ra || cupsArrayFind(ra, "queued-job-count"))
     add_queued_job_count(con, printer);
 
-  copy_attrs(con->response, printer->attrs, ra, IPP_TAG_ZERO, 0, NULL);
-  if (printer->ppd_attrs)
-    copy_attrs(con->response, printer->ppd_attrs, ra, IPP_TAG_ZERO, 0, NULL);
-  copy_attrs(con->response, CommonData, ra, IPP_TAG_ZERO, IPP_TAG_COPY, NULL);
+  if (cupsdCachePrinterAttrs(printer))
+  {
+    copy_cached_attrs(con->response, printer, ra);
+  }
+  else
+  {
+    copy_attrs(con->response, printer->attrs, ra, IPP_TAG_ZERO, 0, NULL);
+    if (printer->ppd_attrs)
+      copy_attrs(con->response, printer->ppd_attrs, ra, IPP_TAG_ZERO, 0, NULL);
+    copy_attrs(con->response, CommonData, ra, IPP_TAG_ZERO, IPP_TAG_COPY, NULL);
+  }
 
   _cupsRWUnlock(&printer->lock);
 }
@@ -6484,6 +6675,8 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
   cupsd_printer_t *printer;		/* Printer */
   cups_array_t	*list;			/* Which job list... */
   int		delete_list = 0;	/* Delete the list afterwards? */
+  cupsd_jobindex_t *dindex,		/* Jobs for destination */
+		*uindex;		/* Jobs for user */
   cups_array_t	*ra,			/* Requested attributes array */
 		*exclude;		/* Private attributes array */
   cupsd_policy_t *policy;		/* Current policy */
@@ -6700,13 +6893,19 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
 
   ra = create_requested_array(con->request);
   for (job_attr = (char *)cupsArrayFirst(ra); job_attr; job_attr = (char *)cupsArrayNext(ra))
-    if (strcmp(job_attr, "job-id") &&
+    if (strcmp(job_attr, "date-time-at-completed") &&
+	strcmp(job_attr, "date-time-at-creation") &&
+	strcmp(job_attr, "date-time-at-processing") &&
+	strcmp(job_attr, "job-id") &&
+	strcmp(job_attr, "job-impressions-completed") &&
 	strcmp(job_attr, "job-k-octets") &&
 	strcmp(job_attr, "job-media-progress") &&
+	strcmp(job_attr, "job-media-sheets-completed") &&
 	strcmp(job_attr, "job-more-info") &&
 	strcmp(job_attr, "job-name") &&
 	strcmp(job_attr, "job-originating-user-name") &&
 	strcmp(job_attr, "job-preserved") &&
+	strcmp(job_attr, "job-printer-state-message") &&
 	strcmp(job_attr, "job-printer-up-time") &&
         strcmp(job_attr, "job-printer-uri") &&
 	strcmp(job_attr, "job-state") &&
@@ -6714,6 +6913,7 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
 	strcmp(job_attr, "job-uri") &&
 	strcmp(job_attr, "time-at-completed") &&
 	strcmp(job_attr, "time-at-creation") &&
+	strcmp(job_attr, "time-at-processing") &&
 	strcmp(job_attr, "number-of-documents"))
     {
       need_load_job = 1;
@@ -6736,6 +6936,67 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
     cupsdLogClient(con, CUPSD_LOG_INFO, "Limiting Get-Jobs response to %d jobs.", limit);
   }
 
+  if (!job_ids && !delete_list && first_index <= 1)
+  {
+   /*
+    * Use the smallest state, destination, or user list that holds all of the
+    * matching jobs.  The per-state and per-destination/user active lists are
+    * sorted the same way as ActiveJobs.  Since "first-index" is a position in
+    * the Jobs or ActiveJobs array, only do this when it is not used...
+    */
+
+    if (list == ActiveJobs && job_comparison == 0)
+      list = JobsByState[job_state - IPP_JOB_PENDING];
+
+    dindex = dest ? cupsdFindJobIndex(JobsByDest, dest) : NULL;
+    uindex = username[0] ? cupsdFindJobIndex(JobsByUser, username) : NULL;
+
+    if (list != PrintingJobs)
+    {
+      if (dindex && (!uindex || cupsArrayCount(dindex->jobs) <= cupsArrayCount(uindex->jobs)))
+      {
+        cups_array_t *jobs = list == Jobs ? dindex->jobs : dindex->active;
+					/* Jobs for destination */
+
+        if (cupsArrayCount(jobs) < cupsArrayCount(list))
+	{
+	  if (printer && printer->job && printer->job->dest &&
+	      _cups_strcasecmp(printer->job->dest, dest))
+	  {
+	   /*
+	    * Also include the job from a class that is printing on this
+	    * printer...
+	    */
+
+	    list        = cupsArrayDup(jobs);
+	    delete_list = 1;
+
+	    cupsArrayAdd(list, printer->job);
+	  }
+	  else
+	    list = jobs;
+	}
+      }
+      else if (uindex)
+      {
+        cups_array_t *jobs = list == Jobs ? uindex->jobs : uindex->active;
+					/* Jobs for user */
+
+        if (cupsArrayCount(jobs) < cupsArrayCount(list))
+	  list = jobs;
+      }
+      else if ((dest && (!printer || !printer->job)) || username[0])
+      {
+       /*
+        * No jobs for this destination or user...
+	*/
+
+        list        = cupsArrayNew(NULL, NULL);
+	delete_list = 1;
+      }
+    }
+  }
+
  /*
   * OK, build a list of jobs for this printer...
   */
@@ -6785,6 +7046,51 @@ get_jobs(cupsd_client_t  *con,		/* I - Client connection */
   }
   else
   {
+    if (need_load_job && JobLoadThreads > 1)
+    {
+     /*
+      * Read the attributes of the (likely) matching jobs in parallel...
+      */
+
+      cups_array_t *load = cupsArrayNew(NULL, NULL);
+					/* Jobs to load */
+
+      if (first_index > 1)
+	job = (cupsd_job_t *)cupsArrayIndex(list, first_index - 1);
+      else
+	job = (cupsd_job_t *)cupsArrayFirst(list);
+
+      for (count = 0; (limit <= 0 || count < limit) && job; job = (cupsd_job_t *)cupsArrayNext(list))
+      {
+        if (!job->dest || !job->username || job->attrs)
+          continue;
+
+	if ((dest && strcmp(job->dest, dest)) &&
+	    (!job->printer || !dest || strcmp(job->printer->name, dest)))
+	  continue;
+	if ((job->dtype & dmask) != dtype &&
+	    (!job->printer || (job->printer->type & dmask) != dtype))
+	  continue;
+
+	if ((job_comparison < 0 && job->state_value > job_state) ||
+	    (job_comparison == 0 && job->state_value != job_state) ||
+	    (job_comparison > 0 && job->state_value < job_state))
+	  continue;
+
+	if (job->id < first_job_id)
+	  continue;
+
+	if (username[0] && _cups_strcasecmp(username, job->username))
+	  continue;
+
+        cupsArrayAdd(load, job);
+        count ++;
+      }
+
+      cupsdLoadJobs(load);
+      cupsArrayDelete(load);
+    }
+
     if (first_index > 1)
       job = (cupsd_job_t *)cupsArrayIndex(list, first_index - 1);
     else
@@ -6871,10 +7177,13 @@ get_notifications(cupsd_client_t *con)	/* I - Client connection */
   int			i, j;		/* Looping vars */
   http_status_t		status;		/* Policy status */
   cupsd_subscription_t	*sub;		/* Subscription */
+  cupsd_event_t		*event;		/* Current event */
   ipp_attribute_t	*ids,		/* notify-subscription-ids */
-			*sequences;	/* notify-sequence-numbers */
+			*sequences,	/* notify-sequence-numbers */
+			*wait;		/* notify-wait */
   int			min_seq;	/* Minimum sequence number */
   int			interval;	/* Poll interval */
+  int			waiting;	/* Is the client waiting for events? */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "get_notifications(con=%p[%d])",
@@ -6940,10 +7249,41 @@ get_notifications(cupsd_client_t *con)	/* I - Client connection */
   }
 
  /*
-  * Tell the client to poll again in N seconds...
+  * See if the client wants to wait for new events...
+  */
+
+  wait    = ippFindAttribute(con->request, "notify-wait", IPP_TAG_BOOLEAN);
+  waiting = wait && wait->values[0].boolean && interval > 0;
+
+  if (waiting && !con->notify_wait && !NeedReload && !check_notifications(con))
+  {
+   /*
+    * No events yet, so hold the request until there are some or the poll
+    * interval has passed.  The response is sent by cupsdUpdateNotifyWaits()...
+    */
+
+    if (interval >= Timeout)
+      interval = Timeout / 2;
+
+    cupsdLogClient(con, CUPSD_LOG_DEBUG,
+                   "Waiting up to %d seconds for notifications.", interval);
+
+    con->notify_wait = time(NULL) + interval;
+
+    ippDelete(con->response);
+    con->response = NULL;
+
+    cupsArrayRemove(ActiveClients, con);
+    cupsdSetBusyState(0);
+    return;
+  }
+
+ /*
+  * Tell the client to poll again in N seconds, unless it is waiting for
+  * events...
   */
 
-  if (interval > 0)
+  if (interval > 0 && !waiting)
     ippAddInteger(con->response, IPP_TAG_OPERATION, IPP_TAG_INTEGER,
                   "notify-get-interval", interval);
 
@@ -6988,10 +7328,13 @@ get_notifications(cupsd_client_t *con)	/* I - Client connection */
 
     for (; j < cupsArrayCount(sub->events); j ++)
     {
+      event = (cupsd_event_t *)cupsArrayIndex(sub->events, j);
+
       ippAddSeparator(con->response);
 
-      copy_attrs(con->response,
-                 ((cupsd_event_t *)cupsArrayIndex(sub->events, j))->attrs, NULL,
+      cupsdAddNotificationAttrs(con->response, sub, event,
+                                sub->first_event_id + j);
+      copy_attrs(con->response, event->attrs, NULL,
         	 IPP_TAG_EVENT_NOTIFICATION, 0, NULL);
     }
   }
@@ -8693,8 +9036,7 @@ read_job_ticket(cupsd_client_t *con)	/* I - Client connection */
   cups_option_t		*options;	/* Options */
   ipp_t			*ticket;	/* New attributes */
   ipp_attribute_t	*attr,		/* Current attribute */
-			*attr2,		/* Job attribute */
-			*prev2;		/* Previous job attribute */
+			*attr2;		/* Job attribute */
 
 
  /*
@@ -8802,25 +9144,7 @@ read_job_ticket(cupsd_client_t *con)	/* I - Client connection */
       * Some other value; first free the old value...
       */
 
-      if (con->request->attrs == attr2)
-      {
-	con->request->attrs = attr2->next;
-	prev2               = NULL;
-      }
-      else
-      {
-	for (prev2 = con->request->attrs; prev2; prev2 = prev2->next)
-	  if (prev2->next == attr2)
-	  {
-	    prev2->next = attr2->next;
-	    break;
-	  }
-      }
-
-      if (con->request->last == attr2)
-        con->request->last = prev2;
-
-      ippDeleteAttribute(NULL, attr2);
+      ippDeleteAttribute(con->request, attr2);
     }
 
    /*
@@ -9912,6 +10236,8 @@ send_document(cupsd_client_t  *con,	/* I - Client connection */
 	ippSetString(job->attrs, &job->reasons, 0, "job-hold-until-specified");
     }
 
+    cupsdUpdateJobTimer(job);
+
     job->dirty = 1;
     cupsdMarkDirty(CUPSD_DIRTY_JOBS);
 
@@ -9931,6 +10257,8 @@ send_document(cupsd_client_t  *con,	/* I - Client connection */
 
       ippSetString(job->attrs, &job->reasons, 0, "job-incoming");
 
+      cupsdUpdateJobTimer(job);
+
       job->dirty = 1;
       cupsdMarkDirty(CUPSD_DIRTY_JOBS);
     }
@@ -10468,15 +10796,7 @@ set_job_attrs(cupsd_client_t  *con,	/* I - Client connection */
       * Some other value; first free the old value...
       */
 
-      if (job->attrs->prev)
-        job->attrs->prev->next = attr2->next;
-      else
-        job->attrs->attrs = attr2->next;
-
-      if (job->attrs->last == attr2)
-        job->attrs->last = job->attrs->prev;
-
-      ippDeleteAttribute(NULL, attr2);
+      ippDeleteAttribute(job->attrs, attr2);
 
      /*
       * Then copy the attribute...
@@ -10493,15 +10813,7 @@ set_job_attrs(cupsd_client_t  *con,	/* I - Client connection */
       if ((attr2 = ippFindAttribute(job->attrs, attr->name,
                                     IPP_TAG_ZERO)) != NULL)
       {
-        if (job->attrs->prev)
-	  job->attrs->prev->next = attr2->next;
-	else
-	  job->attrs->attrs = attr2->next;
-
-        if (attr2 == job->attrs->last)
-	  job->attrs->last = job->attrs->prev;
-
-        ippDeleteAttribute(NULL, attr2);
+        ippDeleteAttribute(job->attrs, attr2);
 
         event |= CUPSD_EVENT_JOB_CONFIG_CHANGED;
       }
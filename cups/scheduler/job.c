@@ -48,6 +48,48 @@
  *     memory consumption.  We don't unload jobs where job->state_value <
  *     IPP_JOB_STOPPED, job->printer != NULL, or job->access_time is recent.
  *
+ * JOB INDEXES (JobsByDest, JobsByUser, JobsByState)
+ *
+ *     The JobsByDest and JobsByUser arrays hold one cupsd_jobindex_t entry per
+ *     destination/username with arrays of all and active jobs, so per-printer
+ *     and per-user job lookups don't need to scan the Jobs array.  The job's
+ *     dest and username strings must only be changed using cupsdSetJobDest
+ *     and cupsdSetJobUsername, and jobs must only be added to or removed from
+ *     the ActiveJobs array using cupsdSetJobActive.  Empty index entries are
+ *     freed by cupsdCleanJobs.
+ *
+ *     The JobsByState arrays hold the jobs in each state and are updated by
+ *     cupsdUpdateJobTimer.  Like ActiveJobs, the active job arrays are sorted
+ *     by priority, so the priority of an active job must only be changed
+ *     using cupsdSetJobPriority.
+ *
+ * JOB TIMERS (JobTimers, NumPendingJobs)
+ *
+ *     Active jobs with a kill_time, cancel_time, or (held) hold_until are
+ *     kept in the JobTimers array sorted by their earliest deadline, and
+ *     NumPendingJobs counts the active jobs that are pending.  cupsdCheckJobs
+ *     and the main loop's select timeout only look at the first JobTimers
+ *     entry instead of scanning every active job.  Code that changes one of
+ *     these fields or the job state directly must call cupsdUpdateJobTimer.
+ *
+ * SAVING OF JOBS (cupsdSaveAllJobs, cupsdSaveJob)
+ *
+ *     The job.cache file holds a summary of every job so that the scheduler
+ *     doesn't need to read every job control file at startup.  Rather than
+ *     rewriting job.cache for every change, cupsdSaveJob and cupsdDeleteJob
+ *     append entries to the job.journal file which is replayed on top of
+ *     job.cache when the jobs are loaded.  cupsdUpdateJobCache only rewrites
+ *     job.cache (and starts a new journal) once the journal has more entries
+ *     than there are jobs.
+ *
+ * LOADING OF JOBS (cupsdLoadJobs)
+ *
+ *     Read-only operations like Get-Jobs that need the attributes of many
+ *     unloaded jobs can read the job control files using up to JobLoadThreads
+ *     worker threads.  The worker threads only read the "c" files into new
+ *     ipp_t objects - everything else, including logging and updating the job
+ *     objects, happens on the main thread once all of the files are read.
+ *
  * STARTING OF JOBS (start_job)
  *
  *     When a job is started, a status buffer, several pipes, a security
@@ -96,6 +138,13 @@
  */
 
 
+/*
+ * Local constants...
+ */
+
+#define JOB_JOURNAL_SLACK	100	/* Extra journal entries so small queues don't rewrite job.cache each time */
+
+
 /*
  * Local globals...
  */
@@ -107,6 +156,33 @@ static mime_filter_t	gziptoany_filter =
 			  0,		/* Cost */
 			  "gziptoany"	/* Filter program to run */
 			};
+static cups_file_t	*JobJournal = NULL;
+					/* job.journal file */
+static int		JobJournalCount = 0,
+					/* Number of entries in job.journal */
+			JobCacheSerial = 0;
+					/* Serial number of job.cache */
+
+
+/*
+ * Local types...
+ */
+
+typedef struct cupsd_jrec_s		/**** Job journal record ****/
+{
+  int			id,		/* Job ID */
+			linenum,	/* Line number of most recent entry */
+			deleted;	/* Has the job been deleted? */
+} cupsd_jrec_t;
+
+typedef struct cupsd_jobload_s		/**** Job loading data ****/
+{
+  _cups_mutex_t		mutex;		/* Mutex for next */
+  int			next,		/* Next job to load */
+			num_jobs,	/* Number of jobs */
+			*ids;		/* Job IDs */
+  ipp_t			**attrs;	/* Job attributes */
+} cupsd_jobload_t;
 
 
 /*
@@ -116,24 +192,42 @@ static mime_filter_t	gziptoany_filter =
 static int	compare_active_jobs(void *first, void *second, void *data);
 static int	compare_completed_jobs(void *first, void *second, void *data);
 static int	compare_jobs(void *first, void *second, void *data);
+static int	compare_job_index(cupsd_jobindex_t *first,
+		                  cupsd_jobindex_t *second);
+static int	compare_job_timers(void *first, void *second, void *data);
+static int	compare_jrecs(cupsd_jrec_t *first, cupsd_jrec_t *second);
 static void	dump_job_history(cupsd_job_t *job);
 static void	finalize_job(cupsd_job_t *job, int set_job_state);
 static void	free_job_history(cupsd_job_t *job);
+static void	free_job_index(cups_array_t *index, int empty_only);
 static char	*get_options(cupsd_job_t *job, int banner_page, char *copies,
 		             size_t copies_size, char *title,
 			     size_t title_size);
+static void	index_job(cups_array_t *index, const char *name,
+		          cupsd_job_t *job, int active);
 static size_t	ipp_length(ipp_t *ipp);
+static int	load_job(cupsd_job_t *job, ipp_t *attrs);
 static void	load_job_cache(const char *filename);
+static cups_array_t *load_job_journal(const char *filename, int *serial);
+static void	*load_job_thread(cupsd_jobload_t *data);
 static void	load_next_job_id(const char *filename);
 static void	load_request_root(void);
+static int	read_job_cache(cups_file_t *fp, const char *filename,
+		               cups_array_t *journal, int serial,
+			       int is_journal);
 static void	remove_job_files(cupsd_job_t *job);
 static void	remove_job_history(cupsd_job_t *job);
 static void	set_time(cupsd_job_t *job, const char *name);
 static void	start_job(cupsd_job_t *job, cupsd_printer_t *printer);
 static void	stop_job(cupsd_job_t *job, cupsd_jobaction_t action);
+static void	unindex_job(cups_array_t *index, const char *name,
+		            cupsd_job_t *job);
 static void	unload_job(cupsd_job_t *job);
 static void	update_job(cupsd_job_t *job);
 static void	update_job_attrs(cupsd_job_t *job, int do_message);
+static void	update_job_summary(cupsd_job_t *job);
+static void	write_job_cache(cups_file_t *fp, cupsd_job_t *job);
+static void	write_job_journal(cupsd_job_t *job, int id);
 
 
 /*
@@ -161,14 +255,14 @@ cupsdAddJob(int        priority,	/* I - Job priority */
   job->status_pipes[0] = -1;
   job->status_pipes[1] = -1;
 
-  cupsdSetString(&job->dest, dest);
+  cupsdSetJobDest(job, dest);
 
  /*
   * Add the new job to the "all jobs" and "active jobs" lists...
   */
 
   cupsArrayAdd(Jobs, job);
-  cupsArrayAdd(ActiveJobs, job);
+  cupsdSetJobActive(job, 1);
 
   return (job);
 }
@@ -184,11 +278,32 @@ cupsdCancelJobs(const char *dest,	/* I - Destination to cancel */
 	        int        purge)	/* I - Purge jobs? */
 {
   cupsd_job_t	*job;			/* Current job */
+  cups_array_t	*list;			/* Jobs to check */
+  cupsd_jobindex_t *index;		/* Index entry */
 
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+  if (dest || username)
+  {
+   /*
+    * Only look at the jobs for the destination or user...
+    */
+
+    if (dest)
+      index = cupsdFindJobIndex(JobsByDest, dest);
+    else
+      index = cupsdFindJobIndex(JobsByUser, username);
+
+    if (!index)
+      return;
+
+    list = index->jobs;
+  }
+  else
+    list = Jobs;
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(list);
        job;
-       job = (cupsd_job_t *)cupsArrayNext(Jobs))
+       job = (cupsd_job_t *)cupsArrayNext(list))
   {
     if ((!job->dest || !job->username) && !cupsdLoadJob(job))
       continue;
@@ -225,93 +340,143 @@ cupsdCheckJobs(void)
   ipp_attribute_t	*attr;		/* Job attribute */
   time_t		curtime;	/* Current time */
   const char		*reasons;	/* job-state-reasons value */
+  int			i,		/* Looping var */
+			num_expired,	/* Number of expired deadlines */
+			*expired;	/* Job IDs with expired deadlines */
 
 
   curtime = time(NULL);
 
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCheckJobs: %d active jobs, sleeping=%d, ac-power=%d, reload=%d, curtime=%ld", cupsArrayCount(ActiveJobs), Sleeping, ACPower, NeedReload, (long)curtime);
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCheckJobs: %d active jobs, %d pending, %d timers, sleeping=%d, ac-power=%d, reload=%d, curtime=%ld", cupsArrayCount(ActiveJobs), NumPendingJobs, cupsArrayCount(JobTimers), Sleeping, ACPower, NeedReload, (long)curtime);
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs);
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
-  {
-    cupsdLogMessage(CUPSD_LOG_DEBUG2,
-                    "cupsdCheckJobs: Job %d - dest=\"%s\", printer=%p, "
-                    "state=%d, cancel_time=%ld, hold_until=%ld, kill_time=%ld, "
-                    "pending_cost=%d, pending_timeout=%ld", job->id, job->dest,
-                    job->printer, job->state_value, (long)job->cancel_time,
-                    (long)job->hold_until, (long)job->kill_time,
-                    job->pending_cost, (long)job->pending_timeout);
+ /*
+  * Collect the jobs whose deadlines have expired - the JobTimers array is
+  * sorted by deadline so we only need to look at the first few entries.  Job
+  * IDs are saved since the state changes below update the JobTimers array
+  * and can delete jobs...
+  */
 
-   /*
-    * Kill jobs if they are unresponsive...
-    */
+  for (num_expired = 0, job = (cupsd_job_t *)cupsArrayFirst(JobTimers);
+       job && job->timer_time <= curtime;
+       num_expired ++, job = (cupsd_job_t *)cupsArrayNext(JobTimers));
+
+  if (num_expired > 0 && (expired = calloc((size_t)num_expired, sizeof(int))) != NULL)
+  {
+    for (i = 0, job = (cupsd_job_t *)cupsArrayFirst(JobTimers);
+         i < num_expired;
+	 i ++, job = (cupsd_job_t *)cupsArrayNext(JobTimers))
+      expired[i] = job->id;
 
-    if (job->kill_time && job->kill_time <= curtime)
+    for (i = 0; i < num_expired; i ++)
     {
-      if (!job->completed)
-        cupsdLogJob(job, CUPSD_LOG_ERROR, "Stopping unresponsive job.");
+      if ((job = cupsdFindJob(expired[i])) == NULL || !job->active)
+        continue;
 
-      stop_job(job, CUPSD_JOB_FORCE);
-      continue;
-    }
+      cupsdLogMessage(CUPSD_LOG_DEBUG2,
+		      "cupsdCheckJobs: Job %d - dest=\"%s\", printer=%p, "
+		      "state=%d, cancel_time=%ld, hold_until=%ld, kill_time=%ld, "
+		      "pending_timeout=%ld", job->id, job->dest, job->printer,
+		      job->state_value, (long)job->cancel_time,
+		      (long)job->hold_until, (long)job->kill_time,
+		      (long)job->pending_timeout);
 
-   /*
-    * Cancel stuck jobs...
-    */
+     /*
+      * Kill jobs if they are unresponsive...
+      */
 
-    if (job->cancel_time && job->cancel_time <= curtime)
-    {
-      int cancel_after;			/* job-cancel-after value */
+      if (job->kill_time && job->kill_time <= curtime)
+      {
+	if (!job->completed)
+	  cupsdLogJob(job, CUPSD_LOG_ERROR, "Stopping unresponsive job.");
 
-      attr         = ippFindAttribute(job->attrs, "job-cancel-after", IPP_TAG_INTEGER);
-      cancel_after = attr ? ippGetInteger(attr, 0) : MaxJobTime;
+	stop_job(job, CUPSD_JOB_FORCE);
+	continue;
+      }
 
-      if (job->completed)
-	cupsdSetJobState(job, IPP_JOB_CANCELED, CUPSD_JOB_FORCE, "Marking stuck job as completed after %d seconds.", cancel_after);
-      else
-	cupsdSetJobState(job, IPP_JOB_CANCELED, CUPSD_JOB_DEFAULT, "Canceling stuck job after %d seconds.", cancel_after);
-      continue;
-    }
+     /*
+      * Cancel stuck jobs...
+      */
 
-   /*
-    * Start held jobs if they are ready...
-    */
+      if (job->cancel_time && job->cancel_time <= curtime)
+      {
+	int cancel_after;		/* job-cancel-after value */
 
-    if (job->state_value == IPP_JOB_HELD &&
-        job->hold_until &&
-	job->hold_until < curtime)
-    {
-      if (job->pending_timeout)
+	attr         = ippFindAttribute(job->attrs, "job-cancel-after", IPP_TAG_INTEGER);
+	cancel_after = attr ? ippGetInteger(attr, 0) : MaxJobTime;
+
+	if (job->completed)
+	  cupsdSetJobState(job, IPP_JOB_CANCELED, CUPSD_JOB_FORCE, "Marking stuck job as completed after %d seconds.", cancel_after);
+	else
+	  cupsdSetJobState(job, IPP_JOB_CANCELED, CUPSD_JOB_DEFAULT, "Canceling stuck job after %d seconds.", cancel_after);
+	continue;
+      }
+
+     /*
+      * Start held jobs if they are ready...
+      */
+
+      if (job->state_value == IPP_JOB_HELD &&
+	  job->hold_until &&
+	  job->hold_until < curtime)
       {
-       /*
-        * This job is pending; check that we don't have an active Send-Document
-	* operation in progress on any of the client connections, then timeout
-	* the job so we can start printing...
-	*/
+	if (job->pending_timeout)
+	{
+	 /*
+	  * This job is pending; check that we don't have an active Send-Document
+	  * operation in progress on any of the client connections, then timeout
+	  * the job so we can start printing...
+	  */
 
-        cupsd_client_t	*con;		/* Current client connection */
+	  cupsd_client_t	*con;	/* Current client connection */
 
-	for (con = (cupsd_client_t *)cupsArrayFirst(Clients);
-	     con;
-	     con = (cupsd_client_t *)cupsArrayNext(Clients))
-	  if (con->request &&
-	      con->request->request.op.operation_id == IPP_SEND_DOCUMENT)
-	    break;
+	  for (con = (cupsd_client_t *)cupsArrayFirst(Clients);
+	       con;
+	       con = (cupsd_client_t *)cupsArrayNext(Clients))
+	    if (con->request &&
+		con->request->request.op.operation_id == IPP_SEND_DOCUMENT)
+	      break;
 
-        if (con)
-	  continue;
+	  if (con)
+	    continue;
 
-        if (cupsdTimeoutJob(job))
-	  continue;
+	  if (cupsdTimeoutJob(job))
+	    continue;
 
-	cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT, "Job submission timed out.");
-	cupsdLogJob(job, CUPSD_LOG_ERROR, "Job submission timed out.");
+	  cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT, "Job submission timed out.");
+	  cupsdLogJob(job, CUPSD_LOG_ERROR, "Job submission timed out.");
+	}
+	else
+	  cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT, "Job hold expired.");
       }
-      else
-	cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT, "Job hold expired.");
     }
 
+    free(expired);
+  }
+
+ /*
+  * Then start or continue the remaining active jobs...
+  */
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
+  {
+   /*
+    * Held jobs are only interesting when their hold expires (above) or when
+    * they were held on create...
+    */
+
+    reasons = ippGetString(job->reasons, 0, NULL);
+
+    if (job->state_value == IPP_JOB_HELD &&
+        (!reasons || strcmp(reasons, "job-held-on-create")))
+      continue;
+
+    cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                    "cupsdCheckJobs: Job %d - dest=\"%s\", printer=%p, "
+                    "state=%d, pending_cost=%d", job->id, job->dest,
+                    job->printer, job->state_value, job->pending_cost);
+
    /*
     * Continue jobs that are waiting on the FilterLimit...
     */
@@ -430,6 +595,9 @@ cupsdCleanJobs(void)
                   "cupsdCleanJobs: MaxJobs=%d, JobHistory=%d, JobFiles=%d",
                   MaxJobs, JobHistory, JobFiles);
 
+  free_job_index(JobsByDest, 1);
+  free_job_index(JobsByUser, 1);
+
   if (MaxJobs <= 0 && JobHistory == INT_MAX && JobFiles == INT_MAX)
     return;
 
@@ -1392,10 +1560,20 @@ cupsdDeleteJob(cupsd_job_t       *job,	/* I - Job */
     finalize_job(job, 1);
 
   if (action == CUPSD_JOB_PURGE)
+  {
     remove_job_history(job);
+    write_job_journal(NULL, job->id);
+  }
+
+  unindex_job(JobsByUser, job->username, job);
+  unindex_job(JobsByDest, job->dest, job);
+
+  if (job->index_state)
+    cupsArrayRemove(JobsByState[job->index_state - IPP_JOB_PENDING], job);
 
   cupsdClearString(&job->username);
   cupsdClearString(&job->dest);
+  cupsdClearString(&job->message);
   for (i = 0;
        i < (int)(sizeof(job->auth_env) / sizeof(job->auth_env[0]));
        i ++)
@@ -1417,8 +1595,9 @@ cupsdDeleteJob(cupsd_job_t       *job,	/* I - Job */
 
   unload_job(job);
 
+  cupsdSetJobActive(job, 0);
+
   cupsArrayRemove(Jobs, job);
-  cupsArrayRemove(ActiveJobs, job);
   cupsArrayRemove(PrintingJobs, job);
 
   free(job);
@@ -1443,11 +1622,20 @@ cupsdFreeAllJobs(void)
   cupsdStopAllJobs(CUPSD_JOB_FORCE, 0);
   cupsdSaveAllJobs();
 
+  if (JobJournal)
+  {
+    cupsFileClose(JobJournal);
+    JobJournal = NULL;
+  }
+
   for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
        job;
        job = (cupsd_job_t *)cupsArrayNext(Jobs))
     cupsdDeleteJob(job, CUPSD_JOB_DEFAULT);
 
+  free_job_index(JobsByDest, 0);
+  free_job_index(JobsByUser, 0);
+
   cupsdReleaseSignals();
 }
 
@@ -1468,6 +1656,26 @@ cupsdFindJob(int id)			/* I - Job ID */
 }
 
 
+/*
+ * 'cupsdFindJobIndex()' - Find the index entry for a destination or user.
+ */
+
+cupsd_jobindex_t *			/* O - Index entry or NULL */
+cupsdFindJobIndex(cups_array_t *index,	/* I - JobsByDest or JobsByUser */
+                  const char   *name)	/* I - Destination or username */
+{
+  cupsd_jobindex_t	key;		/* Search key */
+
+
+  if (!index || !name)
+    return (NULL);
+
+  key.name = (char *)name;
+
+  return ((cupsd_jobindex_t *)cupsArrayFind(index, &key));
+}
+
+
 /*
  * 'cupsdGetCompletedJobs()'- Generate a completed jobs list.
  */
@@ -1476,17 +1684,51 @@ cups_array_t *				/* O - Array of jobs */
 cupsdGetCompletedJobs(
     cupsd_printer_t *p)			/* I - Printer */
 {
-  cups_array_t	*list;			/* Array of jobs */
+  cups_array_t	*list,			/* Array of jobs */
+		*jobs;			/* Jobs to check */
   cupsd_job_t	*job;			/* Current job */
+  cupsd_jobindex_t *index = NULL;	/* Index entry */
+  ipp_jstate_t	state;			/* Job state */
+  int		count;			/* Number of jobs in state lists */
 
 
   list = cupsArrayNew(compare_completed_jobs, NULL);
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(Jobs))
-    if ((!p || !_cups_strcasecmp(p->name, job->dest)) && job->state_value >= IPP_JOB_STOPPED && job->completed_time)
-      cupsArrayAdd(list, job);
+  if (p && (index = cupsdFindJobIndex(JobsByDest, p->name)) == NULL)
+    return (list);
+
+ /*
+  * Use the stopped and completed state lists unless the printer has fewer
+  * jobs...
+  */
+
+  for (state = IPP_JOB_STOPPED, count = 0; state <= IPP_JOB_COMPLETED; state ++)
+    count += cupsArrayCount(JobsByState[state - IPP_JOB_PENDING]);
+
+  if (index && cupsArrayCount(index->jobs) < count)
+  {
+    jobs = index->jobs;
+
+    for (job = (cupsd_job_t *)cupsArrayFirst(jobs);
+	 job;
+	 job = (cupsd_job_t *)cupsArrayNext(jobs))
+      if (job->state_value >= IPP_JOB_STOPPED && job->completed_time)
+	cupsArrayAdd(list, job);
+
+    return (list);
+  }
+
+  for (state = IPP_JOB_STOPPED; state <= IPP_JOB_COMPLETED; state ++)
+  {
+    jobs = JobsByState[state - IPP_JOB_PENDING];
+
+    for (job = (cupsd_job_t *)cupsArrayFirst(jobs);
+	 job;
+	 job = (cupsd_job_t *)cupsArrayNext(jobs))
+      if (job->completed_time &&
+          (!p || (job->dest && !_cups_strcasecmp(job->dest, p->name))))
+	cupsArrayAdd(list, job);
+  }
 
   return (list);
 }
@@ -1501,17 +1743,13 @@ int					/* O - Job count */
 cupsdGetPrinterJobCount(
     const char *dest)			/* I - Printer or class name */
 {
-  int		count;			/* Job count */
-  cupsd_job_t	*job;			/* Current job */
+  cupsd_jobindex_t *index;		/* Index entry */
 
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs), count = 0;
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
-    if (job->dest && !_cups_strcasecmp(job->dest, dest))
-      count ++;
-
-  return (count);
+  if ((index = cupsdFindJobIndex(JobsByDest, dest)) != NULL)
+    return (cupsArrayCount(index->active));
+  else
+    return (0);
 }
 
 
@@ -1524,17 +1762,13 @@ int					/* O - Job count */
 cupsdGetUserJobCount(
     const char *username)		/* I - Username */
 {
-  int		count;			/* Job count */
-  cupsd_job_t	*job;			/* Current job */
+  cupsd_jobindex_t *index;		/* Index entry */
 
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs), count = 0;
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
-    if (!_cups_strcasecmp(job->username, username))
-      count ++;
-
-  return (count);
+  if ((index = cupsdFindJobIndex(JobsByUser, username)) != NULL)
+    return (cupsArrayCount(index->active));
+  else
+    return (0);
 }
 
 
@@ -1545,11 +1779,14 @@ cupsdGetUserJobCount(
 void
 cupsdLoadAllJobs(void)
 {
-  char		filename[1024];		/* Full filename of job.cache file */
-  struct stat	fileinfo;		/* Information on job.cache file */
+  char		filename[1024],		/* Full filename of job.cache file */
+		journalfile[1024];	/* Full filename of job.journal file */
+  struct stat	fileinfo,		/* Information on job.cache file */
+		journalinfo;		/* Information on job.journal file */
   cups_dir_t	*dir;			/* RequestRoot dir */
   cups_dentry_t	*dent;			/* Entry in RequestRoot */
   int		load_cache = 1;		/* Load the job.cache file? */
+  ipp_jstate_t	state;			/* Job state */
 
 
  /*
@@ -1565,11 +1802,32 @@ cupsdLoadAllJobs(void)
   if (!PrintingJobs)
     PrintingJobs = cupsArrayNew(compare_jobs, NULL);
 
+  if (!JobsByDest)
+    JobsByDest = cupsArrayNew((cups_array_func_t)compare_job_index, NULL);
+
+  if (!JobsByUser)
+    JobsByUser = cupsArrayNew((cups_array_func_t)compare_job_index, NULL);
+
+  if (!JobTimers)
+    JobTimers = cupsArrayNew(compare_job_timers, NULL);
+
+  for (state = IPP_JOB_PENDING; state <= IPP_JOB_COMPLETED; state ++)
+  {
+    if (JobsByState[state - IPP_JOB_PENDING])
+      continue;
+
+    if (state <= IPP_JOB_STOPPED)
+      JobsByState[state - IPP_JOB_PENDING] = cupsArrayNew(compare_active_jobs, NULL);
+    else
+      JobsByState[state - IPP_JOB_PENDING] = cupsArrayNew(compare_jobs, NULL);
+  }
+
  /*
   * See whether the job.cache file is older than the RequestRoot directory...
   */
 
   snprintf(filename, sizeof(filename), "%s/job.cache", CacheDir);
+  snprintf(journalfile, sizeof(journalfile), "%s/job.journal", CacheDir);
 
   if (stat(filename, &fileinfo))
   {
@@ -1594,6 +1852,15 @@ cupsdLoadAllJobs(void)
   }
   else
   {
+   /*
+    * Job history files are also current if they are older than the
+    * job.journal file...
+    */
+
+    if (!stat(journalfile, &journalinfo) &&
+        journalinfo.st_mtime > fileinfo.st_mtime)
+      fileinfo.st_mtime = journalinfo.st_mtime;
+
     while ((dent = cupsDirRead(dir)) != NULL)
     {
       if (strlen(dent->filename) >= 6 && dent->filename[0] == 'c' && dent->fileinfo.st_mtime > fileinfo.st_mtime)
@@ -1649,660 +1916,416 @@ cupsdLoadAllJobs(void)
 int					/* O - 1 on success, 0 on failure */
 cupsdLoadJob(cupsd_job_t *job)		/* I - Job */
 {
-  int			i;		/* Looping var */
-  char			jobfile[1024];	/* Job filename */
-  cups_file_t		*fp;		/* Job file */
-  int			fileid;		/* Current file ID */
-  ipp_attribute_t	*attr;		/* Job attribute */
-  const char		*dest;		/* Destination name */
-  cupsd_printer_t	*destptr;	/* Pointer to destination */
-  mime_type_t		**filetypes;	/* New filetypes array */
-  int			*compressions;	/* New compressions array */
+  return (load_job(job, NULL));
+}
 
 
-  if (job->attrs)
-  {
-    if (job->state_value > IPP_JOB_STOPPED)
-      job->access_time = time(NULL);
+/*
+ * 'cupsdLoadJobs()' - Load the attributes for a list of jobs.
+ *
+ * The job control files are read using up to JobLoadThreads threads.
+ */
 
-    return (1);
-  }
+void
+cupsdLoadJobs(cups_array_t *jobs)	/* I - Jobs to load */
+{
+  int			i,		/* Looping var */
+			num_threads;	/* Number of threads */
+  cupsd_job_t		*job;		/* Current job */
+  cupsd_jobload_t	data;		/* Job loading data */
+  _cups_thread_t	threads[CUPSD_MAX_LOAD_THREADS];
+					/* Worker threads */
 
-  if ((job->attrs = ippNew()) == NULL)
-  {
-    cupsdLogJob(job, CUPSD_LOG_ERROR, "Ran out of memory for job attributes.");
-    return (0);
-  }
 
  /*
-  * Load job attributes...
+  * Figure out which jobs need to be loaded...
   */
 
-  cupsdLogJob(job, CUPSD_LOG_DEBUG, "Loading attributes...");
+  memset(&data, 0, sizeof(data));
 
-  snprintf(jobfile, sizeof(jobfile), "%s/c%05d", RequestRoot, job->id);
-  if ((fp = cupsdOpenConfFile(jobfile)) == NULL)
-    goto error;
+  if ((data.ids = calloc((size_t)cupsArrayCount(jobs) + 1, sizeof(int))) == NULL)
+    return;
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(jobs);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(jobs))
+    if (!job->attrs)
+      data.ids[data.num_jobs ++] = job->id;
 
-  if (ippReadIO(fp, (ipp_iocb_t)cupsFileRead, 1, NULL, job->attrs) != IPP_DATA)
+  if ((num_threads = JobLoadThreads) > CUPSD_MAX_LOAD_THREADS)
+    num_threads = CUPSD_MAX_LOAD_THREADS;
+  if (num_threads > data.num_jobs / 2)
+    num_threads = data.num_jobs / 2;
+
+  if (num_threads > 1 &&
+      (data.attrs = calloc((size_t)data.num_jobs, sizeof(ipp_t *))) != NULL)
   {
-    cupsdLogJob(job, CUPSD_LOG_ERROR,
-		"Unable to read job control file \"%s\".", jobfile);
-    cupsFileClose(fp);
-    goto error;
-  }
+   /*
+    * Read the job control files in parallel...
+    */
 
-  cupsFileClose(fp);
+    cupsdLogMessage(CUPSD_LOG_DEBUG2,
+                    "cupsdLoadJobs: Loading %d jobs using %d threads.",
+		    data.num_jobs, num_threads);
 
- /*
-  * Copy attribute data to the job object...
-  */
+    _cupsMutexInit(&data.mutex);
 
-  if (!ippFindAttribute(job->attrs, "time-at-creation", IPP_TAG_INTEGER))
-  {
-    cupsdLogJob(job, CUPSD_LOG_ERROR,
-		"Missing or bad time-at-creation attribute in control file.");
-    goto error;
-  }
+    for (i = 0; i < num_threads; i ++)
+      if ((threads[i] = _cupsThreadCreate((_cups_thread_func_t)load_job_thread,
+                                          &data)) == 0)
+        break;
 
-  if ((job->state = ippFindAttribute(job->attrs, "job-state",
-                                     IPP_TAG_ENUM)) == NULL)
-  {
-    cupsdLogJob(job, CUPSD_LOG_ERROR,
-		"Missing or bad job-state attribute in control file.");
-    goto error;
-  }
+    num_threads = i;
 
-  job->state_value  = (ipp_jstate_t)job->state->values[0].integer;
-  job->file_time    = 0;
-  job->history_time = 0;
+    if (num_threads == 0)
+      load_job_thread(&data);		/* Unable to create threads... */
 
-  if ((attr = ippFindAttribute(job->attrs, "time-at-creation", IPP_TAG_INTEGER)) != NULL)
-    job->creation_time = attr->values[0].integer;
+    for (i = 0; i < num_threads; i ++)
+      _cupsThreadWait(threads[i]);
+  }
 
-  if (job->state_value >= IPP_JOB_CANCELED && (attr = ippFindAttribute(job->attrs, "time-at-completed", IPP_TAG_INTEGER)) != NULL)
+ /*
+  * Finish loading the jobs on the main thread...
+  */
+
+  for (i = 0; i < data.num_jobs; i ++)
   {
-    job->completed_time = attr->values[0].integer;
+    if ((job = cupsdFindJob(data.ids[i])) == NULL)
+      continue;
 
-    if (JobHistory < INT_MAX)
-      job->history_time = job->completed_time + JobHistory;
+    if (data.attrs && data.attrs[i] && !job->attrs)
+      load_job(job, data.attrs[i]);
     else
-      job->history_time = INT_MAX;
+    {
+      if (data.attrs)
+        ippDelete(data.attrs[i]);
 
-    if (job->history_time < time(NULL))
-      goto error;			/* Expired, remove from history */
+      cupsdLoadJob(job);
+    }
+  }
 
-    if (job->history_time < JobHistoryUpdate || !JobHistoryUpdate)
-      JobHistoryUpdate = job->history_time;
+  free(data.ids);
+  free(data.attrs);
+}
 
-    if (JobFiles < INT_MAX)
-      job->file_time = job->completed_time + JobFiles;
-    else
-      job->file_time = INT_MAX;
 
-    cupsdLogJob(job, CUPSD_LOG_DEBUG2, "cupsdLoadJob: job->file_time=%ld, time-at-completed=%ld, JobFiles=%d", (long)job->file_time, (long)attr->values[0].integer, JobFiles);
+/*
+ * 'cupsdMoveJob()' - Move the specified job to a different destination.
+ */
 
-    if (job->file_time < JobHistoryUpdate || !JobHistoryUpdate)
-      JobHistoryUpdate = job->file_time;
+void
+cupsdMoveJob(cupsd_job_t     *job,	/* I - Job */
+             cupsd_printer_t *p)	/* I - Destination printer or class */
+{
+  ipp_attribute_t	*attr;		/* job-printer-uri attribute */
+  const char		*olddest;	/* Old destination */
+  cupsd_printer_t	*oldp;		/* Old pointer */
 
-    cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdLoadJob: JobHistoryUpdate=%ld",
-		    (long)JobHistoryUpdate);
-  }
 
-  if (!job->dest)
-  {
-    if ((attr = ippFindAttribute(job->attrs, "job-printer-uri",
-                                 IPP_TAG_URI)) == NULL)
-    {
-      cupsdLogJob(job, CUPSD_LOG_ERROR,
-		  "No job-printer-uri attribute in control file.");
-      goto error;
-    }
+ /*
+  * Don't move completed jobs...
+  */
 
-    if ((dest = cupsdValidateDest(attr->values[0].string.text, &(job->dtype),
-                                  &destptr)) == NULL)
-    {
-      cupsdLogJob(job, CUPSD_LOG_ERROR,
-		  "Unable to queue job for destination \"%s\".",
-		  attr->values[0].string.text);
-      goto error;
-    }
+  if (job->state_value > IPP_JOB_STOPPED)
+    return;
 
-    cupsdSetString(&job->dest, dest);
-  }
-  else if ((destptr = cupsdFindDest(job->dest)) == NULL)
-  {
-    cupsdLogJob(job, CUPSD_LOG_ERROR,
-		"Unable to queue job for destination \"%s\".",
-		job->dest);
-    goto error;
-  }
+ /*
+  * Get the old destination...
+  */
 
-  if ((job->reasons = ippFindAttribute(job->attrs, "job-state-reasons",
-                                       IPP_TAG_KEYWORD)) == NULL)
-  {
-    const char	*reason;		/* job-state-reason keyword */
+  olddest = job->dest;
 
-    cupsdLogJob(job, CUPSD_LOG_DEBUG,
-		"Adding missing job-state-reasons attribute to  control file.");
+  if (job->printer)
+    oldp = job->printer;
+  else
+    oldp = cupsdFindDest(olddest);
 
-    switch (job->state_value)
-    {
-      default :
-      case IPP_JOB_PENDING :
-          if (destptr->state == IPP_PRINTER_STOPPED)
-            reason = "printer-stopped";
-          else
-            reason = "none";
-          break;
+ /*
+  * Change the destination information...
+  */
 
-      case IPP_JOB_HELD :
-          if ((attr = ippFindAttribute(job->attrs, "job-hold-until",
-                                       IPP_TAG_ZERO)) != NULL &&
-              (attr->value_tag == IPP_TAG_NAME ||
-	       attr->value_tag == IPP_TAG_NAMELANG ||
-	       attr->value_tag == IPP_TAG_KEYWORD) &&
-	      strcmp(attr->values[0].string.text, "no-hold"))
-	    reason = "job-hold-until-specified";
-	  else
-	    reason = "job-incoming";
-          break;
+  if (job->state_value > IPP_JOB_HELD)
+    cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT,
+		     "Stopping job prior to move.");
 
-      case IPP_JOB_PROCESSING :
-          reason = "job-printing";
-          break;
+  cupsdAddEvent(CUPSD_EVENT_JOB_CONFIG_CHANGED, oldp, job,
+                "Job #%d moved from %s to %s.", job->id, olddest,
+		p->name);
 
-      case IPP_JOB_STOPPED :
-          reason = "job-stopped";
-          break;
+  cupsdSetJobDest(job, p->name);
+  job->dtype = p->type & (CUPS_PRINTER_CLASS | CUPS_PRINTER_REMOTE);
 
-      case IPP_JOB_CANCELED :
-          reason = "job-canceled-by-user";
-          break;
+  if ((attr = ippFindAttribute(job->attrs, "job-printer-uri",
+                               IPP_TAG_URI)) != NULL)
+    ippSetString(job->attrs, &attr, 0, p->uri);
 
-      case IPP_JOB_ABORTED :
-          reason = "aborted-by-system";
-          break;
+  cupsdAddEvent(CUPSD_EVENT_JOB_STOPPED, p, job,
+                "Job #%d moved from %s to %s.", job->id, olddest,
+		p->name);
 
-      case IPP_JOB_COMPLETED :
-          reason = "job-completed-successfully";
-          break;
-    }
+  job->dirty = 1;
+  cupsdMarkDirty(CUPSD_DIRTY_JOBS);
+}
 
-    job->reasons = ippAddString(job->attrs, IPP_TAG_JOB, IPP_TAG_KEYWORD,
-                                "job-state-reasons", NULL, reason);
-  }
-  else if (job->state_value == IPP_JOB_PENDING)
-  {
-    if (destptr->state == IPP_PRINTER_STOPPED)
-      ippSetString(job->attrs, &job->reasons, 0, "printer-stopped");
-    else
-      ippSetString(job->attrs, &job->reasons, 0, "none");
-  }
 
-  job->impressions = ippFindAttribute(job->attrs, "job-impressions-completed", IPP_TAG_INTEGER);
-  job->sheets      = ippFindAttribute(job->attrs, "job-media-sheets-completed", IPP_TAG_INTEGER);
-  job->job_sheets  = ippFindAttribute(job->attrs, "job-sheets", IPP_TAG_NAME);
+/*
+ * 'cupsdReleaseJob()' - Release the specified job.
+ */
 
-  if (!job->impressions)
-    job->impressions = ippAddInteger(job->attrs, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-impressions-completed", 0);
-  if (!job->sheets)
-    job->sheets = ippAddInteger(job->attrs, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-media-sheets-completed", 0);
+void
+cupsdReleaseJob(cupsd_job_t *job)	/* I - Job */
+{
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdReleaseJob(job=%p(%d))", job,
+                  job->id);
 
-  if (!job->priority)
+  if (job->state_value == IPP_JOB_HELD)
   {
-    if ((attr = ippFindAttribute(job->attrs, "job-priority",
-                        	 IPP_TAG_INTEGER)) == NULL)
-    {
-      cupsdLogJob(job, CUPSD_LOG_ERROR,
-		  "Missing or bad job-priority attribute in control file.");
-      goto error;
-    }
+   /*
+    * Add trailing banner as needed...
+    */
 
-    job->priority = attr->values[0].integer;
+    if (job->pending_timeout)
+      cupsdTimeoutJob(job);
+
+    cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT,
+                     "Job released by user.");
   }
+}
 
-  if (!job->username)
-  {
-    if ((attr = ippFindAttribute(job->attrs, "job-originating-user-name",
-                        	 IPP_TAG_NAME)) == NULL)
-    {
-      cupsdLogJob(job, CUPSD_LOG_ERROR,
-		  "Missing or bad job-originating-user-name "
-		  "attribute in control file.");
-      goto error;
-    }
 
-    cupsdSetString(&job->username, attr->values[0].string.text);
-  }
+/*
+ * 'cupsdRestartJob()' - Restart the specified job.
+ */
 
-  if (!job->name)
-  {
-    if ((attr = ippFindAttribute(job->attrs, "job-name", IPP_TAG_NAME)) != NULL)
-      cupsdSetString(&job->name, attr->values[0].string.text);
-  }
+void
+cupsdRestartJob(cupsd_job_t *job)	/* I - Job */
+{
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdRestartJob(job=%p(%d))", job,
+                  job->id);
+
+  if (job->state_value == IPP_JOB_STOPPED || job->num_files)
+    cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT,
+                     "Job restarted by user.");
+}
+
+
+/*
+ * 'cupsdSaveAllJobs()' - Save a summary of all jobs to disk.
+ *
+ * The job.journal file is reset once the new job.cache file is in place.
+ */
+
+void
+cupsdSaveAllJobs(void)
+{
+  cups_file_t	*fp;			/* job.cache file */
+  char		filename[1024],		/* job.cache filename */
+		temp[1024];		/* Temporary string */
+  cupsd_job_t	*job;			/* Current job */
+  time_t	curtime;		/* Current time */
+  struct tm	curdate;		/* Current date */
+  int		serial;			/* Serial number for job.cache */
+
+
+  snprintf(filename, sizeof(filename), "%s/job.cache", CacheDir);
+  if ((fp = cupsdCreateConfFile(filename, ConfigFilePerm)) == NULL)
+    return;
+
+  cupsdLogMessage(CUPSD_LOG_INFO, "Saving job.cache...");
 
  /*
-  * Set the job hold-until time and state...
+  * Write a small header to the file...
   */
 
-  if (job->state_value == IPP_JOB_HELD)
-  {
-    if ((attr = ippFindAttribute(job->attrs, "job-hold-until",
-	                         IPP_TAG_KEYWORD)) == NULL)
-      attr = ippFindAttribute(job->attrs, "job-hold-until", IPP_TAG_NAME);
+  time(&curtime);
+  localtime_r(&curtime, &curdate);
+  strftime(temp, sizeof(temp) - 1, "%Y-%m-%d %H:%M", &curdate);
 
-    if (attr)
-      cupsdSetJobHoldUntil(job, attr->values[0].string.text, CUPSD_JOB_DEFAULT);
-    else
-    {
-      job->state->values[0].integer = IPP_JOB_PENDING;
-      job->state_value              = IPP_JOB_PENDING;
-    }
-  }
-  else if (job->state_value == IPP_JOB_PROCESSING)
-  {
-    job->state->values[0].integer = IPP_JOB_PENDING;
-    job->state_value              = IPP_JOB_PENDING;
-  }
+  cupsFilePuts(fp, "# Job cache file for " CUPS_SVERSION "\n");
+  cupsFilePrintf(fp, "# Written by cupsd on %s\n", temp);
+  cupsFilePrintf(fp, "NextJobId %d\n", NextJobId);
 
-  if ((attr = ippFindAttribute(job->attrs, "job-k-octets", IPP_TAG_INTEGER)) != NULL)
-    job->koctets = attr->values[0].integer;
+ /*
+  * The serial number ties the job.journal file to this job.cache file; use
+  * the current time so that a journal from an older job.cache file (after a
+  * crash or restore) won't match...
+  */
 
-  if (!job->num_files)
-  {
-   /*
-    * Find all the d##### files...
-    */
+  if ((serial = (int)curtime) <= JobCacheSerial)
+    serial = JobCacheSerial + 1;
 
-    for (fileid = 1; fileid < 10000; fileid ++)
-    {
-      snprintf(jobfile, sizeof(jobfile), "%s/d%05d-%03d", RequestRoot,
-               job->id, fileid);
+  cupsFilePrintf(fp, "Serial %d\n", serial);
 
-      if (access(jobfile, 0))
-        break;
+ /*
+  * Write each job known to the system...
+  */
 
-      cupsdLogJob(job, CUPSD_LOG_DEBUG,
-		  "Auto-typing document file \"%s\"...", jobfile);
-
-      if (fileid > job->num_files)
-      {
-        if (job->num_files == 0)
-	{
-	  compressions = (int *)calloc((size_t)fileid, sizeof(int));
-	  filetypes    = (mime_type_t **)calloc((size_t)fileid, sizeof(mime_type_t *));
-	}
-	else
-	{
-	  compressions = (int *)realloc(job->compressions, sizeof(int) * (size_t)fileid);
-	  filetypes    = (mime_type_t **)realloc(job->filetypes, sizeof(mime_type_t *) * (size_t)fileid);
-        }
-
-	if (compressions)
-	  job->compressions = compressions;
-
-	if (filetypes)
-	  job->filetypes = filetypes;
-
-        if (!compressions || !filetypes)
-	{
-          cupsdLogJob(job, CUPSD_LOG_ERROR,
-		      "Ran out of memory for job file types.");
-
-	  ippDelete(job->attrs);
-	  job->attrs = NULL;
-
-	  if (job->compressions)
-	  {
-	    free(job->compressions);
-	    job->compressions = NULL;
-	  }
-
-	  if (job->filetypes)
-	  {
-	    free(job->filetypes);
-	    job->filetypes = NULL;
-	  }
-
-	  job->num_files = 0;
-	  return (0);
-	}
-
-	job->num_files = fileid;
-      }
-
-      job->filetypes[fileid - 1] = mimeFileType(MimeDatabase, jobfile, NULL,
-                                                job->compressions + fileid - 1);
-
-      if (!job->filetypes[fileid - 1])
-        job->filetypes[fileid - 1] = mimeType(MimeDatabase, "application",
-	                                      "vnd.cups-raw");
-    }
-  }
-
- /*
-  * Load authentication information as needed...
-  */
-
-  if (job->state_value < IPP_JOB_STOPPED)
+  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+       job;
+       job = (cupsd_job_t *)cupsArrayNext(Jobs))
   {
-    snprintf(jobfile, sizeof(jobfile), "%s/a%05d", RequestRoot, job->id);
-
-    for (i = 0;
-	 i < (int)(sizeof(job->auth_env) / sizeof(job->auth_env[0]));
-	 i ++)
-      cupsdClearString(job->auth_env + i);
-    cupsdClearString(&job->auth_uid);
-
-    if ((fp = cupsFileOpen(jobfile, "r")) != NULL)
+    if (job->printer && job->printer->temporary)
     {
-      int	bytes,			/* Size of auth data */
-		linenum = 1;		/* Current line number */
-      char	line[65536],		/* Line from file */
-		*value,			/* Value from line */
-		data[65536];		/* Decoded data */
-
-
-      if (cupsFileGets(fp, line, sizeof(line)) &&
-          !strcmp(line, "CUPSD-AUTH-V3"))
-      {
-        i = 0;
-        while (cupsFileGetConf(fp, line, sizeof(line), &value, &linenum))
-        {
-         /*
-          * Decode value...
-          */
-
-          if (strcmp(line, "negotiate") && strcmp(line, "uid"))
-          {
-	    bytes = sizeof(data);
-	    httpDecode64_2(data, &bytes, value);
-	  }
-
-         /*
-          * Assign environment variables...
-          */
-
-          if (!strcmp(line, "uid"))
-          {
-            cupsdSetStringf(&job->auth_uid, "AUTH_UID=%s", value);
-            continue;
-          }
-          else if (i >= (int)(sizeof(job->auth_env) / sizeof(job->auth_env[0])))
-            break;
-
-	  if (!strcmp(line, "username"))
-	    cupsdSetStringf(job->auth_env + i, "AUTH_USERNAME=%s", data);
-	  else if (!strcmp(line, "domain"))
-	    cupsdSetStringf(job->auth_env + i, "AUTH_DOMAIN=%s", data);
-	  else if (!strcmp(line, "password"))
-	    cupsdSetStringf(job->auth_env + i, "AUTH_PASSWORD=%s", data);
-	  else if (!strcmp(line, "negotiate"))
-	    cupsdSetStringf(job->auth_env + i, "AUTH_NEGOTIATE=%s", value);
-	  else
-	    continue;
-
-	  i ++;
-	}
-      }
+     /*
+      * Don't save jobs on temporary printers...
+      */
 
-      cupsFileClose(fp);
+      continue;
     }
+
+    write_job_cache(fp, job);
   }
 
-  job->access_time = time(NULL);
-  return (1);
+  if (cupsdCloseCreatedConfFile(fp, filename))
+    return;
 
  /*
-  * If we get here then something bad happened...
+  * Start a new job.journal file for the new job.cache file...
   */
 
-  error:
+  JobCacheSerial  = serial;
+  JobJournalCount = 0;
 
-  ippDelete(job->attrs);
-  job->attrs = NULL;
+  if (JobJournal)
+    cupsFileClose(JobJournal);
 
-  remove_job_history(job);
-  remove_job_files(job);
+  snprintf(filename, sizeof(filename), "%s/job.journal", CacheDir);
+  if ((JobJournal = cupsFileOpen(filename, "w")) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to create \"%s\": %s", filename,
+                    strerror(errno));
+    return;
+  }
 
-  return (0);
+  if (!getuid() && fchown(cupsFileNumber(JobJournal), getuid(), Group))
+    cupsdLogMessage(CUPSD_LOG_WARN, "Unable to change group for \"%s\": %s",
+		    filename, strerror(errno));
+
+  if (fchmod(cupsFileNumber(JobJournal), ConfigFilePerm))
+    cupsdLogMessage(CUPSD_LOG_WARN,
+		    "Unable to change permissions for \"%s\": %s",
+		    filename, strerror(errno));
+
+  cupsFilePuts(JobJournal, "# Job journal file for " CUPS_SVERSION "\n");
+  cupsFilePrintf(JobJournal, "Serial %d\n", JobCacheSerial);
+  cupsFileFlush(JobJournal);
 }
 
 
 /*
- * 'cupsdMoveJob()' - Move the specified job to a different destination.
+ * 'cupsdSaveJob()' - Save a job to disk.
  */
 
 void
-cupsdMoveJob(cupsd_job_t     *job,	/* I - Job */
-             cupsd_printer_t *p)	/* I - Destination printer or class */
+cupsdSaveJob(cupsd_job_t *job)		/* I - Job */
 {
-  ipp_attribute_t	*attr;		/* job-printer-uri attribute */
-  const char		*olddest;	/* Old destination */
-  cupsd_printer_t	*oldp;		/* Old pointer */
+  char		filename[1024];		/* Job control filename */
+  cups_file_t	*fp;			/* Job file */
 
 
- /*
-  * Don't move completed jobs...
-  */
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdSaveJob(job=%p(%d)): job->attrs=%p",
+                  job, job->id, job->attrs);
 
-  if (job->state_value > IPP_JOB_STOPPED)
-    return;
+  if (job->printer && job->printer->temporary)
+  {
+   /*
+    * Don't save jobs on temporary printers...
+    */
 
- /*
-  * Get the old destination...
-  */
+    job->dirty = 0;
+    return;
+  }
 
-  olddest = job->dest;
+  snprintf(filename, sizeof(filename), "%s/c%05d", RequestRoot, job->id);
 
-  if (job->printer)
-    oldp = job->printer;
-  else
-    oldp = cupsdFindDest(olddest);
+  if ((fp = cupsdCreateConfFile(filename, ConfigFilePerm & 0600)) == NULL)
+    return;
 
- /*
-  * Change the destination information...
-  */
+  fchown(cupsFileNumber(fp), RunUser, Group);
 
-  if (job->state_value > IPP_JOB_HELD)
-    cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT,
-		     "Stopping job prior to move.");
+  job->attrs->state = IPP_IDLE;
 
-  cupsdAddEvent(CUPSD_EVENT_JOB_CONFIG_CHANGED, oldp, job,
-                "Job #%d moved from %s to %s.", job->id, olddest,
-		p->name);
+  if (ippWriteIO(fp, (ipp_iocb_t)cupsFileWrite, 1, NULL,
+                 job->attrs) != IPP_DATA)
+  {
+    cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to write job control file.");
+    cupsFileClose(fp);
+    return;
+  }
 
-  cupsdSetString(&job->dest, p->name);
-  job->dtype = p->type & (CUPS_PRINTER_CLASS | CUPS_PRINTER_REMOTE);
+  if (!cupsdCloseCreatedConfFile(fp, filename))
+  {
+   /*
+    * Remove backup file and mark this job as clean...
+    */
 
-  if ((attr = ippFindAttribute(job->attrs, "job-printer-uri",
-                               IPP_TAG_URI)) != NULL)
-    ippSetString(job->attrs, &attr, 0, p->uri);
+    strlcat(filename, ".O", sizeof(filename));
+    unlink(filename);
 
-  cupsdAddEvent(CUPSD_EVENT_JOB_STOPPED, p, job,
-                "Job #%d moved from %s to %s.", job->id, olddest,
-		p->name);
+    job->dirty = 0;
 
-  job->dirty = 1;
-  cupsdMarkDirty(CUPSD_DIRTY_JOBS);
+    write_job_journal(job, job->id);
+  }
 }
 
 
 /*
- * 'cupsdReleaseJob()' - Release the specified job.
+ * 'cupsdSetJobActive()' - Add or remove a job from the active jobs.
  */
 
 void
-cupsdReleaseJob(cupsd_job_t *job)	/* I - Job */
+cupsdSetJobActive(cupsd_job_t *job,	/* I - Job */
+                  int         active)	/* I - 1 if active, 0 otherwise */
 {
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdReleaseJob(job=%p(%d))", job,
-                  job->id);
+  cupsd_jobindex_t	*index;		/* Index entry */
 
-  if (job->state_value == IPP_JOB_HELD)
-  {
-   /*
-    * Add trailing banner as needed...
-    */
 
-    if (job->pending_timeout)
-      cupsdTimeoutJob(job);
+  if (active == job->active)
+    return;
 
-    cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT,
-                     "Job released by user.");
+  if (active)
+    cupsArrayAdd(ActiveJobs, job);
+  else
+    cupsArrayRemove(ActiveJobs, job);
+
+  job->active = active;
+
+  if ((index = cupsdFindJobIndex(JobsByDest, job->dest)) != NULL)
+  {
+    if (active)
+      cupsArrayAdd(index->active, job);
+    else
+      cupsArrayRemove(index->active, job);
+  }
+
+  if ((index = cupsdFindJobIndex(JobsByUser, job->username)) != NULL)
+  {
+    if (active)
+      cupsArrayAdd(index->active, job);
+    else
+      cupsArrayRemove(index->active, job);
   }
+
+  cupsdUpdateJobTimer(job);
 }
 
 
 /*
- * 'cupsdRestartJob()' - Restart the specified job.
+ * 'cupsdSetJobDest()' - Set the destination for a job.
  */
 
 void
-cupsdRestartJob(cupsd_job_t *job)	/* I - Job */
+cupsdSetJobDest(cupsd_job_t *job,	/* I - Job */
+                const char  *dest)	/* I - Destination name */
 {
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdRestartJob(job=%p(%d))", job,
-                  job->id);
-
-  if (job->state_value == IPP_JOB_STOPPED || job->num_files)
-    cupsdSetJobState(job, IPP_JOB_PENDING, CUPSD_JOB_DEFAULT,
-                     "Job restarted by user.");
+  unindex_job(JobsByDest, job->dest, job);
+  cupsdSetString(&job->dest, dest);
+  index_job(JobsByDest, job->dest, job, job->active);
 }
 
 
 /*
- * 'cupsdSaveAllJobs()' - Save a summary of all jobs to disk.
- */
-
-void
-cupsdSaveAllJobs(void)
-{
-  int		i;			/* Looping var */
-  cups_file_t	*fp;			/* job.cache file */
-  char		filename[1024],		/* job.cache filename */
-		temp[1024];		/* Temporary string */
-  cupsd_job_t	*job;			/* Current job */
-  time_t	curtime;		/* Current time */
-  struct tm	curdate;		/* Current date */
-
-
-  snprintf(filename, sizeof(filename), "%s/job.cache", CacheDir);
-  if ((fp = cupsdCreateConfFile(filename, ConfigFilePerm)) == NULL)
-    return;
-
-  cupsdLogMessage(CUPSD_LOG_INFO, "Saving job.cache...");
-
- /*
-  * Write a small header to the file...
-  */
-
-  time(&curtime);
-  localtime_r(&curtime, &curdate);
-  strftime(temp, sizeof(temp) - 1, "%Y-%m-%d %H:%M", &curdate);
-
-  cupsFilePuts(fp, "# Job cache file for " CUPS_SVERSION "\n");
-  cupsFilePrintf(fp, "# Written by cupsd on %s\n", temp);
-  cupsFilePrintf(fp, "NextJobId %d\n", NextJobId);
-
- /*
-  * Write each job known to the system...
-  */
-
-  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(Jobs))
-  {
-    if (job->printer && job->printer->temporary)
-    {
-     /*
-      * Don't save jobs on temporary printers...
-      */
-
-      continue;
-    }
-
-    cupsFilePrintf(fp, "<Job %d>\n", job->id);
-    cupsFilePrintf(fp, "State %d\n", job->state_value);
-    cupsFilePrintf(fp, "Created %ld\n", (long)job->creation_time);
-    if (job->completed_time)
-      cupsFilePrintf(fp, "Completed %ld\n", (long)job->completed_time);
-    cupsFilePrintf(fp, "Priority %d\n", job->priority);
-    if (job->hold_until)
-      cupsFilePrintf(fp, "HoldUntil %ld\n", (long)job->hold_until);
-    cupsFilePrintf(fp, "Username %s\n", job->username);
-    if (job->name)
-      cupsFilePutConf(fp, "Name", job->name);
-    cupsFilePrintf(fp, "Destination %s\n", job->dest);
-    cupsFilePrintf(fp, "DestType %d\n", job->dtype);
-    cupsFilePrintf(fp, "KOctets %d\n", job->koctets);
-    cupsFilePrintf(fp, "NumFiles %d\n", job->num_files);
-    for (i = 0; i < job->num_files; i ++)
-      cupsFilePrintf(fp, "File %d %s/%s %d\n", i + 1, job->filetypes[i]->super,
-                     job->filetypes[i]->type, job->compressions[i]);
-    cupsFilePuts(fp, "</Job>\n");
-  }
-
-  cupsdCloseCreatedConfFile(fp, filename);
-}
-
-
-/*
- * 'cupsdSaveJob()' - Save a job to disk.
- */
-
-void
-cupsdSaveJob(cupsd_job_t *job)		/* I - Job */
-{
-  char		filename[1024];		/* Job control filename */
-  cups_file_t	*fp;			/* Job file */
-
-
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdSaveJob(job=%p(%d)): job->attrs=%p",
-                  job, job->id, job->attrs);
-
-  if (job->printer && job->printer->temporary)
-  {
-   /*
-    * Don't save jobs on temporary printers...
-    */
-
-    job->dirty = 0;
-    return;
-  }
-
-  snprintf(filename, sizeof(filename), "%s/c%05d", RequestRoot, job->id);
-
-  if ((fp = cupsdCreateConfFile(filename, ConfigFilePerm & 0600)) == NULL)
-    return;
-
-  fchown(cupsFileNumber(fp), RunUser, Group);
-
-  job->attrs->state = IPP_IDLE;
-
-  if (ippWriteIO(fp, (ipp_iocb_t)cupsFileWrite, 1, NULL,
-                 job->attrs) != IPP_DATA)
-  {
-    cupsdLogJob(job, CUPSD_LOG_ERROR, "Unable to write job control file.");
-    cupsFileClose(fp);
-    return;
-  }
-
-  if (!cupsdCloseCreatedConfFile(fp, filename))
-  {
-   /*
-    * Remove backup file and mark this job as clean...
-    */
-
-    strlcat(filename, ".O", sizeof(filename));
-    unlink(filename);
-
-    job->dirty = 0;
-  }
-}
-
-
-/*
- * 'cupsdSetJobHoldUntil()' - Set the hold time for a job.
+ * 'cupsdSetJobHoldUntil()' - Set the hold time for a job.
  */
 
 void
@@ -2478,6 +2501,8 @@ cupsdSetJobHoldUntil(cupsd_job_t *job,	/* I - Job */
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdSetJobHoldUntil: hold_until=%d",
                   (int)job->hold_until);
+
+  cupsdUpdateJobTimer(job);
 }
 
 
@@ -2502,10 +2527,17 @@ cupsdSetJobPriority(
     return;
 
  /*
-  * Set the new priority and re-add the job into the active list...
+  * Set the new priority and re-add the job into the active and state lists,
+  * which are sorted by priority...
   */
 
-  cupsArrayRemove(ActiveJobs, job);
+  cupsdSetJobActive(job, 0);
+
+  if (job->index_state)
+  {
+    cupsArrayRemove(JobsByState[job->index_state - IPP_JOB_PENDING], job);
+    job->index_state = (ipp_jstate_t)0;
+  }
 
   job->priority = priority;
 
@@ -2516,7 +2548,7 @@ cupsdSetJobPriority(
     ippAddInteger(job->attrs, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-priority",
                   priority);
 
-  cupsArrayAdd(ActiveJobs, job);
+  cupsdSetJobActive(job, 1);
 
   job->dirty = 1;
   cupsdMarkDirty(CUPSD_DIRTY_JOBS);
@@ -2658,8 +2690,7 @@ cupsdSetJobState(
         * Make sure the job is in the active list...
 	*/
 
-        if (!cupsArrayFind(ActiveJobs, job))
-	  cupsArrayAdd(ActiveJobs, job);
+        cupsdSetJobActive(job, 1);
 
        /*
 	* Save the job state to disk...
@@ -2682,7 +2713,7 @@ cupsdSetJobState(
 	  for (i = 0; job->filters[i] < 0; i++);
 
 	  if (!job->filters[i] && job->backend <= 0)
-	    cupsArrayRemove(ActiveJobs, job);
+	    cupsdSetJobActive(job, 0);
 	}
 	else
 	{
@@ -2690,7 +2721,7 @@ cupsdSetJobState(
 	  * Otherwise just remove the job from the active list immediately...
 	  */
 
-	  cupsArrayRemove(ActiveJobs, job);
+	  cupsdSetJobActive(job, 0);
 	}
 
        /*
@@ -2755,6 +2786,9 @@ cupsdSetJobState(
 	break;
   }
 
+  if (job)
+    cupsdUpdateJobTimer(job);
+
  /*
   * Finalize the job immediately if we forced things...
   */
@@ -2770,6 +2804,21 @@ cupsdSetJobState(
 }
 
 
+/*
+ * 'cupsdSetJobUsername()' - Set the username for a job.
+ */
+
+void
+cupsdSetJobUsername(
+    cupsd_job_t *job,			/* I - Job */
+    const char  *username)		/* I - Username */
+{
+  unindex_job(JobsByUser, job->username, job);
+  cupsdSetString(&job->username, username);
+  index_job(JobsByUser, job->username, job, job->active);
+}
+
+
 /*
  * 'cupsdStopAllJobs()' - Stop all print jobs.
  */
@@ -2829,6 +2878,91 @@ cupsdUnloadCompletedJobs(void)
 }
 
 
+/*
+ * 'cupsdUpdateJobCache()' - Update the job.cache file as needed.
+ *
+ * Job changes are normally appended to the job.journal file by cupsdSaveJob
+ * and cupsdDeleteJob.  The job.cache file is only rewritten when there is no
+ * journal or the journal has grown larger than the number of jobs.
+ */
+
+void
+cupsdUpdateJobCache(void)
+{
+  if (!JobJournal || JobJournalCount > (cupsArrayCount(Jobs) + JOB_JOURNAL_SLACK))
+    cupsdSaveAllJobs();
+}
+
+
+/*
+ * 'cupsdUpdateJobTimer()' - Update the deadline and pending state of a job.
+ *
+ * This must be called whenever the kill_time, cancel_time, hold_until, or
+ * state_value of a job changes so that cupsdCheckJobs and the main loop only
+ * need to look at the first entries in the JobTimers array, and so that the
+ * job is in the right JobsByState array.
+ */
+
+void
+cupsdUpdateJobTimer(cupsd_job_t *job)	/* I - Job */
+{
+  time_t	deadline = 0;		/* Next deadline for job */
+  int		is_pending;		/* Is the job pending? */
+
+
+  if (job->active)
+  {
+    if (job->kill_time)
+      deadline = job->kill_time;
+
+    if (job->cancel_time && (!deadline || job->cancel_time < deadline))
+      deadline = job->cancel_time;
+
+    if (job->state_value == IPP_JOB_HELD && job->hold_until &&
+        (!deadline || job->hold_until < deadline))
+      deadline = job->hold_until;
+  }
+
+  if (job->state_value != job->index_state)
+  {
+    if (job->index_state)
+      cupsArrayRemove(JobsByState[job->index_state - IPP_JOB_PENDING], job);
+
+    if (job->state_value >= IPP_JOB_PENDING &&
+        job->state_value <= IPP_JOB_COMPLETED)
+    {
+      job->index_state = job->state_value;
+      cupsArrayAdd(JobsByState[job->index_state - IPP_JOB_PENDING], job);
+    }
+    else
+      job->index_state = (ipp_jstate_t)0;
+  }
+
+  is_pending = job->active && job->state_value == IPP_JOB_PENDING;
+
+  if (is_pending != job->is_pending)
+  {
+    if (is_pending)
+      NumPendingJobs ++;
+    else
+      NumPendingJobs --;
+
+    job->is_pending = is_pending;
+  }
+
+  if (deadline != job->timer_time)
+  {
+    if (job->timer_time)
+      cupsArrayRemove(JobTimers, job);
+
+    job->timer_time = deadline;
+
+    if (deadline)
+      cupsArrayAdd(JobTimers, job);
+  }
+}
+
+
 /*
  * 'cupsdUpdateJobs()' - Update the history/file files for all jobs.
  */
@@ -2948,6 +3082,53 @@ compare_jobs(void *first,		/* I - First job */
 }
 
 
+/*
+ * 'compare_job_index()' - Compare the names of two job index entries.
+ */
+
+static int				/* O - Difference */
+compare_job_index(
+    cupsd_jobindex_t *first,		/* I - First index entry */
+    cupsd_jobindex_t *second)		/* I - Second index entry */
+{
+  return (_cups_strcasecmp(first->name, second->name));
+}
+
+
+/*
+ * 'compare_job_timers()' - Compare the deadlines and IDs of two jobs.
+ */
+
+static int				/* O - Difference */
+compare_job_timers(void *first,		/* I - First job */
+                   void *second,	/* I - Second job */
+		   void *data)		/* I - App data (not used) */
+{
+  time_t	diff;			/* Difference */
+
+
+  (void)data;
+
+  if ((diff = ((cupsd_job_t *)first)->timer_time -
+              ((cupsd_job_t *)second)->timer_time) != 0)
+    return (diff < 0 ? -1 : 1);
+  else
+    return (((cupsd_job_t *)first)->id - ((cupsd_job_t *)second)->id);
+}
+
+
+/*
+ * 'compare_jrecs()' - Compare the job IDs of two journal records.
+ */
+
+static int				/* O - Difference */
+compare_jrecs(cupsd_jrec_t *first,	/* I - First record */
+              cupsd_jrec_t *second)	/* I - Second record */
+{
+  return (first->id - second->id);
+}
+
+
 /*
  * 'dump_job_history()' - Dump any debug messages for a job.
  */
@@ -3096,1193 +3277,2026 @@ finalize_job(cupsd_job_t *job,		/* I - Job */
   char			buffer[1024];	/* Buffer for formatted messages */
 
 
-  cupsdLogMessage(CUPSD_LOG_DEBUG2, "finalize_job(job=%p(%d))", job, job->id);
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "finalize_job(job=%p(%d))", job, job->id);
+
+ /*
+  * Clear the "connecting-to-device" and "cups-waiting-for-job-completed"
+  * reasons, which are only valid when a printer is processing, along with any
+  * remote printing job state...
+  */
+
+  cupsdSetPrinterReasons(job->printer, "-connecting-to-device,"
+                                       "cups-waiting-for-job-completed,"
+				       "cups-remote-pending,"
+				       "cups-remote-pending-held,"
+				       "cups-remote-processing,"
+				       "cups-remote-stopped,"
+				       "cups-remote-canceled,"
+				       "cups-remote-aborted,"
+				       "cups-remote-completed");
+
+ /*
+  * Similarly, clear the "offline-report" reason for non-USB devices since we
+  * rarely have current information for network devices...
+  */
+
+  if (strncmp(job->printer->device_uri, "usb:", 4) &&
+      strncmp(job->printer->device_uri, "ippusb:", 7))
+    cupsdSetPrinterReasons(job->printer, "-offline-report");
+
+ /*
+  * Free the security profile...
+  */
+
+  cupsdDestroyProfile(job->profile);
+  job->profile = NULL;
+  cupsdDestroyProfile(job->bprofile);
+  job->bprofile = NULL;
+
+ /*
+  * Clear the unresponsive job watchdog timers...
+  */
+
+  job->cancel_time = 0;
+  job->kill_time   = 0;
+
+ /*
+  * Close pipes and status buffer...
+  */
+
+  cupsdClosePipe(job->print_pipes);
+  cupsdClosePipe(job->back_pipes);
+  cupsdClosePipe(job->side_pipes);
+
+  cupsdRemoveSelect(job->status_pipes[0]);
+  cupsdClosePipe(job->status_pipes);
+  cupsdStatBufDelete(job->status_buffer);
+  job->status_buffer = NULL;
+
+ /*
+  * Log the final impression (page) count...
+  */
+
+  snprintf(buffer, sizeof(buffer), "total %d", ippGetInteger(job->impressions, 0));
+  cupsdLogPage(job, buffer);
+
+ /*
+  * Process the exit status...
+  */
+
+  if (job->printer->state == IPP_PRINTER_PROCESSING)
+    printer_state = IPP_PRINTER_IDLE;
+  else
+    printer_state = job->printer->state;
+
+  switch (job_state = job->state_value)
+  {
+    case IPP_JOB_PENDING :
+        message = "Job paused.";
+	break;
+
+    case IPP_JOB_HELD :
+        message = "Job held.";
+	break;
+
+    default :
+    case IPP_JOB_PROCESSING :
+    case IPP_JOB_COMPLETED :
+	job_state = IPP_JOB_COMPLETED;
+	message   = "Job completed.";
+
+        if (!job->status)
+	  ippSetString(job->attrs, &job->reasons, 0,
+		       "job-completed-successfully");
+        break;
+
+    case IPP_JOB_STOPPED :
+        message = "Job stopped.";
+
+	ippSetString(job->attrs, &job->reasons, 0, "job-stopped");
+	break;
+
+    case IPP_JOB_CANCELED :
+        message = "Job canceled.";
+
+	ippSetString(job->attrs, &job->reasons, 0, "job-canceled-by-user");
+	break;
+
+    case IPP_JOB_ABORTED :
+        message = "Job aborted.";
+	break;
+  }
+
+  if (job->status < 0)
+  {
+   /*
+    * Backend had errors...
+    */
+
+    int exit_code;			/* Exit code from backend */
+
+   /*
+    * Convert the status to an exit code.  Due to the way the W* macros are
+    * implemented on macOS (bug?), we have to store the exit status in a
+    * variable first and then convert...
+    */
+
+    exit_code = -job->status;
+    if (WIFEXITED(exit_code))
+      exit_code = WEXITSTATUS(exit_code);
+    else
+    {
+      ippSetString(job->attrs, &job->reasons, 0, "cups-backend-crashed");
+      exit_code = job->status;
+    }
+
+    cupsdLogJob(job, CUPSD_LOG_INFO, "Backend returned status %d (%s)",
+		exit_code,
+		exit_code == CUPS_BACKEND_FAILED ? "failed" :
+		    exit_code == CUPS_BACKEND_AUTH_REQUIRED ?
+			"authentication required" :
+		    exit_code == CUPS_BACKEND_HOLD ? "hold job" :
+		    exit_code == CUPS_BACKEND_STOP ? "stop printer" :
+		    exit_code == CUPS_BACKEND_CANCEL ? "cancel job" :
+		    exit_code == CUPS_BACKEND_RETRY ? "retry job later" :
+		    exit_code == CUPS_BACKEND_RETRY_CURRENT ? "retry job immediately" :
+		    exit_code < 0 ? "crashed" : "unknown");
+
+   /*
+    * Do what needs to be done...
+    */
+
+    switch (exit_code)
+    {
+      default :
+      case CUPS_BACKEND_FAILED :
+         /*
+	  * Backend failure, use the error-policy to determine how to
+	  * act...
+	  */
+
+          if (job->dtype & CUPS_PRINTER_CLASS)
+	  {
+	   /*
+	    * Queued on a class - mark the job as pending and we'll retry on
+	    * another printer...
+	    */
+
+            if (job_state == IPP_JOB_COMPLETED)
+	    {
+	      job_state = IPP_JOB_PENDING;
+	      message   = "Retrying job on another printer.";
+
+	      ippSetString(job->attrs, &job->reasons, 0,
+	                   "resources-are-not-ready");
+	    }
+          }
+	  else if (!strcmp(job->printer->error_policy, "retry-current-job"))
+	  {
+	   /*
+	    * The error policy is "retry-current-job" - mark the job as pending
+	    * and we'll retry on the same printer...
+	    */
+
+            if (job_state == IPP_JOB_COMPLETED)
+	    {
+	      job_state = IPP_JOB_PENDING;
+	      message   = "Retrying job on same printer.";
+
+	      ippSetString(job->attrs, &job->reasons, 0, "none");
+	    }
+          }
+	  else if ((job->printer->type & CUPS_PRINTER_FAX) ||
+        	   !strcmp(job->printer->error_policy, "retry-job"))
+	  {
+            if (job_state == IPP_JOB_COMPLETED)
+	    {
+	     /*
+	      * The job was queued on a fax or the error policy is "retry-job" -
+	      * hold the job if the number of retries is less than the
+	      * JobRetryLimit, otherwise abort the job.
+	      */
+
+	      job->tries ++;
+
+	      if (job->tries > JobRetryLimit && JobRetryLimit > 0)
+	      {
+	       /*
+		* Too many tries...
+		*/
+
+		snprintf(buffer, sizeof(buffer),
+			 "Job aborted after %d unsuccessful attempts.",
+			 JobRetryLimit);
+		job_state = IPP_JOB_ABORTED;
+		message   = buffer;
+
+		ippSetString(job->attrs, &job->reasons, 0, "aborted-by-system");
+	      }
+	      else
+	      {
+	       /*
+		* Try again in N seconds...
+		*/
+
+		snprintf(buffer, sizeof(buffer),
+			 "Job held for %d seconds since it could not be sent.",
+			 JobRetryInterval);
+
+		job->hold_until = time(NULL) + JobRetryInterval;
+		job_state       = IPP_JOB_HELD;
+		message         = buffer;
+
+		ippSetString(job->attrs, &job->reasons, 0,
+		             "resources-are-not-ready");
+	      }
+            }
+	  }
+	  else if (!strcmp(job->printer->error_policy, "abort-job") &&
+	           job_state == IPP_JOB_COMPLETED)
+	  {
+	    job_state = IPP_JOB_ABORTED;
+
+	    if (ErrorLog)
+	    {
+	      snprintf(buffer, sizeof(buffer), "Job aborted due to backend errors; please consult the %s file for details.", ErrorLog);
+	      message = buffer;
+            }
+            else
+	      message = "Job aborted due to backend errors.";
+
+	    ippSetString(job->attrs, &job->reasons, 0, "aborted-by-system");
+	  }
+	  else if (job->state_value == IPP_JOB_PROCESSING)
+          {
+            job_state     = IPP_JOB_PENDING;
+	    printer_state = IPP_PRINTER_STOPPED;
+
+	    if (ErrorLog)
+	    {
+	      snprintf(buffer, sizeof(buffer), "Printer stopped due to backend errors; please consult the %s file for details.", ErrorLog);
+	      message = buffer;
+            }
+            else
+	      message = "Printer stopped due to backend errors.";
+
+	    ippSetString(job->attrs, &job->reasons, 0, "none");
+	  }
+          break;
+
+      case CUPS_BACKEND_CANCEL :
+         /*
+	  * Cancel the job...
+	  */
+
+	  if (job_state == IPP_JOB_COMPLETED)
+	  {
+	    job_state = IPP_JOB_CANCELED;
+	    message   = "Job canceled at printer.";
+
+	    ippSetString(job->attrs, &job->reasons, 0, "canceled-at-device");
+	  }
+          break;
+
+      case CUPS_BACKEND_HOLD :
+	  if (job_state == IPP_JOB_COMPLETED)
+	  {
+	   /*
+	    * Hold the job...
+	    */
+
+	    const char *reason = ippGetString(job->reasons, 0, NULL);
+
+	    cupsdLogJob(job, CUPSD_LOG_DEBUG, "job-state-reasons=\"%s\"",
+	                reason);
+
+	    if (!reason || strncmp(reason, "account-", 8))
+	    {
+	      cupsdSetJobHoldUntil(job, "indefinite", 1);
+
+	      ippSetString(job->attrs, &job->reasons, 0,
+			   "job-hold-until-specified");
+
+	      if (ErrorLog)
+	      {
+		snprintf(buffer, sizeof(buffer), "Job held indefinitely due to backend errors; please consult the %s file for details.", ErrorLog);
+		message = buffer;
+	      }
+	      else
+		message = "Job held indefinitely due to backend errors.";
+            }
+            else if (!strcmp(reason, "account-info-needed"))
+            {
+	      cupsdSetJobHoldUntil(job, "indefinite", 0);
+
+	      message = "Job held indefinitely - account information is required.";
+            }
+            else if (!strcmp(reason, "account-closed"))
+            {
+	      cupsdSetJobHoldUntil(job, "indefinite", 0);
+
+	      message = "Job held indefinitely - account has been closed.";
+	    }
+            else if (!strcmp(reason, "account-limit-reached"))
+            {
+	      cupsdSetJobHoldUntil(job, "indefinite", 0);
+
+	      message = "Job held indefinitely - account limit has been reached.";
+	    }
+            else
+            {
+	      cupsdSetJobHoldUntil(job, "indefinite", 0);
+
+	      message = "Job held indefinitely - account authorization failed.";
+	    }
+
+	    job_state = IPP_JOB_HELD;
+          }
+          break;
+
+      case CUPS_BACKEND_STOP :
+         /*
+	  * Stop the printer...
+	  */
+
+          if (job_state == IPP_JSTATE_CANCELED || job_state == IPP_JSTATE_ABORTED)
+          {
+            cupsdLogJob(job, CUPSD_LOG_INFO, "Ignored STOP from backend since the job is %s.", job_state == IPP_JSTATE_CANCELED ? "canceled" : "aborted");
+            break;
+	  }
+
+	  printer_state = IPP_PRINTER_STOPPED;
+
+	  if (ErrorLog)
+	  {
+	    snprintf(buffer, sizeof(buffer), "Printer stopped due to backend errors; please consult the %s file for details.", ErrorLog);
+	    message = buffer;
+	  }
+	  else
+	    message = "Printer stopped due to backend errors.";
+
+	  if (job_state == IPP_JOB_COMPLETED)
+	  {
+	    job_state = IPP_JOB_PENDING;
+
+	    ippSetString(job->attrs, &job->reasons, 0, "resources-are-not-ready");
+	  }
+          break;
+
+      case CUPS_BACKEND_AUTH_REQUIRED :
+         /*
+	  * Hold the job for authentication...
+	  */
+
+	  if (job_state == IPP_JOB_COMPLETED)
+	  {
+	    cupsdSetJobHoldUntil(job, "auth-info-required", 1);
+
+	    job_state = IPP_JOB_HELD;
+	    message   = "Job held for authentication.";
+
+            if (strncmp(job->reasons->values[0].string.text, "account-", 8))
+	      ippSetString(job->attrs, &job->reasons, 0,
+			   "cups-held-for-authentication");
+          }
+          break;
+
+      case CUPS_BACKEND_RETRY :
+	  if (job_state == IPP_JOB_COMPLETED)
+	  {
+	   /*
+	    * Hold the job if the number of retries is less than the
+	    * JobRetryLimit, otherwise abort the job.
+	    */
+
+	    job->tries ++;
+
+	    if (job->tries > JobRetryLimit && JobRetryLimit > 0)
+	    {
+	     /*
+	      * Too many tries...
+	      */
+
+	      snprintf(buffer, sizeof(buffer),
+		       "Job aborted after %d unsuccessful attempts.",
+		       JobRetryLimit);
+	      job_state = IPP_JOB_ABORTED;
+	      message   = buffer;
+
+	      ippSetString(job->attrs, &job->reasons, 0, "aborted-by-system");
+	    }
+	    else
+	    {
+	     /*
+	      * Try again in N seconds...
+	      */
+
+	      snprintf(buffer, sizeof(buffer),
+		       "Job held for %d seconds since it could not be sent.",
+		       JobRetryInterval);
+
+	      job->hold_until = time(NULL) + JobRetryInterval;
+	      job_state       = IPP_JOB_HELD;
+	      message         = buffer;
+
+	      ippSetString(job->attrs, &job->reasons, 0,
+	                   "resources-are-not-ready");
+	    }
+	  }
+          break;
+
+      case CUPS_BACKEND_RETRY_CURRENT :
+	 /*
+	  * Mark the job as pending and retry on the same printer...
+	  */
+
+	  if (job_state == IPP_JOB_COMPLETED)
+	  {
+	    job_state = IPP_JOB_PENDING;
+	    message   = "Retrying job on same printer.";
+
+	    ippSetString(job->attrs, &job->reasons, 0, "none");
+	  }
+          break;
+    }
+  }
+  else if (job->status > 0)
+  {
+   /*
+    * Filter had errors; stop job...
+    */
+
+    if (job_state == IPP_JOB_COMPLETED)
+    {
+      job_state = IPP_JOB_STOPPED;
+
+      if (ErrorLog)
+      {
+	snprintf(buffer, sizeof(buffer), "Job stopped due to filter errors; please consult the %s file for details.", ErrorLog);
+	message = buffer;
+      }
+      else
+	message = "Job stopped due to filter errors.";
+
+      if (WIFSIGNALED(job->status))
+	ippSetString(job->attrs, &job->reasons, 0, "cups-filter-crashed");
+      else
+	ippSetString(job->attrs, &job->reasons, 0, "job-completed-with-errors");
+    }
+  }
+
+ /*
+  * Update the printer and job state.
+  */
+
+  if (set_job_state && job_state != job->state_value)
+    cupsdSetJobState(job, job_state, CUPSD_JOB_DEFAULT, "%s", message);
+
+  cupsdSetPrinterState(job->printer, printer_state,
+                       printer_state == IPP_PRINTER_STOPPED);
+  update_job_attrs(job, 0);
+
+  if (job->history)
+  {
+    if (job->status &&
+        (job->state_value == IPP_JOB_ABORTED ||
+         job->state_value == IPP_JOB_STOPPED))
+      dump_job_history(job);
+    else
+      free_job_history(job);
+  }
+
+  cupsArrayRemove(PrintingJobs, job);
+
+ /*
+  * Clear informational messages...
+  */
+
+  if (job->status_level > CUPSD_LOG_ERROR)
+    job->printer->state_message[0] = '\0';
+
+ /*
+  * Apply any PPD updates...
+  */
+
+  if (job->num_keywords)
+  {
+    if (cupsdUpdatePrinterPPD(job->printer, job->num_keywords, job->keywords))
+      cupsdSetPrinterAttrs(job->printer);
+
+    cupsFreeOptions(job->num_keywords, job->keywords);
+
+    job->num_keywords = 0;
+    job->keywords     = NULL;
+  }
+
+ /*
+  * Clear the printer <-> job association...
+  */
+
+  job->printer->job = NULL;
+  job->printer      = NULL;
+
+  cupsdUpdateJobTimer(job);
+}
+
+
+/*
+ * 'free_job_index()' - Free the entries in a job index.
+ */
+
+static void
+free_job_index(cups_array_t *index,	/* I - JobsByDest or JobsByUser */
+               int          empty_only)	/* I - Only free empty entries? */
+{
+  cupsd_jobindex_t	*entry;		/* Index entry */
+
+
+  for (entry = (cupsd_jobindex_t *)cupsArrayFirst(index);
+       entry;
+       entry = (cupsd_jobindex_t *)cupsArrayNext(index))
+  {
+    if (empty_only && cupsArrayCount(entry->jobs) > 0)
+      continue;
+
+    cupsArrayRemove(index, entry);
+
+    cupsArrayDelete(entry->jobs);
+    cupsArrayDelete(entry->active);
+    cupsdClearString(&entry->name);
+    free(entry);
+  }
+}
+
+
+/*
+ * 'get_options()' - Get a string containing the job options.
+ */
+
+static char *				/* O - Options string */
+get_options(cupsd_job_t *job,		/* I - Job */
+            int         banner_page,	/* I - Printing a banner page? */
+	    char        *copies,	/* I - Copies buffer */
+	    size_t      copies_size,	/* I - Size of copies buffer */
+	    char        *title,		/* I - Title buffer */
+	    size_t      title_size)	/* I - Size of title buffer */
+{
+  int			i;		/* Looping var */
+  size_t		newlength;	/* New option buffer length */
+  char			*optptr,	/* Pointer to options */
+			*valptr;	/* Pointer in value string */
+  ipp_attribute_t	*attr;		/* Current attribute */
+  _ppd_cache_t		*pc;		/* PPD cache and mapping data */
+  int			num_pwgppds;	/* Number of PWG->PPD options */
+  cups_option_t		*pwgppds,	/* PWG->PPD options */
+			*pwgppd,	/* Current PWG->PPD option */
+			*preset;	/* Current preset option */
+  int			print_color_mode,
+					/* Output mode (if any) */
+			print_quality;	/* Print quality (if any) */
+  const char		*ppd;		/* PPD option choice */
+  int			exact;		/* Did we get an exact match? */
+  static char		*options = NULL;/* Full list of options */
+  static size_t		optlength = 0;	/* Length of option buffer */
+
+
+ /*
+  * Building the options string is harder than it needs to be, but for the
+  * moment we need to pass strings for command-line args and not IPP attribute
+  * pointers... :)
+  *
+  * First build an options array for any PWG->PPD mapped option/choice pairs.
+  */
+
+  pc          = job->printer->pc;
+  num_pwgppds = 0;
+  pwgppds     = NULL;
+
+  if (pc &&
+      !ippFindAttribute(job->attrs, "com.apple.print.DocumentTicket.PMSpoolFormat", IPP_TAG_ZERO) &&
+      !ippFindAttribute(job->attrs, "APPrinterPreset", IPP_TAG_ZERO) &&
+      (ippFindAttribute(job->attrs, "print-color-mode", IPP_TAG_ZERO) || ippFindAttribute(job->attrs, "print-quality", IPP_TAG_ZERO) || ippFindAttribute(job->attrs, "cupsPrintQuality", IPP_TAG_ZERO)))
+  {
+   /*
+    * Map print-color-mode and print-quality to a preset...
+    */
+
+    if ((attr = ippFindAttribute(job->attrs, "print-color-mode",
+				 IPP_TAG_KEYWORD)) != NULL &&
+        !strcmp(attr->values[0].string.text, "monochrome"))
+      print_color_mode = _PWG_PRINT_COLOR_MODE_MONOCHROME;
+    else
+      print_color_mode = _PWG_PRINT_COLOR_MODE_COLOR;
+
+    if ((attr = ippFindAttribute(job->attrs, "print-quality", IPP_TAG_ENUM)) != NULL)
+    {
+      ipp_quality_t pq = (ipp_quality_t)ippGetInteger(attr, 0);
+
+      if (pq >= IPP_QUALITY_DRAFT && pq <= IPP_QUALITY_HIGH)
+        print_quality = attr->values[0].integer - IPP_QUALITY_DRAFT;
+      else
+        print_quality = _PWG_PRINT_QUALITY_NORMAL;
+    }
+    else if ((attr = ippFindAttribute(job->attrs, "cupsPrintQuality", IPP_TAG_NAME)) != NULL)
+    {
+      const char *pq = ippGetString(attr, 0, NULL);
+
+      if (!_cups_strcasecmp(pq, "draft"))
+        print_quality = _PWG_PRINT_QUALITY_DRAFT;
+      else if (!_cups_strcasecmp(pq, "high"))
+        print_quality = _PWG_PRINT_QUALITY_HIGH;
+      else
+        print_quality = _PWG_PRINT_QUALITY_NORMAL;
+
+      if (!ippFindAttribute(job->attrs, "print-quality", IPP_TAG_ENUM))
+      {
+        cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Mapping cupsPrintQuality=%s to print-quality=%d", pq, print_quality + IPP_QUALITY_DRAFT);
+        num_pwgppds = cupsAddIntegerOption("print-quality", print_quality + IPP_QUALITY_DRAFT, num_pwgppds, &pwgppds);
+      }
+    }
+    else
+    {
+      print_quality = _PWG_PRINT_QUALITY_NORMAL;
+    }
+
+    if (pc->num_presets[print_color_mode][print_quality] == 0)
+    {
+     /*
+      * Try to find a preset that works so that we maximize the chances of us
+      * getting a good print using IPP attributes.
+      */
+
+      if (pc->num_presets[print_color_mode][_PWG_PRINT_QUALITY_NORMAL] > 0)
+        print_quality = _PWG_PRINT_QUALITY_NORMAL;
+      else if (pc->num_presets[_PWG_PRINT_COLOR_MODE_COLOR][print_quality] > 0)
+        print_color_mode = _PWG_PRINT_COLOR_MODE_COLOR;
+      else
+      {
+        print_quality    = _PWG_PRINT_QUALITY_NORMAL;
+        print_color_mode = _PWG_PRINT_COLOR_MODE_COLOR;
+      }
+    }
+
+    if (pc->num_presets[print_color_mode][print_quality] > 0)
+    {
+     /*
+      * Copy the preset options as long as the corresponding names are not
+      * already defined in the IPP request...
+      */
+
+      for (i = pc->num_presets[print_color_mode][print_quality],
+	       preset = pc->presets[print_color_mode][print_quality];
+	   i > 0;
+	   i --, preset ++)
+      {
+        if (!ippFindAttribute(job->attrs, preset->name, IPP_TAG_ZERO))
+        {
+          cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Adding preset option %s=%s", preset->name, preset->value);
+
+	  num_pwgppds = cupsAddOption(preset->name, preset->value, num_pwgppds, &pwgppds);
+        }
+      }
+    }
+  }
+
+  if (pc)
+  {
+    if ((attr = ippFindAttribute(job->attrs, "print-quality", IPP_TAG_ENUM)) != NULL)
+    {
+      int pq = ippGetInteger(attr, 0);
+      static const char * const pqs[] = { "Draft", "Normal", "High" };
+
+      if (pq >= IPP_QUALITY_DRAFT && pq <= IPP_QUALITY_HIGH)
+      {
+        cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Mapping print-quality=%d to cupsPrintQuality=%s", pq, pqs[pq - IPP_QUALITY_DRAFT]);
+
+        num_pwgppds = cupsAddOption("cupsPrintQuality", pqs[pq - IPP_QUALITY_DRAFT], num_pwgppds, &pwgppds);
+      }
+    }
+
+    if (!ippFindAttribute(job->attrs, "InputSlot", IPP_TAG_ZERO) &&
+	!ippFindAttribute(job->attrs, "HPPaperSource", IPP_TAG_ZERO))
+    {
+      if ((ppd = _ppdCacheGetInputSlot(pc, job->attrs, NULL)) != NULL)
+	num_pwgppds = cupsAddOption(pc->source_option, ppd, num_pwgppds,
+				    &pwgppds);
+    }
+    if (!ippFindAttribute(job->attrs, "MediaType", IPP_TAG_ZERO) &&
+	(ppd = _ppdCacheGetMediaType(pc, job->attrs, NULL)) != NULL)
+    {
+      cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Mapping media to MediaType=%s", ppd);
+
+      num_pwgppds = cupsAddOption("MediaType", ppd, num_pwgppds, &pwgppds);
+    }
+
+    if (!ippFindAttribute(job->attrs, "PageRegion", IPP_TAG_ZERO) &&
+	!ippFindAttribute(job->attrs, "PageSize", IPP_TAG_ZERO) &&
+	(ppd = _ppdCacheGetPageSize(pc, job->attrs, NULL, &exact)) != NULL)
+    {
+      cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Mapping media to Pagesize=%s", ppd);
+
+      num_pwgppds = cupsAddOption("PageSize", ppd, num_pwgppds, &pwgppds);
+
+      if (!ippFindAttribute(job->attrs, "media", IPP_TAG_ZERO))
+      {
+        cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Adding media=%s", ppd);
+
+        num_pwgppds = cupsAddOption("media", ppd, num_pwgppds, &pwgppds);
+      }
+    }
+
+    if (!ippFindAttribute(job->attrs, "OutputBin", IPP_TAG_ZERO) &&
+	(attr = ippFindAttribute(job->attrs, "output-bin",
+				 IPP_TAG_ZERO)) != NULL &&
+	(attr->value_tag == IPP_TAG_KEYWORD ||
+	 attr->value_tag == IPP_TAG_NAME) &&
+	(ppd = _ppdCacheGetOutputBin(pc, attr->values[0].string.text)) != NULL)
+    {
+     /*
+      * Map output-bin to OutputBin option...
+      */
+
+      cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Mapping output-bin to OutputBin=%s", ppd);
+
+      num_pwgppds = cupsAddOption("OutputBin", ppd, num_pwgppds, &pwgppds);
+    }
+
+    if (pc->sides_option &&
+        !ippFindAttribute(job->attrs, pc->sides_option, IPP_TAG_ZERO) &&
+	(attr = ippFindAttribute(job->attrs, "sides", IPP_TAG_KEYWORD)) != NULL)
+    {
+     /*
+      * Map sides to duplex option...
+      */
+
+      if (!strcmp(attr->values[0].string.text, "one-sided"))
+      {
+        cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Mapping sizes to Duplex=%s", pc->sides_1sided);
+
+        num_pwgppds = cupsAddOption(pc->sides_option, pc->sides_1sided, num_pwgppds, &pwgppds);
+      }
+      else if (!strcmp(attr->values[0].string.text, "two-sided-long-edge"))
+      {
+        cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Mapping sizes to Duplex=%s", pc->sides_2sided_long);
+
+        num_pwgppds = cupsAddOption(pc->sides_option, pc->sides_2sided_long, num_pwgppds, &pwgppds);
+      }
+      else if (!strcmp(attr->values[0].string.text, "two-sided-short-edge"))
+      {
+        cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Mapping sizes to Duplex=%s", pc->sides_2sided_short);
+
+        num_pwgppds = cupsAddOption(pc->sides_option, pc->sides_2sided_short, num_pwgppds, &pwgppds);
+      }
+    }
+
+   /*
+    * Map finishings values...
+    */
+
+    num_pwgppds = _ppdCacheGetFinishingOptions(pc, job->attrs, IPP_FINISHINGS_NONE, num_pwgppds, &pwgppds);
+
+    for (i = num_pwgppds, pwgppd = pwgppds; i > 0; i --, pwgppd ++)
+      cupsdLogJob(job, CUPSD_LOG_DEBUG2, "After mapping finishings %s=%s", pwgppd->name, pwgppd->value);
+  }
+
+ /*
+  * Map page-delivery values...
+  */
+
+  if ((attr = ippFindAttribute(job->attrs, "page-delivery", IPP_TAG_KEYWORD)) != NULL && !ippFindAttribute(job->attrs, "outputorder", IPP_TAG_ZERO))
+  {
+    const char *page_delivery = ippGetString(attr, 0, NULL);
+
+    if (!strncmp(page_delivery, "same-order", 10))
+      num_pwgppds = cupsAddOption("OutputOrder", "Normal", num_pwgppds, &pwgppds);
+    else if (!strncmp(page_delivery, "reverse-order", 13))
+      num_pwgppds = cupsAddOption("OutputOrder", "Reverse", num_pwgppds, &pwgppds);
+  }
+
+ /*
+  * Figure out how much room we need...
+  */
+
+  newlength = ipp_length(job->attrs);
+
+  for (i = num_pwgppds, pwgppd = pwgppds; i > 0; i --, pwgppd ++)
+    newlength += 1 + strlen(pwgppd->name) + 1 + strlen(pwgppd->value);
+
+ /*
+  * Then allocate/reallocate the option buffer as needed...
+  */
+
+  if (newlength == 0)			/* This can never happen, but Clang */
+    newlength = 1;			/* thinks it can... */
+
+  if (newlength > optlength || !options)
+  {
+    if (!options)
+      optptr = malloc(newlength);
+    else
+      optptr = realloc(options, newlength);
+
+    if (!optptr)
+    {
+      cupsdLogJob(job, CUPSD_LOG_CRIT,
+		  "Unable to allocate " CUPS_LLFMT " bytes for option buffer.",
+		  CUPS_LLCAST newlength);
+      return (NULL);
+    }
+
+    options   = optptr;
+    optlength = newlength;
+  }
+
+ /*
+  * Now loop through the attributes and convert them to the textual
+  * representation used by the filters...
+  */
+
+  optptr  = options;
+  *optptr = '\0';
+
+  snprintf(title, title_size, "%s-%d", job->printer->name, job->id);
+  strlcpy(copies, "1", copies_size);
+
+  for (attr = job->attrs->attrs; attr != NULL; attr = attr->next)
+  {
+    if (!strcmp(attr->name, "copies") &&
+	attr->value_tag == IPP_TAG_INTEGER)
+    {
+     /*
+      * Don't use the # copies attribute if we are printing the job sheets...
+      */
+
+      if (!banner_page)
+        snprintf(copies, copies_size, "%d", attr->values[0].integer);
+    }
+    else if (!strcmp(attr->name, "job-name") &&
+	     (attr->value_tag == IPP_TAG_NAME ||
+	      attr->value_tag == IPP_TAG_NAMELANG))
+      strlcpy(title, attr->values[0].string.text, title_size);
+    else if (attr->group_tag == IPP_TAG_JOB)
+    {
+     /*
+      * Filter out other unwanted attributes...
+      */
+
+      if (attr->value_tag == IPP_TAG_NOVALUE ||
+          attr->value_tag == IPP_TAG_MIMETYPE ||
+	  attr->value_tag == IPP_TAG_NAMELANG ||
+	  attr->value_tag == IPP_TAG_TEXTLANG ||
+	  (attr->value_tag == IPP_TAG_URI && strcmp(attr->name, "job-uuid") &&
+	   strcmp(attr->name, "job-authorization-uri")) ||
+	  attr->value_tag == IPP_TAG_URISCHEME ||
+	  attr->value_tag == IPP_TAG_BEGIN_COLLECTION) /* Not yet supported */
+	continue;
+
+      if (!strcmp(attr->name, "job-hold-until") ||
+          !strcmp(attr->name, "job-id") ||
+          !strcmp(attr->name, "job-k-octets") ||
+          !strcmp(attr->name, "job-media-sheets") ||
+          !strcmp(attr->name, "job-media-sheets-completed") ||
+          !strcmp(attr->name, "job-state") ||
+          !strcmp(attr->name, "job-state-reasons"))
+	continue;
+
+      if (!strncmp(attr->name, "job-", 4) &&
+          strcmp(attr->name, "job-account-id") &&
+          strcmp(attr->name, "job-accounting-user-id") &&
+          strcmp(attr->name, "job-authorization-uri") &&
+          strcmp(attr->name, "job-billing") &&
+          strcmp(attr->name, "job-impressions") &&
+          strcmp(attr->name, "job-originating-host-name") &&
+          strcmp(attr->name, "job-password") &&
+          strcmp(attr->name, "job-password-encryption") &&
+          strcmp(attr->name, "job-uuid") &&
+          !(job->printer->type & CUPS_PRINTER_REMOTE))
+	continue;
+
+      if ((!strcmp(attr->name, "job-impressions") ||
+           !strcmp(attr->name, "page-label") ||
+           !strcmp(attr->name, "page-border") ||
+           !strncmp(attr->name, "number-up", 9) ||
+	   !strcmp(attr->name, "page-ranges") ||
+	   !strcmp(attr->name, "page-set") ||
+	   !_cups_strcasecmp(attr->name, "AP_FIRSTPAGE_InputSlot") ||
+	   !_cups_strcasecmp(attr->name, "AP_FIRSTPAGE_ManualFeed") ||
+	   !_cups_strcasecmp(attr->name, "com.apple.print.PrintSettings."
+	                           "PMTotalSidesImaged..n.") ||
+	   !_cups_strcasecmp(attr->name, "com.apple.print.PrintSettings."
+	                           "PMTotalBeginPages..n.")) &&
+	  banner_page)
+        continue;
+
+     /*
+      * Otherwise add them to the list...
+      */
+
+      if (optptr > options)
+	strlcat(optptr, " ", optlength - (size_t)(optptr - options));
+
+      if (attr->value_tag != IPP_TAG_BOOLEAN)
+      {
+	strlcat(optptr, attr->name, optlength - (size_t)(optptr - options));
+	strlcat(optptr, "=", optlength - (size_t)(optptr - options));
+      }
+
+      for (i = 0; i < attr->num_values; i ++)
+      {
+	if (i)
+	  strlcat(optptr, ",", optlength - (size_t)(optptr - options));
+
+	optptr += strlen(optptr);
+
+	switch (attr->value_tag)
+	{
+	  case IPP_TAG_INTEGER :
+	  case IPP_TAG_ENUM :
+	      snprintf(optptr, optlength - (size_t)(optptr - options),
+	               "%d", attr->values[i].integer);
+	      break;
+
+	  case IPP_TAG_BOOLEAN :
+	      if (!attr->values[i].boolean)
+		strlcat(optptr, "no", optlength - (size_t)(optptr - options));
+
+	      strlcat(optptr, attr->name, optlength - (size_t)(optptr - options));
+	      break;
+
+	  case IPP_TAG_RANGE :
+	      if (attr->values[i].range.lower == attr->values[i].range.upper)
+		snprintf(optptr, optlength - (size_t)(optptr - options) - 1,
+	        	 "%d", attr->values[i].range.lower);
+              else
+		snprintf(optptr, optlength - (size_t)(optptr - options) - 1,
+	        	 "%d-%d", attr->values[i].range.lower,
+			 attr->values[i].range.upper);
+	      break;
+
+	  case IPP_TAG_RESOLUTION :
+	      snprintf(optptr, optlength - (size_t)(optptr - options) - 1,
+	               "%dx%d%s", attr->values[i].resolution.xres,
+		       attr->values[i].resolution.yres,
+		       attr->values[i].resolution.units == IPP_RES_PER_INCH ?
+			   "dpi" : "dpcm");
+	      break;
+
+          case IPP_TAG_STRING :
+              {
+                int length = attr->values[i].unknown.length;
+
+		for (valptr = attr->values[i].unknown.data; length > 0; length --)
+		{
+		  if ((*valptr & 255) < 0x20 || *valptr == 0x7f)
+		    break;
+		}
+
+		if (length > 0)
+		{
+		 /*
+		  * Encode this string as hex characters...
+		  */
+
+                  *optptr++ = '<';
+
+		  for (valptr = attr->values[i].unknown.data, length = attr->values[i].unknown.length; length > 0; length --)
+		  {
+		    snprintf(optptr, optlength - (size_t)(optptr - options) - 1, "%02X", *valptr & 255);
+		    optptr += 2;
+		  }
+
+                  *optptr++ = '>';
+		}
+		else
+		{
+		  for (valptr = attr->values[i].unknown.data, length = attr->values[i].unknown.length; length > 0; length --)
+		  {
+		    if (strchr(" \t\n\\\'\"", *valptr))
+		      *optptr++ = '\\';
+		    *optptr++ = *valptr++;
+		  }
+		}
+	      }
+
+	      *optptr = '\0';
+	      break;
+
+	  case IPP_TAG_TEXT :
+	  case IPP_TAG_NAME :
+	  case IPP_TAG_KEYWORD :
+	  case IPP_TAG_CHARSET :
+	  case IPP_TAG_LANGUAGE :
+	  case IPP_TAG_URI :
+	      for (valptr = attr->values[i].string.text; *valptr;)
+	      {
+	        if (strchr(" \t\n\\\'\"", *valptr))
+		  *optptr++ = '\\';
+		*optptr++ = *valptr++;
+	      }
+
+	      *optptr = '\0';
+	      break;
+
+          default :
+	      break; /* anti-compiler-warning-code */
+	}
+      }
+
+      optptr += strlen(optptr);
+    }
+  }
 
  /*
-  * Clear the "connecting-to-device" and "cups-waiting-for-job-completed"
-  * reasons, which are only valid when a printer is processing, along with any
-  * remote printing job state...
+  * Finally loop through the PWG->PPD mapped options and add them...
   */
 
-  cupsdSetPrinterReasons(job->printer, "-connecting-to-device,"
-                                       "cups-waiting-for-job-completed,"
-				       "cups-remote-pending,"
-				       "cups-remote-pending-held,"
-				       "cups-remote-processing,"
-				       "cups-remote-stopped,"
-				       "cups-remote-canceled,"
-				       "cups-remote-aborted,"
-				       "cups-remote-completed");
-
- /*
-  * Similarly, clear the "offline-report" reason for non-USB devices since we
-  * rarely have current information for network devices...
-  */
+  for (i = num_pwgppds, pwgppd = pwgppds; i > 0; i --, pwgppd ++)
+  {
+    *optptr++ = ' ';
+    strlcpy(optptr, pwgppd->name, optlength - (size_t)(optptr - options));
+    optptr += strlen(optptr);
+    *optptr++ = '=';
+    strlcpy(optptr, pwgppd->value, optlength - (size_t)(optptr - options));
+    optptr += strlen(optptr);
+  }
 
-  if (strncmp(job->printer->device_uri, "usb:", 4) &&
-      strncmp(job->printer->device_uri, "ippusb:", 7))
-    cupsdSetPrinterReasons(job->printer, "-offline-report");
+  cupsFreeOptions(num_pwgppds, pwgppds);
 
  /*
-  * Free the security profile...
+  * Return the options string...
   */
 
-  cupsdDestroyProfile(job->profile);
-  job->profile = NULL;
-  cupsdDestroyProfile(job->bprofile);
-  job->bprofile = NULL;
+  return (options);
+}
 
- /*
-  * Clear the unresponsive job watchdog timers...
-  */
 
-  job->cancel_time = 0;
-  job->kill_time   = 0;
+/*
+ * 'index_job()' - Add a job to a job index.
+ */
 
- /*
-  * Close pipes and status buffer...
-  */
+static void
+index_job(cups_array_t *index,		/* I - JobsByDest or JobsByUser */
+          const char   *name,		/* I - Destination or username */
+          cupsd_job_t  *job,		/* I - Job */
+	  int          active)		/* I - Is the job active? */
+{
+  cupsd_jobindex_t	*entry;		/* Index entry */
 
-  cupsdClosePipe(job->print_pipes);
-  cupsdClosePipe(job->back_pipes);
-  cupsdClosePipe(job->side_pipes);
 
-  cupsdRemoveSelect(job->status_pipes[0]);
-  cupsdClosePipe(job->status_pipes);
-  cupsdStatBufDelete(job->status_buffer);
-  job->status_buffer = NULL;
+  if (!index || !name)
+    return;
 
- /*
-  * Log the final impression (page) count...
-  */
+  if ((entry = cupsdFindJobIndex(index, name)) == NULL)
+  {
+    if ((entry = calloc(1, sizeof(cupsd_jobindex_t))) == NULL)
+    {
+      cupsdLogJob(job, CUPSD_LOG_EMERG, "Unable to allocate memory for job index.");
+      return;
+    }
 
-  snprintf(buffer, sizeof(buffer), "total %d", ippGetInteger(job->impressions, 0));
-  cupsdLogPage(job, buffer);
+    cupsdSetString(&entry->name, name);
+    entry->jobs   = cupsArrayNew(compare_jobs, NULL);
+    entry->active = cupsArrayNew(compare_active_jobs, NULL);
 
- /*
-  * Process the exit status...
-  */
+    cupsArrayAdd(index, entry);
+  }
 
-  if (job->printer->state == IPP_PRINTER_PROCESSING)
-    printer_state = IPP_PRINTER_IDLE;
-  else
-    printer_state = job->printer->state;
+  cupsArrayAdd(entry->jobs, job);
 
-  switch (job_state = job->state_value)
-  {
-    case IPP_JOB_PENDING :
-        message = "Job paused.";
-	break;
+  if (active)
+    cupsArrayAdd(entry->active, job);
+}
 
-    case IPP_JOB_HELD :
-        message = "Job held.";
-	break;
 
-    default :
-    case IPP_JOB_PROCESSING :
-    case IPP_JOB_COMPLETED :
-	job_state = IPP_JOB_COMPLETED;
-	message   = "Job completed.";
+/*
+ * 'ipp_length()' - Compute the size of the buffer needed to hold
+ *		    the textual IPP attributes.
+ */
 
-        if (!job->status)
-	  ippSetString(job->attrs, &job->reasons, 0,
-		       "job-completed-successfully");
-        break;
+static size_t				/* O - Size of attribute buffer */
+ipp_length(ipp_t *ipp)			/* I - IPP request */
+{
+  size_t		bytes; 		/* Number of bytes */
+  int			i;		/* Looping var */
+  ipp_attribute_t	*attr;		/* Current attribute */
 
-    case IPP_JOB_STOPPED :
-        message = "Job stopped.";
 
-	ippSetString(job->attrs, &job->reasons, 0, "job-stopped");
-	break;
+ /*
+  * Loop through all attributes...
+  */
 
-    case IPP_JOB_CANCELED :
-        message = "Job canceled.";
+  bytes = 0;
 
-	ippSetString(job->attrs, &job->reasons, 0, "job-canceled-by-user");
-	break;
+  for (attr = ipp->attrs; attr != NULL; attr = attr->next)
+  {
+   /*
+    * Skip attributes that won't be sent to filters...
+    */
 
-    case IPP_JOB_ABORTED :
-        message = "Job aborted.";
-	break;
-  }
+    if (attr->value_tag == IPP_TAG_NOVALUE ||
+	attr->value_tag == IPP_TAG_MIMETYPE ||
+	attr->value_tag == IPP_TAG_NAMELANG ||
+	attr->value_tag == IPP_TAG_TEXTLANG ||
+	attr->value_tag == IPP_TAG_URI ||
+	attr->value_tag == IPP_TAG_URISCHEME)
+      continue;
 
-  if (job->status < 0)
-  {
    /*
-    * Backend had errors...
+    * Add space for a leading space and commas between each value.
+    * For the first attribute, the leading space isn't used, so the
+    * extra byte can be used as the nul terminator...
     */
 
-    int exit_code;			/* Exit code from backend */
+    bytes ++;				/* " " separator */
+    bytes += (size_t)attr->num_values;	/* "," separators */
 
    /*
-    * Convert the status to an exit code.  Due to the way the W* macros are
-    * implemented on macOS (bug?), we have to store the exit status in a
-    * variable first and then convert...
+    * Boolean attributes appear as "foo,nofoo,foo,nofoo", while
+    * other attributes appear as "foo=value1,value2,...,valueN".
     */
 
-    exit_code = -job->status;
-    if (WIFEXITED(exit_code))
-      exit_code = WEXITSTATUS(exit_code);
+    if (attr->value_tag != IPP_TAG_BOOLEAN)
+      bytes += strlen(attr->name);
     else
-    {
-      ippSetString(job->attrs, &job->reasons, 0, "cups-backend-crashed");
-      exit_code = job->status;
-    }
-
-    cupsdLogJob(job, CUPSD_LOG_INFO, "Backend returned status %d (%s)",
-		exit_code,
-		exit_code == CUPS_BACKEND_FAILED ? "failed" :
-		    exit_code == CUPS_BACKEND_AUTH_REQUIRED ?
-			"authentication required" :
-		    exit_code == CUPS_BACKEND_HOLD ? "hold job" :
-		    exit_code == CUPS_BACKEND_STOP ? "stop printer" :
-		    exit_code == CUPS_BACKEND_CANCEL ? "cancel job" :
-		    exit_code == CUPS_BACKEND_RETRY ? "retry job later" :
-		    exit_code == CUPS_BACKEND_RETRY_CURRENT ? "retry job immediately" :
-		    exit_code < 0 ? "crashed" : "unknown");
+      bytes += (size_t)attr->num_values * strlen(attr->name);
 
    /*
-    * Do what needs to be done...
+    * Now add the size required for each value in the attribute...
     */
 
-    switch (exit_code)
+    switch (attr->value_tag)
     {
-      default :
-      case CUPS_BACKEND_FAILED :
+      case IPP_TAG_INTEGER :
+      case IPP_TAG_ENUM :
          /*
-	  * Backend failure, use the error-policy to determine how to
-	  * act...
+	  * Minimum value of a signed integer is -2147483647, or 11 digits.
 	  */
 
-          if (job->dtype & CUPS_PRINTER_CLASS)
-	  {
-	   /*
-	    * Queued on a class - mark the job as pending and we'll retry on
-	    * another printer...
-	    */
-
-            if (job_state == IPP_JOB_COMPLETED)
-	    {
-	      job_state = IPP_JOB_PENDING;
-	      message   = "Retrying job on another printer.";
-
-	      ippSetString(job->attrs, &job->reasons, 0,
-	                   "resources-are-not-ready");
-	    }
-          }
-	  else if (!strcmp(job->printer->error_policy, "retry-current-job"))
-	  {
-	   /*
-	    * The error policy is "retry-current-job" - mark the job as pending
-	    * and we'll retry on the same printer...
-	    */
-
-            if (job_state == IPP_JOB_COMPLETED)
-	    {
-	      job_state = IPP_JOB_PENDING;
-	      message   = "Retrying job on same printer.";
-
-	      ippSetString(job->attrs, &job->reasons, 0, "none");
-	    }
-          }
-	  else if ((job->printer->type & CUPS_PRINTER_FAX) ||
-        	   !strcmp(job->printer->error_policy, "retry-job"))
-	  {
-            if (job_state == IPP_JOB_COMPLETED)
-	    {
-	     /*
-	      * The job was queued on a fax or the error policy is "retry-job" -
-	      * hold the job if the number of retries is less than the
-	      * JobRetryLimit, otherwise abort the job.
-	      */
-
-	      job->tries ++;
-
-	      if (job->tries > JobRetryLimit && JobRetryLimit > 0)
-	      {
-	       /*
-		* Too many tries...
-		*/
-
-		snprintf(buffer, sizeof(buffer),
-			 "Job aborted after %d unsuccessful attempts.",
-			 JobRetryLimit);
-		job_state = IPP_JOB_ABORTED;
-		message   = buffer;
-
-		ippSetString(job->attrs, &job->reasons, 0, "aborted-by-system");
-	      }
-	      else
-	      {
-	       /*
-		* Try again in N seconds...
-		*/
-
-		snprintf(buffer, sizeof(buffer),
-			 "Job held for %d seconds since it could not be sent.",
-			 JobRetryInterval);
+	  bytes += (size_t)attr->num_values * 11;
+	  break;
 
-		job->hold_until = time(NULL) + JobRetryInterval;
-		job_state       = IPP_JOB_HELD;
-		message         = buffer;
+      case IPP_TAG_BOOLEAN :
+         /*
+	  * Add two bytes for each false ("no") value...
+	  */
 
-		ippSetString(job->attrs, &job->reasons, 0,
-		             "resources-are-not-ready");
-	      }
-            }
-	  }
-	  else if (!strcmp(job->printer->error_policy, "abort-job") &&
-	           job_state == IPP_JOB_COMPLETED)
-	  {
-	    job_state = IPP_JOB_ABORTED;
+          for (i = 0; i < attr->num_values; i ++)
+	    if (!attr->values[i].boolean)
+	      bytes += 2;
+	  break;
 
-	    if (ErrorLog)
-	    {
-	      snprintf(buffer, sizeof(buffer), "Job aborted due to backend errors; please consult the %s file for details.", ErrorLog);
-	      message = buffer;
-            }
-            else
-	      message = "Job aborted due to backend errors.";
+      case IPP_TAG_RANGE :
+         /*
+	  * A range is two signed integers separated by a hyphen, or
+	  * 23 characters max.
+	  */
 
-	    ippSetString(job->attrs, &job->reasons, 0, "aborted-by-system");
-	  }
-	  else if (job->state_value == IPP_JOB_PROCESSING)
-          {
-            job_state     = IPP_JOB_PENDING;
-	    printer_state = IPP_PRINTER_STOPPED;
+	  bytes += (size_t)attr->num_values * 23;
+	  break;
 
-	    if (ErrorLog)
-	    {
-	      snprintf(buffer, sizeof(buffer), "Printer stopped due to backend errors; please consult the %s file for details.", ErrorLog);
-	      message = buffer;
-            }
-            else
-	      message = "Printer stopped due to backend errors.";
+      case IPP_TAG_RESOLUTION :
+         /*
+	  * A resolution is two signed integers separated by an "x" and
+	  * suffixed by the units, or 26 characters max.
+	  */
 
-	    ippSetString(job->attrs, &job->reasons, 0, "none");
-	  }
-          break;
+	  bytes += (size_t)attr->num_values * 26;
+	  break;
 
-      case CUPS_BACKEND_CANCEL :
+      case IPP_TAG_STRING :
          /*
-	  * Cancel the job...
+	  * Octet strings can contain characters that need quoting.  We need
+	  * at least 2 * len + 2 characters to cover the quotes and any
+	  * backslashes in the string.
 	  */
 
-	  if (job_state == IPP_JOB_COMPLETED)
-	  {
-	    job_state = IPP_JOB_CANCELED;
-	    message   = "Job canceled at printer.";
+          for (i = 0; i < attr->num_values; i ++)
+	    bytes += 2 * (size_t)attr->values[i].unknown.length + 2;
+	  break;
 
-	    ippSetString(job->attrs, &job->reasons, 0, "canceled-at-device");
-	  }
-          break;
+      case IPP_TAG_TEXT :
+      case IPP_TAG_NAME :
+      case IPP_TAG_KEYWORD :
+      case IPP_TAG_CHARSET :
+      case IPP_TAG_LANGUAGE :
+      case IPP_TAG_URI :
+         /*
+	  * Strings can contain characters that need quoting.  We need
+	  * at least 2 * len + 2 characters to cover the quotes and
+	  * any backslashes in the string.
+	  */
 
-      case CUPS_BACKEND_HOLD :
-	  if (job_state == IPP_JOB_COMPLETED)
-	  {
-	   /*
-	    * Hold the job...
-	    */
+          for (i = 0; i < attr->num_values; i ++)
+	    bytes += 2 * strlen(attr->values[i].string.text) + 2;
+	  break;
 
-	    const char *reason = ippGetString(job->reasons, 0, NULL);
+       default :
+	  break; /* anti-compiler-warning-code */
+    }
+  }
 
-	    cupsdLogJob(job, CUPSD_LOG_DEBUG, "job-state-reasons=\"%s\"",
-	                reason);
+  return (bytes);
+}
 
-	    if (!reason || strncmp(reason, "account-", 8))
-	    {
-	      cupsdSetJobHoldUntil(job, "indefinite", 1);
 
-	      ippSetString(job->attrs, &job->reasons, 0,
-			   "job-hold-until-specified");
+/*
+ * 'load_job()' - Load a single job using the (optional) pre-read attributes.
+ */
 
-	      if (ErrorLog)
-	      {
-		snprintf(buffer, sizeof(buffer), "Job held indefinitely due to backend errors; please consult the %s file for details.", ErrorLog);
-		message = buffer;
-	      }
-	      else
-		message = "Job held indefinitely due to backend errors.";
-            }
-            else if (!strcmp(reason, "account-info-needed"))
-            {
-	      cupsdSetJobHoldUntil(job, "indefinite", 0);
+static int				/* O - 1 on success, 0 on failure */
+load_job(cupsd_job_t *job,		/* I - Job */
+         ipp_t       *attrs)		/* I - Pre-read attributes or NULL */
+{
+  int			i;		/* Looping var */
+  char			jobfile[1024];	/* Job filename */
+  cups_file_t		*fp;		/* Job file */
+  int			fileid;		/* Current file ID */
+  ipp_attribute_t	*attr;		/* Job attribute */
+  const char		*dest;		/* Destination name */
+  cupsd_printer_t	*destptr;	/* Pointer to destination */
+  mime_type_t		**filetypes;	/* New filetypes array */
+  int			*compressions;	/* New compressions array */
 
-	      message = "Job held indefinitely - account information is required.";
-            }
-            else if (!strcmp(reason, "account-closed"))
-            {
-	      cupsdSetJobHoldUntil(job, "indefinite", 0);
 
-	      message = "Job held indefinitely - account has been closed.";
-	    }
-            else if (!strcmp(reason, "account-limit-reached"))
-            {
-	      cupsdSetJobHoldUntil(job, "indefinite", 0);
+  if (job->attrs)
+  {
+    if (job->state_value > IPP_JOB_STOPPED)
+      job->access_time = time(NULL);
 
-	      message = "Job held indefinitely - account limit has been reached.";
-	    }
-            else
-            {
-	      cupsdSetJobHoldUntil(job, "indefinite", 0);
+    ippDelete(attrs);
 
-	      message = "Job held indefinitely - account authorization failed.";
-	    }
+    return (1);
+  }
 
-	    job_state = IPP_JOB_HELD;
-          }
-          break;
+  if (attrs)
+  {
+   /*
+    * Use the attributes that were read by cupsdLoadJobs...
+    */
 
-      case CUPS_BACKEND_STOP :
-         /*
-	  * Stop the printer...
-	  */
+    cupsdLogJob(job, CUPSD_LOG_DEBUG, "Loading pre-read attributes...");
 
-          if (job_state == IPP_JSTATE_CANCELED || job_state == IPP_JSTATE_ABORTED)
-          {
-            cupsdLogJob(job, CUPSD_LOG_INFO, "Ignored STOP from backend since the job is %s.", job_state == IPP_JSTATE_CANCELED ? "canceled" : "aborted");
-            break;
-	  }
+    job->attrs = attrs;
+  }
+  else
+  {
+    if ((job->attrs = ippNew()) == NULL)
+    {
+      cupsdLogJob(job, CUPSD_LOG_ERROR, "Ran out of memory for job attributes.");
+      return (0);
+    }
 
-	  printer_state = IPP_PRINTER_STOPPED;
+   /*
+    * Load job attributes...
+    */
 
-	  if (ErrorLog)
-	  {
-	    snprintf(buffer, sizeof(buffer), "Printer stopped due to backend errors; please consult the %s file for details.", ErrorLog);
-	    message = buffer;
-	  }
-	  else
-	    message = "Printer stopped due to backend errors.";
+    cupsdLogJob(job, CUPSD_LOG_DEBUG, "Loading attributes...");
 
-	  if (job_state == IPP_JOB_COMPLETED)
-	  {
-	    job_state = IPP_JOB_PENDING;
+    snprintf(jobfile, sizeof(jobfile), "%s/c%05d", RequestRoot, job->id);
+    if ((fp = cupsdOpenConfFile(jobfile)) == NULL)
+      goto error;
 
-	    ippSetString(job->attrs, &job->reasons, 0, "resources-are-not-ready");
-	  }
-          break;
+    if (ippReadIO(fp, (ipp_iocb_t)cupsFileRead, 1, NULL, job->attrs) != IPP_DATA)
+    {
+      cupsdLogJob(job, CUPSD_LOG_ERROR,
+		  "Unable to read job control file \"%s\".", jobfile);
+      cupsFileClose(fp);
+      goto error;
+    }
 
-      case CUPS_BACKEND_AUTH_REQUIRED :
-         /*
-	  * Hold the job for authentication...
-	  */
+    cupsFileClose(fp);
+  }
 
-	  if (job_state == IPP_JOB_COMPLETED)
-	  {
-	    cupsdSetJobHoldUntil(job, "auth-info-required", 1);
+ /*
+  * Copy attribute data to the job object...
+  */
 
-	    job_state = IPP_JOB_HELD;
-	    message   = "Job held for authentication.";
+  if (!ippFindAttribute(job->attrs, "time-at-creation", IPP_TAG_INTEGER))
+  {
+    cupsdLogJob(job, CUPSD_LOG_ERROR,
+		"Missing or bad time-at-creation attribute in control file.");
+    goto error;
+  }
 
-            if (strncmp(job->reasons->values[0].string.text, "account-", 8))
-	      ippSetString(job->attrs, &job->reasons, 0,
-			   "cups-held-for-authentication");
-          }
-          break;
+  if ((job->state = ippFindAttribute(job->attrs, "job-state",
+                                     IPP_TAG_ENUM)) == NULL)
+  {
+    cupsdLogJob(job, CUPSD_LOG_ERROR,
+		"Missing or bad job-state attribute in control file.");
+    goto error;
+  }
 
-      case CUPS_BACKEND_RETRY :
-	  if (job_state == IPP_JOB_COMPLETED)
-	  {
-	   /*
-	    * Hold the job if the number of retries is less than the
-	    * JobRetryLimit, otherwise abort the job.
-	    */
+  job->state_value  = (ipp_jstate_t)job->state->values[0].integer;
+  job->file_time    = 0;
+  job->history_time = 0;
 
-	    job->tries ++;
+  if ((attr = ippFindAttribute(job->attrs, "time-at-creation", IPP_TAG_INTEGER)) != NULL)
+    job->creation_time = attr->values[0].integer;
 
-	    if (job->tries > JobRetryLimit && JobRetryLimit > 0)
-	    {
-	     /*
-	      * Too many tries...
-	      */
+  if (job->state_value >= IPP_JOB_CANCELED && (attr = ippFindAttribute(job->attrs, "time-at-completed", IPP_TAG_INTEGER)) != NULL)
+  {
+    job->completed_time = attr->values[0].integer;
 
-	      snprintf(buffer, sizeof(buffer),
-		       "Job aborted after %d unsuccessful attempts.",
-		       JobRetryLimit);
-	      job_state = IPP_JOB_ABORTED;
-	      message   = buffer;
+    if (JobHistory < INT_MAX)
+      job->history_time = job->completed_time + JobHistory;
+    else
+      job->history_time = INT_MAX;
 
-	      ippSetString(job->attrs, &job->reasons, 0, "aborted-by-system");
-	    }
-	    else
-	    {
-	     /*
-	      * Try again in N seconds...
-	      */
+    if (job->history_time < time(NULL))
+      goto error;			/* Expired, remove from history */
 
-	      snprintf(buffer, sizeof(buffer),
-		       "Job held for %d seconds since it could not be sent.",
-		       JobRetryInterval);
+    if (job->history_time < JobHistoryUpdate || !JobHistoryUpdate)
+      JobHistoryUpdate = job->history_time;
 
-	      job->hold_until = time(NULL) + JobRetryInterval;
-	      job_state       = IPP_JOB_HELD;
-	      message         = buffer;
+    if (JobFiles < INT_MAX)
+      job->file_time = job->completed_time + JobFiles;
+    else
+      job->file_time = INT_MAX;
 
-	      ippSetString(job->attrs, &job->reasons, 0,
-	                   "resources-are-not-ready");
-	    }
-	  }
-          break;
+    cupsdLogJob(job, CUPSD_LOG_DEBUG2, "cupsdLoadJob: job->file_time=%ld, time-at-completed=%ld, JobFiles=%d", (long)job->file_time, (long)attr->values[0].integer, JobFiles);
 
-      case CUPS_BACKEND_RETRY_CURRENT :
-	 /*
-	  * Mark the job as pending and retry on the same printer...
-	  */
+    if (job->file_time < JobHistoryUpdate || !JobHistoryUpdate)
+      JobHistoryUpdate = job->file_time;
 
-	  if (job_state == IPP_JOB_COMPLETED)
-	  {
-	    job_state = IPP_JOB_PENDING;
-	    message   = "Retrying job on same printer.";
+    cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdLoadJob: JobHistoryUpdate=%ld",
+		    (long)JobHistoryUpdate);
+  }
 
-	    ippSetString(job->attrs, &job->reasons, 0, "none");
-	  }
-          break;
+  if (!job->dest)
+  {
+    if ((attr = ippFindAttribute(job->attrs, "job-printer-uri",
+                                 IPP_TAG_URI)) == NULL)
+    {
+      cupsdLogJob(job, CUPSD_LOG_ERROR,
+		  "No job-printer-uri attribute in control file.");
+      goto error;
+    }
+
+    if ((dest = cupsdValidateDest(attr->values[0].string.text, &(job->dtype),
+                                  &destptr)) == NULL)
+    {
+      cupsdLogJob(job, CUPSD_LOG_ERROR,
+		  "Unable to queue job for destination \"%s\".",
+		  attr->values[0].string.text);
+      goto error;
     }
+
+    cupsdSetJobDest(job, dest);
   }
-  else if (job->status > 0)
+  else if ((destptr = cupsdFindDest(job->dest)) == NULL)
   {
-   /*
-    * Filter had errors; stop job...
-    */
+    cupsdLogJob(job, CUPSD_LOG_ERROR,
+		"Unable to queue job for destination \"%s\".",
+		job->dest);
+    goto error;
+  }
 
-    if (job_state == IPP_JOB_COMPLETED)
+  if ((job->reasons = ippFindAttribute(job->attrs, "job-state-reasons",
+                                       IPP_TAG_KEYWORD)) == NULL)
+  {
+    const char	*reason;		/* job-state-reason keyword */
+
+    cupsdLogJob(job, CUPSD_LOG_DEBUG,
+		"Adding missing job-state-reasons attribute to  control file.");
+
+    switch (job->state_value)
     {
-      job_state = IPP_JOB_STOPPED;
+      default :
+      case IPP_JOB_PENDING :
+          if (destptr->state == IPP_PRINTER_STOPPED)
+            reason = "printer-stopped";
+          else
+            reason = "none";
+          break;
 
-      if (ErrorLog)
-      {
-	snprintf(buffer, sizeof(buffer), "Job stopped due to filter errors; please consult the %s file for details.", ErrorLog);
-	message = buffer;
-      }
-      else
-	message = "Job stopped due to filter errors.";
+      case IPP_JOB_HELD :
+          if ((attr = ippFindAttribute(job->attrs, "job-hold-until",
+                                       IPP_TAG_ZERO)) != NULL &&
+              (attr->value_tag == IPP_TAG_NAME ||
+	       attr->value_tag == IPP_TAG_NAMELANG ||
+	       attr->value_tag == IPP_TAG_KEYWORD) &&
+	      strcmp(attr->values[0].string.text, "no-hold"))
+	    reason = "job-hold-until-specified";
+	  else
+	    reason = "job-incoming";
+          break;
 
-      if (WIFSIGNALED(job->status))
-	ippSetString(job->attrs, &job->reasons, 0, "cups-filter-crashed");
-      else
-	ippSetString(job->attrs, &job->reasons, 0, "job-completed-with-errors");
-    }
-  }
+      case IPP_JOB_PROCESSING :
+          reason = "job-printing";
+          break;
 
- /*
-  * Update the printer and job state.
-  */
+      case IPP_JOB_STOPPED :
+          reason = "job-stopped";
+          break;
 
-  if (set_job_state && job_state != job->state_value)
-    cupsdSetJobState(job, job_state, CUPSD_JOB_DEFAULT, "%s", message);
+      case IPP_JOB_CANCELED :
+          reason = "job-canceled-by-user";
+          break;
 
-  cupsdSetPrinterState(job->printer, printer_state,
-                       printer_state == IPP_PRINTER_STOPPED);
-  update_job_attrs(job, 0);
+      case IPP_JOB_ABORTED :
+          reason = "aborted-by-system";
+          break;
 
-  if (job->history)
+      case IPP_JOB_COMPLETED :
+          reason = "job-completed-successfully";
+          break;
+    }
+
+    job->reasons = ippAddString(job->attrs, IPP_TAG_JOB, IPP_TAG_KEYWORD,
+                                "job-state-reasons", NULL, reason);
+  }
+  else if (job->state_value == IPP_JOB_PENDING)
   {
-    if (job->status &&
-        (job->state_value == IPP_JOB_ABORTED ||
-         job->state_value == IPP_JOB_STOPPED))
-      dump_job_history(job);
+    if (destptr->state == IPP_PRINTER_STOPPED)
+      ippSetString(job->attrs, &job->reasons, 0, "printer-stopped");
     else
-      free_job_history(job);
+      ippSetString(job->attrs, &job->reasons, 0, "none");
   }
 
-  cupsArrayRemove(PrintingJobs, job);
+  job->impressions = ippFindAttribute(job->attrs, "job-impressions-completed", IPP_TAG_INTEGER);
+  job->sheets      = ippFindAttribute(job->attrs, "job-media-sheets-completed", IPP_TAG_INTEGER);
+  job->job_sheets  = ippFindAttribute(job->attrs, "job-sheets", IPP_TAG_NAME);
 
- /*
-  * Clear informational messages...
-  */
+  if (!job->impressions)
+    job->impressions = ippAddInteger(job->attrs, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-impressions-completed", 0);
+  if (!job->sheets)
+    job->sheets = ippAddInteger(job->attrs, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-media-sheets-completed", 0);
 
-  if (job->status_level > CUPSD_LOG_ERROR)
-    job->printer->state_message[0] = '\0';
+  if (!job->priority)
+  {
+    if ((attr = ippFindAttribute(job->attrs, "job-priority",
+                        	 IPP_TAG_INTEGER)) == NULL)
+    {
+      cupsdLogJob(job, CUPSD_LOG_ERROR,
+		  "Missing or bad job-priority attribute in control file.");
+      goto error;
+    }
 
- /*
-  * Apply any PPD updates...
-  */
+    job->priority = attr->values[0].integer;
+  }
 
-  if (job->num_keywords)
+  if (!job->username)
   {
-    if (cupsdUpdatePrinterPPD(job->printer, job->num_keywords, job->keywords))
-      cupsdSetPrinterAttrs(job->printer);
+    if ((attr = ippFindAttribute(job->attrs, "job-originating-user-name",
+                        	 IPP_TAG_NAME)) == NULL)
+    {
+      cupsdLogJob(job, CUPSD_LOG_ERROR,
+		  "Missing or bad job-originating-user-name "
+		  "attribute in control file.");
+      goto error;
+    }
 
-    cupsFreeOptions(job->num_keywords, job->keywords);
+    cupsdSetJobUsername(job, attr->values[0].string.text);
+  }
 
-    job->num_keywords = 0;
-    job->keywords     = NULL;
+  if (!job->name)
+  {
+    if ((attr = ippFindAttribute(job->attrs, "job-name", IPP_TAG_NAME)) != NULL)
+      cupsdSetString(&job->name, attr->values[0].string.text);
   }
 
  /*
-  * Clear the printer <-> job association...
+  * Set the job hold-until time and state...
   */
 
-  job->printer->job = NULL;
-  job->printer      = NULL;
-}
-
-
-/*
- * 'get_options()' - Get a string containing the job options.
- */
-
-static char *				/* O - Options string */
-get_options(cupsd_job_t *job,		/* I - Job */
-            int         banner_page,	/* I - Printing a banner page? */
-	    char        *copies,	/* I - Copies buffer */
-	    size_t      copies_size,	/* I - Size of copies buffer */
-	    char        *title,		/* I - Title buffer */
-	    size_t      title_size)	/* I - Size of title buffer */
-{
-  int			i;		/* Looping var */
-  size_t		newlength;	/* New option buffer length */
-  char			*optptr,	/* Pointer to options */
-			*valptr;	/* Pointer in value string */
-  ipp_attribute_t	*attr;		/* Current attribute */
-  _ppd_cache_t		*pc;		/* PPD cache and mapping data */
-  int			num_pwgppds;	/* Number of PWG->PPD options */
-  cups_option_t		*pwgppds,	/* PWG->PPD options */
-			*pwgppd,	/* Current PWG->PPD option */
-			*preset;	/* Current preset option */
-  int			print_color_mode,
-					/* Output mode (if any) */
-			print_quality;	/* Print quality (if any) */
-  const char		*ppd;		/* PPD option choice */
-  int			exact;		/* Did we get an exact match? */
-  static char		*options = NULL;/* Full list of options */
-  static size_t		optlength = 0;	/* Length of option buffer */
-
+  if (job->state_value == IPP_JOB_HELD)
+  {
+    if ((attr = ippFindAttribute(job->attrs, "job-hold-until",
+	                         IPP_TAG_KEYWORD)) == NULL)
+      attr = ippFindAttribute(job->attrs, "job-hold-until", IPP_TAG_NAME);
 
- /*
-  * Building the options string is harder than it needs to be, but for the
-  * moment we need to pass strings for command-line args and not IPP attribute
-  * pointers... :)
-  *
-  * First build an options array for any PWG->PPD mapped option/choice pairs.
-  */
+    if (attr)
+      cupsdSetJobHoldUntil(job, attr->values[0].string.text, CUPSD_JOB_DEFAULT);
+    else
+    {
+      job->state->values[0].integer = IPP_JOB_PENDING;
+      job->state_value              = IPP_JOB_PENDING;
+    }
+  }
+  else if (job->state_value == IPP_JOB_PROCESSING)
+  {
+    job->state->values[0].integer = IPP_JOB_PENDING;
+    job->state_value              = IPP_JOB_PENDING;
+  }
 
-  pc          = job->printer->pc;
-  num_pwgppds = 0;
-  pwgppds     = NULL;
+  if ((attr = ippFindAttribute(job->attrs, "job-k-octets", IPP_TAG_INTEGER)) != NULL)
+    job->koctets = attr->values[0].integer;
 
-  if (pc &&
-      !ippFindAttribute(job->attrs, "com.apple.print.DocumentTicket.PMSpoolFormat", IPP_TAG_ZERO) &&
-      !ippFindAttribute(job->attrs, "APPrinterPreset", IPP_TAG_ZERO) &&
-      (ippFindAttribute(job->attrs, "print-color-mode", IPP_TAG_ZERO) || ippFindAttribute(job->attrs, "print-quality", IPP_TAG_ZERO) || ippFindAttribute(job->attrs, "cupsPrintQuality", IPP_TAG_ZERO)))
+  if (!job->num_files)
   {
    /*
-    * Map print-color-mode and print-quality to a preset...
+    * Find all the d##### files...
     */
 
-    if ((attr = ippFindAttribute(job->attrs, "print-color-mode",
-				 IPP_TAG_KEYWORD)) != NULL &&
-        !strcmp(attr->values[0].string.text, "monochrome"))
-      print_color_mode = _PWG_PRINT_COLOR_MODE_MONOCHROME;
-    else
-      print_color_mode = _PWG_PRINT_COLOR_MODE_COLOR;
-
-    if ((attr = ippFindAttribute(job->attrs, "print-quality", IPP_TAG_ENUM)) != NULL)
+    for (fileid = 1; fileid < 10000; fileid ++)
     {
-      ipp_quality_t pq = (ipp_quality_t)ippGetInteger(attr, 0);
+      snprintf(jobfile, sizeof(jobfile), "%s/d%05d-%03d", RequestRoot,
+               job->id, fileid);
 
-      if (pq >= IPP_QUALITY_DRAFT && pq <= IPP_QUALITY_HIGH)
-        print_quality = attr->values[0].integer - IPP_QUALITY_DRAFT;
-      else
-        print_quality = _PWG_PRINT_QUALITY_NORMAL;
-    }
-    else if ((attr = ippFindAttribute(job->attrs, "cupsPrintQuality", IPP_TAG_NAME)) != NULL)
-    {
-      const char *pq = ippGetString(attr, 0, NULL);
+      if (access(jobfile, 0))
+        break;
 
-      if (!_cups_strcasecmp(pq, "draft"))
-        print_quality = _PWG_PRINT_QUALITY_DRAFT;
-      else if (!_cups_strcasecmp(pq, "high"))
-        print_quality = _PWG_PRINT_QUALITY_HIGH;
-      else
-        print_quality = _PWG_PRINT_QUALITY_NORMAL;
+      cupsdLogJob(job, CUPSD_LOG_DEBUG,
+		  "Auto-typing document file \"%s\"...", jobfile);
 
-      if (!ippFindAttribute(job->attrs, "print-quality", IPP_TAG_ENUM))
+      if (fileid > job->num_files)
       {
-        cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Mapping cupsPrintQuality=%s to print-quality=%d", pq, print_quality + IPP_QUALITY_DRAFT);
-        num_pwgppds = cupsAddIntegerOption("print-quality", print_quality + IPP_QUALITY_DRAFT, num_pwgppds, &pwgppds);
-      }
-    }
-    else
-    {
-      print_quality = _PWG_PRINT_QUALITY_NORMAL;
-    }
+        if (job->num_files == 0)
+	{
+	  compressions = (int *)calloc((size_t)fileid, sizeof(int));
+	  filetypes    = (mime_type_t **)calloc((size_t)fileid, sizeof(mime_type_t *));
+	}
+	else
+	{
+	  compressions = (int *)realloc(job->compressions, sizeof(int) * (size_t)fileid);
+	  filetypes    = (mime_type_t **)realloc(job->filetypes, sizeof(mime_type_t *) * (size_t)fileid);
+        }
 
-    if (pc->num_presets[print_color_mode][print_quality] == 0)
-    {
-     /*
-      * Try to find a preset that works so that we maximize the chances of us
-      * getting a good print using IPP attributes.
-      */
+	if (compressions)
+	  job->compressions = compressions;
 
-      if (pc->num_presets[print_color_mode][_PWG_PRINT_QUALITY_NORMAL] > 0)
-        print_quality = _PWG_PRINT_QUALITY_NORMAL;
-      else if (pc->num_presets[_PWG_PRINT_COLOR_MODE_COLOR][print_quality] > 0)
-        print_color_mode = _PWG_PRINT_COLOR_MODE_COLOR;
-      else
-      {
-        print_quality    = _PWG_PRINT_QUALITY_NORMAL;
-        print_color_mode = _PWG_PRINT_COLOR_MODE_COLOR;
-      }
-    }
+	if (filetypes)
+	  job->filetypes = filetypes;
 
-    if (pc->num_presets[print_color_mode][print_quality] > 0)
-    {
-     /*
-      * Copy the preset options as long as the corresponding names are not
-      * already defined in the IPP request...
-      */
+        if (!compressions || !filetypes)
+	{
+          cupsdLogJob(job, CUPSD_LOG_ERROR,
+		      "Ran out of memory for job file types.");
 
-      for (i = pc->num_presets[print_color_mode][print_quality],
-	       preset = pc->presets[print_color_mode][print_quality];
-	   i > 0;
-	   i --, preset ++)
-      {
-        if (!ippFindAttribute(job->attrs, preset->name, IPP_TAG_ZERO))
-        {
-          cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Adding preset option %s=%s", preset->name, preset->value);
+	  ippDelete(job->attrs);
+	  job->attrs = NULL;
 
-	  num_pwgppds = cupsAddOption(preset->name, preset->value, num_pwgppds, &pwgppds);
-        }
-      }
-    }
-  }
+	  if (job->compressions)
+	  {
+	    free(job->compressions);
+	    job->compressions = NULL;
+	  }
 
-  if (pc)
-  {
-    if ((attr = ippFindAttribute(job->attrs, "print-quality", IPP_TAG_ENUM)) != NULL)
-    {
-      int pq = ippGetInteger(attr, 0);
-      static const char * const pqs[] = { "Draft", "Normal", "High" };
+	  if (job->filetypes)
+	  {
+	    free(job->filetypes);
+	    job->filetypes = NULL;
+	  }
 
-      if (pq >= IPP_QUALITY_DRAFT && pq <= IPP_QUALITY_HIGH)
-      {
-        cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Mapping print-quality=%d to cupsPrintQuality=%s", pq, pqs[pq - IPP_QUALITY_DRAFT]);
+	  job->num_files = 0;
+	  return (0);
+	}
 
-        num_pwgppds = cupsAddOption("cupsPrintQuality", pqs[pq - IPP_QUALITY_DRAFT], num_pwgppds, &pwgppds);
+	job->num_files = fileid;
       }
-    }
 
-    if (!ippFindAttribute(job->attrs, "InputSlot", IPP_TAG_ZERO) &&
-	!ippFindAttribute(job->attrs, "HPPaperSource", IPP_TAG_ZERO))
-    {
-      if ((ppd = _ppdCacheGetInputSlot(pc, job->attrs, NULL)) != NULL)
-	num_pwgppds = cupsAddOption(pc->source_option, ppd, num_pwgppds,
-				    &pwgppds);
-    }
-    if (!ippFindAttribute(job->attrs, "MediaType", IPP_TAG_ZERO) &&
-	(ppd = _ppdCacheGetMediaType(pc, job->attrs, NULL)) != NULL)
-    {
-      cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Mapping media to MediaType=%s", ppd);
+      job->filetypes[fileid - 1] = mimeFileType(MimeDatabase, jobfile, NULL,
+                                                job->compressions + fileid - 1);
 
-      num_pwgppds = cupsAddOption("MediaType", ppd, num_pwgppds, &pwgppds);
+      if (!job->filetypes[fileid - 1])
+        job->filetypes[fileid - 1] = mimeType(MimeDatabase, "application",
+	                                      "vnd.cups-raw");
     }
+  }
 
-    if (!ippFindAttribute(job->attrs, "PageRegion", IPP_TAG_ZERO) &&
-	!ippFindAttribute(job->attrs, "PageSize", IPP_TAG_ZERO) &&
-	(ppd = _ppdCacheGetPageSize(pc, job->attrs, NULL, &exact)) != NULL)
-    {
-      cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Mapping media to Pagesize=%s", ppd);
-
-      num_pwgppds = cupsAddOption("PageSize", ppd, num_pwgppds, &pwgppds);
+ /*
+  * Load authentication information as needed...
+  */
 
-      if (!ippFindAttribute(job->attrs, "media", IPP_TAG_ZERO))
-      {
-        cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Adding media=%s", ppd);
+  if (job->state_value < IPP_JOB_STOPPED)
+  {
+    snprintf(jobfile, sizeof(jobfile), "%s/a%05d", RequestRoot, job->id);
 
-        num_pwgppds = cupsAddOption("media", ppd, num_pwgppds, &pwgppds);
-      }
-    }
+    for (i = 0;
+	 i < (int)(sizeof(job->auth_env) / sizeof(job->auth_env[0]));
+	 i ++)
+      cupsdClearString(job->auth_env + i);
+    cupsdClearString(&job->auth_uid);
 
-    if (!ippFindAttribute(job->attrs, "OutputBin", IPP_TAG_ZERO) &&
-	(attr = ippFindAttribute(job->attrs, "output-bin",
-				 IPP_TAG_ZERO)) != NULL &&
-	(attr->value_tag == IPP_TAG_KEYWORD ||
-	 attr->value_tag == IPP_TAG_NAME) &&
-	(ppd = _ppdCacheGetOutputBin(pc, attr->values[0].string.text)) != NULL)
+    if ((fp = cupsFileOpen(jobfile, "r")) != NULL)
     {
-     /*
-      * Map output-bin to OutputBin option...
-      */
+      int	bytes,			/* Size of auth data */
+		linenum = 1;		/* Current line number */
+      char	line[65536],		/* Line from file */
+		*value,			/* Value from line */
+		data[65536];		/* Decoded data */
 
-      cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Mapping output-bin to OutputBin=%s", ppd);
 
-      num_pwgppds = cupsAddOption("OutputBin", ppd, num_pwgppds, &pwgppds);
-    }
+      if (cupsFileGets(fp, line, sizeof(line)) &&
+          !strcmp(line, "CUPSD-AUTH-V3"))
+      {
+        i = 0;
+        while (cupsFileGetConf(fp, line, sizeof(line), &value, &linenum))
+        {
+         /*
+          * Decode value...
+          */
 
-    if (pc->sides_option &&
-        !ippFindAttribute(job->attrs, pc->sides_option, IPP_TAG_ZERO) &&
-	(attr = ippFindAttribute(job->attrs, "sides", IPP_TAG_KEYWORD)) != NULL)
-    {
-     /*
-      * Map sides to duplex option...
-      */
+          if (strcmp(line, "negotiate") && strcmp(line, "uid"))
+          {
+	    bytes = sizeof(data);
+	    httpDecode64_2(data, &bytes, value);
+	  }
 
-      if (!strcmp(attr->values[0].string.text, "one-sided"))
-      {
-        cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Mapping sizes to Duplex=%s", pc->sides_1sided);
+         /*
+          * Assign environment variables...
+          */
 
-        num_pwgppds = cupsAddOption(pc->sides_option, pc->sides_1sided, num_pwgppds, &pwgppds);
-      }
-      else if (!strcmp(attr->values[0].string.text, "two-sided-long-edge"))
-      {
-        cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Mapping sizes to Duplex=%s", pc->sides_2sided_long);
+          if (!strcmp(line, "uid"))
+          {
+            cupsdSetStringf(&job->auth_uid, "AUTH_UID=%s", value);
+            continue;
+          }
+          else if (i >= (int)(sizeof(job->auth_env) / sizeof(job->auth_env[0])))
+            break;
 
-        num_pwgppds = cupsAddOption(pc->sides_option, pc->sides_2sided_long, num_pwgppds, &pwgppds);
-      }
-      else if (!strcmp(attr->values[0].string.text, "two-sided-short-edge"))
-      {
-        cupsdLogJob(job, CUPSD_LOG_DEBUG2, "Mapping sizes to Duplex=%s", pc->sides_2sided_short);
+	  if (!strcmp(line, "username"))
+	    cupsdSetStringf(job->auth_env + i, "AUTH_USERNAME=%s", data);
+	  else if (!strcmp(line, "domain"))
+	    cupsdSetStringf(job->auth_env + i, "AUTH_DOMAIN=%s", data);
+	  else if (!strcmp(line, "password"))
+	    cupsdSetStringf(job->auth_env + i, "AUTH_PASSWORD=%s", data);
+	  else if (!strcmp(line, "negotiate"))
+	    cupsdSetStringf(job->auth_env + i, "AUTH_NEGOTIATE=%s", value);
+	  else
+	    continue;
 
-        num_pwgppds = cupsAddOption(pc->sides_option, pc->sides_2sided_short, num_pwgppds, &pwgppds);
+	  i ++;
+	}
       }
+
+      cupsFileClose(fp);
     }
+  }
 
-   /*
-    * Map finishings values...
-    */
-
-    num_pwgppds = _ppdCacheGetFinishingOptions(pc, job->attrs, IPP_FINISHINGS_NONE, num_pwgppds, &pwgppds);
+  cupsdUpdateJobTimer(job);
 
-    for (i = num_pwgppds, pwgppd = pwgppds; i > 0; i --, pwgppd ++)
-      cupsdLogJob(job, CUPSD_LOG_DEBUG2, "After mapping finishings %s=%s", pwgppd->name, pwgppd->value);
-  }
+  job->access_time = time(NULL);
+  return (1);
 
  /*
-  * Map page-delivery values...
+  * If we get here then something bad happened...
   */
 
-  if ((attr = ippFindAttribute(job->attrs, "page-delivery", IPP_TAG_KEYWORD)) != NULL && !ippFindAttribute(job->attrs, "outputorder", IPP_TAG_ZERO))
-  {
-    const char *page_delivery = ippGetString(attr, 0, NULL);
+  error:
 
-    if (!strncmp(page_delivery, "same-order", 10))
-      num_pwgppds = cupsAddOption("OutputOrder", "Normal", num_pwgppds, &pwgppds);
-    else if (!strncmp(page_delivery, "reverse-order", 13))
-      num_pwgppds = cupsAddOption("OutputOrder", "Reverse", num_pwgppds, &pwgppds);
-  }
+  ippDelete(job->attrs);
+  job->attrs = NULL;
 
- /*
-  * Figure out how much room we need...
-  */
+  remove_job_history(job);
+  remove_job_files(job);
 
-  newlength = ipp_length(job->attrs);
+  return (0);
+}
 
-  for (i = num_pwgppds, pwgppd = pwgppds; i > 0; i --, pwgppd ++)
-    newlength += 1 + strlen(pwgppd->name) + 1 + strlen(pwgppd->value);
 
- /*
-  * Then allocate/reallocate the option buffer as needed...
-  */
+/*
+ * 'load_job_cache()' - Load jobs from the job.cache and job.journal files.
+ */
 
-  if (newlength == 0)			/* This can never happen, but Clang */
-    newlength = 1;			/* thinks it can... */
+static void
+load_job_cache(const char *filename)	/* I - job.cache filename */
+{
+  cups_file_t	*fp;			/* job.cache/job.journal file */
+  char		journalfile[1024];	/* job.journal filename */
+  cups_array_t	*journal;		/* Journal index */
+  int		serial = 0,		/* Journal serial number */
+		status;			/* Read status */
 
-  if (newlength > optlength || !options)
-  {
-    if (!options)
-      optptr = malloc(newlength);
-    else
-      optptr = realloc(options, newlength);
 
-    if (!optptr)
-    {
-      cupsdLogJob(job, CUPSD_LOG_CRIT,
-		  "Unable to allocate " CUPS_LLFMT " bytes for option buffer.",
-		  CUPS_LLCAST newlength);
-      return (NULL);
-    }
+ /*
+  * Open the job.cache file...
+  */
 
-    options   = optptr;
-    optlength = newlength;
+  if ((fp = cupsdOpenConfFile(filename)) == NULL)
+  {
+    load_request_root();
+    return;
   }
 
  /*
-  * Now loop through the attributes and convert them to the textual
-  * representation used by the filters...
+  * Index the journal so that we only load the most recent entry for each
+  * job...
   */
 
-  optptr  = options;
-  *optptr = '\0';
-
-  snprintf(title, title_size, "%s-%d", job->printer->name, job->id);
-  strlcpy(copies, "1", copies_size);
-
-  for (attr = job->attrs->attrs; attr != NULL; attr = attr->next)
+  snprintf(journalfile, sizeof(journalfile), "%s/job.journal", CacheDir);
+  if ((journal = load_job_journal(journalfile, &serial)) != NULL && serial <= 0)
   {
-    if (!strcmp(attr->name, "copies") &&
-	attr->value_tag == IPP_TAG_INTEGER)
-    {
-     /*
-      * Don't use the # copies attribute if we are printing the job sheets...
-      */
-
-      if (!banner_page)
-        snprintf(copies, copies_size, "%d", attr->values[0].integer);
-    }
-    else if (!strcmp(attr->name, "job-name") &&
-	     (attr->value_tag == IPP_TAG_NAME ||
-	      attr->value_tag == IPP_TAG_NAMELANG))
-      strlcpy(title, attr->values[0].string.text, title_size);
-    else if (attr->group_tag == IPP_TAG_JOB)
-    {
-     /*
-      * Filter out other unwanted attributes...
-      */
-
-      if (attr->value_tag == IPP_TAG_NOVALUE ||
-          attr->value_tag == IPP_TAG_MIMETYPE ||
-	  attr->value_tag == IPP_TAG_NAMELANG ||
-	  attr->value_tag == IPP_TAG_TEXTLANG ||
-	  (attr->value_tag == IPP_TAG_URI && strcmp(attr->name, "job-uuid") &&
-	   strcmp(attr->name, "job-authorization-uri")) ||
-	  attr->value_tag == IPP_TAG_URISCHEME ||
-	  attr->value_tag == IPP_TAG_BEGIN_COLLECTION) /* Not yet supported */
-	continue;
-
-      if (!strcmp(attr->name, "job-hold-until") ||
-          !strcmp(attr->name, "job-id") ||
-          !strcmp(attr->name, "job-k-octets") ||
-          !strcmp(attr->name, "job-media-sheets") ||
-          !strcmp(attr->name, "job-media-sheets-completed") ||
-          !strcmp(attr->name, "job-state") ||
-          !strcmp(attr->name, "job-state-reasons"))
-	continue;
-
-      if (!strncmp(attr->name, "job-", 4) &&
-          strcmp(attr->name, "job-account-id") &&
-          strcmp(attr->name, "job-accounting-user-id") &&
-          strcmp(attr->name, "job-authorization-uri") &&
-          strcmp(attr->name, "job-billing") &&
-          strcmp(attr->name, "job-impressions") &&
-          strcmp(attr->name, "job-originating-host-name") &&
-          strcmp(attr->name, "job-password") &&
-          strcmp(attr->name, "job-password-encryption") &&
-          strcmp(attr->name, "job-uuid") &&
-          !(job->printer->type & CUPS_PRINTER_REMOTE))
-	continue;
-
-      if ((!strcmp(attr->name, "job-impressions") ||
-           !strcmp(attr->name, "page-label") ||
-           !strcmp(attr->name, "page-border") ||
-           !strncmp(attr->name, "number-up", 9) ||
-	   !strcmp(attr->name, "page-ranges") ||
-	   !strcmp(attr->name, "page-set") ||
-	   !_cups_strcasecmp(attr->name, "AP_FIRSTPAGE_InputSlot") ||
-	   !_cups_strcasecmp(attr->name, "AP_FIRSTPAGE_ManualFeed") ||
-	   !_cups_strcasecmp(attr->name, "com.apple.print.PrintSettings."
-	                           "PMTotalSidesImaged..n.") ||
-	   !_cups_strcasecmp(attr->name, "com.apple.print.PrintSettings."
-	                           "PMTotalBeginPages..n.")) &&
-	  banner_page)
-        continue;
-
-     /*
-      * Otherwise add them to the list...
-      */
+    cupsArrayDelete(journal);
+    journal = NULL;
+  }
 
-      if (optptr > options)
-	strlcat(optptr, " ", optlength - (size_t)(optptr - options));
+  cupsdLogMessage(CUPSD_LOG_INFO, "Loading job cache file \"%s\"...",
+                  filename);
 
-      if (attr->value_tag != IPP_TAG_BOOLEAN)
-      {
-	strlcat(optptr, attr->name, optlength - (size_t)(optptr - options));
-	strlcat(optptr, "=", optlength - (size_t)(optptr - options));
-      }
+  JobCacheSerial = 0;
+  status         = read_job_cache(fp, filename, journal, serial, 0);
 
-      for (i = 0; i < attr->num_values; i ++)
-      {
-	if (i)
-	  strlcat(optptr, ",", optlength - (size_t)(optptr - options));
+  cupsFileClose(fp);
 
-	optptr += strlen(optptr);
+  if (!status && journal && serial == JobCacheSerial)
+  {
+   /*
+    * The journal goes with this job.cache file, replay it...
+    */
 
-	switch (attr->value_tag)
-	{
-	  case IPP_TAG_INTEGER :
-	  case IPP_TAG_ENUM :
-	      snprintf(optptr, optlength - (size_t)(optptr - options),
-	               "%d", attr->values[i].integer);
-	      break;
+    cupsdLogMessage(CUPSD_LOG_INFO, "Loading job journal file \"%s\"...",
+		    journalfile);
 
-	  case IPP_TAG_BOOLEAN :
-	      if (!attr->values[i].boolean)
-		strlcat(optptr, "no", optlength - (size_t)(optptr - options));
+    if ((fp = cupsFileOpen(journalfile, "r")) != NULL)
+    {
+      status = read_job_cache(fp, journalfile, journal, serial, 1);
 
-	      strlcat(optptr, attr->name, optlength - (size_t)(optptr - options));
-	      break;
+      cupsFileClose(fp);
+    }
+  }
+  else if (journal)
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "Ignoring stale job journal file \"%s\".",
+                    journalfile);
 
-	  case IPP_TAG_RANGE :
-	      if (attr->values[i].range.lower == attr->values[i].range.upper)
-		snprintf(optptr, optlength - (size_t)(optptr - options) - 1,
-	        	 "%d", attr->values[i].range.lower);
-              else
-		snprintf(optptr, optlength - (size_t)(optptr - options) - 1,
-	        	 "%d-%d", attr->values[i].range.lower,
-			 attr->values[i].range.upper);
-	      break;
+  cupsArrayDelete(journal);
 
-	  case IPP_TAG_RESOLUTION :
-	      snprintf(optptr, optlength - (size_t)(optptr - options) - 1,
-	               "%dx%d%s", attr->values[i].resolution.xres,
-		       attr->values[i].resolution.yres,
-		       attr->values[i].resolution.units == IPP_RES_PER_INCH ?
-			   "dpi" : "dpcm");
-	      break;
+  if (status)
+  {
+   /*
+    * job.cache file is out-of-date compared to spool directory; load that
+    * instead...
+    */
 
-          case IPP_TAG_STRING :
-              {
-                int length = attr->values[i].unknown.length;
+    load_request_root();
+  }
+}
 
-		for (valptr = attr->values[i].unknown.data; length > 0; length --)
-		{
-		  if ((*valptr & 255) < 0x20 || *valptr == 0x7f)
-		    break;
-		}
 
-		if (length > 0)
-		{
-		 /*
-		  * Encode this string as hex characters...
-		  */
+/*
+ * 'load_job_journal()' - Index the entries in the job.journal file.
+ */
 
-                  *optptr++ = '<';
+static cups_array_t *			/* O - Journal index or NULL */
+load_job_journal(const char *filename,	/* I - job.journal filename */
+                 int        *serial)	/* O - Journal serial number */
+{
+  cups_file_t	*fp;			/* job.journal file */
+  cups_array_t	*journal;		/* Journal index */
+  char		line[1024],		/* Line buffer */
+		*value;			/* Value on line */
+  int		linenum = 0;		/* Line number in file */
+  cupsd_jrec_t	key,			/* Search key */
+		*jrec;			/* Journal record */
 
-		  for (valptr = attr->values[i].unknown.data, length = attr->values[i].unknown.length; length > 0; length --)
-		  {
-		    snprintf(optptr, optlength - (size_t)(optptr - options) - 1, "%02X", *valptr & 255);
-		    optptr += 2;
-		  }
 
-                  *optptr++ = '>';
-		}
-		else
-		{
-		  for (valptr = attr->values[i].unknown.data, length = attr->values[i].unknown.length; length > 0; length --)
-		  {
-		    if (strchr(" \t\n\\\'\"", *valptr))
-		      *optptr++ = '\\';
-		    *optptr++ = *valptr++;
-		  }
-		}
-	      }
+  if ((fp = cupsFileOpen(filename, "r")) == NULL)
+    return (NULL);
 
-	      *optptr = '\0';
-	      break;
+  journal = cupsArrayNew3((cups_array_func_t)compare_jrecs, NULL, NULL, 0, NULL,
+                          (cups_afree_func_t)free);
 
-	  case IPP_TAG_TEXT :
-	  case IPP_TAG_NAME :
-	  case IPP_TAG_KEYWORD :
-	  case IPP_TAG_CHARSET :
-	  case IPP_TAG_LANGUAGE :
-	  case IPP_TAG_URI :
-	      for (valptr = attr->values[i].string.text; *valptr;)
-	      {
-	        if (strchr(" \t\n\\\'\"", *valptr))
-		  *optptr++ = '\\';
-		*optptr++ = *valptr++;
-	      }
+  while (cupsFileGetConf(fp, line, sizeof(line), &value, &linenum))
+  {
+    if (!value)
+      continue;
 
-	      *optptr = '\0';
-	      break;
+    if (!_cups_strcasecmp(line, "Serial"))
+    {
+      *serial = atoi(value);
+      continue;
+    }
+    else if (_cups_strcasecmp(line, "<Job") &&
+             _cups_strcasecmp(line, "DeleteJob"))
+      continue;
 
-          default :
-	      break; /* anti-compiler-warning-code */
-	}
-      }
+    if ((key.id = atoi(value)) < 1)
+      continue;
 
-      optptr += strlen(optptr);
+    if ((jrec = (cupsd_jrec_t *)cupsArrayFind(journal, &key)) == NULL)
+    {
+      if ((jrec = calloc(1, sizeof(cupsd_jrec_t))) == NULL)
+        break;
+
+      jrec->id = key.id;
+      cupsArrayAdd(journal, jrec);
     }
+
+    jrec->linenum = linenum;
+    jrec->deleted = !_cups_strcasecmp(line, "DeleteJob");
   }
 
- /*
-  * Finally loop through the PWG->PPD mapped options and add them...
-  */
+  cupsFileClose(fp);
 
-  for (i = num_pwgppds, pwgppd = pwgppds; i > 0; i --, pwgppd ++)
+  return (journal);
+}
+
+
+/*
+ * 'load_job_thread()' - Read job control files for cupsdLoadJobs.
+ *
+ * Only thread-safe CUPS API functions may be used here - in particular, no
+ * logging and no changes to the job objects.
+ */
+
+static void *				/* O - Thread exit status */
+load_job_thread(cupsd_jobload_t *data)	/* I - Job loading data */
+{
+  int		i;			/* Current job */
+  char		jobfile[1024];		/* Job filename */
+  cups_file_t	*fp;			/* Job file */
+  ipp_t		*attrs;			/* Job attributes */
+
+
+  for (;;)
   {
-    *optptr++ = ' ';
-    strlcpy(optptr, pwgppd->name, optlength - (size_t)(optptr - options));
-    optptr += strlen(optptr);
-    *optptr++ = '=';
-    strlcpy(optptr, pwgppd->value, optlength - (size_t)(optptr - options));
-    optptr += strlen(optptr);
-  }
+    _cupsMutexLock(&data->mutex);
+    i = data->next ++;
+    _cupsMutexUnlock(&data->mutex);
 
-  cupsFreeOptions(num_pwgppds, pwgppds);
+    if (i >= data->num_jobs)
+      break;
 
- /*
-  * Return the options string...
-  */
+    snprintf(jobfile, sizeof(jobfile), "%s/c%05d", RequestRoot, data->ids[i]);
+    if ((fp = cupsFileOpen(jobfile, "r")) == NULL)
+      continue;				/* Main thread will report the error */
 
-  return (options);
+    if ((attrs = ippNew()) != NULL)
+    {
+      if (ippReadIO(fp, (ipp_iocb_t)cupsFileRead, 1, NULL, attrs) == IPP_DATA)
+        data->attrs[i] = attrs;
+      else
+        ippDelete(attrs);
+    }
+
+    cupsFileClose(fp);
+  }
+
+  return (NULL);
 }
 
 
 /*
- * 'ipp_length()' - Compute the size of the buffer needed to hold
- *		    the textual IPP attributes.
+ * 'load_next_job_id()' - Load the NextJobId value from the job.cache file.
  */
 
-static size_t				/* O - Size of attribute buffer */
-ipp_length(ipp_t *ipp)			/* I - IPP request */
+static void
+load_next_job_id(const char *filename)	/* I - job.cache filename */
 {
-  size_t		bytes; 		/* Number of bytes */
-  int			i;		/* Looping var */
-  ipp_attribute_t	*attr;		/* Current attribute */
+  cups_file_t	*fp;			/* job.cache file */
+  char		line[1024],		/* Line buffer */
+		*value;			/* Value on line */
+  int		linenum;		/* Line number in file */
+  int		next_job_id;		/* NextJobId value from line */
 
 
  /*
-  * Loop through all attributes...
+  * Read the NextJobId directive from the job.cache file and use
+  * the value (if any).
   */
 
-  bytes = 0;
+  if ((fp = cupsFileOpen(filename, "r")) == NULL)
+  {
+    if (errno != ENOENT)
+      cupsdLogMessage(CUPSD_LOG_ERROR,
+                      "Unable to open job cache file \"%s\": %s",
+                      filename, strerror(errno));
 
-  for (attr = ipp->attrs; attr != NULL; attr = attr->next)
+    return;
+  }
+
+  cupsdLogMessage(CUPSD_LOG_INFO,
+                  "Loading NextJobId from job cache file \"%s\"...", filename);
+
+  linenum = 0;
+
+  while (cupsFileGetConf(fp, line, sizeof(line), &value, &linenum))
   {
-   /*
-    * Skip attributes that won't be sent to filters...
-    */
+    if (!_cups_strcasecmp(line, "NextJobId"))
+    {
+      if (value)
+      {
+        next_job_id = atoi(value);
 
-    if (attr->value_tag == IPP_TAG_NOVALUE ||
-	attr->value_tag == IPP_TAG_MIMETYPE ||
-	attr->value_tag == IPP_TAG_NAMELANG ||
-	attr->value_tag == IPP_TAG_TEXTLANG ||
-	attr->value_tag == IPP_TAG_URI ||
-	attr->value_tag == IPP_TAG_URISCHEME)
-      continue;
+        if (next_job_id > NextJobId)
+	  NextJobId = next_job_id;
+      }
+      break;
+    }
+  }
 
-   /*
-    * Add space for a leading space and commas between each value.
-    * For the first attribute, the leading space isn't used, so the
-    * extra byte can be used as the nul terminator...
-    */
+  cupsFileClose(fp);
+}
 
-    bytes ++;				/* " " separator */
-    bytes += (size_t)attr->num_values;	/* "," separators */
 
-   /*
-    * Boolean attributes appear as "foo,nofoo,foo,nofoo", while
-    * other attributes appear as "foo=value1,value2,...,valueN".
-    */
+/*
+ * 'load_request_root()' - Load jobs from the RequestRoot directory.
+ */
 
-    if (attr->value_tag != IPP_TAG_BOOLEAN)
-      bytes += strlen(attr->name);
-    else
-      bytes += (size_t)attr->num_values * strlen(attr->name);
+static void
+load_request_root(void)
+{
+  cups_dir_t		*dir;		/* Directory */
+  cups_dentry_t		*dent;		/* Directory entry */
+  cupsd_job_t		*job;		/* New job */
 
-   /*
-    * Now add the size required for each value in the attribute...
-    */
 
-    switch (attr->value_tag)
-    {
-      case IPP_TAG_INTEGER :
-      case IPP_TAG_ENUM :
-         /*
-	  * Minimum value of a signed integer is -2147483647, or 11 digits.
-	  */
+ /*
+  * Open the requests directory...
+  */
 
-	  bytes += (size_t)attr->num_values * 11;
-	  break;
+  cupsdLogMessage(CUPSD_LOG_DEBUG, "Scanning %s for jobs...", RequestRoot);
 
-      case IPP_TAG_BOOLEAN :
-         /*
-	  * Add two bytes for each false ("no") value...
-	  */
+  if ((dir = cupsDirOpen(RequestRoot)) == NULL)
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR,
+                    "Unable to open spool directory \"%s\": %s",
+                    RequestRoot, strerror(errno));
+    return;
+  }
 
-          for (i = 0; i < attr->num_values; i ++)
-	    if (!attr->values[i].boolean)
-	      bytes += 2;
-	  break;
+ /*
+  * Read all the c##### files...
+  */
 
-      case IPP_TAG_RANGE :
-         /*
-	  * A range is two signed integers separated by a hyphen, or
-	  * 23 characters max.
-	  */
+  while ((dent = cupsDirRead(dir)) != NULL)
+    if (strlen(dent->filename) >= 6 && dent->filename[0] == 'c')
+    {
+     /*
+      * Allocate memory for the job...
+      */
 
-	  bytes += (size_t)attr->num_values * 23;
-	  break;
+      if ((job = calloc(sizeof(cupsd_job_t), 1)) == NULL)
+      {
+        cupsdLogMessage(CUPSD_LOG_ERROR, "Ran out of memory for jobs.");
+	cupsDirClose(dir);
+	return;
+      }
 
-      case IPP_TAG_RESOLUTION :
-         /*
-	  * A resolution is two signed integers separated by an "x" and
-	  * suffixed by the units, or 26 characters max.
-	  */
+     /*
+      * Assign the job ID...
+      */
 
-	  bytes += (size_t)attr->num_values * 26;
-	  break;
+      job->id              = atoi(dent->filename + 1);
+      job->back_pipes[0]   = -1;
+      job->back_pipes[1]   = -1;
+      job->print_pipes[0]  = -1;
+      job->print_pipes[1]  = -1;
+      job->side_pipes[0]   = -1;
+      job->side_pipes[1]   = -1;
+      job->status_pipes[0] = -1;
+      job->status_pipes[1] = -1;
 
-      case IPP_TAG_STRING :
-         /*
-	  * Octet strings can contain characters that need quoting.  We need
-	  * at least 2 * len + 2 characters to cover the quotes and any
-	  * backslashes in the string.
-	  */
+      if (job->id >= NextJobId)
+        NextJobId = job->id + 1;
 
-          for (i = 0; i < attr->num_values; i ++)
-	    bytes += 2 * (size_t)attr->values[i].unknown.length + 2;
-	  break;
+     /*
+      * Load the job...
+      */
 
-      case IPP_TAG_TEXT :
-      case IPP_TAG_NAME :
-      case IPP_TAG_KEYWORD :
-      case IPP_TAG_CHARSET :
-      case IPP_TAG_LANGUAGE :
-      case IPP_TAG_URI :
-         /*
-	  * Strings can contain characters that need quoting.  We need
-	  * at least 2 * len + 2 characters to cover the quotes and
-	  * any backslashes in the string.
-	  */
+      if (cupsdLoadJob(job))
+      {
+       /*
+        * Insert the job into the array, sorting by job priority and ID...
+        */
 
-          for (i = 0; i < attr->num_values; i ++)
-	    bytes += 2 * strlen(attr->values[i].string.text) + 2;
-	  break;
+	cupsArrayAdd(Jobs, job);
 
-       default :
-	  break; /* anti-compiler-warning-code */
+	if (job->state_value <= IPP_JOB_STOPPED)
+	  cupsdSetJobActive(job, 1);
+	else
+	  unload_job(job);
+      }
+      else
+      {
+       /*
+        * Free the job, removing it from the job indexes...
+	*/
+
+        cupsdDeleteJob(job, CUPSD_JOB_DEFAULT);
+      }
     }
-  }
 
-  return (bytes);
+  cupsDirClose(dir);
 }
 
 
 /*
- * 'load_job_cache()' - Load jobs from the job.cache file.
+ * 'read_job_cache()' - Read jobs from the job.cache or job.journal file.
  */
 
-static void
-load_job_cache(const char *filename)	/* I - job.cache filename */
+static int				/* O - 0 on success, -1 if out-of-date */
+read_job_cache(cups_file_t  *fp,	/* I - File to read */
+               const char   *filename,	/* I - Filename */
+               cups_array_t *journal,	/* I - Journal index or NULL */
+               int          serial,	/* I - Journal serial number */
+	       int          is_journal)	/* I - Reading the journal? */
 {
-  cups_file_t	*fp;			/* job.cache file */
   char		line[1024],		/* Line buffer */
 		*value;			/* Value on line */
   int		linenum;		/* Line number in file */
   cupsd_job_t	*job;			/* Current job */
   int		jobid;			/* Job ID */
   char		jobfile[1024];		/* Job filename */
+  cupsd_jrec_t	key,			/* Search key */
+		*jrec;			/* Journal record */
+  int		have_summary = 0;	/* Have the cached job summary? */
 
 
- /*
-  * Open the job.cache file...
-  */
-
-  if ((fp = cupsdOpenConfFile(filename)) == NULL)
-  {
-    load_request_root();
-    return;
-  }
-
  /*
   * Read entries from the job cache file and create jobs as needed.
   */
 
-  cupsdLogMessage(CUPSD_LOG_INFO, "Loading job cache file \"%s\"...",
-                  filename);
-
   linenum = 0;
   job     = NULL;
 
@@ -4293,6 +5307,16 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
       if (value)
         NextJobId = atoi(value);
     }
+    else if (!_cups_strcasecmp(line, "Serial"))
+    {
+      if (value && !is_journal)
+        JobCacheSerial = atoi(value);
+    }
+    else if (!_cups_strcasecmp(line, "DeleteJob"))
+    {
+      if (value && atoi(value) >= NextJobId)
+        NextJobId = atoi(value) + 1;
+    }
     else if (!_cups_strcasecmp(line, "<Job"))
     {
       if (job)
@@ -4309,12 +5333,34 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
 
       jobid = atoi(value);
 
+      if (!is_journal && JobCacheSerial != serial)
+        journal = NULL;			/* Journal is for another job.cache */
+
       if (jobid < 1)
       {
         cupsdLogMessage(CUPSD_LOG_ERROR, "Bad job ID %d on line %d of %s.", jobid, linenum, filename);
         continue;
       }
 
+      if (jobid >= NextJobId)
+        NextJobId = jobid + 1;
+
+      key.id = jobid;
+
+      if ((jrec = (cupsd_jrec_t *)cupsArrayFind(journal, &key)) != NULL &&
+          (!is_journal || jrec->linenum != linenum || jrec->deleted))
+      {
+       /*
+        * Skip entries that have been replaced or deleted by the journal...
+	*/
+
+        while (cupsFileGetConf(fp, line, sizeof(line), &value, &linenum))
+	  if (!_cups_strcasecmp(line, "</Job>"))
+	    break;
+
+        continue;
+      }
+
       snprintf(jobfile, sizeof(jobfile), "%s/c%05d", RequestRoot, jobid);
       if (access(jobfile, 0))
       {
@@ -4329,9 +5375,7 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
           * that instead...
           */
 
-	  cupsFileClose(fp);
-          load_request_root();
-          return;
+          return (-1);
 	}
       }
 
@@ -4353,6 +5397,8 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
       job->status_pipes[0] = -1;
       job->status_pipes[1] = -1;
 
+      have_summary = 0;
+
       cupsdLogJob(job, CUPSD_LOG_DEBUG, "Loading from cache...");
     }
     else if (!job)
@@ -4366,16 +5412,18 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
       cupsArrayAdd(Jobs, job);
 
       if (job->state_value <= IPP_JOB_STOPPED && cupsdLoadJob(job))
-	cupsArrayAdd(ActiveJobs, job);
+	cupsdSetJobActive(job, 1);
       else if (job->state_value > IPP_JOB_STOPPED)
       {
-        if (!job->completed_time || !job->creation_time || !job->name || !job->koctets)
+        if (!job->completed_time || !job->creation_time || !job->name || !job->koctets || !have_summary)
 	{
 	  cupsdLoadJob(job);
 	  unload_job(job);
 	}
       }
 
+      cupsdUpdateJobTimer(job);
+
       job = NULL;
     }
     else if (!value)
@@ -4400,6 +5448,10 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
     {
       job->creation_time = strtol(value, NULL, 10);
     }
+    else if (!_cups_strcasecmp(line, "Processed"))
+    {
+      job->processing_time = strtol(value, NULL, 10);
+    }
     else if (!_cups_strcasecmp(line, "Completed"))
     {
       job->completed_time = strtol(value, NULL, 10);
@@ -4414,11 +5466,11 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
     }
     else if (!_cups_strcasecmp(line, "Username"))
     {
-      cupsdSetString(&job->username, value);
+      cupsdSetJobUsername(job, value);
     }
     else if (!_cups_strcasecmp(line, "Destination"))
     {
-      cupsdSetString(&job->dest, value);
+      cupsdSetJobDest(job, value);
     }
     else if (!_cups_strcasecmp(line, "DestType"))
     {
@@ -4428,6 +5480,19 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
     {
       job->koctets = atoi(value);
     }
+    else if (!_cups_strcasecmp(line, "Impressions"))
+    {
+      job->num_impressions = atoi(value);
+    }
+    else if (!_cups_strcasecmp(line, "Sheets"))
+    {
+      job->num_sheets = atoi(value);
+      have_summary    = 1;
+    }
+    else if (!_cups_strcasecmp(line, "Message"))
+    {
+      cupsdSetString(&job->message, value);
+    }
     else if (!_cups_strcasecmp(line, "NumFiles"))
     {
       job->num_files = atoi(value);
@@ -4523,146 +5588,7 @@ load_job_cache(const char *filename)	/* I - job.cache filename */
     cupsdDeleteJob(job, CUPSD_JOB_PURGE);
   }
 
-  cupsFileClose(fp);
-}
-
-
-/*
- * 'load_next_job_id()' - Load the NextJobId value from the job.cache file.
- */
-
-static void
-load_next_job_id(const char *filename)	/* I - job.cache filename */
-{
-  cups_file_t	*fp;			/* job.cache file */
-  char		line[1024],		/* Line buffer */
-		*value;			/* Value on line */
-  int		linenum;		/* Line number in file */
-  int		next_job_id;		/* NextJobId value from line */
-
-
- /*
-  * Read the NextJobId directive from the job.cache file and use
-  * the value (if any).
-  */
-
-  if ((fp = cupsFileOpen(filename, "r")) == NULL)
-  {
-    if (errno != ENOENT)
-      cupsdLogMessage(CUPSD_LOG_ERROR,
-                      "Unable to open job cache file \"%s\": %s",
-                      filename, strerror(errno));
-
-    return;
-  }
-
-  cupsdLogMessage(CUPSD_LOG_INFO,
-                  "Loading NextJobId from job cache file \"%s\"...", filename);
-
-  linenum = 0;
-
-  while (cupsFileGetConf(fp, line, sizeof(line), &value, &linenum))
-  {
-    if (!_cups_strcasecmp(line, "NextJobId"))
-    {
-      if (value)
-      {
-        next_job_id = atoi(value);
-
-        if (next_job_id > NextJobId)
-	  NextJobId = next_job_id;
-      }
-      break;
-    }
-  }
-
-  cupsFileClose(fp);
-}
-
-
-/*
- * 'load_request_root()' - Load jobs from the RequestRoot directory.
- */
-
-static void
-load_request_root(void)
-{
-  cups_dir_t		*dir;		/* Directory */
-  cups_dentry_t		*dent;		/* Directory entry */
-  cupsd_job_t		*job;		/* New job */
-
-
- /*
-  * Open the requests directory...
-  */
-
-  cupsdLogMessage(CUPSD_LOG_DEBUG, "Scanning %s for jobs...", RequestRoot);
-
-  if ((dir = cupsDirOpen(RequestRoot)) == NULL)
-  {
-    cupsdLogMessage(CUPSD_LOG_ERROR,
-                    "Unable to open spool directory \"%s\": %s",
-                    RequestRoot, strerror(errno));
-    return;
-  }
-
- /*
-  * Read all the c##### files...
-  */
-
-  while ((dent = cupsDirRead(dir)) != NULL)
-    if (strlen(dent->filename) >= 6 && dent->filename[0] == 'c')
-    {
-     /*
-      * Allocate memory for the job...
-      */
-
-      if ((job = calloc(sizeof(cupsd_job_t), 1)) == NULL)
-      {
-        cupsdLogMessage(CUPSD_LOG_ERROR, "Ran out of memory for jobs.");
-	cupsDirClose(dir);
-	return;
-      }
-
-     /*
-      * Assign the job ID...
-      */
-
-      job->id              = atoi(dent->filename + 1);
-      job->back_pipes[0]   = -1;
-      job->back_pipes[1]   = -1;
-      job->print_pipes[0]  = -1;
-      job->print_pipes[1]  = -1;
-      job->side_pipes[0]   = -1;
-      job->side_pipes[1]   = -1;
-      job->status_pipes[0] = -1;
-      job->status_pipes[1] = -1;
-
-      if (job->id >= NextJobId)
-        NextJobId = job->id + 1;
-
-     /*
-      * Load the job...
-      */
-
-      if (cupsdLoadJob(job))
-      {
-       /*
-        * Insert the job into the array, sorting by job priority and ID...
-        */
-
-	cupsArrayAdd(Jobs, job);
-
-	if (job->state_value <= IPP_JOB_STOPPED)
-	  cupsArrayAdd(ActiveJobs, job);
-	else
-	  unload_job(job);
-      }
-      else
-        free(job);
-    }
-
-  cupsDirClose(dir);
+  return (0);
 }
 
 
@@ -4848,6 +5774,8 @@ start_job(cupsd_job_t     *job,		/* I - Job ID */
   else
     job->cancel_time = 0;
 
+  cupsdUpdateJobTimer(job);
+
  /*
   * Check for support files...
   */
@@ -5030,6 +5958,28 @@ stop_job(cupsd_job_t       *job,	/* I - Job */
 
     job->status = 0;
   }
+
+  cupsdUpdateJobTimer(job);
+}
+
+
+/*
+ * 'unindex_job()' - Remove a job from a job index.
+ */
+
+static void
+unindex_job(cups_array_t *index,	/* I - JobsByDest or JobsByUser */
+            const char   *name,		/* I - Destination or username */
+            cupsd_job_t  *job)		/* I - Job */
+{
+  cupsd_jobindex_t	*entry;		/* Index entry */
+
+
+  if ((entry = cupsdFindJobIndex(index, name)) != NULL)
+  {
+    cupsArrayRemove(entry->jobs, job);
+    cupsArrayRemove(entry->active, job);
+  }
 }
 
 
@@ -5045,6 +5995,8 @@ unload_job(cupsd_job_t *job)		/* I - Job */
 
   cupsdLogJob(job, CUPSD_LOG_DEBUG, "Unloading...");
 
+  update_job_summary(job);
+
   ippDelete(job->attrs);
 
   job->attrs           = NULL;
@@ -5216,6 +6168,8 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
 	      job->cancel_time = time(NULL) + MaxJobTime;
 	    else
 	      job->cancel_time = 0;
+
+	    cupsdUpdateJobTimer(job);
 	  }
         }
       }
@@ -5407,7 +6361,7 @@ update_job(cupsd_job_t *job)		/* I - Job to check */
       }
     }
 
-    if (!strchr(job->status_buffer->buffer, '\n'))
+    if (!cupsdStatBufHasLine(job->status_buffer))
       break;
   }
 
@@ -5579,3 +6533,115 @@ update_job_attrs(cupsd_job_t *job,	/* I - Job to update */
   job->dirty = 1;
   cupsdMarkDirty(CUPSD_DIRTY_JOBS);
 }
+
+
+/*
+ * 'update_job_summary()' - Cache the job attributes used for unloaded jobs.
+ */
+
+static void
+update_job_summary(cupsd_job_t *job)	/* I - Job */
+{
+  ipp_attribute_t	*attr;		/* Job attribute */
+
+
+  if (!job->attrs)
+    return;
+
+  if ((attr = ippFindAttribute(job->attrs, "time-at-processing", IPP_TAG_INTEGER)) != NULL)
+    job->processing_time = attr->values[0].integer;
+
+  if (job->impressions)
+    job->num_impressions = job->impressions->values[0].integer;
+
+  if (job->sheets)
+    job->num_sheets = job->sheets->values[0].integer;
+
+  if ((attr = ippFindAttribute(job->attrs, "job-printer-state-message", IPP_TAG_TEXT)) != NULL)
+    cupsdSetString(&job->message, attr->values[0].string.text);
+  else
+    cupsdClearString(&job->message);
+}
+
+
+/*
+ * 'write_job_cache()' - Write the job.cache entry for a job.
+ */
+
+static void
+write_job_cache(cups_file_t *fp,	/* I - job.cache or job.journal file */
+                cupsd_job_t *job)	/* I - Job */
+{
+  int	i;				/* Looping var */
+
+
+  update_job_summary(job);
+
+  cupsFilePrintf(fp, "<Job %d>\n", job->id);
+  cupsFilePrintf(fp, "State %d\n", job->state_value);
+  cupsFilePrintf(fp, "Created %ld\n", (long)job->creation_time);
+  if (job->processing_time)
+    cupsFilePrintf(fp, "Processed %ld\n", (long)job->processing_time);
+  if (job->completed_time)
+    cupsFilePrintf(fp, "Completed %ld\n", (long)job->completed_time);
+  cupsFilePrintf(fp, "Priority %d\n", job->priority);
+  if (job->hold_until)
+    cupsFilePrintf(fp, "HoldUntil %ld\n", (long)job->hold_until);
+  cupsFilePrintf(fp, "Username %s\n", job->username);
+  if (job->name)
+    cupsFilePutConf(fp, "Name", job->name);
+  cupsFilePrintf(fp, "Destination %s\n", job->dest);
+  cupsFilePrintf(fp, "DestType %d\n", job->dtype);
+  cupsFilePrintf(fp, "KOctets %d\n", job->koctets);
+  cupsFilePrintf(fp, "Impressions %d\n", job->num_impressions);
+  cupsFilePrintf(fp, "Sheets %d\n", job->num_sheets);
+  if (job->message)
+    cupsFilePutConf(fp, "Message", job->message);
+  cupsFilePrintf(fp, "NumFiles %d\n", job->num_files);
+  for (i = 0; i < job->num_files; i ++)
+    cupsFilePrintf(fp, "File %d %s/%s %d\n", i + 1, job->filetypes[i]->super,
+		   job->filetypes[i]->type, job->compressions[i]);
+  cupsFilePuts(fp, "</Job>\n");
+}
+
+
+/*
+ * 'write_job_journal()' - Append a job change to the job.journal file.
+ */
+
+static void
+write_job_journal(cupsd_job_t *job,	/* I - Job or NULL if deleted */
+                  int         id)	/* I - Job ID */
+{
+  if (!JobJournal)
+    return;				/* Changes go in the next job.cache */
+
+  if (job)
+  {
+    if (job->printer && job->printer->temporary)
+      return;
+
+    write_job_cache(JobJournal, job);
+  }
+  else
+    cupsFilePrintf(JobJournal, "DeleteJob %d\n", id);
+
+  JobJournalCount ++;
+
+  if (cupsFileFlush(JobJournal))
+  {
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to write job.journal: %s",
+                    strerror(errno));
+
+   /*
+    * Stop using the journal and write a new job.cache file...
+    */
+
+    cupsFileClose(JobJournal);
+    JobJournal = NULL;
+
+    cupsdMarkDirty(CUPSD_DIRTY_JOBS);
+  }
+  else if (SyncOnClose)
+    fsync(cupsFileNumber(JobJournal));
+}
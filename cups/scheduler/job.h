@@ -27,14 +27,20 @@ struct cupsd_job_s			/**** Job request ****/
 {
   int			id,		/* Job ID */
 			priority,	/* Job priority */
-			dirty;		/* Do we need to write the "c" file? */
-  ipp_jstate_t		state_value;	/* Cached job-state */
+			dirty,		/* Do we need to write the "c" file? */
+			active,		/* Is the job in the ActiveJobs array? */
+			is_pending;	/* Counted in NumPendingJobs? */
+  ipp_jstate_t		state_value,	/* Cached job-state */
+			index_state;	/* State in JobsByState (0 if none) */
   int			pending_timeout;/* Non-zero if the job was created and
 					 * waiting on files */
   char			*username;	/* Printing user */
   char			*dest;		/* Destination printer or class */
   char			*name;		/* Job name/title */
   int			koctets;	/* job-k-octets */
+  int			num_impressions,/* Cached job-impressions-completed */
+			num_sheets;	/* Cached job-media-sheets-completed */
+  char			*message;	/* Cached job-printer-state-message */
   cups_ptype_t		dtype;		/* Destination type */
   cupsd_printer_t	*printer;	/* Printer this job is assigned to */
   int			num_files;	/* Number of files in job */
@@ -46,10 +52,12 @@ struct cupsd_job_s			/**** Job request ****/
 			cancel_time,	/* When to cancel/send SIGTERM */
 			creation_time,	/* When job was created */
 			completed_time,	/* When job was completed (0 if not) */
+			processing_time,/* When job was processed (0 if not) */
 			file_time,	/* Job file retain time */
 			history_time,	/* Job history retain time */
 			hold_until,	/* Hold expiration date/time */
-			kill_time;	/* When to send SIGKILL */
+			kill_time,	/* When to send SIGKILL */
+			timer_time;	/* Deadline in JobTimers (0 if none) */
   ipp_attribute_t	*state;		/* Job state */
   ipp_attribute_t	*reasons;	/* Job state reasons */
   ipp_attribute_t	*job_sheets;	/* Job sheets (NULL if none) */
@@ -86,6 +94,13 @@ struct cupsd_job_s			/**** Job request ****/
   cups_option_t		*keywords;	/* PPD keywords */
 };
 
+typedef struct cupsd_jobindex_s		/**** Job index entry ****/
+{
+  char			*name;		/* Destination or username */
+  cups_array_t		*jobs,		/* All jobs, sorted by ID */
+			*active;	/* Active jobs, sorted by priority */
+} cupsd_jobindex_t;
+
 typedef struct cupsd_joblog_s		/**** Job log message ****/
 {
   time_t		time;		/* Time of message */
@@ -97,6 +112,8 @@ typedef struct cupsd_joblog_s		/**** Job log message ****/
  * Globals...
  */
 
+#define CUPSD_MAX_LOAD_THREADS	16	/* Max threads for cupsdLoadJobs */
+
 VAR int			JobHistory	VALUE(INT_MAX);
 					/* Preserve job history? */
 VAR int			JobFiles	VALUE(86400);
@@ -121,16 +138,28 @@ VAR cups_array_t	*Jobs		VALUE(NULL),
 					/* List of current jobs */
 			*ActiveJobs	VALUE(NULL),
 					/* List of active jobs */
-			*PrintingJobs	VALUE(NULL);
+			*PrintingJobs	VALUE(NULL),
 					/* List of jobs that are printing */
+			*JobsByDest	VALUE(NULL),
+					/* Jobs indexed by destination */
+			*JobsByUser	VALUE(NULL),
+					/* Jobs indexed by username */
+			*JobTimers	VALUE(NULL),
+					/* Active jobs sorted by deadline */
+			*JobsByState[IPP_JSTATE_COMPLETED - IPP_JSTATE_PENDING + 1];
+					/* Jobs indexed by state */
+VAR int			NumPendingJobs	VALUE(0);
+					/* Number of pending active jobs */
 VAR int			NextJobId	VALUE(1);
 					/* Next job ID to use */
 VAR int			JobKillDelay	VALUE(DEFAULT_TIMEOUT),
 					/* Delay before killing jobs */
 			JobRetryLimit	VALUE(5),
 					/* Max number of tries */
-			JobRetryInterval VALUE(300);
+			JobRetryInterval VALUE(300),
 					/* Seconds between retries */
+			JobLoadThreads	VALUE(0);
+					/* Threads for loading jobs */
 
 
 /*
@@ -146,17 +175,22 @@ extern void		cupsdContinueJob(cupsd_job_t *job);
 extern void		cupsdDeleteJob(cupsd_job_t *job,
 			               cupsd_jobaction_t action);
 extern cupsd_job_t	*cupsdFindJob(int id);
+extern cupsd_jobindex_t	*cupsdFindJobIndex(cups_array_t *index,
+			                   const char *name);
 extern void		cupsdFreeAllJobs(void);
 extern cups_array_t	*cupsdGetCompletedJobs(cupsd_printer_t *p);
 extern int		cupsdGetPrinterJobCount(const char *dest);
 extern int		cupsdGetUserJobCount(const char *username);
 extern void		cupsdLoadAllJobs(void);
 extern int		cupsdLoadJob(cupsd_job_t *job);
+extern void		cupsdLoadJobs(cups_array_t *jobs);
 extern void		cupsdMoveJob(cupsd_job_t *job, cupsd_printer_t *p);
 extern void		cupsdReleaseJob(cupsd_job_t *job);
 extern void		cupsdRestartJob(cupsd_job_t *job);
 extern void		cupsdSaveAllJobs(void);
 extern void		cupsdSaveJob(cupsd_job_t *job);
+extern void		cupsdSetJobActive(cupsd_job_t *job, int active);
+extern void		cupsdSetJobDest(cupsd_job_t *job, const char *dest);
 extern void		cupsdSetJobHoldUntil(cupsd_job_t *job,
 			                     const char *when, int update);
 extern void		cupsdSetJobPriority(cupsd_job_t *job, int priority);
@@ -166,8 +200,12 @@ extern void		cupsdSetJobState(cupsd_job_t *job,
 					 const char *message, ...)
 					__attribute__((__format__(__printf__,
 					                          4, 5)));
+extern void		cupsdSetJobUsername(cupsd_job_t *job,
+			                    const char *username);
 extern void		cupsdStopAllJobs(cupsd_jobaction_t action,
 			                 int kill_delay);
 extern int		cupsdTimeoutJob(cupsd_job_t *job);
 extern void		cupsdUnloadCompletedJobs(void);
+extern void		cupsdUpdateJobCache(void);
+extern void		cupsdUpdateJobTimer(cupsd_job_t *job);
 extern void		cupsdUpdateJobs(void);
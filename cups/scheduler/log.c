@@ -51,6 +51,13 @@
 #define PWG_JobAccountingUserURI	"JAUU"
 
 
+/*
+ * Size of the error log queue used by the writer thread...
+ */
+
+#define CUPSD_LOG_QUEUE_SIZE		262144
+
+
 /*
  * Local globals...
  */
@@ -59,6 +66,18 @@ static _cups_mutex_t log_mutex = _CUPS_MUTEX_INITIALIZER;
 					/* Mutex for logging */
 static size_t	log_linesize = 0;	/* Size of line for output file */
 static char	*log_line = NULL;	/* Line for output file */
+static _cups_cond_t log_cond = _CUPS_COND_INITIALIZER;
+					/* Condition for error log queue */
+static _cups_thread_t log_thread;	/* Error log writer thread */
+static pid_t	log_pid = 0;		/* Process that started the thread */
+static int	log_active = 0,		/* Is the writer thread active? */
+		log_running = 0,	/* Should the writer thread keep running? */
+		log_busy = 0,		/* Is ErrorFile being written or rotated? */
+		log_rotate = 0,		/* Does the ErrorLog need to be rotated? */
+		log_dropped = 0;	/* Number of dropped log messages */
+static char	*log_queue = NULL,	/* Queued log lines */
+		*log_writebuf = NULL;	/* Lines being written by the thread */
+static size_t	log_queue_used = 0;	/* Bytes in queue */
 
 #ifdef HAVE_ASL_H
 static const int log_levels[] =		/* ASL levels... */
@@ -95,7 +114,14 @@ static const int log_levels[] =		/* SYSLOG levels... */
  * Local functions...
  */
 
+static void	*error_log_thread(void *data);
 static int	format_log_line(const char *message, va_list ap);
+static void	log_json_attr(cups_file_t *fp, const char *name, ipp_attribute_t *attr);
+static void	log_json_puts(cups_file_t *fp, const char *s);
+static void	log_json_time(cups_file_t *fp, struct timeval *t);
+static ipp_attribute_t *log_page_attr(cupsd_job_t *job, const char *name);
+static int	log_page_json(cupsd_job_t *job, const char *number, int copies);
+static void	queue_log_line(char level, const char *date, const char *message);
 
 
 /*
@@ -292,19 +318,48 @@ cupsdCheckLogFile(cups_file_t **lf,	/* IO - Log file */
 }
 
 
+/*
+ * 'cupsdFlushLogFiles()' - Write any buffered access and page log entries.
+ *
+ * Access and page log entries are buffered and written once per pass through
+ * the main loop instead of once per entry.
+ */
+
+void
+cupsdFlushLogFiles(void)
+{
+  if (AccessFile)
+    cupsFileFlush(AccessFile);
+
+  if (PageFile && PageFile != AccessFile)
+    cupsFileFlush(PageFile);
+}
+
+
 /*
  * 'cupsdGetDateTime()' - Returns a pointer to a date/time string.
+ *
+ * The date and time are only formatted once per second; when using
+ * microseconds the digits are updated in place.
  */
 
 char *					/* O - Date/time string */
 cupsdGetDateTime(struct timeval *t,	/* I - Time value or NULL for current */
                  cupsd_time_t   format)	/* I - Format to use */
 {
+  int			i,		/* Looping var */
+			usec;		/* Microseconds */
+  char			*ptr;		/* Pointer into string */
   struct timeval	curtime;	/* Current time value */
   struct tm		date;		/* Date/time value */
   static struct timeval	last_time = { 0, 0 };
 	    				/* Last time we formatted */
-  static char		s[1024];	/* Date/time string */
+  static int		last_format = -1;
+					/* Last format we used */
+  static size_t		datelen = 0;	/* Length of date and time */
+  static char		s[1024],	/* Date/time string */
+			datestr[64],	/* Date and time without zone */
+			zonestr[32];	/* Timezone offset */
   static const char * const months[12] =/* Months */
 		{
 		  "Jan",
@@ -332,10 +387,10 @@ cupsdGetDateTime(struct timeval *t,	/* I - Time value or NULL for current */
     t = &curtime;
   }
 
-  if (t->tv_sec != last_time.tv_sec ||
-      (LogTimeFormat == CUPSD_TIME_USECS && t->tv_usec != last_time.tv_usec))
+  if (t->tv_sec != last_time.tv_sec)
   {
-    last_time = *t;
+    last_time.tv_sec = t->tv_sec;
+    last_format      = -1;
 
    /*
     * Get the date and time from the UNIX time value, and then format it
@@ -353,24 +408,42 @@ cupsdGetDateTime(struct timeval *t,	/* I - Time value or NULL for current */
 
     localtime_r(&(t->tv_sec), &date);
 
-    if (format == CUPSD_TIME_STANDARD)
-      snprintf(s, sizeof(s), "[%02d/%s/%04d:%02d:%02d:%02d %+03ld%02ld]",
-	       date.tm_mday, months[date.tm_mon], 1900 + date.tm_year,
-	       date.tm_hour, date.tm_min, date.tm_sec,
+    snprintf(datestr, sizeof(datestr), "[%02d/%s/%04d:%02d:%02d:%02d",
+	     date.tm_mday, months[date.tm_mon], 1900 + date.tm_year,
+	     date.tm_hour, date.tm_min, date.tm_sec);
+    snprintf(zonestr, sizeof(zonestr), " %+03ld%02ld]",
 #ifdef HAVE_TM_GMTOFF
-	       date.tm_gmtoff / 3600, (date.tm_gmtoff / 60) % 60);
+	     date.tm_gmtoff / 3600, (date.tm_gmtoff / 60) % 60);
 #else
-	       timezone / 3600, (timezone / 60) % 60);
+	     timezone / 3600, (timezone / 60) % 60);
 #endif /* HAVE_TM_GMTOFF */
+
+    datelen = strlen(datestr);
+  }
+
+  if (format == CUPSD_TIME_USECS && last_format == CUPSD_TIME_USECS)
+  {
+   /*
+    * Same second, just update the microseconds...
+    */
+
+    if (t->tv_usec != last_time.tv_usec)
+    {
+      last_time.tv_usec = t->tv_usec;
+
+      for (i = 6, ptr = s + datelen + 7, usec = (int)t->tv_usec; i > 0; i --, usec /= 10)
+        *--ptr = (char)('0' + usec % 10);
+    }
+  }
+  else if (format != last_format)
+  {
+    last_format       = (int)format;
+    last_time.tv_usec = t->tv_usec;
+
+    if (format == CUPSD_TIME_STANDARD)
+      snprintf(s, sizeof(s), "%s%s", datestr, zonestr);
     else
-      snprintf(s, sizeof(s), "[%02d/%s/%04d:%02d:%02d:%02d.%06d %+03ld%02ld]",
-	       date.tm_mday, months[date.tm_mon], 1900 + date.tm_year,
-	       date.tm_hour, date.tm_min, date.tm_sec, (int)t->tv_usec,
-#ifdef HAVE_TM_GMTOFF
-	       date.tm_gmtoff / 3600, (date.tm_gmtoff / 60) % 60);
-#else
-	       timezone / 3600, (timezone / 60) % 60);
-#endif /* HAVE_TM_GMTOFF */
+      snprintf(s, sizeof(s), "%s.%06d%s", datestr, (int)t->tv_usec, zonestr);
   }
 
   return (s);
@@ -792,6 +865,9 @@ cupsdLogPage(cupsd_job_t *job,		/* I - Job being printed */
   copies = 1;
   sscanf(page, "%255s%d", number, &copies);
 
+  if (LogFileFormat == CUPSD_LOGFORMAT_JSON && strcmp(PageLog, "syslog"))
+    return (log_page_json(job, number, copies));
+
   for (format = PageLogFormat, bufptr = buffer; *format; format ++)
   {
     if (*format == '%')
@@ -847,27 +923,7 @@ cupsdLogPage(cupsd_job_t *job,		/* I - Job being printed */
 
 	      format = nameend;
 
-	      attr = ippFindAttribute(job->attrs, name, IPP_TAG_ZERO);
-	      if (!attr && !strcmp(name, "job-billing"))
-	      {
-	       /*
-	        * Handle alias "job-account-id" (which was standardized after
-		* "job-billing" was defined for CUPS...
-		*/
-
-	        attr = ippFindAttribute(job->attrs, "job-account-id", IPP_TAG_ZERO);
-	      }
-	      else if (!attr && !strcmp(name, "media"))
-	      {
-	       /*
-	        * Handle alias "media-col" which uses dimensions instead of
-		* names...
-		*/
-
-		attr = ippFindAttribute(job->attrs, "media-col/media-size", IPP_TAG_BEGIN_COLLECTION);
-	      }
-
-	      if (attr)
+	      if ((attr = log_page_attr(job, name)) != NULL)
 	      {
 	       /*
 	        * Add the attribute value...
@@ -1004,7 +1060,6 @@ cupsdLogPage(cupsd_job_t *job,		/* I - Job being printed */
   */
 
   cupsFilePrintf(PageFile, "%s\n", buffer);
-  cupsFileFlush(PageFile);
 
   return (1);
 }
@@ -1185,7 +1240,34 @@ cupsdLogRequest(cupsd_client_t *con,	/* I - Request to log */
     return (0);
 
  /*
-  * Write a log of the request in "common log format"...
+  * Write a log of the request as a JSON object...
+  */
+
+  if (LogFileFormat == CUPSD_LOGFORMAT_JSON)
+  {
+    log_json_time(AccessFile, &(con->start));
+
+    cupsFilePuts(AccessFile, ",\"host\":");
+    log_json_puts(AccessFile, con->http->hostname);
+    cupsFilePuts(AccessFile, ",\"user\":");
+    if (con->username[0])
+      log_json_puts(AccessFile, con->username);
+    else
+      cupsFilePuts(AccessFile, "null");
+    cupsFilePrintf(AccessFile, ",\"method\":\"%s\",\"uri\":", states[con->operation]);
+    log_json_puts(AccessFile, con->uri);
+    cupsFilePrintf(AccessFile, ",\"version\":\"%d.%d\",\"status\":%d,\"bytes\":" CUPS_LLFMT, con->http->version / 100, con->http->version % 100, code, CUPS_LLCAST con->bytes);
+    if (con->request)
+      cupsFilePrintf(AccessFile, ",\"operation\":\"%s\"", ippOpString(con->request->request.op.operation_id));
+    if (con->response)
+      cupsFilePrintf(AccessFile, ",\"status-code\":\"%s\"", ippErrorString(con->response->request.status.status_code));
+    cupsFilePuts(AccessFile, "}\n");
+
+    return (1);
+  }
+
+ /*
+  * Or in "common log format"...
   */
 
   cupsFilePrintf(AccessFile,
@@ -1203,12 +1285,127 @@ cupsdLogRequest(cupsd_client_t *con,	/* I - Request to log */
 		     ippErrorString(con->response->request.status.status_code) :
 		     "-");
 
-  cupsFileFlush(AccessFile);
-
   return (1);
 }
 
 
+/*
+ * 'cupsdStartLogThread()' - Start writing the ErrorLog from a separate thread.
+ *
+ * Once started, cupsdWriteErrorLog() only formats and queues each message;
+ * the writer thread writes the queued messages in batches.  When the queue is
+ * full the caller waits briefly for the writer thread, after which messages
+ * that do not fit are dropped and counted.  Logging to syslog or stderr
+ * (which may be shared with the other log files) stays synchronous.
+ *
+ * The ErrorLog is opened and rotated on the main thread since that may log
+ * messages or end the scheduler; the writer thread only writes to it.
+ */
+
+void
+cupsdStartLogThread(void)
+{
+  if (log_active || !ErrorLog || !strcmp(ErrorLog, "syslog") ||
+      !strcmp(ErrorLog, "stderr"))
+    return;
+
+ /*
+  * Allocate the queue buffers...
+  */
+
+  if (!log_queue && (log_queue = malloc(CUPSD_LOG_QUEUE_SIZE)) == NULL)
+    return;
+
+  if (!log_writebuf && (log_writebuf = malloc(CUPSD_LOG_QUEUE_SIZE)) == NULL)
+    return;
+
+ /*
+  * Open the log file...
+  */
+
+  if (!cupsdCheckLogFile(&ErrorFile, ErrorLog) || ErrorFile == LogStderr)
+    return;
+
+ /*
+  * Start the writer thread...
+  */
+
+  _cupsMutexLock(&log_mutex);
+
+  log_running = 1;
+  log_active  = 1;
+  log_busy    = 0;
+  log_rotate  = 0;
+
+  if ((log_thread = _cupsThreadCreate((_cups_thread_func_t)error_log_thread, NULL)) == 0)
+  {
+    log_running = 0;
+    log_active  = 0;
+
+    _cupsMutexUnlock(&log_mutex);
+
+    cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to create error log thread: %s", strerror(errno));
+    return;
+  }
+
+  _cupsMutexUnlock(&log_mutex);
+
+ /*
+  * Make sure queued messages are written when the scheduler exits...
+  */
+
+  if (!log_pid)
+    atexit(cupsdStopLogThread);
+
+  log_pid = getpid();
+}
+
+
+/*
+ * 'cupsdStopLogThread()' - Write any queued messages and stop the writer thread.
+ */
+
+void
+cupsdStopLogThread(void)
+{
+  int	dropped;			/* Number of dropped messages */
+
+
+ /*
+  * Only the scheduler process can stop the thread; child processes also run
+  * this function at exit...
+  */
+
+  if (log_pid != getpid())
+    return;
+
+  _cupsMutexLock(&log_mutex);
+
+  if (!log_active)
+  {
+    _cupsMutexUnlock(&log_mutex);
+    return;
+  }
+
+  log_running = 0;
+  _cupsCondBroadcast(&log_cond);
+
+  _cupsMutexUnlock(&log_mutex);
+
+  _cupsThreadWait(log_thread);
+
+ /*
+  * Report any messages that were dropped at the end...
+  */
+
+  if ((dropped = log_dropped) > 0)
+  {
+    log_dropped = 0;
+    cupsdLogMessage(CUPSD_LOG_WARN, "Dropped %d log messages.", dropped);
+  }
+}
+
+
 /*
  * 'cupsdWriteErrorLog()' - Write a line to the ErrorLog.
  */
@@ -1258,7 +1455,35 @@ cupsdWriteErrorLog(int        level,	/* I - Log level */
 
   _cupsMutexLock(&log_mutex);
 
-  if (!cupsdCheckLogFile(&ErrorFile, ErrorLog))
+  if (log_active)
+  {
+   /*
+    * Rotate the log file as needed once the writer thread is done with it,
+    * then queue the message for the writer thread...
+    */
+
+    if (log_rotate)
+    {
+      while (log_busy)
+        _cupsCondWait(&log_cond, &log_mutex, 0.0);
+
+      log_rotate = 0;
+      log_busy   = 1;
+
+      _cupsMutexUnlock(&log_mutex);
+
+      if (ErrorFile)
+        cupsdCheckLogFile(&ErrorFile, ErrorLog);
+
+      _cupsMutexLock(&log_mutex);
+
+      log_busy = 0;
+      _cupsCondBroadcast(&log_cond);
+    }
+
+    queue_log_line(levels[level], cupsdGetDateTime(NULL, LogTimeFormat), message);
+  }
+  else if (!cupsdCheckLogFile(&ErrorFile, ErrorLog))
   {
     ret = 0;
   }
@@ -1279,6 +1504,90 @@ cupsdWriteErrorLog(int        level,	/* I - Log level */
 }
 
 
+/*
+ * 'error_log_thread()' - Write queued messages to the ErrorLog.
+ */
+
+static void *				/* O - Exit status (unused) */
+error_log_thread(void *data)		/* I - Thread data (unused) */
+{
+  char		*buffer;		/* Lines to write */
+  size_t	bytes;			/* Number of bytes to write */
+  cups_file_t	*fp;			/* Log file */
+  int		rotate;			/* Rotate the log file? */
+
+
+  (void)data;
+
+  _cupsMutexLock(&log_mutex);
+
+  for (;;)
+  {
+    if (!log_queue_used)
+    {
+      if (!log_running)
+        break;
+
+      _cupsCondWait(&log_cond, &log_mutex, 0.0);
+      continue;
+    }
+    else if (log_busy)
+    {
+     /*
+      * Wait for the main thread to finish rotating the log file...
+      */
+
+      _cupsCondWait(&log_cond, &log_mutex, 0.0);
+      continue;
+    }
+
+   /*
+    * Swap buffers so that new messages can be queued while we write...
+    */
+
+    buffer         = log_queue;
+    bytes          = log_queue_used;
+    log_queue      = log_writebuf;
+    log_writebuf   = buffer;
+    log_queue_used = 0;
+    fp             = ErrorFile;
+    log_busy       = 1;
+
+    _cupsCondBroadcast(&log_cond);
+    _cupsMutexUnlock(&log_mutex);
+
+   /*
+    * Write the lines; the main thread opens and rotates the log file...
+    */
+
+    rotate = 0;
+
+    if (fp)
+    {
+      cupsFileWrite(fp, buffer, bytes);
+      cupsFileFlush(fp);
+
+      rotate = MaxLogSize > 0 && cupsFileTell(fp) > MaxLogSize &&
+               strncmp(ErrorLog, "/dev/", 5);
+    }
+
+    _cupsMutexLock(&log_mutex);
+
+    log_busy = 0;
+    if (rotate)
+      log_rotate = 1;
+
+    _cupsCondBroadcast(&log_cond);
+  }
+
+  log_active = 0;
+
+  _cupsMutexUnlock(&log_mutex);
+
+  return (NULL);
+}
+
+
 /*
  * 'format_log_line()' - Format a line for a log file.
  *
@@ -1341,3 +1650,338 @@ format_log_line(const char *message,	/* I - Printf-style format string */
 
   return (1);
 }
+
+
+/*
+ * 'log_json_attr()' - Write an IPP attribute as a JSON member.
+ */
+
+static void
+log_json_attr(cups_file_t     *fp,	/* I - Log file */
+              const char      *name,	/* I - Member name */
+              ipp_attribute_t *attr)	/* I - Attribute or NULL */
+{
+  int	i;				/* Looping var */
+
+
+  cupsFilePutChar(fp, ',');
+  log_json_puts(fp, name);
+  cupsFilePutChar(fp, ':');
+
+  if (!attr)
+  {
+    cupsFilePuts(fp, "null");
+    return;
+  }
+
+  if (attr->num_values > 1)
+    cupsFilePutChar(fp, '[');
+
+  for (i = 0; i < attr->num_values; i ++)
+  {
+    if (i)
+      cupsFilePutChar(fp, ',');
+
+    switch (attr->value_tag)
+    {
+      case IPP_TAG_INTEGER :
+      case IPP_TAG_ENUM :
+          cupsFilePrintf(fp, "%d", attr->values[i].integer);
+	  break;
+
+      case IPP_TAG_BOOLEAN :
+          cupsFilePuts(fp, attr->values[i].boolean ? "true" : "false");
+	  break;
+
+      case IPP_TAG_TEXTLANG :
+      case IPP_TAG_NAMELANG :
+      case IPP_TAG_TEXT :
+      case IPP_TAG_NAME :
+      case IPP_TAG_KEYWORD :
+      case IPP_TAG_URI :
+      case IPP_TAG_URISCHEME :
+      case IPP_TAG_CHARSET :
+      case IPP_TAG_LANGUAGE :
+      case IPP_TAG_MIMETYPE :
+          log_json_puts(fp, attr->values[i].string.text);
+	  break;
+
+      case IPP_TAG_BEGIN_COLLECTION :
+          if (!strcmp(attr->name, "media-size"))
+	  {
+	    ipp_attribute_t *x_dimension = ippFindAttribute(attr->values[i].collection, "x-dimension", IPP_TAG_INTEGER);
+	    ipp_attribute_t *y_dimension = ippFindAttribute(attr->values[i].collection, "y-dimension", IPP_TAG_INTEGER);
+					/* Media dimensions */
+	    pwg_media_t	*pwg;		/* PWG media name */
+
+	    if (x_dimension && y_dimension && (pwg = pwgMediaForSize(ippGetInteger(x_dimension, 0), ippGetInteger(y_dimension, 0))) != NULL)
+	    {
+	      log_json_puts(fp, pwg->pwg);
+	      break;
+	    }
+	  }
+
+	  /* fall through */
+
+      default :
+          cupsFilePuts(fp, "null");
+	  break;
+    }
+  }
+
+  if (attr->num_values > 1)
+    cupsFilePutChar(fp, ']');
+}
+
+
+/*
+ * 'log_json_puts()' - Write a quoted JSON string.
+ */
+
+static void
+log_json_puts(cups_file_t *fp,		/* I - Log file */
+              const char  *s)		/* I - String */
+{
+  const char	*start;			/* Start of unquoted characters */
+
+
+  cupsFilePutChar(fp, '\"');
+
+  for (start = s; *s; s ++)
+  {
+    if (*s == '\"' || *s == '\\' || (*s & 255) < ' ')
+    {
+      if (s > start)
+        cupsFileWrite(fp, start, (size_t)(s - start));
+
+      if (*s == '\"' || *s == '\\')
+      {
+        cupsFilePutChar(fp, '\\');
+        cupsFilePutChar(fp, *s);
+      }
+      else
+        cupsFilePrintf(fp, "\\u%04x", *s & 255);
+
+      start = s + 1;
+    }
+  }
+
+  if (s > start)
+    cupsFileWrite(fp, start, (size_t)(s - start));
+
+  cupsFilePutChar(fp, '\"');
+}
+
+
+/*
+ * 'log_json_time()' - Start a JSON log object with the "time" member.
+ *
+ * The time is written as UNIX time, with microseconds when LogTimeFormat is
+ * "usecs".
+ */
+
+static void
+log_json_time(cups_file_t    *fp,	/* I - Log file */
+              struct timeval *t)	/* I - Time */
+{
+  if (LogTimeFormat == CUPSD_TIME_USECS)
+    cupsFilePrintf(fp, "{\"time\":%ld.%06d", (long)t->tv_sec, (int)t->tv_usec);
+  else
+    cupsFilePrintf(fp, "{\"time\":%ld", (long)t->tv_sec);
+}
+
+
+/*
+ * 'log_page_attr()' - Find a job attribute for the page log.
+ */
+
+static ipp_attribute_t *		/* O - Attribute or NULL */
+log_page_attr(cupsd_job_t *job,		/* I - Job */
+              const char  *name)	/* I - Attribute name */
+{
+  ipp_attribute_t	*attr;		/* Attribute */
+
+
+  attr = ippFindAttribute(job->attrs, name, IPP_TAG_ZERO);
+  if (!attr && !strcmp(name, "job-billing"))
+  {
+   /*
+    * Handle alias "job-account-id" (which was standardized after
+    * "job-billing" was defined for CUPS...
+    */
+
+    attr = ippFindAttribute(job->attrs, "job-account-id", IPP_TAG_ZERO);
+  }
+  else if (!attr && !strcmp(name, "media"))
+  {
+   /*
+    * Handle alias "media-col" which uses dimensions instead of
+    * names...
+    */
+
+    attr = ippFindAttribute(job->attrs, "media-col/media-size", IPP_TAG_BEGIN_COLLECTION);
+  }
+
+  return (attr);
+}
+
+
+/*
+ * 'log_page_json()' - Log a page to the page log file as a JSON object.
+ *
+ * The members are the items from PageLogFormat, in the same order; literal
+ * text is ignored.
+ */
+
+static int				/* O - 1 on success, 0 on error */
+log_page_json(cupsd_job_t *job,		/* I - Job being printed */
+              const char  *number,	/* I - Page number */
+              int         copies)	/* I - Number of copies */
+{
+  const char		*format,	/* Pointer into PageLogFormat */
+			*nameend;	/* End of attribute name */
+  char			name[256];	/* Attribute name */
+  struct timeval	curtime;	/* Current time */
+
+
+  if (!cupsdCheckLogFile(&PageFile, PageLog))
+    return (0);
+
+  gettimeofday(&curtime, NULL);
+  log_json_time(PageFile, &curtime);
+
+  for (format = PageLogFormat; *format; format ++)
+  {
+    if (*format != '%')
+      continue;
+
+    switch (*++format)
+    {
+      case '\0' :
+          format --;
+	  break;
+
+      case 'p' :			/* Printer name */
+          cupsFilePuts(PageFile, ",\"printer\":");
+	  log_json_puts(PageFile, job->dest);
+	  break;
+
+      case 'j' :			/* Job ID */
+          cupsFilePrintf(PageFile, ",\"job-id\":%d", job->id);
+	  break;
+
+      case 'u' :			/* Username */
+          cupsFilePuts(PageFile, ",\"user\":");
+	  if (job->username)
+	    log_json_puts(PageFile, job->username);
+	  else
+	    cupsFilePuts(PageFile, "null");
+	  break;
+
+      case 'P' :			/* Page number */
+          cupsFilePuts(PageFile, ",\"page\":");
+	  if (number[0] && !number[strspn(number, "0123456789")])
+	    cupsFilePuts(PageFile, number);
+	  else
+	    log_json_puts(PageFile, number);
+	  break;
+
+      case 'C' :			/* Number of copies */
+          cupsFilePrintf(PageFile, ",\"copies\":%d", copies);
+	  break;
+
+      case '{' :			/* {attribute} */
+	  if ((nameend = strchr(format, '}')) != NULL && (size_t)(nameend - format - 2) < (sizeof(name) - 1))
+	  {
+	    memcpy(name, format + 1, (size_t)(nameend - format - 1));
+	    name[nameend - format - 1] = '\0';
+
+	    format = nameend;
+
+	    log_json_attr(PageFile, name, log_page_attr(job, name));
+	  }
+	  break;
+
+      default :				/* "%%", "%T", and unknown */
+          break;
+    }
+  }
+
+  cupsFilePuts(PageFile, "}\n");
+
+  return (1);
+}
+
+
+/*
+ * 'queue_log_line()' - Queue a line for the writer thread.
+ *
+ * The log mutex must be held by the caller.
+ */
+
+static void
+queue_log_line(char       level,	/* I - Log level character */
+               const char *date,	/* I - Date/time string */
+               const char *message)	/* I - Message string */
+{
+  char		temp[256],		/* Dropped message */
+		*ptr;			/* Pointer into queue */
+  size_t	datelen = strlen(date),	/* Length of date/time */
+		msglen = strlen(message),
+					/* Length of message */
+		bytes;			/* Bytes needed */
+
+
+ /*
+  * Report dropped messages first...
+  */
+
+  if (log_dropped)
+  {
+    snprintf(temp, sizeof(temp), "W %s Dropped %d log messages.\n", date, log_dropped);
+    bytes = strlen(temp);
+
+    if ((log_queue_used + bytes) <= CUPSD_LOG_QUEUE_SIZE)
+    {
+      memcpy(log_queue + log_queue_used, temp, bytes);
+      log_queue_used += bytes;
+      log_dropped    = 0;
+    }
+  }
+
+ /*
+  * Then copy the message as "L DATE MESSAGE\n"...
+  */
+
+  bytes = datelen + msglen + 4;
+
+  if (!log_dropped && (log_queue_used + bytes) > CUPSD_LOG_QUEUE_SIZE && bytes <= CUPSD_LOG_QUEUE_SIZE)
+  {
+   /*
+    * Give the writer thread a chance to catch up before dropping anything...
+    */
+
+    _cupsCondBroadcast(&log_cond);
+    _cupsCondWait(&log_cond, &log_mutex, 0.1);
+  }
+
+  if (log_dropped || (log_queue_used + bytes) > CUPSD_LOG_QUEUE_SIZE)
+  {
+    log_dropped ++;
+    return;
+  }
+
+  ptr    = log_queue + log_queue_used;
+  *ptr++ = level;
+  *ptr++ = ' ';
+  memcpy(ptr, date, datelen);
+  ptr    += datelen;
+  *ptr++ = ' ';
+  memcpy(ptr, message, msglen);
+  ptr    += msglen;
+  *ptr   = '\n';
+
+  log_queue_used += bytes;
+
+  _cupsCondBroadcast(&log_cond);
+}
@@ -800,6 +800,18 @@ main(int  argc,				/* I - Number of command-line args */
       }
     }
 
+   /*
+    * Answer any Get-Notifications requests that were waiting for events...
+    */
+
+    cupsdUpdateNotifyWaits();
+
+   /*
+    * Write any access and page log entries from the last pass...
+    */
+
+    cupsdFlushLogFiles();
+
    /*
     * Check for available input or ready output.  If cupsdDoSelect()
     * returns 0 or -1, something bad happened and we should exit
@@ -1061,7 +1073,9 @@ main(int  argc,				/* I - Number of command-line args */
     {
       size_t		string_count,	/* String count */
 			alloc_bytes,	/* Allocated string bytes */
-			total_bytes;	/* Total string bytes */
+			total_bytes,	/* Total string bytes */
+			lock_count,	/* String pool locks */
+			lock_waits;	/* String pool lock waits */
 #ifdef HAVE_MALLINFO
       struct mallinfo	mem;		/* Malloc information */
 
@@ -1094,6 +1108,14 @@ main(int  argc,				/* I - Number of command-line args */
                       "Report: stringpool-total-bytes=" CUPS_LLFMT,
 		      CUPS_LLCAST total_bytes);
 
+      lock_count = _cupsStrLockStatistics(&lock_waits);
+      cupsdLogMessage(CUPSD_LOG_DEBUG,
+                      "Report: stringpool-lock-count=" CUPS_LLFMT,
+		      CUPS_LLCAST lock_count);
+      cupsdLogMessage(CUPSD_LOG_DEBUG,
+                      "Report: stringpool-lock-waits=" CUPS_LLFMT,
+		      CUPS_LLCAST lock_waits);
+
       report_time = current_time;
     }
 
@@ -1548,7 +1570,7 @@ process_children(void)
 	  for (i = 0; job->filters[i] < 0; i++);
 
 	  if (!job->filters[i] && job->backend <= 0)
-	    cupsArrayRemove(ActiveJobs, job);
+	    cupsdSetJobActive(job, 0);
 	}
 	else if (job->current_file < job->num_files && job->printer)
 	{
@@ -1702,12 +1724,20 @@ select_timeout(int fds)			/* I - Number of descriptors returned */
   for (con = (cupsd_client_t *)cupsArrayFirst(Clients);
        con;
        con = (cupsd_client_t *)cupsArrayNext(Clients))
+  {
     if ((httpGetActivity(con->http) + Timeout) < timeout)
     {
       timeout = httpGetActivity(con->http) + Timeout;
       why     = "timeout a client connection";
     }
 
+    if (con->notify_wait && con->notify_wait < timeout)
+    {
+      timeout = con->notify_wait;
+      why     = "answer a waiting Get-Notifications request";
+    }
+  }
+
  /*
   * Write out changes to configuration and state files...
   */
@@ -1722,34 +1752,23 @@ select_timeout(int fds)			/* I - Number of descriptors returned */
   * Check for any job activity...
   */
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs);
-       job;
-       job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
+  if ((job = (cupsd_job_t *)cupsArrayFirst(JobTimers)) != NULL &&
+      job->timer_time < timeout)
   {
-    if (job->cancel_time && job->cancel_time < timeout)
-    {
-      timeout = job->cancel_time;
-      why     = "cancel stuck jobs";
-    }
+    timeout = job->timer_time;
 
-    if (job->kill_time && job->kill_time < timeout)
-    {
-      timeout = job->kill_time;
-      why     = "kill unresponsive jobs";
-    }
-
-    if (job->state_value == IPP_JOB_HELD && job->hold_until < timeout)
-    {
-      timeout = job->hold_until;
-      why     = "release held jobs";
-    }
+    if (job->timer_time == job->kill_time)
+      why = "kill unresponsive jobs";
+    else if (job->timer_time == job->cancel_time)
+      why = "cancel stuck jobs";
+    else
+      why = "release held jobs";
+  }
 
-    if (job->state_value == IPP_JOB_PENDING && timeout > (now + 10))
-    {
-      timeout = now + 10;
-      why     = "start pending jobs";
-      break;
-    }
+  if (NumPendingJobs > 0 && timeout > (now + 10))
+  {
+    timeout = now + 10;
+    why     = "start pending jobs";
   }
 
  /*
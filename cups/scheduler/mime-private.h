@@ -26,6 +26,7 @@ extern "C" {
  * Prototypes...
  */
 
+extern void	_mimeClearFilterCache(mime_t *mime);
 extern void	_mimeError(mime_t *mime, const char *format, ...) _CUPS_FORMAT(2, 3);
 
 
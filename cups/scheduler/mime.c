@@ -91,6 +91,8 @@ mimeDelete(mime_t *mime)		/* I - MIME database */
   cupsArrayDelete(mime->types);
   cupsArrayDelete(mime->filters);
   cupsArrayDelete(mime->srcs);
+  cupsArrayDelete(mime->ftypes);
+  _mimeClearFilterCache(mime);
   free(mime);
 }
 
@@ -134,6 +136,8 @@ mimeDeleteFilter(mime_t        *mime,	/* I - MIME database */
     cupsArrayDelete(mime->srcs);
     mime->srcs = NULL;
   }
+
+  _mimeClearFilterCache(mime);
 }
 
 
@@ -160,6 +164,19 @@ mimeDeleteType(mime_t      *mime,	/* I - MIME database */
 
   mime_delete_rules(mt->rules);
   free(mt);
+
+ /*
+  * Deleting a type invalidates the detection order used by mimeFileType()...
+  */
+
+  if (mime->ftypes)
+  {
+    DEBUG_puts("1mimeDeleteType: Deleting type detection cache.");
+    cupsArrayDelete(mime->ftypes);
+    mime->ftypes = NULL;
+  }
+
+  _mimeClearFilterCache(mime);
 }
 
 
@@ -106,6 +106,9 @@ typedef struct _mime_s			/**** MIME Database ****/
   cups_array_t		*srcs;		/* Filters sorted by source type */
   mime_error_cb_t	error_cb;	/* Error message callback */
   void			*error_ctx;	/* Pointer for callback */
+  cups_array_t		*ftypes;	/* Types with rules sorted by priority */
+  cups_array_t		*fcache;	/* Cached filter chains */
+  cups_array_t		*fsizes;	/* Filters with a maximum file size */
 } mime_t;
 
 
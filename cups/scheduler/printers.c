@@ -46,6 +46,8 @@ static void	delete_printer_filters(cupsd_printer_t *p);
 static void	dirty_printer(cupsd_printer_t *p);
 static void	load_ppd(cupsd_printer_t *p);
 static ipp_t	*new_media_col(pwg_size_t *size);
+static ssize_t	write_cached_attr(cupsd_printer_t *p, ipp_uchar_t *buffer,
+		                  size_t bytes);
 static void	write_xml_string(cups_file_t *fp, const char *s);
 
 
@@ -125,6 +127,155 @@ cupsdAddPrinter(const char *name)	/* I - Name of printer */
 }
 
 
+/*
+ * 'cupsdCachePrinterAttrs()' - Encode the static attributes of a printer.
+ *
+ * The printer, PPD, and common attributes are encoded once and then copied
+ * into Get-Printer-Attributes and CUPS-Get-Printers responses until they
+ * change.
+ */
+
+int					/* O - 1 on success, 0 on error */
+cupsdCachePrinterAttrs(
+    cupsd_printer_t *p)			/* I - Printer */
+{
+  int			i;		/* Looping var */
+  ipp_t			*sources[3],	/* Attributes to cache */
+			*temp;		/* Message for encoding */
+  ipp_attribute_t	*attr,		/* Current attribute */
+			*tattr;		/* Copy of current attribute */
+  cupsd_cattr_t		*cattr;		/* Cached attribute */
+  int			alloc_cattrs;	/* Allocated cached attributes */
+  size_t		alloc_length,	/* Allocated encoded data */
+			length,		/* Length of encoded message */
+			offset;		/* Offset of encoded attribute */
+
+
+  if (p->cattr_data)
+    return (1);
+
+  temp         = NULL;
+  alloc_cattrs = 0;
+  alloc_length = 65536;
+
+  if ((p->cattr_data = malloc(alloc_length)) == NULL || (temp = ippNew()) == NULL)
+    goto error;
+
+  p->cattr_length = 0;
+
+  sources[0] = p->attrs;
+  sources[1] = p->ppd_attrs;
+  sources[2] = CommonData;
+
+  for (i = 0; i < 3; i ++)
+  {
+    if (!sources[i])
+      continue;
+
+    for (attr = sources[i]->attrs; attr; attr = attr->next)
+    {
+      if (!attr->name)
+        continue;
+
+     /*
+      * Encode the attribute by itself and then strip the message header, group
+      * tag, and end tag...
+      */
+
+      if ((tattr = ippCopyAttribute(temp, attr, 1)) == NULL)
+        goto error;
+
+      length = ippLength(temp);
+
+      if ((p->cattr_length + length) > alloc_length)
+      {
+        unsigned char *data;		/* New encoded data */
+
+        while ((p->cattr_length + length) > alloc_length)
+          alloc_length *= 2;
+
+        if ((data = realloc(p->cattr_data, alloc_length)) == NULL)
+          goto error;
+
+        p->cattr_data = data;
+      }
+
+      if (p->num_cattrs >= alloc_cattrs)
+      {
+        if ((cattr = realloc(p->cattrs, (size_t)(alloc_cattrs + 64) * sizeof(cupsd_cattr_t))) == NULL)
+          goto error;
+
+        p->cattrs    = cattr;
+        alloc_cattrs += 64;
+      }
+
+      offset = p->cattr_length;
+
+      ippSetState(temp, IPP_STATE_IDLE);
+      if (ippWriteIO(p, (ipp_iocb_t)write_cached_attr, 1, NULL, temp) != IPP_STATE_DATA || p->cattr_length != (offset + length))
+        goto error;
+
+      length -= 10;
+      memmove(p->cattr_data + offset, p->cattr_data + offset + 9, length);
+      p->cattr_length = offset + length;
+
+      cattr = p->cattrs + p->num_cattrs;
+      p->num_cattrs ++;
+
+      cattr->name      = _cupsStrAlloc(attr->name);
+      cattr->value_tag = attr->value_tag & IPP_TAG_CUPS_MASK;
+      cattr->offset    = offset;
+      cattr->length    = length;
+
+      ippDeleteAttribute(temp, tattr);
+    }
+  }
+
+  ippDelete(temp);
+
+  cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdCachePrinterAttrs: Encoded %d attributes (" CUPS_LLFMT " bytes) for %s.", p->num_cattrs, CUPS_LLCAST p->cattr_length, p->name);
+
+  return (1);
+
+ /*
+  * If we get here, something went wrong...
+  */
+
+  error:
+
+  cupsdLogMessage(CUPSD_LOG_ERROR, "Unable to cache attributes for %s.", p->name);
+
+  ippDelete(temp);
+  cupsdClearPrinterCache(p);
+
+  return (0);
+}
+
+
+/*
+ * 'cupsdClearPrinterCache()' - Clear the cached attributes of a printer.
+ */
+
+void
+cupsdClearPrinterCache(
+    cupsd_printer_t *p)			/* I - Printer */
+{
+  int		i;			/* Looping var */
+
+
+  for (i = 0; i < p->num_cattrs; i ++)
+    _cupsStrFree(p->cattrs[i].name);
+
+  free(p->cattrs);
+  free(p->cattr_data);
+
+  p->num_cattrs   = 0;
+  p->cattrs       = NULL;
+  p->cattr_data   = NULL;
+  p->cattr_length = 0;
+}
+
+
 /*
  * 'cupsdCreateCommonData()' - Create the common printer data.
  */
@@ -134,6 +285,7 @@ cupsdCreateCommonData(void)
 {
   int			i;		/* Looping var */
   ipp_attribute_t	*attr;		/* Attribute data */
+  cupsd_printer_t	*printer;	/* Current printer */
   cups_dir_t		*dir;		/* Notifier directory */
   cups_dentry_t		*dent;		/* Notifier directory entry */
   cups_array_t		*notifiers;	/* Notifier array */
@@ -393,6 +545,15 @@ cupsdCreateCommonData(void)
 
   CommonData = ippNew();
 
+  cupsArraySave(Printers);
+
+  for (printer = (cupsd_printer_t *)cupsArrayFirst(Printers);
+       printer;
+       printer = (cupsd_printer_t *)cupsArrayNext(Printers))
+    cupsdClearPrinterCache(printer);
+
+  cupsArrayRestore(Printers);
+
  /*
   * Get the maximum spool size based on the size of the filesystem used for
   * the RequestRoot directory.  If the host OS doesn't support the statfs call
@@ -822,6 +983,8 @@ cupsdDeletePrinter(
   ippDelete(p->attrs);
   ippDelete(p->ppd_attrs);
 
+  cupsdClearPrinterCache(p);
+
   mimeDeleteType(MimeDatabase, p->filetype);
   mimeDeleteType(MimeDatabase, p->prefiltertype);
 
@@ -2028,6 +2191,8 @@ cupsdSetPrinterAttr(
     return;
   }
 
+  cupsdClearPrinterCache(p);
+
  /*
   * Count the number of values...
   */
@@ -2263,6 +2428,8 @@ cupsdSetPrinterAttrs(cupsd_printer_t *p)/* I - Printer to setup */
 
   _cupsRWLockWrite(&p->lock);
 
+  cupsdClearPrinterCache(p);
+
  /*
   * Clear out old filters, if any...
   */
@@ -2752,6 +2919,7 @@ cupsdSetPrinterState(
     int             update)		/* I - Update printers.conf? */
 {
   cupsd_job_t	*job;			/* Current job */
+  cupsd_jobindex_t *index;		/* Job index for printer */
   ipp_pstate_t	old_state;		/* Old printer state */
   static const char * const printer_states[] =
   {					/* State strings */
@@ -2792,13 +2960,13 @@ cupsdSetPrinterState(
   else
     cupsdSetPrinterReasons(p, "-paused");
 
-  if (old_state != s)
+  if (old_state != s &&
+      (index = cupsdFindJobIndex(JobsByDest, p->name)) != NULL)
   {
-    for (job = (cupsd_job_t *)cupsArrayFirst(ActiveJobs);
+    for (job = (cupsd_job_t *)cupsArrayFirst(index->active);
 	 job;
-	 job = (cupsd_job_t *)cupsArrayNext(ActiveJobs))
-      if (job->reasons && job->state_value == IPP_JOB_PENDING &&
-	  !_cups_strcasecmp(job->dest, p->name))
+	 job = (cupsd_job_t *)cupsArrayNext(index->active))
+      if (job->reasons && job->state_value == IPP_JOB_PENDING)
 	ippSetString(job->attrs, &job->reasons, 0,
 		     s == IPP_PRINTER_STOPPED ? "printer-stopped" : "none");
   }
@@ -5067,6 +5235,25 @@ new_media_col(pwg_size_t *size)		/* I - media-size/margin values */
 }
 
 
+/*
+ * 'write_cached_attr()' - Write encoded attribute data to the cache.
+ *
+ * The caller has already made room for the data.
+ */
+
+static ssize_t				/* O - Number of bytes written */
+write_cached_attr(
+    cupsd_printer_t *p,			/* I - Printer */
+    ipp_uchar_t     *buffer,		/* I - Encoded data */
+    size_t          bytes)		/* I - Number of bytes */
+{
+  memcpy(p->cattr_data + p->cattr_length, buffer, bytes);
+  p->cattr_length += bytes;
+
+  return ((ssize_t)bytes);
+}
+
+
 /*
  * 'write_xml_string()' - Write a string with XML escaping.
  */
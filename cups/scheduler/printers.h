@@ -31,6 +31,19 @@ typedef struct
 } cupsd_quota_t;
 
 
+/*
+ * Cached (encoded) printer attributes...
+ */
+
+typedef struct
+{
+  char		*name;			/* Attribute name */
+  ipp_tag_t	value_tag;		/* Value tag */
+  size_t	offset,			/* Offset of encoded attribute */
+		length;			/* Length of encoded attribute */
+} cupsd_cattr_t;
+
+
 /*
  * DNS-SD types to make the code cleaner/clearer...
  */
@@ -112,6 +125,10 @@ struct cupsd_printer_s
 		*alert_description;	/* PSX printer-alert-description value */
   time_t	marker_time;		/* Last time marker attributes were updated */
   _ppd_cache_t	*pc;			/* PPD cache and mapping data */
+  int		num_cattrs;		/* Number of cached attributes */
+  cupsd_cattr_t	*cattrs;		/* Cached attributes */
+  unsigned char	*cattr_data;		/* Encoded attribute data */
+  size_t	cattr_length;		/* Length of encoded attribute data */
 
 #if defined(HAVE_DNSSD) || defined(HAVE_AVAHI)
   char		*reg_name,		/* Name used for service registration */
@@ -153,6 +170,8 @@ VAR cupsd_policy_t	*DefaultPolicyPtr
  */
 
 extern cupsd_printer_t	*cupsdAddPrinter(const char *name);
+extern int		cupsdCachePrinterAttrs(cupsd_printer_t *p);
+extern void		cupsdClearPrinterCache(cupsd_printer_t *p);
 extern void		cupsdCreateCommonData(void);
 extern void		cupsdDeleteAllPrinters(void);
 extern int		cupsdDeletePrinter(cupsd_printer_t *p, int update);
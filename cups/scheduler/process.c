@@ -483,6 +483,7 @@ cupsdStartProcess(
   posix_spawn_file_actions_t actions;	/* Spawn file actions */
   posix_spawnattr_t attrs;		/* Spawn attributes */
   sigset_t	defsignals;		/* Default signals */
+  mode_t	mask = 0;		/* Saved umask */
 #elif defined(HAVE_SIGACTION) && !defined(HAVE_SIGSET)
   struct sigaction action;		/* POSIX signal handler */
 #endif /* USE_POSIX_SPAWN */
@@ -546,12 +547,17 @@ cupsdStartProcess(
 #endif	/* __APPLE__ */
 
  /*
-  * Use helper program when we have a sandbox profile...
+  * Use helper program when we have a sandbox profile or, with posix_spawn,
+  * when the child needs a different user, group, or nice value.  When running
+  * as an unprivileged user with the default nice value the helper would not
+  * change anything, so save the extra exec and run the command directly...
   */
 
-#if !USE_POSIX_SPAWN
+#if USE_POSIX_SPAWN
+  if (profile || !RunUser || FilterNice)
+#else
   if (profile)
-#endif /* !USE_POSIX_SPAWN */
+#endif /* USE_POSIX_SPAWN */
   {
     snprintf(cups_exec, sizeof(cups_exec), "%s/daemon/cups-exec", ServerBin);
     snprintf(user_str, sizeof(user_str), "%d", user);
@@ -635,6 +641,22 @@ cupsdStartProcess(
   if (sidefd != 4 && sidefd >= 0)
     posix_spawn_file_actions_adddup2(&actions, sidefd, 4);
 
+  if (exec_path == command)
+  {
+   /*
+    * Do what cups-exec would do: make the side and back channel FDs
+    * non-blocking and restrict permissions on created files...
+    */
+
+    if (backfd >= 0)
+      fcntl(backfd, F_SETFL, O_NDELAY);
+
+    if (sidefd >= 0)
+      fcntl(sidefd, F_SETFL, O_NDELAY);
+
+    mask = umask(077);
+  }
+
   cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdStartProcess: Calling posix_spawn.");
 
   if (posix_spawn(pid, exec_path, &actions, &attrs, argv, envp ? envp : environ))
@@ -646,6 +668,9 @@ cupsdStartProcess(
   else
     cupsdLogMessage(CUPSD_LOG_DEBUG2, "cupsdStartProcess: pid=%d", (int)*pid);
 
+  if (exec_path == command)
+    umask(mask);
+
   posix_spawn_file_actions_destroy(&actions);
   posix_spawnattr_destroy(&attrs);
 
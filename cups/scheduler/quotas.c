@@ -88,8 +88,12 @@ cupsdUpdateQuota(
 {
   cupsd_quota_t		*q;		/* Quota data */
   cupsd_job_t		*job;		/* Current job */
-  time_t		curtime;	/* Current time */
+  time_t		curtime,	/* Current time */
+			jobtime;	/* Time for job */
+  int			jobpages,	/* Pages for job */
+			jobk;		/* Kilobytes for job */
   ipp_attribute_t	*attr;		/* Job attribute */
+  cupsd_jobindex_t	*index;		/* Jobs for printer */
 
 
   if (!p || !username)
@@ -124,34 +128,69 @@ cupsdUpdateQuota(
   q->page_count  = 0;
   q->k_count     = 0;
 
-  for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
+  if ((index = cupsdFindJobIndex(JobsByDest, p->name)) == NULL)
+    return (q);
+
+  for (job = (cupsd_job_t *)cupsArrayFirst(index->jobs);
        job;
-       job = (cupsd_job_t *)cupsArrayNext(Jobs))
+       job = (cupsd_job_t *)cupsArrayNext(index->jobs))
   {
    /*
-    * We only care about the current printer/class and user...
+    * We only care about the current user...
     */
 
-    if (_cups_strcasecmp(job->dest, p->name) != 0 ||
-        _cups_strcasecmp(job->username, q->username) != 0)
+    if (_cups_strcasecmp(job->username, q->username) != 0)
       continue;
 
-   /*
-    * Make sure attributes are loaded; we always call cupsdLoadJob() to ensure
-    * the access_time member is updated so the job isn't unloaded right away...
-    */
+    if (job->attrs)
+    {
+     /*
+      * Use the job attributes; we call cupsdLoadJob() to ensure the
+      * access_time member is updated so the job isn't unloaded right away...
+      */
 
-    if (!cupsdLoadJob(job))
-      continue;
+      cupsdLoadJob(job);
+
+      if ((attr = ippFindAttribute(job->attrs, "time-at-completed",
+				   IPP_TAG_INTEGER)) == NULL)
+	if ((attr = ippFindAttribute(job->attrs, "time-at-processing",
+				     IPP_TAG_INTEGER)) == NULL)
+	  attr = ippFindAttribute(job->attrs, "time-at-creation",
+				  IPP_TAG_INTEGER);
+
+      jobtime = attr ? attr->values[0].integer : job->creation_time;
 
-    if ((attr = ippFindAttribute(job->attrs, "time-at-completion",
-                                 IPP_TAG_INTEGER)) == NULL)
-      if ((attr = ippFindAttribute(job->attrs, "time-at-processing",
-                                   IPP_TAG_INTEGER)) == NULL)
-        attr = ippFindAttribute(job->attrs, "time-at-creation",
-                                IPP_TAG_INTEGER);
+      if ((attr = ippFindAttribute(job->attrs, "job-media-sheets-completed",
+				   IPP_TAG_INTEGER)) != NULL)
+	jobpages = attr->values[0].integer;
+      else
+        jobpages = 0;
 
-    if (attr->values[0].integer < curtime)
+      if ((attr = ippFindAttribute(job->attrs, "job-k-octets",
+				   IPP_TAG_INTEGER)) != NULL)
+	jobk = attr->values[0].integer;
+      else
+        jobk = 0;
+    }
+    else
+    {
+     /*
+      * Use the cached summary for unloaded jobs rather than reading the job
+      * control file...
+      */
+
+      if (job->completed_time)
+        jobtime = job->completed_time;
+      else if (job->processing_time)
+        jobtime = job->processing_time;
+      else
+        jobtime = job->creation_time;
+
+      jobpages = job->num_sheets;
+      jobk     = job->koctets;
+    }
+
+    if (jobtime < curtime)
     {
      /*
       * This job is too old to count towards the quota, ignore it...
@@ -164,15 +203,10 @@ cupsdUpdateQuota(
     }
 
     if (q->next_update == 0)
-      q->next_update = attr->values[0].integer + p->quota_period;
-
-    if ((attr = ippFindAttribute(job->attrs, "job-media-sheets-completed",
-                                 IPP_TAG_INTEGER)) != NULL)
-      q->page_count += attr->values[0].integer;
+      q->next_update = jobtime + p->quota_period;
 
-    if ((attr = ippFindAttribute(job->attrs, "job-k-octets",
-                                 IPP_TAG_INTEGER)) != NULL)
-      q->k_count += attr->values[0].integer;
+    q->page_count += jobpages;
+    q->k_count    += jobk;
   }
 
   return (q);
@@ -33,6 +33,12 @@ static int		started = 0;	/* Did we start the server already? */
 void
 cupsdStartServer(void)
 {
+ /*
+  * Start writing the error log from a separate thread...
+  */
+
+  cupsdStartLogThread();
+
  /*
   * Create the default security profile...
   */
@@ -138,9 +144,11 @@ cupsdStopServer(void)
   }
 
  /*
-  * Close all log files...
+  * Write any queued log messages and close all log files...
   */
 
+  cupsdStopLogThread();
+
   if (AccessFile != NULL)
   {
     if (AccessFile != LogStderr)
@@ -15,6 +15,15 @@
 #include <stdarg.h>
 
 
+/*
+ * Local functions...
+ */
+
+static char	*sb_find_line(cupsd_statbuf_t *sb);
+static char	*sb_summary(cupsd_statbuf_t *sb, int *loglevel, char *line,
+		            int linelen);
+
+
 /*
  * 'cupsdStatBufDelete()' - Destroy a status buffer.
  */
@@ -39,6 +48,18 @@ cupsdStatBufDelete(cupsd_statbuf_t *sb)	/* I - Status buffer */
 }
 
 
+/*
+ * 'cupsdStatBufHasLine()' - Determine whether a complete line is buffered.
+ */
+
+int					/* O - 1 if a line is buffered, 0 otherwise */
+cupsdStatBufHasLine(
+    cupsd_statbuf_t *sb)		/* I - Status buffer */
+{
+  return (sb_find_line(sb) != NULL);
+}
+
+
 /*
  * 'cupsdStatBufNew()' - Create a new status buffer.
  */
@@ -69,7 +90,10 @@ cupsdStatBufNew(int        fd,		/* I - File descriptor of pipe */
     * Assign the file descriptor...
     */
 
-    sb->fd = fd;
+    sb->fd        = fd;
+    sb->laststate = -1;
+    sb->lastattr  = -1;
+    sb->debugtime = time(NULL);
 
    /*
     * Format the prefix string, if any.  This is usually "[Job 123]"
@@ -102,6 +126,12 @@ cupsdStatBufNew(int        fd,		/* I - File descriptor of pipe */
 
 /*
  * 'cupsdStatBufUpdate()' - Update the status buffer.
+ *
+ * All data available on the pipe is read at once and the buffered lines are
+ * then returned one at a time without further reads.  Repeated STATE: and
+ * ATTR: messages are coalesced and debug messages are limited to
+ * CUPSD_SB_MAX_DEBUG per second, with the number of dropped messages reported
+ * in a periodic summary message.
  */
 
 char *					/* O - Line from buffer, "", or NULL */
@@ -111,207 +141,358 @@ cupsdStatBufUpdate(
     char            *line,		/* I - Line buffer */
     int             linelen)		/* I - Size of line buffer */
 {
-  int		bytes;			/* Number of bytes read */
-  char		*lineptr,		/* Pointer to end of line in buffer */
-		*message;		/* Pointer to message text */
-
-
- /*
-  * Check if the buffer already contains a full line...
-  */
-
-  if ((lineptr = strchr(sb->buffer, '\n')) == NULL)
+  int		bytes,			/* Number of bytes read */
+		skipped = 0;		/* Did we skip any lines? */
+  char		*start,			/* Start of line in buffer */
+		*lineptr,		/* Pointer to end of line in buffer */
+		*next,			/* Start of next line in buffer */
+		*message,		/* Pointer to message text */
+		saved;			/* Character at end of line */
+  int		*last;			/* Last STATE: or ATTR: message */
+  time_t	curtime;		/* Current time */
+
+
+  for (;;)
   {
    /*
-    * No, read more data...
+    * Check if the buffer already contains a full line...
     */
 
-    if ((bytes = read(sb->fd, sb->buffer + sb->bufused, (size_t)(CUPSD_SB_BUFFER_SIZE - sb->bufused - 1))) > 0)
+    if ((lineptr = sb_find_line(sb)) == NULL)
     {
-      sb->bufused += bytes;
-      sb->buffer[sb->bufused] = '\0';
+      if (skipped)
+      {
+       /*
+        * Everything we read has been coalesced or dropped; return an empty
+	* debug line so the caller doesn't see end-of-file...
+	*/
+
+	*loglevel = CUPSD_LOG_DEBUG;
+	line[0]   = '\0';
+
+	return (line);
+      }
 
      /*
-      * Guard against a line longer than the max buffer size...
+      * No, move any partial line to the front of the buffer and read as much
+      * data as is available...
       */
 
-      if ((lineptr = strchr(sb->buffer, '\n')) == NULL &&
-          sb->bufused == (CUPSD_SB_BUFFER_SIZE - 1))
-	lineptr = sb->buffer + sb->bufused;
+      if (sb->bufstart > 0)
+      {
+	memmove(sb->buffer, sb->buffer + sb->bufstart, (size_t)(sb->bufused - sb->bufstart + 1));
+	sb->bufused  -= sb->bufstart;
+	sb->bufstart = 0;
+      }
+
+      sb->laststate = -1;
+      sb->lastattr  = -1;
+
+      if ((bytes = (int)read(sb->fd, sb->buffer + sb->bufused, (size_t)(CUPSD_SB_READ_SIZE - sb->bufused - 1))) > 0)
+      {
+	sb->bufused += bytes;
+	sb->buffer[sb->bufused] = '\0';
+
+	lineptr = sb_find_line(sb);
+      }
+      else if (bytes < 0 && errno == EINTR)
+      {
+       /*
+	* Return an empty line if we are interrupted...
+	*/
+
+	*loglevel = CUPSD_LOG_NONE;
+	line[0]   = '\0';
+
+	return (line);
+      }
+      else
+      {
+       /*
+	* End-of-file, so use the whole buffer...
+	*/
+
+	lineptr  = sb->buffer + sb->bufused;
+	*lineptr = '\0';
+
+       /*
+	* Final check for end-of-file...
+	*/
+
+	if (sb->bufused == 0 && bytes == 0)
+	{
+	  if (sb->dropped || sb->coalesced)
+	    return (sb_summary(sb, loglevel, line, linelen));
+
+	  lineptr = NULL;
+	}
+      }
     }
-    else if (bytes < 0 && errno == EINTR)
+
+    if (!lineptr)
     {
      /*
-      * Return an empty line if we are interrupted...
+      * End of file or no complete line...
       */
 
       *loglevel = CUPSD_LOG_NONE;
       line[0]   = '\0';
 
-      return (line);
+      return (NULL);
+    }
+
+   /*
+    * Terminate the line and process it...
+    */
+
+    start    = sb->buffer + sb->bufstart;
+    saved    = *lineptr;
+    *lineptr = '\0';
+    next     = saved == '\n' ? lineptr + 1 : lineptr;
+
+   /*
+    * Figure out the logging level...
+    */
+
+    if (!strncmp(start, "EMERG:", 6))
+    {
+      *loglevel = CUPSD_LOG_EMERG;
+      message   = start + 6;
+    }
+    else if (!strncmp(start, "ALERT:", 6))
+    {
+      *loglevel = CUPSD_LOG_ALERT;
+      message   = start + 6;
+    }
+    else if (!strncmp(start, "CRIT:", 5))
+    {
+      *loglevel = CUPSD_LOG_CRIT;
+      message   = start + 5;
+    }
+    else if (!strncmp(start, "ERROR:", 6))
+    {
+      *loglevel = CUPSD_LOG_ERROR;
+      message   = start + 6;
+    }
+    else if (!strncmp(start, "WARNING:", 8))
+    {
+      *loglevel = CUPSD_LOG_WARN;
+      message   = start + 8;
+    }
+    else if (!strncmp(start, "NOTICE:", 7))
+    {
+      *loglevel = CUPSD_LOG_NOTICE;
+      message   = start + 7;
+    }
+    else if (!strncmp(start, "INFO:", 5))
+    {
+      *loglevel = CUPSD_LOG_INFO;
+      message   = start + 5;
+    }
+    else if (!strncmp(start, "DEBUG:", 6))
+    {
+      *loglevel = CUPSD_LOG_DEBUG;
+      message   = start + 6;
+    }
+    else if (!strncmp(start, "DEBUG2:", 7))
+    {
+      *loglevel = CUPSD_LOG_DEBUG2;
+      message   = start + 7;
+    }
+    else if (!strncmp(start, "PAGE:", 5))
+    {
+      *loglevel = CUPSD_LOG_PAGE;
+      message   = start + 5;
+    }
+    else if (!strncmp(start, "STATE:", 6))
+    {
+      *loglevel = CUPSD_LOG_STATE;
+      message   = start + 6;
+    }
+    else if (!strncmp(start, "JOBSTATE:", 9))
+    {
+      *loglevel = CUPSD_LOG_JOBSTATE;
+      message   = start + 9;
+    }
+    else if (!strncmp(start, "ATTR:", 5))
+    {
+      *loglevel = CUPSD_LOG_ATTR;
+      message   = start + 5;
+    }
+    else if (!strncmp(start, "PPD:", 4))
+    {
+      *loglevel = CUPSD_LOG_PPD;
+      message   = start + 4;
     }
     else
+    {
+      *loglevel = CUPSD_LOG_DEBUG;
+      message   = start;
+    }
+
+   /*
+    * Skip leading whitespace in the message...
+    */
+
+    while (isspace(*message & 255))
+      message ++;
+
+   /*
+    * Report dropped messages once per second, leaving the current line in the
+    * buffer for the next call...
+    */
+
+    curtime = 0;
+
+    if ((sb->dropped || sb->coalesced) && (curtime = time(NULL)) != sb->debugtime)
+    {
+      *lineptr = saved;
+
+      return (sb_summary(sb, loglevel, line, linelen));
+    }
+
+    if (*loglevel >= CUPSD_LOG_DEBUG)
+    {
+     /*
+      * Limit the number of debug messages per second...
+      */
+
+      if (!curtime)
+        curtime = time(NULL);
+
+      if (curtime != sb->debugtime)
+      {
+        sb->debugtime  = curtime;
+	sb->debugcount = 0;
+      }
+
+      if (sb->debugcount >= CUPSD_SB_MAX_DEBUG)
+      {
+        sb->dropped ++;
+	sb->bufstart = (int)(next - sb->buffer);
+	skipped      = 1;
+	continue;
+      }
+
+      sb->debugcount ++;
+    }
+    else if ((*loglevel == CUPSD_LOG_STATE || *loglevel == CUPSD_LOG_ATTR) && saved == '\n')
     {
      /*
-      * End-of-file, so use the whole buffer...
+      * Coalesce STATE: and ATTR: messages that repeat the previous one...
       */
 
-      lineptr  = sb->buffer + sb->bufused;
-      *lineptr = '\0';
+      last = *loglevel == CUPSD_LOG_STATE ? &sb->laststate : &sb->lastattr;
+
+      if (*last >= 0 && !strcmp(sb->buffer + *last, message))
+      {
+        sb->coalesced ++;
+	sb->bufstart = (int)(next - sb->buffer);
+	skipped      = 1;
+	continue;
+      }
+
+      *last = (int)(message - sb->buffer);
     }
 
    /*
-    * Final check for end-of-file...
+    * Send it to the log file as needed...
     */
 
-    if (sb->bufused == 0 && bytes == 0)
-      lineptr = NULL;
-  }
+    if (sb->prefix[0])
+    {
+      if (*loglevel > CUPSD_LOG_NONE &&
+	  (*loglevel != CUPSD_LOG_INFO || LogLevel >= CUPSD_LOG_DEBUG))
+      {
+       /*
+	* General status message; send it to the error_log file...
+	*/
+
+	if (message[0] == '[')
+	  cupsdLogMessage(*loglevel, "%s", message);
+	else
+	  cupsdLogMessage(*loglevel, "%s %s", sb->prefix, message);
+      }
+      else if (*loglevel < CUPSD_LOG_NONE && LogLevel >= CUPSD_LOG_DEBUG)
+	cupsdLogMessage(CUPSD_LOG_DEBUG2, "%s %s", sb->prefix, start);
+    }
 
-  if (!lineptr)
-  {
    /*
-    * End of file...
+    * Copy the message to the line buffer...
     */
 
-    *loglevel = CUPSD_LOG_NONE;
-    line[0]   = '\0';
-
-    return (NULL);
-  }
+    strlcpy(line, message, (size_t)linelen);
 
- /*
-  * Terminate the line and process it...
-  */
+   /*
+    * Skip over the buffer data we've used up...
+    */
 
-  *lineptr++ = '\0';
+    if (saved != '\n')
+      *lineptr = saved;
 
- /*
-  * Figure out the logging level...
-  */
+    if ((sb->bufstart = (int)(next - sb->buffer)) >= sb->bufused)
+    {
+      sb->bufstart = 0;
+      sb->bufused  = 0;
+    }
 
-  if (!strncmp(sb->buffer, "EMERG:", 6))
-  {
-    *loglevel = CUPSD_LOG_EMERG;
-    message   = sb->buffer + 6;
-  }
-  else if (!strncmp(sb->buffer, "ALERT:", 6))
-  {
-    *loglevel = CUPSD_LOG_ALERT;
-    message   = sb->buffer + 6;
-  }
-  else if (!strncmp(sb->buffer, "CRIT:", 5))
-  {
-    *loglevel = CUPSD_LOG_CRIT;
-    message   = sb->buffer + 5;
-  }
-  else if (!strncmp(sb->buffer, "ERROR:", 6))
-  {
-    *loglevel = CUPSD_LOG_ERROR;
-    message   = sb->buffer + 6;
-  }
-  else if (!strncmp(sb->buffer, "WARNING:", 8))
-  {
-    *loglevel = CUPSD_LOG_WARN;
-    message   = sb->buffer + 8;
-  }
-  else if (!strncmp(sb->buffer, "NOTICE:", 7))
-  {
-    *loglevel = CUPSD_LOG_NOTICE;
-    message   = sb->buffer + 7;
-  }
-  else if (!strncmp(sb->buffer, "INFO:", 5))
-  {
-    *loglevel = CUPSD_LOG_INFO;
-    message   = sb->buffer + 5;
-  }
-  else if (!strncmp(sb->buffer, "DEBUG:", 6))
-  {
-    *loglevel = CUPSD_LOG_DEBUG;
-    message   = sb->buffer + 6;
-  }
-  else if (!strncmp(sb->buffer, "DEBUG2:", 7))
-  {
-    *loglevel = CUPSD_LOG_DEBUG2;
-    message   = sb->buffer + 7;
-  }
-  else if (!strncmp(sb->buffer, "PAGE:", 5))
-  {
-    *loglevel = CUPSD_LOG_PAGE;
-    message   = sb->buffer + 5;
-  }
-  else if (!strncmp(sb->buffer, "STATE:", 6))
-  {
-    *loglevel = CUPSD_LOG_STATE;
-    message   = sb->buffer + 6;
-  }
-  else if (!strncmp(sb->buffer, "JOBSTATE:", 9))
-  {
-    *loglevel = CUPSD_LOG_JOBSTATE;
-    message   = sb->buffer + 9;
-  }
-  else if (!strncmp(sb->buffer, "ATTR:", 5))
-  {
-    *loglevel = CUPSD_LOG_ATTR;
-    message   = sb->buffer + 5;
-  }
-  else if (!strncmp(sb->buffer, "PPD:", 4))
-  {
-    *loglevel = CUPSD_LOG_PPD;
-    message   = sb->buffer + 4;
-  }
-  else
-  {
-    *loglevel = CUPSD_LOG_DEBUG;
-    message   = sb->buffer;
+    return (line);
   }
+}
 
- /*
-  * Skip leading whitespace in the message...
-  */
 
-  while (isspace(*message & 255))
-    message ++;
+/*
+ * 'sb_find_line()' - Find the end of the next line in the buffer.
+ */
+
+static char *				/* O - End of line or NULL if none */
+sb_find_line(cupsd_statbuf_t *sb)	/* I - Status buffer */
+{
+  char	*start,				/* Start of unprocessed data */
+	*lineptr;			/* End of line */
+  int	bytes;				/* Unprocessed bytes */
 
- /*
-  * Send it to the log file as needed...
-  */
 
-  if (sb->prefix[0])
+  start = sb->buffer + sb->bufstart;
+  bytes = sb->bufused - sb->bufstart;
+
+  if (bytes > (CUPSD_SB_BUFFER_SIZE - 1))
+    bytes = CUPSD_SB_BUFFER_SIZE - 1;
+
+  if ((lineptr = memchr(start, '\n', (size_t)bytes)) == NULL && bytes == (CUPSD_SB_BUFFER_SIZE - 1))
   {
-    if (*loglevel > CUPSD_LOG_NONE &&
-	(*loglevel != CUPSD_LOG_INFO || LogLevel >= CUPSD_LOG_DEBUG))
-    {
-     /*
-      * General status message; send it to the error_log file...
-      */
+   /*
+    * Guard against a line longer than the max line size...
+    */
 
-      if (message[0] == '[')
-	cupsdLogMessage(*loglevel, "%s", message);
-      else
-	cupsdLogMessage(*loglevel, "%s %s", sb->prefix, message);
-    }
-    else if (*loglevel < CUPSD_LOG_NONE && LogLevel >= CUPSD_LOG_DEBUG)
-      cupsdLogMessage(CUPSD_LOG_DEBUG2, "%s %s", sb->prefix, sb->buffer);
+    lineptr = start + bytes;
   }
 
- /*
-  * Copy the message to the line buffer...
-  */
+  return (lineptr);
+}
 
-  strlcpy(line, message, (size_t)linelen);
 
- /*
-  * Copy over the buffer data we've used up...
-  */
+/*
+ * 'sb_summary()' - Return a summary of dropped messages.
+ */
+
+static char *				/* O - Summary line */
+sb_summary(cupsd_statbuf_t *sb,		/* I - Status buffer */
+           int             *loglevel,	/* O - Log level */
+           char            *line,	/* I - Line buffer */
+           int             linelen)	/* I - Size of line buffer */
+{
+  *loglevel = CUPSD_LOG_DEBUG;
 
-  if (lineptr < sb->buffer + sb->bufused)
-    _cups_strcpy(sb->buffer, lineptr);
+  snprintf(line, (size_t)linelen, "Dropped %d debug and %d duplicate status messages.", sb->dropped, sb->coalesced);
 
-  sb->bufused -= lineptr - sb->buffer;
+  if (sb->prefix[0])
+    cupsdLogMessage(CUPSD_LOG_DEBUG, "%s %s", sb->prefix, line);
 
-  if (sb->bufused < 0)
-    sb->bufused = 0;
+  sb->debugtime  = time(NULL);
+  sb->debugcount = 0;
+  sb->dropped    = 0;
+  sb->coalesced  = 0;
 
   return (line);
 }
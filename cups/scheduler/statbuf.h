@@ -12,7 +12,9 @@
  * Constants...
  */
 
-#define CUPSD_SB_BUFFER_SIZE	2048	/* Bytes for job status buffer */
+#define CUPSD_SB_BUFFER_SIZE	2048	/* Bytes for job status line */
+#define CUPSD_SB_READ_SIZE	65536	/* Bytes for status pipe buffer */
+#define CUPSD_SB_MAX_DEBUG	1000	/* Max debug messages per second */
 
 
 /*
@@ -23,8 +25,15 @@ typedef struct				/**** Status buffer */
 {
   int	fd;				/* File descriptor to read from */
   char	prefix[64];			/* Prefix for log messages */
-  int	bufused;			/* How much is used in buffer */
-  char	buffer[CUPSD_SB_BUFFER_SIZE];	/* Buffer */
+  int	bufused,			/* How much is used in buffer */
+	bufstart;			/* Start of unprocessed data */
+  int	laststate,			/* Offset of last STATE: message or -1 */
+	lastattr;			/* Offset of last ATTR: message or -1 */
+  time_t debugtime;			/* Time of current debug interval */
+  int	debugcount,			/* Debug messages in current interval */
+	dropped,			/* Number of debug messages dropped */
+	coalesced;			/* Number of duplicate messages dropped */
+  char	buffer[CUPSD_SB_READ_SIZE];	/* Buffer */
 } cupsd_statbuf_t;
 
 
@@ -33,6 +42,7 @@ typedef struct				/**** Status buffer */
  */
 
 extern void		cupsdStatBufDelete(cupsd_statbuf_t *sb);
+extern int		cupsdStatBufHasLine(cupsd_statbuf_t *sb);
 extern cupsd_statbuf_t	*cupsdStatBufNew(int fd, const char *prefix, ...);
 extern char		*cupsdStatBufUpdate(cupsd_statbuf_t *sb, int *loglevel,
 			                    char *line, int linelen);
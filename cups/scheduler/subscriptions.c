@@ -23,6 +23,18 @@
 #endif /* HAVE_DBUS */
 
 
+/*
+ * Local types...
+ */
+
+typedef struct cupsd_buffer_s		/**** Growable output buffer ****/
+{
+  ipp_uchar_t	*data;			/* Buffer */
+  size_t	used,			/* Bytes used */
+		size;			/* Size of buffer */
+} cupsd_buffer_t;
+
+
 /*
  * Local functions...
  */
@@ -31,6 +43,7 @@ static int	cupsd_compare_subscriptions(cupsd_subscription_t *first,
 					    cupsd_subscription_t *second,
 					    void *unused);
 static void	cupsd_delete_event(cupsd_event_t *event);
+static void	cupsd_index_subscriptions(void);
 #ifdef HAVE_DBUS
 static void	cupsd_send_dbus(cupsd_eventmask_t event, cupsd_printer_t *dest,
 				cupsd_job_t *job);
@@ -39,6 +52,22 @@ static void	cupsd_send_notification(cupsd_subscription_t *sub,
 					cupsd_event_t *event);
 static void	cupsd_start_notifier(cupsd_subscription_t *sub);
 static void	cupsd_update_notifier(void);
+static ssize_t	cupsd_write_buffer(cupsd_buffer_t *buffer, ipp_uchar_t *data,
+				   size_t bytes);
+static int	cupsd_write_event(cupsd_subscription_t *sub,
+				  cupsd_event_t *event);
+
+
+/*
+ * Local globals...
+ */
+
+#define CUPSD_EVENT_BITS	21	/* Number of bits in CUPSD_EVENT_ALL */
+
+static cups_array_t	*SubscriptionIndex[CUPSD_EVENT_BITS];
+					/* Subscriptions for each event bit */
+static int		SubscriptionIndexDirty = 1;
+					/* Does the index need to be rebuilt? */
 
 
 /*
@@ -58,6 +87,8 @@ cupsdAddEvent(
   ipp_attribute_t	*attr;		/* Printer/job attribute */
   cupsd_event_t		*temp;		/* New event pointer */
   cupsd_subscription_t	*sub;		/* Current subscription */
+  cups_array_t		*subs;		/* Subscriptions to check */
+  int			bit;		/* Event bit */
 
 
   cupsdLogMessage(CUPSD_LOG_DEBUG2,
@@ -87,14 +118,35 @@ cupsdAddEvent(
     return;
   }
 
+ /*
+  * Only look at the subscriptions that want this event; combined events need
+  * to check all subscriptions...
+  */
+
+  if (SubscriptionIndexDirty)
+    cupsd_index_subscriptions();
+
+  subs = Subscriptions;
+
+  if (event && !(event & (event - 1)))
+  {
+    for (bit = 0; bit < CUPSD_EVENT_BITS; bit ++)
+      if (event == (cupsd_eventmask_t)(1 << bit))
+      {
+        subs = SubscriptionIndex[bit];
+        break;
+      }
+  }
+
  /*
   * Then loop through the subscriptions and add the event to the corresponding
-  * caches...
+  * caches.  The event is created once and shared by all of the subscriptions;
+  * the per-subscription attributes are added when the event is delivered...
   */
 
-  for (temp = NULL, sub = (cupsd_subscription_t *)cupsArrayFirst(Subscriptions);
+  for (temp = NULL, sub = (cupsd_subscription_t *)cupsArrayFirst(subs);
        sub;
-       sub = (cupsd_subscription_t *)cupsArrayNext(Subscriptions))
+       sub = (cupsd_subscription_t *)cupsArrayNext(subs))
   {
    /*
     * Check if this subscription requires this event...
@@ -102,133 +154,116 @@ cupsdAddEvent(
 
     if ((sub->mask & event) != 0 && (sub->dest == dest || !sub->dest || sub->job == job))
     {
-     /*
-      * Need this event, so create a new event record...
-      */
-
-      if ((temp = (cupsd_event_t *)calloc(1, sizeof(cupsd_event_t))) == NULL)
+      if (!temp)
       {
-	cupsdLogMessage(CUPSD_LOG_CRIT,
-			"Unable to allocate memory for event - %s",
-			strerror(errno));
-	return;
-      }
-
-      temp->event = event;
-      temp->time  = time(NULL);
-      temp->attrs = ippNew();
-      temp->job	  = job;
-
-      if (dest)
-	temp->dest = dest;
-      else if (job)
-	temp->dest = dest = cupsdFindPrinter(job->dest);
-
-     /*
-      * Add common event notification attributes...
-      */
-
-      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_CHARSET,
-		   "notify-charset", NULL, "utf-8");
-
-      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_LANGUAGE,
-		   "notify-natural-language", NULL, "en-US");
-
-      ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
-		    "notify-subscription-id", sub->id);
-
-      ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
-		    "notify-sequence-number", sub->next_event_id);
-
-      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD,
-		   "notify-subscribed-event", NULL, cupsdEventName(event));
-
-      if (sub->user_data_len > 0)
-	ippAddOctetString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION,
-			  "notify-user-data", sub->user_data,
-			  sub->user_data_len);
+       /*
+	* Need this event, so create a new event record...
+	*/
 
-      ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
-		    "printer-up-time", time(NULL));
+	if ((temp = (cupsd_event_t *)calloc(1, sizeof(cupsd_event_t))) == NULL)
+	{
+	  cupsdLogMessage(CUPSD_LOG_CRIT,
+			  "Unable to allocate memory for event - %s",
+			  strerror(errno));
+	  return;
+	}
 
-      va_start(ap, text);
-      vsnprintf(ftext, sizeof(ftext), text, ap);
-      va_end(ap);
+	temp->event = event;
+	temp->time  = time(NULL);
+	temp->attrs = ippNew();
+	temp->job   = job;
 
-      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_TEXT,
-		   "notify-text", NULL, ftext);
+	if (dest)
+	  temp->dest = dest;
+	else if (job)
+	  temp->dest = dest = cupsdFindPrinter(job->dest);
 
-      if (dest)
-      {
        /*
-	* Add printer attributes...
+	* Add common event notification attributes...
 	*/
 
-	ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_URI, "notify-printer-uri", NULL, dest->uri);
+	ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
+		      "printer-up-time", time(NULL));
 
-	ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_NAME, "printer-name", NULL, dest->name);
+	va_start(ap, text);
+	vsnprintf(ftext, sizeof(ftext), text, ap);
+	va_end(ap);
 
-	ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_ENUM, "printer-state", (int)dest->state);
+	ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_TEXT,
+		     "notify-text", NULL, ftext);
 
-	if (dest->num_reasons == 0)
-	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "printer-state-reasons", NULL, dest->state == IPP_PRINTER_STOPPED ? "paused" : "none");
-	else
-	  ippAddStrings(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "printer-state-reasons", dest->num_reasons, NULL, (const char * const *)dest->reasons);
+	if (dest)
+	{
+	 /*
+	  * Add printer attributes...
+	  */
 
-	ippAddBoolean(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, "printer-is-accepting-jobs", (char)dest->accepting);
-      }
+	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_URI, "notify-printer-uri", NULL, dest->uri);
 
-      if (job)
-      {
-       /*
-	* Add job attributes...
-	*/
+	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_NAME, "printer-name", NULL, dest->name);
 
-	ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "notify-job-id", job->id);
-	ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_ENUM, "job-state", (int)job->state_value);
+	  ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_ENUM, "printer-state", (int)dest->state);
 
-	if ((attr = ippFindAttribute(job->attrs, "job-name", IPP_TAG_NAME)) != NULL)
-	  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_NAME, "job-name", NULL, attr->values[0].string.text);
+	  if (dest->num_reasons == 0)
+	    ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "printer-state-reasons", NULL, dest->state == IPP_PRINTER_STOPPED ? "paused" : "none");
+	  else
+	    ippAddStrings(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "printer-state-reasons", dest->num_reasons, NULL, (const char * const *)dest->reasons);
 
-	switch (job->state_value)
-	{
-	  case IPP_JOB_PENDING :
-	      if (dest && dest->state == IPP_PRINTER_STOPPED)
-		ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "printer-stopped");
-	      else
-		ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "none");
-	      break;
+	  ippAddBoolean(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, "printer-is-accepting-jobs", (char)dest->accepting);
+	}
 
-	  case IPP_JOB_HELD :
-	      if (ippFindAttribute(job->attrs, "job-hold-until", IPP_TAG_KEYWORD) != NULL ||
-		  ippFindAttribute(job->attrs, "job-hold-until", IPP_TAG_NAME) != NULL)
-		ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-hold-until-specified");
-	      else
-		ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-incoming");
-	      break;
+	if (job)
+	{
+	 /*
+	  * Add job attributes...
+	  */
 
-	  case IPP_JOB_PROCESSING :
-	      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-printing");
-	      break;
+	  ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "notify-job-id", job->id);
+	  ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_ENUM, "job-state", (int)job->state_value);
 
-	  case IPP_JOB_STOPPED :
-	      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-stopped");
-	      break;
+	  if ((attr = ippFindAttribute(job->attrs, "job-name", IPP_TAG_NAME)) != NULL)
+	    ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_NAME, "job-name", NULL, attr->values[0].string.text);
 
-	  case IPP_JOB_CANCELED :
-	      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-canceled-by-user");
-	      break;
-
-	  case IPP_JOB_ABORTED :
-	      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "aborted-by-system");
-	      break;
+	  switch (job->state_value)
+	  {
+	    case IPP_JOB_PENDING :
+		if (dest && dest->state == IPP_PRINTER_STOPPED)
+		  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "printer-stopped");
+		else
+		  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "none");
+		break;
+
+	    case IPP_JOB_HELD :
+		if (ippFindAttribute(job->attrs, "job-hold-until", IPP_TAG_KEYWORD) != NULL ||
+		    ippFindAttribute(job->attrs, "job-hold-until", IPP_TAG_NAME) != NULL)
+		  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-hold-until-specified");
+		else
+		  ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-incoming");
+		break;
+
+	    case IPP_JOB_PROCESSING :
+		ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-printing");
+		break;
+
+	    case IPP_JOB_STOPPED :
+		ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-stopped");
+		break;
+
+	    case IPP_JOB_CANCELED :
+		ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-canceled-by-user");
+		break;
+
+	    case IPP_JOB_ABORTED :
+		ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "aborted-by-system");
+		break;
+
+	    case IPP_JOB_COMPLETED :
+		ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-completed-successfully");
+		break;
+	  }
 
-	  case IPP_JOB_COMPLETED :
-	      ippAddString(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD, "job-state-reasons", NULL, "job-completed-successfully");
-	      break;
+	  ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "job-impressions-completed", job->sheets ? job->sheets->values[0].integer : 0);
 	}
-
-	ippAddInteger(temp->attrs, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER, "job-impressions-completed", job->sheets ? job->sheets->values[0].integer : 0);
       }
 
      /*
@@ -240,12 +275,58 @@ cupsdAddEvent(
   }
 
   if (temp)
+  {
+    if (!temp->refs)
+    {
+     /*
+      * No subscription was able to cache the event...
+      */
+
+      temp->refs = 1;
+      cupsd_delete_event(temp);
+    }
+
     cupsdMarkDirty(CUPSD_DIRTY_SUBSCRIPTIONS);
+  }
   else
     cupsdLogMessage(CUPSD_LOG_DEBUG, "Discarding unused %s event...", cupsdEventName(event));
 }
 
 
+/*
+ * 'cupsdAddNotificationAttrs()' - Add the per-subscription notification
+ *                                 attributes for an event.
+ */
+
+void
+cupsdAddNotificationAttrs(
+    ipp_t                *ipp,		/* I - Message */
+    cupsd_subscription_t *sub,		/* I - Subscription */
+    cupsd_event_t        *event,	/* I - Event */
+    int                  sequence)	/* I - notify-sequence-number */
+{
+  ippAddString(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_CHARSET,
+	       "notify-charset", NULL, "utf-8");
+
+  ippAddString(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_LANGUAGE,
+	       "notify-natural-language", NULL, "en-US");
+
+  ippAddInteger(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
+		"notify-subscription-id", sub->id);
+
+  ippAddInteger(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_INTEGER,
+		"notify-sequence-number", sequence);
+
+  ippAddString(ipp, IPP_TAG_EVENT_NOTIFICATION, IPP_TAG_KEYWORD,
+	       "notify-subscribed-event", NULL, cupsdEventName(event->event));
+
+  if (sub->user_data_len > 0)
+    ippAddOctetString(ipp, IPP_TAG_EVENT_NOTIFICATION,
+		      "notify-user-data", sub->user_data,
+		      sub->user_data_len);
+}
+
+
 /*
  * 'cupsdAddSubscription()' - Add a new subscription object.
  */
@@ -379,6 +460,8 @@ cupsdAddSubscription(
 
   cupsArrayAdd(Subscriptions, temp);
 
+  SubscriptionIndexDirty = 1;
+
  /*
   * For RSS subscriptions, run the notifier immediately...
   */
@@ -410,6 +493,8 @@ cupsdDeleteAllSubscriptions(void)
 
   cupsArrayDelete(Subscriptions);
   Subscriptions = NULL;
+
+  SubscriptionIndexDirty = 1;
 }
 
 
@@ -435,6 +520,8 @@ cupsdDeleteSubscription(
 
   cupsArrayRemove(Subscriptions, sub);
 
+  SubscriptionIndexDirty = 1;
+
  /*
   * Free memory...
   */
@@ -776,6 +863,8 @@ cupsdLoadAllSubscriptions(void)
 	* See if the name exists...
 	*/
 
+	SubscriptionIndexDirty = 1;
+
 	if ((sub->mask |= cupsdEventValue(value)) == CUPSD_EVENT_NONE)
 	{
 	  cupsdLogMessage(CUPSD_LOG_ERROR,
@@ -1214,7 +1303,7 @@ cupsd_compare_subscriptions(
 
 
 /*
- * 'cupsd_delete_event()' - Delete a single event...
+ * 'cupsd_delete_event()' - Release a reference to a single event...
  *
  * Oldest events must be deleted first, otherwise the subscription cache
  * flushing code will not work properly.
@@ -1224,14 +1313,54 @@ static void
 cupsd_delete_event(cupsd_event_t *event)/* I - Event to delete */
 {
  /*
-  * Free memory...
+  * Only free memory once the last subscription lets go of the event...
   */
 
+  if (-- event->refs > 0)
+    return;
+
   ippDelete(event->attrs);
+  free(event->data);
   free(event);
 }
 
 
+/*
+ * 'cupsd_index_subscriptions()' - Rebuild the per-event subscription lists.
+ */
+
+static void
+cupsd_index_subscriptions(void)
+{
+  int			bit;		/* Current event bit */
+  cupsd_subscription_t	*sub;		/* Current subscription */
+
+
+  for (bit = 0; bit < CUPSD_EVENT_BITS; bit ++)
+  {
+    if (SubscriptionIndex[bit])
+      cupsArrayClear(SubscriptionIndex[bit]);
+    else
+      SubscriptionIndex[bit] = cupsArrayNew(NULL, NULL);
+  }
+
+ /*
+  * Subscriptions are sorted by ID, so each list stays in the same order...
+  */
+
+  for (sub = (cupsd_subscription_t *)cupsArrayFirst(Subscriptions);
+       sub;
+       sub = (cupsd_subscription_t *)cupsArrayNext(Subscriptions))
+  {
+    for (bit = 0; bit < CUPSD_EVENT_BITS; bit ++)
+      if (sub->mask & (1 << bit))
+	cupsArrayAdd(SubscriptionIndex[bit], sub);
+  }
+
+  SubscriptionIndexDirty = 0;
+}
+
+
 #ifdef HAVE_DBUS
 /*
  * 'cupsd_send_dbus()' - Send a DBUS notification...
@@ -1321,9 +1450,6 @@ cupsd_send_notification(
     cupsd_subscription_t *sub,		/* I - Subscription object */
     cupsd_event_t	 *event)	/* I - Event to send */
 {
-  ipp_state_t	state;			/* IPP event state */
-
-
   cupsdLogMessage(CUPSD_LOG_DEBUG2,
 		  "cupsd_send_notification(sub=%p(%d), event=%p(%s))",
 		  sub, sub->id, event, cupsdEventName(event->event));
@@ -1371,6 +1497,7 @@ cupsd_send_notification(
   */
 
   cupsArrayAdd(sub->events, event);
+  event->refs ++;
 
  /*
   * Deliver the event...
@@ -1388,13 +1515,7 @@ cupsd_send_notification(
       if (sub->pipe < 0)
 	break;
 
-      event->attrs->state = IPP_IDLE;
-
-      while ((state = ippWriteFile(sub->pipe, event->attrs)) != IPP_DATA)
-	if (state == IPP_ERROR)
-	  break;
-
-      if (state == IPP_ERROR)
+      if (cupsd_write_event(sub, event))
       {
 	if (errno == EPIPE)
 	{
@@ -1574,7 +1695,157 @@ cupsd_update_notifier(void)
     if (loglevel == CUPSD_LOG_INFO)
       cupsdLogMessage(CUPSD_LOG_INFO, "%s", message);
 
-    if (!strchr(NotifierStatusBuffer->buffer, '\n'))
+    if (!cupsdStatBufHasLine(NotifierStatusBuffer))
       break;
   }
 }
+
+
+/*
+ * 'cupsd_write_buffer()' - Append IPP data to an output buffer.
+ */
+
+static ssize_t				/* O - Number of bytes written or -1 */
+cupsd_write_buffer(
+    cupsd_buffer_t *buffer,		/* I - Output buffer */
+    ipp_uchar_t    *data,		/* I - Data to write */
+    size_t         bytes)		/* I - Number of bytes to write */
+{
+  if (buffer->used + bytes > buffer->size)
+  {
+    size_t	size;			/* New size of buffer */
+    ipp_uchar_t	*temp;			/* New buffer */
+
+    for (size = buffer->size ? buffer->size : 1024;
+         size < buffer->used + bytes;
+	 size *= 2);
+
+    if ((temp = realloc(buffer->data, size)) == NULL)
+      return (-1);
+
+    buffer->data = temp;
+    buffer->size = size;
+  }
+
+  memcpy(buffer->data + buffer->used, data, bytes);
+  buffer->used += bytes;
+
+  return ((ssize_t)bytes);
+}
+
+
+/*
+ * 'cupsd_write_event()' - Write an event to a subscription's notifier.
+ *
+ * The shared event attributes are encoded once and reused for every notifier;
+ * only the per-subscription attributes are encoded for each write.
+ */
+
+static int				/* O - 0 on success, -1 on error */
+cupsd_write_event(
+    cupsd_subscription_t *sub,		/* I - Subscription object */
+    cupsd_event_t        *event)	/* I - Event to send */
+{
+  ipp_t			*ipp;		/* Per-subscription attributes */
+  ipp_state_t		state;		/* IPP write state */
+  cupsd_buffer_t	buffer;		/* Output buffer */
+  ipp_uchar_t		*ptr,		/* Pointer into buffer */
+			end = IPP_TAG_END;
+					/* End of attributes tag */
+  size_t		bytes;		/* Bytes left to write */
+  ssize_t		written;	/* Bytes written */
+
+
+  memset(&buffer, 0, sizeof(buffer));
+
+  if (!event->data)
+  {
+   /*
+    * Encode the shared attributes, then strip the message header, group tag,
+    * and end tag so they can follow the per-subscription attributes...
+    */
+
+    event->attrs->state = IPP_IDLE;
+
+    while ((state = ippWriteIO(&buffer, (ipp_iocb_t)cupsd_write_buffer, 1,
+                               NULL, event->attrs)) != IPP_DATA)
+      if (state == IPP_ERROR)
+	break;
+
+    if (state == IPP_ERROR || buffer.used < 10)
+    {
+      free(buffer.data);
+      errno = ENOMEM;
+      return (-1);
+    }
+
+    event->datalen = buffer.used - 10;
+    memmove(buffer.data, buffer.data + 9, event->datalen);
+    event->data = buffer.data;
+
+    memset(&buffer, 0, sizeof(buffer));
+  }
+
+ /*
+  * Encode the per-subscription attributes without the end tag and append the
+  * shared attributes...
+  */
+
+  if ((ipp = ippNew()) == NULL)
+  {
+    errno = ENOMEM;
+    return (-1);
+  }
+
+  cupsdAddNotificationAttrs(ipp, sub, event, sub->next_event_id);
+
+  while ((state = ippWriteIO(&buffer, (ipp_iocb_t)cupsd_write_buffer, 1,
+                             NULL, ipp)) != IPP_DATA)
+    if (state == IPP_ERROR)
+      break;
+
+  ippDelete(ipp);
+
+  if (state == IPP_ERROR || buffer.used < 1)
+  {
+    free(buffer.data);
+    errno = ENOMEM;
+    return (-1);
+  }
+
+  buffer.used --;
+
+  if (cupsd_write_buffer(&buffer, event->data, event->datalen) < 0 ||
+      cupsd_write_buffer(&buffer, &end, 1) < 0)
+  {
+    free(buffer.data);
+    errno = ENOMEM;
+    return (-1);
+  }
+
+ /*
+  * Write the message to the notifier...
+  */
+
+  for (ptr = buffer.data, bytes = buffer.used; bytes > 0; ptr += written, bytes -= (size_t)written)
+  {
+    if ((written = write(sub->pipe, ptr, bytes)) < 0)
+    {
+      int error = errno;		/* Write error */
+
+      if (error == EINTR)
+      {
+        written = 0;
+	continue;
+      }
+
+      free(buffer.data);
+      errno = error;
+      return (-1);
+    }
+  }
+
+  free(buffer.data);
+
+  return (0);
+}
@@ -71,9 +71,13 @@ typedef struct cupsd_event_s		/**** Event structure ****/
 {
   cupsd_eventmask_t	event;		/* Event */
   time_t		time;		/* Time of event */
-  ipp_t			*attrs;		/* Notification message */
+  ipp_t			*attrs;		/* Notification attributes shared by all
+					 * subscriptions */
   cupsd_printer_t	*dest;		/* Associated printer, if any */
   cupsd_job_t		*job;		/* Associated job, if any */
+  int			refs;		/* Number of subscriptions using event */
+  ipp_uchar_t		*data;		/* Encoded attributes for notifiers */
+  size_t		datalen;	/* Length of encoded attributes */
 } cupsd_event_t;
 
 typedef struct cupsd_subscription_s	/**** Subscription structure ****/
@@ -135,6 +139,9 @@ VAR cupsd_statbuf_t *NotifierStatusBuffer VALUE(NULL);
 
 extern void	cupsdAddEvent(cupsd_eventmask_t event, cupsd_printer_t *dest,
 		              cupsd_job_t *job, const char *text, ...);
+extern void	cupsdAddNotificationAttrs(ipp_t *ipp,
+		                          cupsd_subscription_t *sub,
+					  cupsd_event_t *event, int sequence);
 extern cupsd_subscription_t *
 		cupsdAddSubscription(unsigned mask, cupsd_printer_t *dest,
 		                     cupsd_job_t *job, const char *uri,
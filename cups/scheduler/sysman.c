@@ -55,7 +55,7 @@ cupsdCleanDirty(void)
   {
     cupsd_job_t	*job;			/* Current job */
 
-    cupsdSaveAllJobs();
+    cupsdUpdateJobCache();
 
     for (job = (cupsd_job_t *)cupsArrayFirst(Jobs);
          job;
@@ -955,6 +955,8 @@ sysUpdate(void)
               job->cancel_time = time(NULL) + ippGetInteger(cancel_after, 0);
             else
               job->cancel_time = time(NULL) + MaxJobTime;
+
+            cupsdUpdateJobTimer(job);
           }
         }
       }
@@ -48,7 +48,8 @@ main(int  argc,				/* I - Number of command-line arguments */
   const char	*events[100];		/* Events */
   int		subscription_id,	/* notify-subscription-id */
 		sequence_number,	/* notify-sequence-number */
-		interval;		/* Interval between polls */
+		interval,		/* Interval between polls */
+		wait;			/* Wait for events? */
   http_t	*http;			/* HTTP connection */
   ipp_t		*request,		/* IPP request */
 		*response;		/* IPP response */
@@ -64,6 +65,7 @@ main(int  argc,				/* I - Number of command-line arguments */
 
   num_events = 0;
   uri        = NULL;
+  wait       = 0;
 
   for (i = 1; i < argc; i ++)
     if (!strcmp(argv[i], "-E"))
@@ -85,6 +87,8 @@ main(int  argc,				/* I - Number of command-line arguments */
 
       cupsSetServer(argv[i]);
     }
+    else if (!strcmp(argv[i], "-w"))
+      wait = 1;
     else if (uri || strncmp(argv[i], "ipp://", 6))
       usage();
     else
@@ -210,6 +214,8 @@ main(int  argc,				/* I - Number of command-line arguments */
     if (sequence_number)
       ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER,
                     "notify-sequence-numbers", sequence_number + 1);
+    if (wait)
+      ippAddBoolean(request, IPP_TAG_OPERATION, "notify-wait", 1);
 
     response = cupsDoRequest(http, request, uri);
 
@@ -234,11 +240,15 @@ main(int  argc,				/* I - Number of command-line arguments */
                                  IPP_TAG_INTEGER)) != NULL &&
         attr->values[0].integer > 0)
       interval = attr->values[0].integer;
+    else if (wait && cupsLastError() == IPP_OK)
+      interval = 0;
     else
       interval = 5;
 
     ippDelete(response);
-    sleep((unsigned)interval);
+
+    if (interval > 0)
+      sleep((unsigned)interval);
   }
 
  /*
@@ -492,6 +502,6 @@ sigterm_handler(int sig)		/* I - Signal number (unused) */
 static void
 usage(void)
 {
-  puts("Usage: testsub [-E] [-e event ... -e eventN] [-h hostname] URI");
+  puts("Usage: testsub [-E] [-e event ... -e eventN] [-h hostname] [-w] URI");
   exit(0);
 }
@@ -34,7 +34,8 @@ typedef struct _mime_filebuf_s		/**** File buffer for MIME typing ****/
   cups_file_t	*fp;			/* File pointer */
   int		offset,			/* Offset in file */
 		length;			/* Length of buffered data */
-  unsigned char	buffer[MIME_MAX_BUFFER];/* Buffered data */
+  unsigned char	buffer[MIME_MAX_BUFFER + 1];
+					/* Buffered data plus nul */
 } _mime_filebuf_t;
 
 
@@ -42,6 +43,7 @@ typedef struct _mime_filebuf_s		/**** File buffer for MIME typing ****/
  * Local functions...
  */
 
+static int	mime_compare_priority(mime_type_t *t0, mime_type_t *t1);
 static int	mime_compare_types(mime_type_t *t0, mime_type_t *t1);
 static int	mime_check_rules(const char *filename, _mime_filebuf_t *fb,
 		                 mime_magic_t *rules);
@@ -99,6 +101,18 @@ mimeAddType(mime_t     *mime,		/* I - MIME database */
     return (NULL);
   }
 
+ /*
+  * Adding a type or rules to an existing type invalidates the detection order
+  * used by mimeFileType()...
+  */
+
+  if (mime->ftypes)
+  {
+    DEBUG_puts("1mimeAddType: Deleting type detection cache.");
+    cupsArrayDelete(mime->ftypes);
+    mime->ftypes = NULL;
+  }
+
  /*
   * See if the type already exists; if so, return the existing type...
   */
@@ -607,6 +621,19 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
     return (NULL);
   }
 
+ /*
+  * (Re)build the detection order as needed...
+  */
+
+  if (!mime->ftypes)
+  {
+    mime->ftypes = cupsArrayNew((cups_array_func_t)mime_compare_priority, NULL);
+
+    for (type = mimeFirstType(mime); type; type = mimeNextType(mime))
+      if (type->rules)
+        cupsArrayAdd(mime->ftypes, type);
+  }
+
  /*
   * Try to open the file...
   */
@@ -657,13 +684,18 @@ mimeFileType(mime_t     *mime,		/* I - MIME database */
   * Then check it against all known types...
   */
 
-  for (type = (mime_type_t *)cupsArrayFirst(mime->types), best = NULL;
+  for (type = (mime_type_t *)cupsArrayFirst(mime->ftypes), best = NULL;
        type;
-       type = (mime_type_t *)cupsArrayNext(mime->types))
+       type = (mime_type_t *)cupsArrayNext(mime->ftypes))
     if (mime_check_rules(base, &fb, type->rules))
     {
-      if (!best || type->priority > best->priority)
-        best = type;
+     /*
+      * Types are checked from highest to lowest priority, so the first match
+      * is the best match...
+      */
+
+      best = type;
+      break;
     }
 
  /*
@@ -723,6 +755,21 @@ mimeType(mime_t     *mime,		/* I - MIME database */
 }
 
 
+/*
+ * 'mime_compare_priority()' - Compare two MIME types by priority and name.
+ */
+
+static int				/* O - Result of comparison */
+mime_compare_priority(mime_type_t *t0,	/* I - First type */
+                      mime_type_t *t1)	/* I - Second type */
+{
+  if (t0->priority != t1->priority)
+    return (t1->priority - t0->priority);
+  else
+    return (mime_compare_types(t0, t1));
+}
+
+
 /*
  * 'mime_compare_types()' - Compare two MIME super/type names.
  */
@@ -799,7 +846,7 @@ mime_check_rules(
 
             cupsFileSeek(fb->fp, rules->offset);
 	    fb->length = cupsFileRead(fb->fp, (char *)fb->buffer,
-	                              sizeof(fb->buffer));
+	                              MIME_MAX_BUFFER);
 	    fb->offset = rules->offset;
 
 	    DEBUG_printf(("4mime_check_rules: MIME_MAGIC_ASCII fb->length=%d", fb->length));
@@ -843,7 +890,7 @@ mime_check_rules(
 
             cupsFileSeek(fb->fp, rules->offset);
 	    fb->length = cupsFileRead(fb->fp, (char *)fb->buffer,
-	                              sizeof(fb->buffer));
+	                              MIME_MAX_BUFFER);
 	    fb->offset = rules->offset;
 
 	    DEBUG_printf(("4mime_check_rules: MIME_MAGIC_PRINTABLE fb->length=%d", fb->length));
@@ -892,7 +939,7 @@ mime_check_rules(
 
             cupsFileSeek(fb->fp, rules->offset);
 	    fb->length = cupsFileRead(fb->fp, (char *)fb->buffer,
-	                              sizeof(fb->buffer));
+	                              MIME_MAX_BUFFER);
 	    fb->offset = rules->offset;
 
 	    DEBUG_printf(("4mime_check_rules: MIME_MAGIC_REGEX fb->length=%d", fb->length));
@@ -910,12 +957,8 @@ mime_check_rules(
 
           if (fb->length > 0)
           {
-            char temp[MIME_MAX_BUFFER + 1];
-					/* Temporary buffer */
-
-            memcpy(temp, fb->buffer, (size_t)fb->length);
-            temp[fb->length] = '\0';
-            result = !regexec(&(rules->value.rev), temp, 0, NULL, 0);
+            fb->buffer[fb->length] = '\0';
+            result = !regexec(&(rules->value.rev), (char *)fb->buffer, 0, NULL, 0);
           }
 
           DEBUG_printf(("5mime_check_rules: result=%d", result));
@@ -938,7 +981,7 @@ mime_check_rules(
 
             cupsFileSeek(fb->fp, rules->offset);
 	    fb->length = cupsFileRead(fb->fp, (char *)fb->buffer,
-	                              sizeof(fb->buffer));
+	                              MIME_MAX_BUFFER);
 	    fb->offset = rules->offset;
 
 	    DEBUG_printf(("4mime_check_rules: MIME_MAGIC_STRING fb->length=%d", fb->length));
@@ -975,7 +1018,7 @@ mime_check_rules(
 
             cupsFileSeek(fb->fp, rules->offset);
 	    fb->length = cupsFileRead(fb->fp, (char *)fb->buffer,
-	                              sizeof(fb->buffer));
+	                              MIME_MAX_BUFFER);
 	    fb->offset = rules->offset;
 
 	    DEBUG_printf(("4mime_check_rules: MIME_MAGIC_ISTRING fb->length=%d", fb->length));
@@ -1005,7 +1048,7 @@ mime_check_rules(
 
             cupsFileSeek(fb->fp, rules->offset);
 	    fb->length = cupsFileRead(fb->fp, (char *)fb->buffer,
-	                              sizeof(fb->buffer));
+	                              MIME_MAX_BUFFER);
 	    fb->offset = rules->offset;
 
 	    DEBUG_printf(("4mime_check_rules: MIME_MAGIC_CHAR fb->length=%d", fb->length));
@@ -1037,7 +1080,7 @@ mime_check_rules(
 
             cupsFileSeek(fb->fp, rules->offset);
 	    fb->length = cupsFileRead(fb->fp, (char *)fb->buffer,
-	                              sizeof(fb->buffer));
+	                              MIME_MAX_BUFFER);
 	    fb->offset = rules->offset;
 
 	    DEBUG_printf(("4mime_check_rules: MIME_MAGIC_SHORT fb->length=%d", fb->length));
@@ -1072,7 +1115,7 @@ mime_check_rules(
 
             cupsFileSeek(fb->fp, rules->offset);
 	    fb->length = cupsFileRead(fb->fp, (char *)fb->buffer,
-	                              sizeof(fb->buffer));
+	                              MIME_MAX_BUFFER);
 	    fb->offset = rules->offset;
 
 	    DEBUG_printf(("4mime_check_rules: MIME_MAGIC_INT fb->length=%d", fb->length));
@@ -1115,7 +1158,7 @@ mime_check_rules(
 
             cupsFileSeek(fb->fp, rules->offset);
 	    fb->length = cupsFileRead(fb->fp, (char *)fb->buffer,
-	                              sizeof(fb->buffer));
+	                              MIME_MAX_BUFFER);
 	    fb->offset = rules->offset;
 
 	    DEBUG_printf(("4mime_check_rules: MIME_MAGIC_CONTAINS fb->length=%d", fb->length));
@@ -5894,7 +5894,7 @@ process_http(ippeve_client_t *client)	/* I - Client connection */
         * Read the IPP request...
 	*/
 
-	client->request = ippNew();
+	client->request = _ippNewArena();
 
         while ((ipp_state = ippRead(client->http,
                                     client->request)) != IPP_STATE_DATA)